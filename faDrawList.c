@@ -0,0 +1,391 @@
+/**
+ * @file
+ * @author Frank Abelbeck <frank.abelbeck@googlemail.com>
+ * @version 2026-10-14
+ * 
+ * @section License
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * @section Description
+ * 
+ * Band renderer for the card10 badge.
+ */
+
+#include <stddef.h> // uses: NULL
+#include "faDrawList.h"
+#include "faFramebuffer.h" // uses: framebufferUpdateFromBand()
+#include "faMemory.h" // uses: memoryAlloc(), memoryFree()
+
+//------------------------------------------------------------------------------
+// constructor and destructor functions
+//------------------------------------------------------------------------------
+
+// DrawList constructor: allocate command array, band surface and scratch mask
+DrawList *drawListConstruct(uint16_t maxCommands, uint16_t colour) {
+	DrawList *list = (DrawList*)memoryAlloc(sizeof(DrawList));
+	if (list == NULL) return NULL;
+	list->nCommands = 0;
+	list->maxCommands = maxCommands;
+	list->colour = colour;
+	list->commands = (DrawCommand*)memoryAlloc(maxCommands * sizeof(DrawCommand));
+	list->band = surfaceSetupOpaque(DISP_WIDTH,DRAWLIST_BAND_HEIGHT);
+	list->scratch = surfaceModConstruct(DRAWLIST_BAND_HEIGHT);
+	if ((list->commands == NULL && maxCommands > 0) || list->band == NULL || list->scratch == NULL) {
+		drawListDestruct(&list);
+		return NULL;
+	}
+	// modifications are derived from command footprints: primitives need not compare pixels
+	list->band->flags |= SURFACE_FLAG_NOTRACK;
+	return list;
+}
+
+// DrawList destructor: free everything owned by the list
+void drawListDestruct(DrawList **list) {
+	memoryFree((*list)->commands);
+	if ((*list)->band != NULL) surfaceDestruct(&(*list)->band);
+	if ((*list)->scratch != NULL) surfaceModDestruct(&(*list)->scratch);
+	memoryFree(*list);
+	*list = NULL;
+}
+
+void drawListClear(DrawList *list) {
+	if (list != NULL) list->nCommands = 0;
+}
+
+//------------------------------------------------------------------------------
+// recording functions
+//------------------------------------------------------------------------------
+
+// internal helper function: append a command of given type; NULL if the list is full
+static DrawCommand *drawListAdd(DrawList *list, uint8_t type) {
+	if (list->nCommands >= list->maxCommands) return NULL;
+	DrawCommand *command = &list->commands[list->nCommands++];
+	command->type = type;
+	command->surface = NULL;
+	command->font = NULL;
+	command->layout = NULL;
+	return command;
+}
+
+// internal helper function: append a primitive with given points;
+// the footprint is the box enclosing all points
+static int8_t drawListAddPrimitive(DrawList *list, uint8_t type, Point *p, uint8_t n, uint16_t colour, uint8_t alpha, uint8_t mode) {
+	if (list == NULL) return RET_DRAWLIST_ARGS;
+	DrawCommand *command = drawListAdd(list,type);
+	if (command == NULL) return RET_DRAWLIST_FULL;
+	command->colour = colour;
+	command->alpha = alpha;
+	command->mode = mode;
+	command->footprint = boundingBoxCreate(p[0].x,p[0].y,p[0].x,p[0].y);
+	for (uint8_t i = 0; i < n; i++) {
+		command->p[i] = p[i];
+		if (p[i].x < command->footprint.min.x) command->footprint.min.x = p[i].x;
+		if (p[i].y < command->footprint.min.y) command->footprint.min.y = p[i].y;
+		if (p[i].x > command->footprint.max.x) command->footprint.max.x = p[i].x;
+		if (p[i].y > command->footprint.max.y) command->footprint.max.y = p[i].y;
+	}
+	return RET_DRAWLIST_OK;
+}
+
+// internal helper function: append a circular primitive; the footprint is the
+// box enclosing the full outer circle
+static int8_t drawListAddCircular(DrawList *list, uint8_t type, Point pm, uint16_t radiusOuter, uint16_t radiusInner, int16_t angleStart, int16_t angleStop, uint16_t colour, uint8_t alpha, uint8_t mode) {
+	int8_t retval = drawListAddPrimitive(list,type,&pm,1,colour,alpha,mode);
+	if (retval != RET_DRAWLIST_OK) return retval;
+	DrawCommand *command = &list->commands[list->nCommands - 1];
+	command->radius[0] = radiusOuter;
+	command->radius[1] = radiusInner;
+	command->angle[0] = angleStart;
+	command->angle[1] = angleStop;
+	command->footprint = boundingBoxCreate(pm.x - radiusOuter,pm.y - radiusOuter,pm.x + radiusOuter,pm.y + radiusOuter);
+	return RET_DRAWLIST_OK;
+}
+
+int8_t drawListSurface(DrawList *list, Surface *surface, Point p, uint8_t mode) {
+	if (list == NULL || surface == NULL) return RET_DRAWLIST_ARGS;
+	DrawCommand *command = drawListAdd(list,DRAW_CMD_SURFACE);
+	if (command == NULL) return RET_DRAWLIST_FULL;
+	command->surface = surface;
+	command->mode = mode;
+	command->p[0] = p;
+	command->footprint = boundingBoxCreate(p.x,p.y,p.x + surface->width - 1,p.y + surface->height - 1);
+	return RET_DRAWLIST_OK;
+}
+
+int8_t drawListSprite(DrawList *list, Surface *sprite, Matrix matrix, uint8_t alpha, uint8_t mode, BoundingBox boundingBoxSprite) {
+	if (list == NULL || sprite == NULL) return RET_DRAWLIST_ARGS;
+	DrawCommand *command = drawListAdd(list,DRAW_CMD_SPRITE);
+	if (command == NULL) return RET_DRAWLIST_FULL;
+	command->surface = sprite;
+	command->matrix = matrix;
+	command->alpha = alpha;
+	command->mode = mode;
+	command->boundingBoxSprite = boundingBoxSprite;
+	command->footprint = composeBoundingBox(sprite,matrix,boundingBoxSprite);
+	return RET_DRAWLIST_OK;
+}
+
+int8_t drawListPoint(DrawList *list, Point p, uint16_t colour, uint8_t alpha, uint8_t mode) {
+	return drawListAddPrimitive(list,DRAW_CMD_POINT,&p,1,colour,alpha,mode);
+}
+
+int8_t drawListLine(DrawList *list, Point p0, Point p1, uint16_t colour, uint8_t alpha, uint8_t mode) {
+	Point p[2] = { p0, p1 };
+	return drawListAddPrimitive(list,DRAW_CMD_LINE,p,2,colour,alpha,mode);
+}
+
+int8_t drawListTriangle(DrawList *list, Point p0, Point p1, Point p2, uint16_t colour, uint8_t alpha, uint8_t mode) {
+	Point p[3] = { p0, p1, p2 };
+	return drawListAddPrimitive(list,DRAW_CMD_TRIANGLE,p,3,colour,alpha,mode);
+}
+
+int8_t drawListRectangle(DrawList *list, Point p0, Point p1, uint16_t colour, uint8_t alpha, uint8_t mode) {
+	Point p[2] = { p0, p1 };
+	return drawListAddPrimitive(list,DRAW_CMD_RECTANGLE,p,2,colour,alpha,mode);
+}
+
+int8_t drawListCircle(DrawList *list, Point pm, uint16_t radius, uint16_t colour, uint8_t alpha, uint8_t mode) {
+	return drawListAddCircular(list,DRAW_CMD_CIRCLE,pm,radius,0,0,0,colour,alpha,mode);
+}
+
+int8_t drawListDisc(DrawList *list, Point pm, uint16_t radius, uint16_t colour, uint8_t alpha, uint8_t mode) {
+	return drawListAddCircular(list,DRAW_CMD_DISC,pm,radius,0,0,0,colour,alpha,mode);
+}
+
+int8_t drawListArc(DrawList *list, Point pm, uint16_t radius, int16_t angleStart, int16_t angleStop, uint16_t colour, uint8_t alpha, uint8_t mode) {
+	return drawListAddCircular(list,DRAW_CMD_ARC,pm,radius,0,angleStart,angleStop,colour,alpha,mode);
+}
+
+int8_t drawListSector(DrawList *list, Point pm, uint16_t radiusOuter, uint16_t radiusInner, int16_t angleStart, int16_t angleStop, uint16_t colour, uint8_t alpha, uint8_t mode) {
+	return drawListAddCircular(list,DRAW_CMD_SECTOR,pm,radiusOuter,radiusInner,angleStart,angleStop,colour,alpha,mode);
+}
+
+int8_t drawListText(DrawList *list, FontFileData *font, FontLayout *layout, Point p) {
+	if (list == NULL || font == NULL || layout == NULL) return RET_DRAWLIST_ARGS;
+	DrawCommand *command = drawListAdd(list,DRAW_CMD_TEXT);
+	if (command == NULL) return RET_DRAWLIST_FULL;
+	command->font = font;
+	command->layout = layout;
+	command->p[0] = p;
+	// layout box: max is exclusive; an empty layout covers nothing
+	if (layout->n == 0)
+		command->footprint = boundingBoxCreate(0,0,-1,-1);
+	else
+		command->footprint = boundingBoxCreate(p.x + layout->bb.min.x,p.y + layout->bb.min.y,p.x + layout->bb.max.x - 1,p.y + layout->bb.max.y - 1);
+	return RET_DRAWLIST_OK;
+}
+
+//------------------------------------------------------------------------------
+// culling and merging
+//------------------------------------------------------------------------------
+
+// internal helper function: clip a footprint to the display; false if nothing is visible
+static bool drawListClip(BoundingBox *bb) {
+	if (bb->min.x < 0) bb->min.x = 0;
+	if (bb->min.y < 0) bb->min.y = 0;
+	if (bb->max.x >= DISP_WIDTH) bb->max.x = DISP_WIDTH - 1;
+	if (bb->max.y >= DISP_HEIGHT) bb->max.y = DISP_HEIGHT - 1;
+	return bb->min.x <= bb->max.x && bb->min.y <= bb->max.y;
+}
+
+// internal helper function: true if a command overwrites every pixel of its
+// footprint regardless of what was drawn before (opaque rectangles and opaque
+// surfaces in mode over)
+static bool drawListIsOpaque(DrawCommand *command) {
+	if ((command->mode & BLEND_MASK_MODE) != BLEND_OVER) return false;
+	switch (command->type) {
+		case DRAW_CMD_RECTANGLE:
+			return command->alpha == 255;
+		case DRAW_CMD_SURFACE:
+			return command->surface->alpha == NULL;
+		default:
+			return false;
+	}
+}
+
+// internal helper function: true if box a lies inside box b
+static inline bool drawListIsInside(BoundingBox a, BoundingBox b) {
+	return a.min.x >= b.min.x && a.max.x <= b.max.x && a.min.y >= b.min.y && a.max.y <= b.max.y;
+}
+
+// internal helper function: true if intervals a0..a1 and b0..b1 form one
+// interval; without overlap, they have to touch exactly
+static inline bool drawListIsJoinable(int32_t a0, int32_t a1, int32_t b0, int32_t b1, bool overlap) {
+	if (overlap) return a0 <= b1 + 1 && b0 <= a1 + 1;
+	return a1 + 1 == b0 || b1 + 1 == a0;
+}
+
+// internal helper function: merge rectangle command b into rectangle command a
+// if both share colour, alpha and mode and their union is a rectangle; pixels
+// must not be blended twice, so only opaque rectangles may overlap
+static bool drawListMergeRectangles(DrawCommand *a, DrawCommand *b) {
+	if (a->type != DRAW_CMD_RECTANGLE || b->type != DRAW_CMD_RECTANGLE) return false;
+	if (a->colour != b->colour || a->alpha != b->alpha || a->mode != b->mode) return false;
+	BoundingBox bbA = a->footprint;
+	BoundingBox bbB = b->footprint;
+	const bool isOpaque = drawListIsOpaque(a);
+	if (bbA.min.y == bbB.min.y && bbA.max.y == bbB.max.y) {
+		if (!drawListIsJoinable(bbA.min.x,bbA.max.x,bbB.min.x,bbB.max.x,isOpaque)) return false;
+	} else if (bbA.min.x == bbB.min.x && bbA.max.x == bbB.max.x) {
+		if (!drawListIsJoinable(bbA.min.y,bbA.max.y,bbB.min.y,bbB.max.y,isOpaque)) return false;
+	} else {
+		return false;
+	}
+	if (bbB.min.x < bbA.min.x) bbA.min.x = bbB.min.x;
+	if (bbB.min.y < bbA.min.y) bbA.min.y = bbB.min.y;
+	if (bbB.max.x > bbA.max.x) bbA.max.x = bbB.max.x;
+	if (bbB.max.y > bbA.max.y) bbA.max.y = bbB.max.y;
+	a->footprint = bbA;
+	a->p[0] = bbA.min;
+	a->p[1] = bbA.max;
+	return true;
+}
+
+uint16_t drawListCull(DrawList *list) {
+	if (list == NULL) return 0;
+	BoundingBox bb,bbOther;
+	uint16_t i,j,n;
+	
+	// backwards: drop commands outside the display or hidden by a later opaque
+	// command; hidden commands get an empty footprint, which is fine for all
+	// earlier commands, since their occluder is hidden by a kept command, too
+	for (i = list->nCommands; i-- > 0;) {
+		bb = list->commands[i].footprint;
+		if (!drawListClip(&bb)) continue;
+		for (j = i + 1; j < list->nCommands; j++) {
+			if (!drawListIsOpaque(&list->commands[j])) continue;
+			bbOther = list->commands[j].footprint;
+			if (drawListClip(&bbOther) && drawListIsInside(bb,bbOther)) {
+				list->commands[i].footprint = boundingBoxCreate(0,0,-1,-1);
+				break;
+			}
+		}
+	}
+	
+	// forwards: compact the list, merging consecutive rectangles
+	for (i = 0, n = 0; i < list->nCommands; i++) {
+		bb = list->commands[i].footprint;
+		if (!drawListClip(&bb)) continue;
+		if (n > 0 && drawListMergeRectangles(&list->commands[n - 1],&list->commands[i])) continue;
+		if (n != i) list->commands[n] = list->commands[i];
+		n++;
+	}
+	i = list->nCommands - n;
+	list->nCommands = n;
+	return i;
+}
+
+//------------------------------------------------------------------------------
+// rendering
+//------------------------------------------------------------------------------
+
+void drawListMark(DrawList *list, SurfaceMod *mask) {
+	if (list == NULL || mask == NULL) return;
+	BoundingBox bb;
+	uint32_t bitmask;
+	for (uint16_t i = 0; i < list->nCommands; i++) {
+		bb = list->commands[i].footprint;
+		if (!drawListClip(&bb)) continue;
+		bitmask = ((2u << (bb.max.x >> 3)) - 1) & ~((1u << (bb.min.x >> 3)) - 1);
+		for (int32_t y = bb.min.y & ~7; y <= bb.max.y; y += 8) surfaceModSetRow(mask,y,bitmask);
+	}
+}
+
+// internal helper function: draw a command on the band surface, which shows
+// display rows y to y + DRAWLIST_BAND_HEIGHT - 1; all drawing functions are
+// translation invariant except compose(), which gets the band offset instead
+// of a shifted matrix (this would change its rounding)
+static void drawListDraw(DrawList *list, DrawCommand *command, int32_t y) {
+	Surface *band = list->band;
+	SurfaceMod *mask = list->scratch;
+	Point p0 = createPoint(command->p[0].x,command->p[0].y - y);
+	Point p1 = createPoint(command->p[1].x,command->p[1].y - y);
+	Point p2 = createPoint(command->p[2].x,command->p[2].y - y);
+	switch (command->type) {
+		case DRAW_CMD_SURFACE:
+			surfaceBlendPosition(command->surface,band,p0,command->mode,mask);
+			break;
+		case DRAW_CMD_SPRITE:
+			composeOffset(band,command->surface,band,command->matrix,command->alpha,command->mode,command->boundingBoxSprite,createPoint(0,y),mask);
+			break;
+		case DRAW_CMD_POINT:
+			surfaceDrawPoint(band,p0,command->colour,command->alpha,command->mode,mask);
+			break;
+		case DRAW_CMD_LINE:
+			surfaceDrawLine(band,p0,p1,command->colour,command->alpha,command->mode,mask);
+			break;
+		case DRAW_CMD_TRIANGLE:
+			surfaceDrawTriangle(band,p0,p1,p2,command->colour,command->alpha,command->mode,mask);
+			break;
+		case DRAW_CMD_RECTANGLE:
+			surfaceDrawRectangle(band,p0,p1,command->colour,command->alpha,command->mode,mask);
+			break;
+		case DRAW_CMD_CIRCLE:
+			surfaceDrawCircle(band,p0,command->radius[0],command->colour,command->alpha,command->mode,mask);
+			break;
+		case DRAW_CMD_DISC:
+			surfaceDrawDisc(band,p0,command->radius[0],command->colour,command->alpha,command->mode,mask);
+			break;
+		case DRAW_CMD_ARC:
+			surfaceDrawArc(band,p0,command->radius[0],command->angle[0],command->angle[1],command->colour,command->alpha,command->mode,mask);
+			break;
+		case DRAW_CMD_SECTOR:
+			surfaceDrawSector(band,p0,command->radius[0],command->radius[1],command->angle[0],command->angle[1],command->colour,command->alpha,command->mode,mask);
+			break;
+		case DRAW_CMD_TEXT:
+			fontFileDraw(band,mask,command->font,command->layout,p0);
+			break;
+	}
+}
+
+uint8_t drawListRender(DrawList *list, union disp_framebuffer *framebuffer, SurfaceMod *mask) {
+	if (list == NULL || framebuffer == NULL) return 0;
+	const uint32_t bitmaskWidth = 0xffffffffu >> (32 - ((DISP_WIDTH + 7) >> 3));
+	DrawCommand *command;
+	uint32_t bitmask;
+	uint8_t nBands = 0;
+	uint16_t i,iStart;
+	int32_t y;
+
+	for (y = 0; y + DRAWLIST_BAND_HEIGHT <= DISP_HEIGHT; y += DRAWLIST_BAND_HEIGHT) {
+		// bands without modified tiles are skipped altogether
+		if (mask == NULL)
+			bitmask = bitmaskWidth;
+		else
+			bitmask = (y < mask->height) ? mask->tile[y >> 3] & bitmaskWidth : 0;
+		if (bitmask == 0) continue;
+
+		// the last opaque command covering the whole band hides the background
+		// and all commands before it
+		for (iStart = list->nCommands; iStart-- > 0;) {
+			command = &list->commands[iStart];
+			if (command->footprint.min.x <= 0 && command->footprint.max.x >= DISP_WIDTH - 1 &&
+				command->footprint.min.y <= y && command->footprint.max.y >= y + DRAWLIST_BAND_HEIGHT - 1 &&
+				drawListIsOpaque(command)) break;
+		}
+		if (iStart >= list->nCommands) {
+			surfaceClear(list->band,list->colour,255);
+			iStart = 0;
+		}
+		for (i = iStart; i < list->nCommands; i++) {
+			command = &list->commands[i];
+			if (command->footprint.max.y < y || command->footprint.min.y >= y + DRAWLIST_BAND_HEIGHT) continue;
+			drawListDraw(list,command,y);
+		}
+		framebufferUpdateFromBand(framebuffer,list->band,y,bitmask);
+		nBands++;
+	}
+	return nBands;
+}
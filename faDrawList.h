@@ -0,0 +1,303 @@
+#ifndef _FADRAWLIST_H
+#define _FADRAWLIST_H
+/**
+ * @file
+ * @author Frank Abelbeck <frank.abelbeck@googlemail.com>
+ * @version 2026-10-14
+ * 
+ * @section License
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * @section Description
+ * 
+ * Band renderer for the card10 badge: draw calls (surfaces, sprites, primitives,
+ * text layouts) are recorded into a draw list, which is then replayed for one
+ * band of DRAWLIST_BAND_HEIGHT display rows at a time. Each band is rendered
+ * into a small opaque band surface and copied directly into the framebuffer,
+ * so no display-sized Surface is needed.
+ * 
+ * The result equals drawing all commands in order on a display-sized opaque
+ * surface cleared to the list's colour. Surfaces, fonts and layouts are
+ * referred to, not copied: they have to stay valid until the list is rendered.
+ * 
+ * Modified areas are derived from command footprints (cf. drawListMark()),
+ * so primitives are drawn onto the band without per-pixel change detection
+ * (SURFACE_FLAG_NOTRACK). Commands hidden by later opaque rectangles or
+ * surfaces can be dropped before rendering (cf. drawListCull()).
+ */
+
+#include <stdint.h> // uses: int8_t, uint8_t, uint16_t, int16_t
+#include <stdbool.h> // uses: bool
+
+#include "epicardium.h" // uses: union disp_framebuffer, DISP_WIDTH, DISP_HEIGHT
+#include "faSurfaceBase.h"
+#include "faSurface.h" // uses: Matrix
+#include "faFontFile.h" // uses: FontFileData, FontLayout
+
+//------------------------------------------------------------------------------
+// constants
+//------------------------------------------------------------------------------
+#define RET_DRAWLIST_OK    0 ///< function returned successfully
+#define RET_DRAWLIST_ARGS -1 ///< invalid arguments passed
+#define RET_DRAWLIST_FULL -2 ///< draw list is full
+
+#define DRAWLIST_BAND_HEIGHT 8 ///< rows per band; equals the SurfaceMod tile height
+
+#define DRAW_CMD_SURFACE   0 ///< command: surfaceBlendPosition()
+#define DRAW_CMD_SPRITE    1 ///< command: compose()
+#define DRAW_CMD_POINT     2 ///< command: surfaceDrawPoint()
+#define DRAW_CMD_LINE      3 ///< command: surfaceDrawLine()
+#define DRAW_CMD_TRIANGLE  4 ///< command: surfaceDrawTriangle()
+#define DRAW_CMD_RECTANGLE 5 ///< command: surfaceDrawRectangle()
+#define DRAW_CMD_CIRCLE    6 ///< command: surfaceDrawCircle()
+#define DRAW_CMD_DISC      7 ///< command: surfaceDrawDisc()
+#define DRAW_CMD_ARC       8 ///< command: surfaceDrawArc()
+#define DRAW_CMD_SECTOR    9 ///< command: surfaceDrawSector()
+#define DRAW_CMD_TEXT     10 ///< command: fontFileDraw()
+
+//------------------------------------------------------------------------------
+// data structures
+//------------------------------------------------------------------------------
+
+/** Data structure of a recorded draw call. */
+typedef struct {
+	uint8_t  type;      ///< One of DRAW_CMD_*.
+	uint8_t  alpha;     ///< Transparency of primitives and sprites.
+	uint8_t  mode;      ///< A mode as defined by BLEND_*.
+	uint16_t colour;    ///< Colour of primitives (RGB565).
+	Point    p[3];      ///< Points of primitives; p[0] is the position of surfaces and text, or the centre of circular primitives.
+	uint16_t radius[2]; ///< Outer and inner radius of circular primitives.
+	int16_t  angle[2];  ///< Start and stop angle of arcs and sectors.
+	Matrix   matrix;    ///< Transformation of a sprite.
+	BoundingBox boundingBoxSprite; ///< Displayed sprite area.
+	Surface  *surface;  ///< Surface or sprite.
+	FontFileData *font; ///< Font of a text command.
+	FontLayout *layout; ///< Layout of a text command.
+	BoundingBox footprint; ///< Display area possibly covered by the command (inclusive, not clipped).
+} DrawCommand;
+
+/** Data structure of a draw list. */
+typedef struct {
+	uint16_t    nCommands;   ///< Number of recorded commands.
+	uint16_t    maxCommands; ///< Capacity of the command array.
+	uint16_t    colour;      ///< Colour of display areas not covered by any command (RGB565).
+	DrawCommand *commands;   ///< Command array, in drawing order.
+	Surface     *band;       ///< Opaque band surface, DISP_WIDTH by DRAWLIST_BAND_HEIGHT pixels.
+	SurfaceMod  *scratch;    ///< Modification mask passed to the drawing functions.
+} DrawList;
+
+//------------------------------------------------------------------------------
+// function prototypes
+//------------------------------------------------------------------------------
+
+/** Constructor: create an empty draw list.
+ * 
+ * @param maxCommands Maximum number of commands.
+ * @param colour Colour of display areas not covered by any command (RGB565).
+ * @returns A pointer to a DrawList structure or NULL if something went wrong.
+ */
+DrawList *drawListConstruct(uint16_t maxCommands, uint16_t colour);
+
+/** Destructor: free any allocated memory of a draw list.
+ * 
+ * Surfaces, fonts and layouts referred to by commands are not freed.
+ * 
+ * @param list Pointer to a pointer to a DrawList structure.
+ */
+void drawListDestruct(DrawList **list);
+
+/** Remove all commands from a draw list, e.g. to record the next frame.
+ * 
+ * @param list Pointer to a DrawList structure.
+ */
+void drawListClear(DrawList *list);
+
+/** Record a surface drawn at a position (cf. surfaceBlendPosition()).
+ * 
+ * @param list Pointer to a DrawList structure.
+ * @param surface Pointer to a Surface structure.
+ * @param p Upper left corner on the display.
+ * @param mode A mode as defined by BLEND_*
+ * @returns RET_DRAWLIST_OK, RET_DRAWLIST_ARGS or RET_DRAWLIST_FULL.
+ */
+int8_t drawListSurface(DrawList *list, Surface *surface, Point p, uint8_t mode);
+
+/** Record a transformed sprite (cf. compose()).
+ * 
+ * @param list Pointer to a DrawList structure.
+ * @param sprite Pointer to a Surface structure.
+ * @param matrix Transformation from sprite to display coordinates.
+ * @param alpha Transparency of the sprite.
+ * @param mode A mode as defined by BLEND_*, optionally combined with BLEND_FLAG_BILINEAR.
+ * @param boundingBoxSprite BoundingBox of the sprite area that should be displayed.
+ * @returns RET_DRAWLIST_OK, RET_DRAWLIST_ARGS or RET_DRAWLIST_FULL.
+ */
+int8_t drawListSprite(DrawList *list, Surface *sprite, Matrix matrix, uint8_t alpha, uint8_t mode, BoundingBox boundingBoxSprite);
+
+/** Record a point (cf. surfaceDrawPoint()).
+ * 
+ * @param list Pointer to a DrawList structure.
+ * @param p A Point structure.
+ * @param colour A 16-bit colour value (RGB565).
+ * @param alpha An 8-bit alpha value.
+ * @param mode A mode as defined by BLEND_*
+ * @returns RET_DRAWLIST_OK, RET_DRAWLIST_ARGS or RET_DRAWLIST_FULL.
+ */
+int8_t drawListPoint(DrawList *list, Point p, uint16_t colour, uint8_t alpha, uint8_t mode);
+
+/** Record a line (cf. surfaceDrawLine()).
+ * 
+ * @param list Pointer to a DrawList structure.
+ * @param p0 A Point structure; start point.
+ * @param p1 A Point structure; end point.
+ * @param colour A 16-bit colour value (RGB565).
+ * @param alpha An 8-bit alpha value.
+ * @param mode A mode as defined by BLEND_*
+ * @returns RET_DRAWLIST_OK, RET_DRAWLIST_ARGS or RET_DRAWLIST_FULL.
+ */
+int8_t drawListLine(DrawList *list, Point p0, Point p1, uint16_t colour, uint8_t alpha, uint8_t mode);
+
+/** Record a filled triangle (cf. surfaceDrawTriangle()).
+ * 
+ * @param list Pointer to a DrawList structure.
+ * @param p0 A Point structure; first vertex.
+ * @param p1 A Point structure; second vertex.
+ * @param p2 A Point structure; third vertex.
+ * @param colour A 16-bit colour value (RGB565).
+ * @param alpha An 8-bit alpha value.
+ * @param mode A mode as defined by BLEND_*
+ * @returns RET_DRAWLIST_OK, RET_DRAWLIST_ARGS or RET_DRAWLIST_FULL.
+ */
+int8_t drawListTriangle(DrawList *list, Point p0, Point p1, Point p2, uint16_t colour, uint8_t alpha, uint8_t mode);
+
+/** Record a filled rectangle (cf. surfaceDrawRectangle()).
+ * 
+ * @param list Pointer to a DrawList structure.
+ * @param p0 A Point structure; one corner.
+ * @param p1 A Point structure; opposite corner.
+ * @param colour A 16-bit colour value (RGB565).
+ * @param alpha An 8-bit alpha value.
+ * @param mode A mode as defined by BLEND_*
+ * @returns RET_DRAWLIST_OK, RET_DRAWLIST_ARGS or RET_DRAWLIST_FULL.
+ */
+int8_t drawListRectangle(DrawList *list, Point p0, Point p1, uint16_t colour, uint8_t alpha, uint8_t mode);
+
+/** Record a circle (cf. surfaceDrawCircle()).
+ * 
+ * @param list Pointer to a DrawList structure.
+ * @param pm A Point structure; centre.
+ * @param radius Radius in pixels.
+ * @param colour A 16-bit colour value (RGB565).
+ * @param alpha An 8-bit alpha value.
+ * @param mode A mode as defined by BLEND_*
+ * @returns RET_DRAWLIST_OK, RET_DRAWLIST_ARGS or RET_DRAWLIST_FULL.
+ */
+int8_t drawListCircle(DrawList *list, Point pm, uint16_t radius, uint16_t colour, uint8_t alpha, uint8_t mode);
+
+/** Record a disc (cf. surfaceDrawDisc()).
+ * 
+ * @param list Pointer to a DrawList structure.
+ * @param pm A Point structure; centre.
+ * @param radius Radius in pixels.
+ * @param colour A 16-bit colour value (RGB565).
+ * @param alpha An 8-bit alpha value.
+ * @param mode A mode as defined by BLEND_*
+ * @returns RET_DRAWLIST_OK, RET_DRAWLIST_ARGS or RET_DRAWLIST_FULL.
+ */
+int8_t drawListDisc(DrawList *list, Point pm, uint16_t radius, uint16_t colour, uint8_t alpha, uint8_t mode);
+
+/** Record an arc (cf. surfaceDrawArc()).
+ * 
+ * @param list Pointer to a DrawList structure.
+ * @param pm A Point structure; centre.
+ * @param radius Radius in pixels.
+ * @param angleStart Start angle in degrees (inclusive).
+ * @param angleStop Stop angle in degrees (exclusive).
+ * @param colour A 16-bit colour value (RGB565).
+ * @param alpha An 8-bit alpha value.
+ * @param mode A mode as defined by BLEND_*
+ * @returns RET_DRAWLIST_OK, RET_DRAWLIST_ARGS or RET_DRAWLIST_FULL.
+ */
+int8_t drawListArc(DrawList *list, Point pm, uint16_t radius, int16_t angleStart, int16_t angleStop, uint16_t colour, uint8_t alpha, uint8_t mode);
+
+/** Record a sector (cf. surfaceDrawSector()).
+ * 
+ * @param list Pointer to a DrawList structure.
+ * @param pm A Point structure; centre.
+ * @param radiusOuter Outer radius in pixels.
+ * @param radiusInner Inner radius in pixels.
+ * @param angleStart Start angle in degrees (inclusive).
+ * @param angleStop Stop angle in degrees (exclusive).
+ * @param colour A 16-bit colour value (RGB565).
+ * @param alpha An 8-bit alpha value.
+ * @param mode A mode as defined by BLEND_*
+ * @returns RET_DRAWLIST_OK, RET_DRAWLIST_ARGS or RET_DRAWLIST_FULL.
+ */
+int8_t drawListSector(DrawList *list, Point pm, uint16_t radiusOuter, uint16_t radiusInner, int16_t angleStart, int16_t angleStop, uint16_t colour, uint8_t alpha, uint8_t mode);
+
+/** Record a text layout (cf. fontFileDraw()).
+ * 
+ * Colours are taken from the font when the list is rendered.
+ * 
+ * @param list Pointer to a DrawList structure.
+ * @param font Pointer to a FontFileData structure.
+ * @param layout Pointer to a FontLayout structure, measured with font (cf. fontFileMeasure()).
+ * @param p Origin of the layout on the display.
+ * @returns RET_DRAWLIST_OK, RET_DRAWLIST_ARGS or RET_DRAWLIST_FULL.
+ */
+int8_t drawListText(DrawList *list, FontFileData *font, FontLayout *layout, Point p);
+
+/** Drop and merge commands without changing the rendered result.
+ * 
+ * Commands outside the display are dropped, as are commands whose visible
+ * footprint lies inside the footprint of a later opaque command: a rectangle
+ * with alpha 255 or a surface without alpha plane, both in mode BLEND_OVER.
+ * Consecutive rectangles of equal colour, alpha and mode are merged if they
+ * form one rectangle; opaque ones may overlap, others have to touch exactly.
+ * 
+ * Call this after recording a frame and before drawListMark(), so that the
+ * tiles of hidden commands are not marked.
+ * 
+ * @param list Pointer to a DrawList structure.
+ * @returns The number of removed commands.
+ */
+uint16_t drawListCull(DrawList *list);
+
+/** Mark all tiles possibly covered by the recorded commands.
+ * 
+ * Marking the tiles of the previous and the current frame's list yields a mask
+ * for drawListRender() that skips all unchanged bands.
+ * 
+ * @param list Pointer to a DrawList structure.
+ * @param mask Pointer to a SurfaceMod structure.
+ */
+void drawListMark(DrawList *list, SurfaceMod *mask);
+
+/** Replay a draw list band by band into a framebuffer.
+ * 
+ * For each band, the band surface is cleared to the list's colour, all commands
+ * touching the band are drawn in order and the band is copied into the
+ * framebuffer. If a mask is given, bands without modified tiles are skipped
+ * and only modified tiles are copied. Drawing starts at the last opaque
+ * command covering the whole band, if any; clearing is skipped then.
+ * 
+ * @param list Pointer to a DrawList structure.
+ * @param framebuffer Pointer to a framebuffer structure.
+ * @param mask Pointer to a SurfaceMod structure selecting the tiles to update; NULL updates the whole display.
+ * @returns The number of rendered bands.
+ */
+uint8_t drawListRender(DrawList *list, union disp_framebuffer *framebuffer, SurfaceMod *mask);
+
+#endif // _FADRAWLIST_H
@@ -2,7 +2,7 @@
 """
 @file
 @author Frank Abelbeck <frank.abelbeck@googlemail.com>
-@version 2020-03-11
+@version 2026-10-14
 
 
 @section License
@@ -35,6 +35,12 @@ FNV1OFFSET    = 0x811c9dc5
 FNV1MASK      = 0x7fffffff # = 2**31-1, maximum value of int32_t
 MAXUCODE      = 0x10ffff
 
+SIGNATURE     = b"\xfa\xff" # column-major symbols, 8 byte header
+SIGNATUREEXT  = b"\xfa\xfe" # extended format, 12 byte header with format flags
+FLAGROWMAJOR  = 0x01 # extended format flag: symbols are stored row by row
+FLAGINKBOX    = 0x02 # extended format flag: V entries include an ink bounding box
+FLAGSKNOWN    = FLAGROWMAJOR | FLAGINKBOX
+
 DEFAULTSUFFIX   = "bin"
 DEFAULTDISTANCE = 2
 DEFAULTMARGIN   = 32
@@ -134,6 +140,59 @@ def createMinimalPerfectHash(source):
 		raise ValueError("Mismatch between number of keys and number of processed keys.")
 
 
+def sizeSymbolWord(width,height,flags):
+	# size of a symbol word in bytes: one word per column in column-major
+	# layout (height bits), one word per row in row-major layout (width bits)
+	if flags & FLAGROWMAJOR:
+		return (width-1) // 8 + 1
+	else:
+		return (height-1) // 8 + 1
+
+
+def sizeSymbolHead(flags):
+	# size of the V entry part before the bitmap: code + optional ink box
+	return 7 if flags & FLAGINKBOX else 3
+
+
+def encodeSymbol(pixels,width,height,flags):
+	# convert a symbol, given as list of rows of booleans, to its V entry bytes
+	# (without character code); words are stored little-endian with the least
+	# significant bit referring to row 0 (column-major) or column 0 (row-major)
+	sizeWord = sizeSymbolWord(width,height,flags)
+	data = bytearray()
+	if flags & FLAGINKBOX:
+		# ink bounding box: xMin, yMin, xMax+1, yMax+1; all zero if empty
+		columns = [ x for x in range(0,width) if any(pixels[y][x] for y in range(0,height)) ]
+		rows = [ y for y in range(0,height) if any(pixels[y]) ]
+		if len(columns) > 0:
+			data.extend(bytes((columns[0],rows[0],columns[-1]+1,rows[-1]+1)))
+		else:
+			data.extend(bytes((0,0,0,0)))
+	if flags & FLAGROWMAJOR:
+		for y in range(0,height):
+			bitmask = 0
+			for x in range(0,width):
+				bitmask = bitmask | (bool(pixels[y][x]) << x)
+			data.extend(bitmask.to_bytes(sizeWord,"little"))
+	else:
+		for x in range(0,width):
+			bitmask = 0
+			for y in range(0,height):
+				bitmask = bitmask | (bool(pixels[y][x]) << y)
+			data.extend(bitmask.to_bytes(sizeWord,"little"))
+	return bytes(data)
+
+
+def isSymbolPixelSet(bitmap,width,height,flags,x,y):
+	# test a pixel of a V entry bitmap (without character code)
+	offset = sizeSymbolHead(flags) - 3
+	sizeWord = sizeSymbolWord(width,height,flags)
+	if flags & FLAGROWMAJOR:
+		return bool(bitmap[offset + y*sizeWord + (x >> 3)] & (1 << (x & 7)))
+	else:
+		return bool(bitmap[offset + x*sizeWord + (y >> 3)] & (1 << (y & 7)))
+
+
 def lookUp(nKeys,G,V,key):
 	g = G[hashFNV1(key) % nKeys]
 	if g < 0:
@@ -150,11 +209,16 @@ def lookUp(nKeys,G,V,key):
 def loadFile(args):
 	# read the input file, build the font dictionary
 	print("Reading input file {}...".format(args.infile.name))
-	if args.infile.read(2) != b"\xfa\xff":
+	signature = args.infile.read(2)
+	if signature != SIGNATURE and signature != SIGNATUREEXT:
 		raise ValueError("File signature not found.")
 	
-	# signature bytes fit, check dimensions
+	# signature bytes fit, check dimensions (and format flags of the extended format)
 	width,height,nChars = struct.unpack(">BBI",args.infile.read(6))
+	flags = 0
+	if signature == SIGNATUREEXT:
+		flags = struct.unpack(">B3x",args.infile.read(4))[0]
+		if flags & ~FLAGSKNOWN: raise IndexError("Unknown format flags 0x{:02x}.".format(flags))
 	
 	if width == 0: raise IndexError("Zero width detected.")
 	if height == 0: raise IndexError("Zero height detected.")
@@ -162,22 +226,30 @@ def loadFile(args):
 	
 	print("symbol dimensions: {}x{} pixels".format(width,height))
 	print("number of characters: {}".format(nChars))
+	print("symbol layout: {}{}".format(
+		"row-major" if flags & FLAGROWMAJOR else "column-major",
+		", with ink bounding boxes" if flags & FLAGINKBOX else ""
+	))
 	
 	# read intermediate table G
 	G = [ struct.unpack(">i",args.infile.read(4))[0] for i in range(0,nChars)]
 	
 	# read value table V
-	sizeEntryV = width * ((height-1) // 8 + 1)
+	if flags & FLAGROWMAJOR:
+		sizeEntryV = height * sizeSymbolWord(width,height,flags)
+	else:
+		sizeEntryV = width * sizeSymbolWord(width,height,flags)
+	sizeEntryV = sizeEntryV + sizeSymbolHead(flags) - 3
 	strFormatV = ">3s{}s".format(sizeEntryV)
 	sizeEntryV = sizeEntryV + 3
 	V = [ struct.unpack(strFormatV,args.infile.read(sizeEntryV)) for i in range(0,nChars)]
 	
-	return width,height,nChars,G,V
+	return width,height,nChars,flags,G,V
 
 
 def loadAndCheckFile(args):
 	try:
-		width,height,nChars,G,V = loadFile(args)
+		width,height,nChars,flags,G,V = loadFile(args)
 	except ValueError as e:
 		print("File signature not found.")
 		raise e
@@ -206,7 +278,7 @@ def loadAndCheckFile(args):
 		raise
 	print("Unicode replacement character at U+FFFD is defined.")
 	
-	return width,height,nChars,G,V
+	return width,height,nChars,flags,G,V
 
 
 def rangePixels(arg):
@@ -241,7 +313,9 @@ def createFile(args):
 	
 	print("detected width {} and height {}.".format(width,height))
 	
-	sizeColumnWord = (height-1)//8+1
+	flags = 0
+	if args.rowMajor: flags = flags | FLAGROWMAJOR
+	if args.inkBox:   flags = flags | FLAGINKBOX
 	fileroot = os.path.dirname(os.path.realpath(os.path.expanduser(args.infile.name)))
 	dictFont = {}
 	iCode = 0
@@ -284,14 +358,13 @@ def createFile(args):
 					try:
 						# valid code found; process it; iCode stores the current code index
 						uCodeBytes = uCode.to_bytes(3,"big")
-						dictFont[uCodeBytes] = b""
 						tx = iCode % widthTiles
 						ty = iCode // widthTiles
-						for x in range(tx*width, (tx+1)*width):
-							bitmask = 0
-							for y in range(ty*height, (ty+1)*height):
-								bitmask = bitmask | (bool(img.getpixel((x,y))) << (y % height))
-							dictFont[uCodeBytes] = dictFont[uCodeBytes] + bitmask.to_bytes(sizeColumnWord,"little")
+						pixels = [
+							[ img.getpixel((x,y)) for x in range(tx*width, (tx+1)*width) ]
+							for y in range(ty*height, (ty+1)*height)
+						]
+						dictFont[uCodeBytes] = encodeSymbol(pixels,width,height,flags)
 					except IndexError:
 						print("{}: read beyond image (more character codes than tiles).".format(filename))
 						print("No output written. Bye.")
@@ -340,12 +413,16 @@ def createFile(args):
 	
 	# prepare output bytes
 	output = bytearray()
-	# first four bytes: signature (fa FF for faFontFile in hex) + char width + char height
-	output.extend(b"\xfa\xff")
+	# first four bytes: signature (fa FF for faFontFile in hex, fa FE for the
+	# extended format) + char width + char height
+	output.extend(SIGNATURE if flags == 0 else SIGNATUREEXT)
 	output.extend((width).to_bytes(1,"big"))
 	output.extend((height).to_bytes(1,"big"))
 	# next four bytes: number of entries, uint32_t, big-endian
 	output.extend((len(G)).to_bytes(4,"big"))
+	# extended format: four more bytes, format flags and three reserved bytes
+	if flags != 0:
+		output.extend(bytes((flags,0,0,0)))
 	# append G table as array of int32_t, big-endian
 	
 	for g in G:
@@ -386,7 +463,7 @@ def createFile(args):
 
 def checkFile(args):
 	try:
-		width,height,nChars,G,V = loadAndCheckFile(args)
+		width,height,nChars,flags,G,V = loadAndCheckFile(args)
 	except Exception as e:
 		print("File check failed.")
 		print(e)
@@ -405,7 +482,7 @@ def checkFile(args):
 def renderString(args):
 	# step 1: check input file
 	try:
-		width,height,nChars,G,V = loadAndCheckFile(args)
+		width,height,nChars,flags,G,V = loadAndCheckFile(args)
 	except Exception as e:
 		print("File check failed.")
 		args.infile.close()
@@ -419,9 +496,6 @@ def renderString(args):
 	heightImage = height + 2 * args.margin
 	xCursor = args.margin
 	yCursor = args.margin
-	sizeWord = (height-1)//8 + 1
-	formatBits = ">{}s".format(sizeWord)
-	
 	print("Dimensions of rendered text (without margin): {}x{}".format(widthImage-2*args.margin,heightImage-2*args.margin))
 	
 	if args.blackOnWhite:
@@ -439,7 +513,7 @@ def renderString(args):
 			bitmap = lookUp(nChars,G,V,b"\x00\xff\xfd")
 		for x in range(0,width):
 			for y in range(0,height):
-				if (bitmap[x*sizeWord + (y >> 3)] & (1 << (y & 7))):
+				if isSymbolPixelSet(bitmap,width,height,flags,x,y):
 					img.putpixel((xCursor+x,yCursor+y),colourFg)
 		
 		xCursor = xCursor + width + args.distance
@@ -493,8 +567,17 @@ Structure of a faFF:
    byte 4..7: number nChars of char definitions, range [1,0x10ffff] (uint32_t)
    bytes 8ff: data, consisting of intermediate table G and value table V
 
-If width, height or nChars are outside the specified ranges, the file is
-considered invalid. If the Unicode replacement character (U+FFFD) is not
+Extended format (faFFTool.py create with -r and/or -i):
+   byte 0..1: values 0xfa 0xfe
+   byte 2..7: as above
+   byte 8:    format flags (uint8_t):
+                 0x01: row-major symbol layout
+                 0x02: ink bounding box in each value table entry
+   byte 9..11: reserved, zero
+   bytes 12ff: data, consisting of intermediate table G and value table V
+
+If width, height or nChars are outside the specified ranges or if unknown format
+flags are set, the file is considered invalid. If the Unicode replacement character (U+FFFD) is not
 included in the character table, the file is considered invalid, too.
 
 Hashing is based on the Fowler-Noll-Vo hash function (example in Python3):
@@ -540,6 +623,17 @@ Unused bits should be set to zero. The bytes of a column word are ordered from
 least to most significant byte, i.e. little-endian (allowing a simpler mapping
 of y coordinate to bit position).
 
+If the row-major flag is set, the bitmap consists of one word per row instead
+(least significant bit = column 0), allowing renderers to process a symbol
+line by line:
+
+ - number of row words = height
+ - size of row word in byte = (width-1) / 8 + 1
+
+If the ink bounding box flag is set, four bytes xMin, yMin, xMax+1, yMax+1
+(uint8_t each) follow the character code, describing the smallest box that
+encloses all set pixels. An empty symbol has the box 0,0,0,0.
+
 """.format(DEFAULTSUFFIX))
 	return 0;
 
@@ -579,6 +673,16 @@ if __name__ == "__main__":
 		metavar="OUTFILE",
 		help="name of the output file (default: use input name with new suffix); overrides -s argument"
 	)
+	parser_create.add_argument("-r",
+		dest="rowMajor",
+		action="store_true",
+		help="store symbols row by row (extended format; default: column by column)"
+	)
+	parser_create.add_argument("-i",
+		dest="inkBox",
+		action="store_true",
+		help="store an ink bounding box per symbol (extended format)"
+	)
 	parser_create.set_defaults(function=createFile)
 	
 	# subparser check
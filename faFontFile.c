@@ -1,7 +1,7 @@
 /**
  * @file
  * @author Frank Abelbeck <frank.abelbeck@googlemail.com>
- * @version 2020-03-05
+ * @version 2026-10-14
  * 
  * @section License
  * 
@@ -23,7 +23,7 @@
  * Frank Abelbeck Font File (faFF) management library
  */
 
-#include <stdlib.h> // uses: malloc(), free()
+#include <string.h> // uses: memcmp()
 #include <stdint.h> // uses: int8_t, uint8_t, int16_t, uint16_t, uint32_t
 #include <stdio.h>
 #include <stdarg.h>
@@ -31,19 +31,34 @@
 
 #include "faFontFile.h"
 #include "faSurfaceBase.h"
+#include "faMemory.h" // uses: memoryAlloc(), memoryFree()
+#include "faProfile.h" // uses: PROFILE_SCOPE(), profileGetStats()
 
 
 FontFileData *fontFileConstruct() {
 	FontFileData *data = NULL;
-	data = (FontFileData*)malloc(sizeof(FontFileData));
+	data = (FontFileData*)memoryAlloc(sizeof(FontFileData));
 	if (data != NULL) {
 		data->width = 0;
 		data->height = 0;
 		data->G = NULL;
 		data->V = NULL;
+		data->flags = 0;
 		data->sizeVWord = 0;
+		data->sizeVHead = 3;
 		data->sizeVEntry = 0;
 		data->iReplChar = -1;
+		data->file = -1;
+		data->offsetV = 0;
+		data->nCache = 0;
+		data->cacheIndex = NULL;
+		data->cacheUse = NULL;
+		data->cacheClock = 0;
+		data->nTiles = 0;
+		data->tiles = NULL;
+		data->tileRgb565 = NULL;
+		data->tileAlpha = NULL;
+		data->tileClock = 0;
 		data->distChar = 0;
 		data->distLine = 0;
 		data->tabWidth = 4;
@@ -56,10 +71,35 @@ FontFileData *fontFileConstruct() {
 	return data;
 }
 
+// free tables, glyph cache and tile cache, close the font file of paged mode
+// and reset the table-related fields of the given font data structure
+void fontFileReset(FontFileData *self) {
+	if (self->file >= 0) epic_file_close(self->file);
+	fontFileTileCacheSetup(self,0);
+	memoryFree(self->G);
+	memoryFree(self->V);
+	memoryFree(self->cacheIndex);
+	memoryFree(self->cacheUse);
+	self->width = 0;
+	self->height = 0;
+	self->G = NULL;
+	self->V = NULL;
+	self->flags = 0;
+	self->sizeVWord = 0;
+	self->sizeVHead = 3;
+	self->sizeVEntry = 0;
+	self->iReplChar = -1;
+	self->file = -1;
+	self->offsetV = 0;
+	self->nCache = 0;
+	self->cacheIndex = NULL;
+	self->cacheUse = NULL;
+	self->cacheClock = 0;
+}
+
 void fontFileDestruct(FontFileData **self) {
-	free((*self)->V);
-	free((*self)->G);
-	free(*self);
+	fontFileReset(*self);
+	memoryFree(*self);
 	*self = NULL;
 }
 
@@ -76,6 +116,36 @@ uint32_t hashFNV1(uint8_t *value, uint32_t seed) {
 }
 
 
+// internal function without saveguards! return the address of V entry index;
+// in paged mode the entry is taken from the glyph cache or read into the least
+// recently used cache slot whose last access is older than pin (slots used
+// since then stay untouched); returns NULL if no slot is free or reading failed
+uint8_t *fontFileGetEntry(FontFileData *self, int32_t index, uint32_t pin) {
+	if (self->nCache == 0) return self->V + index * self->sizeVEntry;
+	
+	uint16_t i,iFree = self->nCache;
+	for (i = 0; i < self->nCache; i++) {
+		if (self->cacheIndex[i] == index) {
+			// cache hit
+			self->cacheUse[i] = ++self->cacheClock;
+			return self->V + i * self->sizeVEntry;
+		}
+		if (self->cacheUse[i] < pin && (iFree == self->nCache || self->cacheUse[i] < self->cacheUse[iFree])) iFree = i;
+	}
+	if (iFree == self->nCache) return NULL;
+	
+	// cache miss: fetch entry from file into the chosen slot
+	uint8_t *entry = self->V + iFree * self->sizeVEntry;
+	self->cacheIndex[iFree] = -1;
+	self->cacheUse[iFree] = 0;
+	if (epic_file_seek(self->file,self->offsetV + (uint32_t)index * self->sizeVEntry,SEEK_SET) != 0 ||
+	    epic_file_read(self->file,entry,self->sizeVEntry) != self->sizeVEntry) return NULL;
+	self->cacheIndex[iFree] = index;
+	self->cacheUse[iFree] = ++self->cacheClock;
+	return entry;
+}
+
+
 int32_t fontFileLookUpIndex(FontFileData *self, uint8_t *code) {
 	if (self == NULL || self->G == NULL || self->V == NULL || code == NULL) return self->iReplChar;
 	
@@ -97,8 +167,8 @@ int32_t fontFileLookUpIndex(FontFileData *self, uint8_t *code) {
 		g %= self->nChars;
 	}
 	
-	uint8_t *v = self->V + g * self->sizeVEntry; // actual byte index in V
-	if (*v++ != *code++ || *v++ != *code++ || *v++ != *code++)
+	uint8_t *v = fontFileGetEntry(self,g,UINT32_MAX); // actual byte index in V
+	if (v == NULL || *v++ != *code++ || *v++ != *code++ || *v++ != *code++)
 		// retrieved value's code and requested code doesn't match: return position of replacement character
 		return self->iReplChar;
 	else
@@ -107,7 +177,7 @@ int32_t fontFileLookUpIndex(FontFileData *self, uint8_t *code) {
 }
 
 
-int8_t fontFileRead(FontFileData *self, char *filename) {
+int8_t fontFileReadPaged(FontFileData *self, char *filename, uint16_t nCache) {
 	// check that data structure exists
 	if (self == NULL || filename == NULL) return RET_FAFF_ARGS;
 	
@@ -117,71 +187,108 @@ int8_t fontFileRead(FontFileData *self, char *filename) {
 	
 	// define general purpose read buffer
 	uint8_t readBuffer[8];
+	uint8_t flags = 0;
 	uint32_t i;
 	
 	// read and check header:
-	//   bytes 0..1 should be 0xfa 0xff (signature)
+	//   bytes 0..1 should be 0xfa 0xff (signature) or 0xfa 0xfe (extended format)
 	//   byte  2    is width-1
 	//   byte  3    is height-1
 	//   bytes 4..7 is number of chars, nChars, as uint32_t, big-endian
+	// extended format only:
+	//   byte  8    is a set of format flags (FAFF_FLAG_*)
+	//   bytes 9..11 are reserved
  	if (epic_file_read(file,readBuffer,8) != 8) {
 		epic_file_close(file);
 		return RET_FAFF_READ;
 	}
-	if (readBuffer[0] != 0xfa || readBuffer[1] != 0xff) {
+	if (readBuffer[0] != 0xfa || (readBuffer[1] != 0xff && readBuffer[1] != 0xfe)) {
 		epic_file_close(file);
 		return RET_FAFF_MAGIC;
 	}
+	if (readBuffer[1] == 0xfe) {
+		uint8_t readBufferFlags[4];
+		if (epic_file_read(file,readBufferFlags,4) != 4) {
+			epic_file_close(file);
+			return RET_FAFF_READ;
+		}
+		flags = readBufferFlags[0];
+		if (flags & ~FAFF_FLAGS_KNOWN) {
+			epic_file_close(file);
+			return RET_FAFF_FORMAT;
+		}
+	}
 	
 	// reading succeeded: free and reset data structure
-	free(self->G);
-	free(self->V);
-// 	surfaceDestruct(&self->buffer);
-	
-	self->width = 0;
-	self->height = 0;
-	self->G = NULL;
-	self->V = NULL;
-	self->sizeVWord = 0;
-	self->sizeVEntry = 0;
-	self->iReplChar = -1;
+	fontFileReset(self);
 	
 	// signature found, process header vars
 	self->width  = readBuffer[2];
 	self->height = readBuffer[3];
 	self->nChars = (readBuffer[4] << 24) + (readBuffer[5] << 16) + (readBuffer[6] << 8) + readBuffer[7];
-	self->sizeVWord = (((self->height-1) >> 3) + 1);
-	self->sizeVEntry = 3 + self->width * self->sizeVWord;
+	self->flags = flags;
+	self->sizeVHead = (flags & FAFF_FLAG_INKBOX) ? 7 : 3;
+	if (flags & FAFF_FLAG_ROWMAJOR) {
+		self->sizeVWord = (((self->width-1) >> 3) + 1);
+		self->sizeVEntry = self->sizeVHead + self->height * self->sizeVWord;
+	} else {
+		self->sizeVWord = (((self->height-1) >> 3) + 1);
+		self->sizeVEntry = self->sizeVHead + self->width * self->sizeVWord;
+	}
 	
-	// read G table
-	self->G = (int32_t*)malloc(self->nChars*sizeof(int32_t));
+	// read G table in one block and convert it in place
+	uint64_t sizeG = self->nChars*sizeof(int32_t);
+	self->G = (int32_t*)memoryAlloc(sizeG);
 	if (self->G == NULL) {
 		epic_file_close(file);
+		fontFileReset(self);
 		return RET_FAFF_GTAB;
 	}
-	for (i = 0; i < self->nChars; i++) {
-		if (epic_file_read(file,readBuffer,4) != 4) {
-			free(self->G);
+	if ((uint64_t)epic_file_read(file,self->G,sizeG) != sizeG) {
+		epic_file_close(file);
+		fontFileReset(self);
+		return RET_FAFF_READ;
+	}
+	uint8_t *g = (uint8_t*)self->G;
+	for (i = 0; i < self->nChars; i++, g += 4) {
+		// convert 4 byte sequence to integer, big-endian, two's complement
+		self->G[i] = (int32_t)(((uint32_t)g[0] << 24) | ((uint32_t)g[1] << 16) | ((uint32_t)g[2] << 8) | g[3]);
+	}
+	
+	// nCache too large to be useful: read the whole V table instead
+	if (nCache >= self->nChars) nCache = 0;
+	
+	if (nCache == 0) {
+		// read V table: no data processing needed, as this table is a directly-copied sequence of bytes
+		uint64_t sizeV = self->nChars*self->sizeVEntry;
+		self->V = (uint8_t*)memoryAlloc(sizeV);
+		if (self->V == NULL) {
 			epic_file_close(file);
+			fontFileReset(self);
+			return RET_FAFF_VTAB;
+		}
+		if ((uint64_t)epic_file_read(file,self->V,sizeV) != sizeV) {
+			epic_file_close(file);
+			fontFileReset(self);
 			return RET_FAFF_READ;
 		}
-		// convert 4 byte sequence to integer, big-endian, and calculate two's complement
-		self->G[i] = (int32_t)(((readBuffer[0] << 24) + (readBuffer[1] << 16) + (readBuffer[2] << 8) + readBuffer[3]) - 0x100000000);
-	}
-	
-	// read V table: no data processing needed, as this table is a directly-copied sequence of bytes
-	uint64_t sizeV = self->nChars*self->sizeVEntry;
-	self->V = (uint8_t*)malloc(sizeV);
-	if (self->V == NULL) {
-		free(self->G);
-		epic_file_close(file);
-		return RET_FAFF_VTAB;
-	}
-	if ((uint64_t)epic_file_read(file,self->V,sizeV) != sizeV) {
-		free(self->G);
-		free(self->V);
 		epic_file_close(file);
-		return RET_FAFF_READ;
+	} else {
+		// paged mode: keep the file open, V only holds the glyph cache
+		self->file = file;
+		self->offsetV = (readBuffer[1] == 0xfe ? 12 : 8) + sizeG;
+		self->nCache = nCache;
+		self->V = (uint8_t*)memoryAlloc(nCache*self->sizeVEntry);
+		self->cacheIndex = (int32_t*)memoryAlloc(nCache*sizeof(int32_t));
+		self->cacheUse = (uint32_t*)memoryAlloc(nCache*sizeof(uint32_t));
+		if (self->V == NULL || self->cacheIndex == NULL || self->cacheUse == NULL) {
+			fontFileReset(self);
+			return RET_FAFF_VTAB;
+		}
+		for (i = 0; i < nCache; i++) {
+			self->cacheIndex[i] = -1;
+			self->cacheUse[i] = 0;
+		}
 	}
 	
 	// look-up Unicode replacement character U+FFFD to check integrity of tables
@@ -189,9 +296,7 @@ int8_t fontFileRead(FontFileData *self, char *filename) {
 	uint8_t replChar[3] = {0x00,0xff,0xfd};
 	self->iReplChar = fontFileLookUpIndex(self,replChar);
 	if (self->iReplChar < 0) {
-		free(self->G);
-		free(self->V);
-		epic_file_close(file);
+		fontFileReset(self);
 		return RET_FAFF_REPLCHAR;
 	}
 	
@@ -199,10 +304,15 @@ int8_t fontFileRead(FontFileData *self, char *filename) {
 }
 
 
-FontFileData *fontFileLoad(char *filename) {
+int8_t fontFileRead(FontFileData *self, char *filename) {
+	return fontFileReadPaged(self,filename,0);
+}
+
+
+FontFileData *fontFileLoadPaged(char *filename, uint16_t nCache) {
 	FontFileData *data = fontFileConstruct();
 	if (data == NULL) return NULL;
-	int8_t retval = fontFileRead(data,filename);
+	int8_t retval = fontFileReadPaged(data,filename,nCache);
 	if (retval == RET_FAFF_OK) {
 		return data;
 	} else {
@@ -212,6 +322,43 @@ FontFileData *fontFileLoad(char *filename) {
 }
 
 
+FontFileData *fontFileLoad(char *filename) {
+	return fontFileLoadPaged(filename,0);
+}
+
+
+int8_t fontFileTileCacheSetup(FontFileData *self, uint16_t nTiles) {
+	if (self == NULL) return RET_FAFF_ARGS;
+	
+	// remove existing tile cache
+	memoryFree(self->tiles);
+	memoryFree(self->tileRgb565);
+	memoryFree(self->tileAlpha);
+	self->nTiles = 0;
+	self->tiles = NULL;
+	self->tileRgb565 = NULL;
+	self->tileAlpha = NULL;
+	self->tileClock = 0;
+	if (nTiles == 0) return RET_FAFF_OK;
+	if (self->G == NULL) return RET_FAFF_ARGS;
+	
+	uint32_t sizeTile = self->width * self->height;
+	self->tiles = (FontFileTile*)memoryAlloc(nTiles*sizeof(FontFileTile));
+	self->tileRgb565 = (uint16_t*)memoryAlloc(nTiles*sizeTile*sizeof(uint16_t));
+	self->tileAlpha = (uint8_t*)memoryAlloc(nTiles*sizeTile);
+	if (self->tiles == NULL || self->tileRgb565 == NULL || self->tileAlpha == NULL) {
+		fontFileTileCacheSetup(self,0);
+		return RET_FAFF_BUFFER;
+	}
+	for (uint16_t i = 0; i < nTiles; i++) {
+		self->tiles[i].code = -1;
+		self->tiles[i].use = 0;
+	}
+	self->nTiles = nTiles;
+	return RET_FAFF_OK;
+}
+
+
 //------------------------------------------------------------------------------
 // helper functions for INTERNAL USE (without input argument saveguards!)
 //------------------------------------------------------------------------------
@@ -276,80 +423,239 @@ int32_t fontFileGetNextUTF8(char **text) {
 	return uCode;
 }
 
-// look-up a character code in the given font data structure and paint the
-// retrieved symbol at the given position of the given surface
-// Note: cursor is moved on automatically afterwards (x += width + distChar)
-void fontFileLookUpAndDraw(Surface *surface, SurfaceMod *mask, FontFileData *font, Point *cursor, int32_t uCode) {
-	uint8_t uCodeBytes[3];
-	int16_t xStart,yStart,xStartFont,yStartFont,width,height;
-	uint16_t iSurface,iSurfaceStart;
-	uint8_t *value,yMask,x,y;
+// render the given glyph bitmaps, placed side by side starting at the given
+// position, row by row; consecutive pixels of equal state (foreground/background)
+// are blended as one span, which continues across glyph boundaries if distChar is zero
+void fontFileRenderGlyphs(Surface *surface, SurfaceMod *mask, FontFileData *font, Point start, uint8_t **glyph, uint8_t nGlyph) {
+	int32_t xGlyph,xRun,xSpan,yFont,yStopFont;
+	int16_t xFont,xStartFont,xStopFont;
+	uint8_t iGlyph,offset,bit;
+	uint8_t *value,*ink;
+	bool isSet,isSetRun;
 	uint32_t bitmask;
+	const int32_t advance = font->width + font->distChar;
+	
+	// fully transparent colours leave the surface untouched in modes over,
+	// atop, xor and plus: their spans can be skipped without scanning them
+	const bool isNop = font->mode == BLEND_OVER || font->mode == BLEND_ATOP || font->mode == BLEND_XOR || font->mode == BLEND_PLUS;
+	const bool drawFg = !(isNop && font->alpha == 0);
+	const bool drawBg = !(isNop && font->alphaBg == 0);
+	
+	// without background, only the ink bounding box of each glyph is scanned;
+	// spans then end at every glyph boundary
+	const bool isRowMajor = font->flags & FAFF_FLAG_ROWMAJOR;
+	const bool useInk = (font->flags & FAFF_FLAG_INKBOX) && !drawBg;
+	const bool isMerged = font->distChar == 0 && !useInk;
+	
+	if (nGlyph == 0 || !(drawFg || drawBg)) return;
+	
+	// clip the run area: rows inside the surface, glyphs fully right of the
+	// surface are dropped
+	yFont = (start.y < 0) ? -start.y : 0;
+	yStopFont = font->height;
+	if (start.y + yStopFont > surface->height) yStopFont = surface->height - start.y;
+	if (start.x >= surface->width) return;
+	if (start.x + (int32_t)(nGlyph-1) * advance >= surface->width)
+		nGlyph = (surface->width - 1 - start.x) / advance + 1;
+	
+	for (; yFont < yStopFont; yFont++) {
+		offset = yFont >> 3;
+		bit = 1 << (yFont & 7);
+		bitmask = 0;
+		xRun = -1; // start of the currently open span; -1 if none
+		isSetRun = false;
+		for (iGlyph = 0, xGlyph = start.x; iGlyph < nGlyph; iGlyph++, xGlyph += advance) {
+			xStartFont = (xGlyph < 0) ? -xGlyph : 0;
+			xStopFont = font->width;
+			if (xGlyph + xStopFont > surface->width) xStopFont = surface->width - xGlyph;
+			value = glyph[iGlyph];
+			if (useInk) {
+				// ink bounding box precedes the bitmap: xMin, yMin, xMax+1, yMax+1
+				ink = value - 4;
+				if (yFont < ink[1] || yFont >= ink[3]) continue;
+				if (xStartFont < ink[0]) xStartFont = ink[0];
+				if (xStopFont > ink[2]) xStopFont = ink[2];
+			}
+			if (xStartFont >= xStopFont) continue;
+			// row-major: one row word per line; column-major: fixed bit of each column word
+			if (isRowMajor) value += yFont * font->sizeVWord; else value += offset;
+			for (xFont = xStartFont; xFont < xStopFont; xFont++) {
+				if (isRowMajor)
+					isSet = value[xFont >> 3] & (1 << (xFont & 7));
+				else
+					isSet = value[xFont*font->sizeVWord] & bit;
+				if (xRun < 0) {
+					xRun = xGlyph + xFont;
+					isSetRun = isSet;
+				} else if (isSet != isSetRun) {
+					xSpan = xGlyph + xFont;
+					if (isSetRun ? drawFg : drawBg)
+						bitmask |= surfaceBlendSpanColour(surface,xRun,start.y + yFont,xSpan - xRun,
+							isSetRun ? font->colour : font->colourBg,isSetRun ? font->alpha : font->alphaBg,font->mode);
+					xRun = xSpan;
+					isSetRun = isSet;
+				}
+			}
+			if (iGlyph + 1 == nGlyph || !isMerged || xStopFont != font->width) {
+				// span ends at the glyph's right edge: blend it
+				xSpan = xGlyph + xStopFont;
+				if (isSetRun ? drawFg : drawBg)
+					bitmask |= surfaceBlendSpanColour(surface,xRun,start.y + yFont,xSpan - xRun,
+						isSetRun ? font->colour : font->colourBg,isSetRun ? font->alpha : font->alphaBg,font->mode);
+				xRun = -1;
+			}
+		}
+		surfaceModSetRow(mask,start.y + yFont,bitmask);
+	}
+}
+
+// render the glyphs collected in the given text run and empty it; in paged
+// mode, the run is split into chunks whose glyphs all fit into the glyph cache
+void fontFileRunFlush(Surface *surface, SurfaceMod *mask, FontFileData *font, FontFileRun *run) {
+	uint8_t *glyph[FAFF_RUN_LENGTH];
+	uint8_t *entry;
+	uint8_t iGlyph,nChunk;
+	uint16_t i;
+	uint32_t pin;
+	Point start = run->start;
+	
+	for (iGlyph = 0; iGlyph < run->n; iGlyph += nChunk) {
+		if (font->cacheClock > UINT32_MAX - FAFF_RUN_LENGTH) {
+			// restart the access counter before it overflows
+			for (i = 0; i < font->nCache; i++) font->cacheUse[i] = 0;
+			font->cacheClock = 0;
+		}
+		// cache slots accessed after pin are kept until the chunk is rendered
+		pin = font->cacheClock + 1;
+		for (nChunk = 0; iGlyph + nChunk < run->n; nChunk++) {
+			entry = fontFileGetEntry(font,run->index[iGlyph + nChunk],pin);
+			if (entry == NULL) break;
+			glyph[nChunk] = entry + font->sizeVHead;
+		}
+		if (nChunk == 0) {
+			// entry not readable: skip this glyph
+			nChunk = 1;
+		} else {
+			fontFileRenderGlyphs(surface,mask,font,start,glyph,nChunk);
+		}
+		start.x += nChunk * (font->width + font->distChar);
+	}
+	run->n = 0;
+}
+
+// return the tile cache slot holding the given character code in the font's
+// current style; on a miss, the symbol is rendered into the least recently
+// used slot; returns -1 if the symbol could not be retrieved
+int32_t fontFileTileGet(FontFileData *font, int32_t uCode) {
+	uint16_t i,iFree = 0;
+	FontFileTile *tile;
 	
+	if (font->tileClock == UINT32_MAX) {
+		// restart the access counter before it overflows
+		for (i = 0; i < font->nTiles; i++) font->tiles[i].use = 0;
+		font->tileClock = 0;
+	}
+	for (i = 0; i < font->nTiles; i++) {
+		tile = &font->tiles[i];
+		if (tile->code == uCode && tile->colour == font->colour && tile->alpha == font->alpha &&
+		    tile->colourBg == font->colourBg && tile->alphaBg == font->alphaBg) {
+			// cache hit
+			tile->use = ++font->tileClock;
+			return i;
+		}
+		if (tile->use < font->tiles[iFree].use) iFree = i;
+	}
+	
+	// cache miss: look-up symbol and render it into the chosen slot
+	uint8_t uCodeBytes[3];
 	uCodeBytes[0] = (uCode & 0xff0000) >> 16;
 	uCodeBytes[1] = (uCode & 0x00ff00) >> 8;
 	uCodeBytes[2] = (uCode & 0x0000ff);
-	value = font->V + 3 + fontFileLookUpIndex(font,uCodeBytes)*font->sizeVEntry;
-	
-	// edit starting point and dimensions so that rendering starts
-	// and ends inside the visible surface area
-	width = font->width;
-	if (cursor->x < 0) {
-		xStartFont = -cursor->x;
-		value += -cursor->x*font->sizeVWord;
-		xStart = 0;
-	} else { 
-		xStartFont = 0;
-		xStart = cursor->x;
-	}
-	if (xStart + width > surface->width) {
-		width = surface->width - xStart;
-	}
-	
-	height = font->height;
-	if (cursor->y < 0) {
-		yStartFont = -cursor->y;
-		yStart = 0;
-	} else { 
-		yStartFont = 0;
-		yStart = cursor->y;
-	}
-	if (yStart + height > surface->height) {
-		height = surface->height - yStart;
-	}
-	
-	if (width > 0 && height > 0) {
-		// character at least partial visible: draw it
-		iSurfaceStart = yStart * surface->width + xStart;
-		for (x = xStartFont; x < width; x++) {
-			yMask = yStart;
-			iSurface = iSurfaceStart;
-			bitmask = 0;
-			for (y = yStartFont; y < height; y++) {
-				if (*(value+(y>>3)) & (1 << (y & 7))) {
-					// blend foreground colour
-					if (surfacePixelBlend(
-							font->colour,font->alpha,
-							surface->rgb565[iSurface],surface->alpha[iSurface],
-							&surface->rgb565[iSurface],&surface->alpha[iSurface],
-							font->mode)) bitmask |= 1 << (yMask >> 3); // pixel changed: mark in bitmask
-				} else {
-					// blend background colour
-					if (surfacePixelBlend(
-							font->colourBg,font->alphaBg,
-							surface->rgb565[iSurface],surface->alpha[iSurface],
-							&surface->rgb565[iSurface],&surface->alpha[iSurface],
-							font->mode)) bitmask |= 1 << (yMask >> 3); // pixel changed: mark in bitmask
-				}
-				iSurface += surface->width;
-				yMask++;
+	uint8_t *value = fontFileGetEntry(font,fontFileLookUpIndex(font,uCodeBytes),UINT32_MAX);
+	if (value == NULL) return -1;
+	value += font->sizeVHead;
+	
+	tile = &font->tiles[iFree];
+	tile->code = uCode;
+	tile->colour = font->colour;
+	tile->alpha = font->alpha;
+	tile->colourBg = font->colourBg;
+	tile->alphaBg = font->alphaBg;
+	tile->xMinInk = font->width;
+	tile->yMinInk = font->height;
+	tile->xMaxInk = 0;
+	tile->yMaxInk = 0;
+	tile->use = ++font->tileClock;
+	
+	uint16_t *colour = font->tileRgb565 + iFree * font->width * font->height;
+	uint8_t  *alpha  = font->tileAlpha  + iFree * font->width * font->height;
+	bool isSet;
+	for (uint8_t y = 0; y < font->height; y++) {
+		for (uint8_t x = 0; x < font->width; x++) {
+			if (font->flags & FAFF_FLAG_ROWMAJOR)
+				isSet = value[y * font->sizeVWord + (x >> 3)] & (1 << (x & 7));
+			else
+				isSet = value[x * font->sizeVWord + (y >> 3)] & (1 << (y & 7));
+			if (isSet) {
+				*colour++ = font->colour;
+				*alpha++  = font->alpha;
+				if (x < tile->xMinInk) tile->xMinInk = x;
+				if (y < tile->yMinInk) tile->yMinInk = y;
+				if (x >= tile->xMaxInk) tile->xMaxInk = x + 1;
+				if (y >= tile->yMaxInk) tile->yMaxInk = y + 1;
+			} else {
+				*colour++ = font->colourBg;
+				*alpha++  = font->alphaBg;
 			}
-			surfaceModSetCol(mask,xStart,bitmask);
-			iSurfaceStart++;
-			xStart++;
-			value += font->sizeVWord;
 		}
 	}
+	return iFree;
+}
+
+// blend the given tile cache slot onto the surface, upper left corner at p;
+// with a transparent background, only the tile's ink box is blended
+void fontFileTileDraw(Surface *surface, SurfaceMod *mask, FontFileData *font, Point p, uint16_t iTile) {
+	FontFileTile *tile = &font->tiles[iTile];
+	const bool isNop = font->mode == BLEND_OVER || font->mode == BLEND_ATOP || font->mode == BLEND_XOR || font->mode == BLEND_PLUS;
+	int32_t xStart = 0, yStart = 0, xStop = font->width, yStop = font->height;
+	
+	if (isNop && tile->alphaBg == 0) {
+		xStart = tile->xMinInk;
+		yStart = tile->yMinInk;
+		xStop  = tile->xMaxInk;
+		yStop  = tile->yMaxInk;
+	}
+	// clip the tile area (font coordinates) to the surface
+	if (p.x + xStart < 0) xStart = -p.x;
+	if (p.y + yStart < 0) yStart = -p.y;
+	if (p.x + xStop > surface->width)  xStop = surface->width - p.x;
+	if (p.y + yStop > surface->height) yStop = surface->height - p.y;
+	if (xStart >= xStop) return;
+	
+	uint32_t i = iTile * font->width * font->height + yStart * font->width + xStart;
+	for (int32_t y = yStart; y < yStop; y++, i += font->width) {
+		surfaceModSetRow(mask,p.y + y,
+			surfaceBlendSpan(font->tileRgb565 + i,font->tileAlpha + i,255,surface,surface,p.x + xStart,p.y + y,xStop - xStart,font->mode));
+	}
+}
+
+// look-up a character code in the given font data structure and append the
+// retrieved symbol to the given text run; a full run is rendered immediately;
+// if a tile cache is set up, the symbol's tile is drawn instead
+// Note: cursor is moved on automatically afterwards (x += width + distChar)
+void fontFileRunPush(Surface *surface, SurfaceMod *mask, FontFileData *font, FontFileRun *run, Point *cursor, int32_t uCode) {
+	int32_t iTile = (font->nTiles > 0) ? fontFileTileGet(font,uCode) : -1;
+	if (iTile >= 0) {
+		fontFileTileDraw(surface,mask,font,*cursor,iTile);
+	} else {
+		uint8_t uCodeBytes[3];
+		uCodeBytes[0] = (uCode & 0xff0000) >> 16;
+		uCodeBytes[1] = (uCode & 0x00ff00) >> 8;
+		uCodeBytes[2] = (uCode & 0x0000ff);
+		if (run->n == 0) run->start = *cursor;
+		run->index[run->n++] = fontFileLookUpIndex(font,uCodeBytes);
+		if (run->n == FAFF_RUN_LENGTH) fontFileRunFlush(surface,mask,font,run);
+	}
 	cursor->x += font->width + font->distChar;
 }
 
@@ -532,14 +838,51 @@ int64_t fontFileGetUTF8Length(char *string) {
 // text rendering functions
 //------------------------------------------------------------------------------
 
-BoundingBox fontFilePrint(Surface *surface, SurfaceMod *mask, FontFileData *font, Point p, char *text, ...) {
-	// sanity check
-	if (surface == NULL || mask == NULL || font == NULL) return boundingBoxCreate(0,0,0,0);
-	
-	// initialise argument list
-	va_list args;
-	va_start(args,text);
-	
+// destination of the glyphs produced by fontFileProcess(): either a surface,
+// with glyphs collected in a text run, or a layout (surface == NULL)
+typedef struct {
+	Surface     *surface;
+	SurfaceMod  *mask;
+	FontFileRun run;
+	FontLayout  *layout;
+	int8_t      retval;
+} FontFileSink;
+
+// pass a character code at the cursor position to the given sink and move the
+// cursor on (x += width + distChar)
+void fontFileSinkPut(FontFileSink *sink, FontFileData *font, Point *cursor, int32_t uCode) {
+	if (sink->surface != NULL) {
+		fontFileRunPush(sink->surface,sink->mask,font,&sink->run,cursor,uCode);
+		return;
+	}
+	FontLayout *layout = sink->layout;
+	if (layout->n < layout->size) {
+		// record glyph and extend the layout's bounding box by its cell
+		if (layout->n == 0) {
+			layout->bb.min = *cursor;
+			layout->bb.max = *cursor;
+		}
+		if (cursor->x < layout->bb.min.x) layout->bb.min.x = cursor->x;
+		if (cursor->y < layout->bb.min.y) layout->bb.min.y = cursor->y;
+		if (cursor->x + font->width  > layout->bb.max.x) layout->bb.max.x = cursor->x + font->width;
+		if (cursor->y + font->height > layout->bb.max.y) layout->bb.max.y = cursor->y + font->height;
+		layout->glyph[layout->n].code = uCode;
+		layout->glyph[layout->n].p = *cursor;
+		layout->n++;
+	} else {
+		sink->retval = RET_FAFF_BUFFER;
+	}
+	cursor->x += font->width + font->distChar;
+}
+
+// tell the given sink that the cursor is about to jump
+void fontFileSinkBreak(FontFileSink *sink, FontFileData *font) {
+	if (sink->surface != NULL) fontFileRunFlush(sink->surface,sink->mask,font,&sink->run);
+}
+
+// parse text and format strings, pass the resulting characters to the given
+// sink; returns the envelope of the cursor positions (cf. fontFilePrint())
+BoundingBox fontFileProcess(FontFileSink *sink, FontFileData *font, Point p, char *text, va_list args) {
 	// prepare bounding box
 	BoundingBox bb;
 	bb.min = p;
@@ -563,18 +906,21 @@ BoundingBox fontFilePrint(Surface *surface, SurfaceMod *mask, FontFileData *font
 			switch (uCode) {
 				case 0x0008:
 					// backspace character: move p one symbol back
+					fontFileSinkBreak(sink,font);
 					cursor.x -= font->width + font->distChar;
 					if (cursor.x < bb.min.x) bb.min.x = cursor.x;
 					continue;
 					
 				case 0x0009:
 					// horizontal tabulator: move cursor font->tabWidth steps forth
+					fontFileSinkBreak(sink,font);
 					cursor.x += font->tabWidth * (font->width + font->distChar);
 					if (cursor.x > bb.max.x) bb.max.x = cursor.x;
 					continue;
 					
 				case 0x000a:
 					// line feed: UNIX newline, move cursor to the beginning of the next line
+					fontFileSinkBreak(sink,font);
 					cursor.x = p.x;
 					cursor.y += font->height + font->distLine;
 					if (cursor.y > bb.max.y) bb.max.y = cursor.y;
@@ -582,12 +928,14 @@ BoundingBox fontFilePrint(Surface *surface, SurfaceMod *mask, FontFileData *font
 					
 				case 0x000b:
 					// vertical tabulator
+					fontFileSinkBreak(sink,font);
 					cursor.y += font->tabWidth * (font->height + font->distLine);
 					if (cursor.y > bb.max.y) bb.max.y = cursor.y;
 					continue;
 					
 				case 0x000d:
 					// carriage return: move cursor the the beginning of this line
+					fontFileSinkBreak(sink,font);
 					cursor.x = p.x;
 					continue;
 					
@@ -613,18 +961,18 @@ BoundingBox fontFilePrint(Surface *surface, SurfaceMod *mask, FontFileData *font
 						if (!(flags & FAFF_FMT_MINUS)) {
 							// minus flag not set: right-align, thus prepend remaining width as spaces
 							while (width > 0) {
-								fontFileLookUpAndDraw(surface,mask,font,&cursor,0x20);
+								fontFileSinkPut(sink,font,&cursor,0x20);
 								width--;
 							}
 						}
 						while (*valueString) {
 							uCode = fontFileGetNextUTF8(&valueString);
-							fontFileLookUpAndDraw(surface,mask,font,&cursor,uCode);
+							fontFileSinkPut(sink,font,&cursor,uCode);
 						}
 						if (flags & FAFF_FMT_MINUS) {
 							// minus flag set: left-align, thus fill remaining width with spaces
 							while (width> 0) {
-								fontFileLookUpAndDraw(surface,mask,font,&cursor,0x20);
+								fontFileSinkPut(sink,font,&cursor,0x20);
 								width--;
 							}
 						}
@@ -647,16 +995,16 @@ BoundingBox fontFilePrint(Surface *surface, SurfaceMod *mask, FontFileData *font
 					// 2. check sign and draw it if needed
 					if (valueInt < 0) {
 						// negative value: always paint sign, make value absolute for following algorithm
-						fontFileLookUpAndDraw(surface,mask,font,&cursor,0x2d);
+						fontFileSinkPut(sink,font,&cursor,0x2d);
 						valueInt = -valueInt;
 						width--; // sign is part of the field width
 					} else if (flags & FAFF_FMT_PLUS) {
 						// positive value and plus specified: paint plus
-						fontFileLookUpAndDraw(surface,mask,font,&cursor,0x2b);
+						fontFileSinkPut(sink,font,&cursor,0x2b);
 						width--; // sign is part of the field width
 					} else if (flags & FAFF_FMT_SPACE) {
 						// positive value and SPACE specified: paint SPACE
-						fontFileLookUpAndDraw(surface,mask,font,&cursor,0x20);
+						fontFileSinkPut(sink,font,&cursor,0x20);
 						width--; // sign is part of the field width
 					}
 					// 3. calculate digits; adjust parsed field width
@@ -675,7 +1023,7 @@ BoundingBox fontFilePrint(Surface *surface, SurfaceMod *mask, FontFileData *font
 						digit = (flags & FAFF_FMT_PAD0) ? 0x30 : 0x20;
 						while (width > 0) {
 							// as long as width is left: draw pad digit, move cursor one character right
-							fontFileLookUpAndDraw(surface,mask,font,&cursor,digit);
+							fontFileSinkPut(sink,font,&cursor,digit);
 							width--;
 						}
 					}
@@ -686,14 +1034,14 @@ BoundingBox fontFilePrint(Surface *surface, SurfaceMod *mask, FontFileData *font
 						if (digit > 0x39) digit += (flags & FAFF_FMT_HEXLOWER) ? 0x27 : 0x07 ; 
 						valueInt %= factor;
 						factor /= base;
-						fontFileLookUpAndDraw(surface,mask,font,&cursor,digit);
+						fontFileSinkPut(sink,font,&cursor,digit);
 					}
 					// 6. if any width remains, and left-alignment is requested (flag 'minus'):
 					//    pad value after printed digits (only with space, ignore any PAD0)
 					if (flags & FAFF_FMT_MINUS) {
 						while (width > 0) {
 							// as long as width is left: draw pad digit, move cursor one character right
-							fontFileLookUpAndDraw(surface,mask,font,&cursor,0x20);
+							fontFileSinkPut(sink,font,&cursor,0x20);
 							width--;
 						}
 					}
@@ -702,12 +1050,12 @@ BoundingBox fontFilePrint(Surface *surface, SurfaceMod *mask, FontFileData *font
 					continue;
 			}
 			// pre-processing the code fell through: look-up and draw character symbol
-			fontFileLookUpAndDraw(surface,mask,font,&cursor,uCode);
+			fontFileSinkPut(sink,font,&cursor,uCode);
 		}
 	}
 	
-	// free argument list
-	va_end(args);
+	// pass on remaining glyphs
+	fontFileSinkBreak(sink,font);
 	
 	// printed entire string; bounding box describes the envelope of the cursor (upper left character pixel)
 	// thus add width and height to get the real maximum coordinates of the text
@@ -717,3 +1065,150 @@ BoundingBox fontFilePrint(Surface *surface, SurfaceMod *mask, FontFileData *font
 	return bb;
 }
 
+
+
+BoundingBox fontFilePrint(Surface *surface, SurfaceMod *mask, FontFileData *font, Point p, char *text, ...) {
+	PROFILE_SCOPE(PROFILE_FONT_PRINT);
+	// sanity check
+	if (surface == NULL || mask == NULL || font == NULL) return boundingBoxCreate(0,0,0,0);
+	
+	// render text via a text run
+	FontFileSink sink;
+	sink.surface = surface;
+	sink.mask = mask;
+	sink.run.n = 0;
+	sink.layout = NULL;
+	sink.retval = RET_FAFF_OK;
+	
+	va_list args;
+	va_start(args,text);
+	BoundingBox bb = fontFileProcess(&sink,font,p,text,args);
+	va_end(args);
+	return bb;
+}
+
+
+//------------------------------------------------------------------------------
+// text layout functions
+//------------------------------------------------------------------------------
+
+FontLayout *fontLayoutConstruct(uint16_t size) {
+	FontLayout *layout = (FontLayout*)memoryAlloc(sizeof(FontLayout));
+	if (layout == NULL) return NULL;
+	layout->glyph = (FontLayoutGlyph*)memoryAlloc(size*sizeof(FontLayoutGlyph));
+	if (layout->glyph == NULL && size > 0) {
+		memoryFree(layout);
+		return NULL;
+	}
+	layout->size = size;
+	layout->n = 0;
+	layout->bb = boundingBoxCreate(0,0,0,0);
+	return layout;
+}
+
+void fontLayoutDestruct(FontLayout **layout) {
+	memoryFree((*layout)->glyph);
+	memoryFree(*layout);
+	*layout = NULL;
+}
+
+int8_t fontFileMeasure(FontLayout *layout, FontFileData *font, char *text, ...) {
+	if (layout == NULL || font == NULL || text == NULL) return RET_FAFF_ARGS;
+	
+	// collect glyphs relative to the origin
+	FontFileSink sink;
+	sink.surface = NULL;
+	sink.mask = NULL;
+	sink.run.n = 0;
+	sink.layout = layout;
+	sink.retval = RET_FAFF_OK;
+	layout->n = 0;
+	layout->bb = boundingBoxCreate(0,0,0,0);
+	
+	va_list args;
+	va_start(args,text);
+	fontFileProcess(&sink,font,createPoint(0,0),text,args);
+	va_end(args);
+	return sink.retval;
+}
+
+BoundingBox fontFileDraw(Surface *surface, SurfaceMod *mask, FontFileData *font, FontLayout *layout, Point p) {
+	PROFILE_SCOPE(PROFILE_FONT_PRINT);
+	if (surface == NULL || mask == NULL || font == NULL || layout == NULL) return boundingBoxCreate(0,0,0,0);
+	
+	FontFileRun run;
+	run.n = 0;
+	Point cursor;
+	const int32_t advance = font->width + font->distChar;
+	
+	for (uint16_t i = 0; i < layout->n; i++) {
+		cursor.x = p.x + layout->glyph[i].p.x;
+		cursor.y = p.y + layout->glyph[i].p.y;
+		// glyphs outside the surface are skipped without look-up
+		if (cursor.x >= surface->width || cursor.x + font->width <= 0 || cursor.y >= surface->height || cursor.y + font->height <= 0) continue;
+		// glyph not adjacent to the current run: render the run first
+		if (run.n > 0 && (cursor.y != run.start.y || cursor.x != run.start.x + run.n * advance))
+			fontFileRunFlush(surface,mask,font,&run);
+		fontFileRunPush(surface,mask,font,&run,&cursor,layout->glyph[i].code);
+	}
+	fontFileRunFlush(surface,mask,font,&run);
+	
+	BoundingBox bb = layout->bb;
+	bb.min.x += p.x;
+	bb.min.y += p.y;
+	bb.max.x += p.x;
+	bb.max.y += p.y;
+	return bb;
+}
+
+Point fontLayoutAlign(FontLayout *layout, BoundingBox box, uint8_t align) {
+	Point p;
+	if (layout == NULL) return box.min;
+	int32_t width  = layout->bb.max.x - layout->bb.min.x;
+	int32_t height = layout->bb.max.y - layout->bb.min.y;
+	
+	// horizontal alignment; box coordinates are inclusive
+	switch (align & FAFF_ALIGN_HMASK) {
+		case FAFF_ALIGN_CENTRE: p.x = box.min.x + (box.max.x - box.min.x + 1 - width) / 2; break;
+		case FAFF_ALIGN_RIGHT:  p.x = box.max.x + 1 - width; break;
+		default:                p.x = box.min.x; break;
+	}
+	// vertical alignment
+	switch (align & FAFF_ALIGN_VMASK) {
+		case FAFF_ALIGN_MIDDLE: p.y = box.min.y + (box.max.y - box.min.y + 1 - height) / 2; break;
+		case FAFF_ALIGN_BOTTOM: p.y = box.max.y + 1 - height; break;
+		default:                p.y = box.min.y; break;
+	}
+	// move the layout's box, not its origin, to the aligned position
+	p.x -= layout->bb.min.x;
+	p.y -= layout->bb.min.y;
+	return p;
+}
+
+bool fontLayoutEqual(FontLayout *layout, FontLayout *other) {
+	if (layout == NULL || other == NULL) return false;
+	if (layout->n != other->n) return false;
+	return memcmp(layout->glyph,other->glyph,layout->n*sizeof(FontLayoutGlyph)) == 0;
+}
+
+
+//------------------------------------------------------------------------------
+// profiling overlay
+//------------------------------------------------------------------------------
+
+#ifdef FAPROFILE
+void fontFileDrawProfile(Surface *surface, SurfaceMod *mask, FontFileData *font, Point p) {
+	if (surface == NULL || mask == NULL || font == NULL) return;
+	ProfileStats stats;
+	for (uint8_t i = 0; i < PROFILE_CHANNELS && p.y + font->height <= surface->height; i++) {
+		if (!profileGetStats(i,&stats)) return;
+		if (i < PROFILE_FRAME_TIME && stats.calls == 0) continue;
+		// probes and frame time in kilocycles, counters as they are
+		if (i <= PROFILE_FRAME_TIME)
+			fontFilePrint(surface,mask,font,p,"%s %i/%i",(char*)profileGetName(i),(int)(stats.avg / 1000),(int)(stats.max / 1000));
+		else
+			fontFilePrint(surface,mask,font,p,"%s %i",(char*)profileGetName(i),(int)stats.avg);
+		p.y += font->height;
+	}
+}
+#endif // FAPROFILE
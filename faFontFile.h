@@ -3,7 +3,7 @@
 /**
  * @file
  * @author Frank Abelbeck <frank.abelbeck@googlemail.com>
- * @version 2020-03-05
+ * @version 2026-10-14
  * 
  * @section License
  * 
@@ -27,6 +27,7 @@
 
 #include <stdlib.h> // uses: malloc(), free()
 #include <stdint.h> // uses: int8_t, uint8_t, int16_t, uint16_t, uint32_t
+#include <stdbool.h> // uses: bool
 
 #include "epicardium.h" // used for file access
 #include "faSurfaceBase.h"
@@ -43,12 +44,28 @@
 #define RET_FAFF_REPLCHAR -6 ///< replacement character not found
 #define RET_FAFF_ARGS     -7 ///< invalid arguments passed
 #define RET_FAFF_BUFFER   -8 ///< failed to set-up bitmap buffer
+#define RET_FAFF_FORMAT   -9 ///< unsupported format flags
 
 #define FNV1PRIME  0x01000193 ///< Fowler-Noll-Vo 1 32 bit hash prime
 #define FNV1OFFSET 0x811c9dc5 ///< Fowler-Noll-Vo 1 32 bit hash offset
 #define FNV1MASK   0x7fffffff ///< hash mask, maximum value of int32_t
 #define MAXUCODE   0x10ffff   ///< maximum Unicode code number
 
+#define FAFF_FLAG_ROWMAJOR 0x01 ///< format flag: symbols stored row by row (extended format 0xfa 0xfe only)
+#define FAFF_FLAG_INKBOX   0x02 ///< format flag: V entries include an ink bounding box (extended format 0xfa 0xfe only)
+#define FAFF_FLAGS_KNOWN   (FAFF_FLAG_ROWMAJOR | FAFF_FLAG_INKBOX) ///< all format flags supported by this library
+
+#define FAFF_ALIGN_LEFT    0x00 ///< layout alignment: left edge of the box
+#define FAFF_ALIGN_CENTRE  0x01 ///< layout alignment: horizontally centred in the box
+#define FAFF_ALIGN_RIGHT   0x02 ///< layout alignment: right edge of the box
+#define FAFF_ALIGN_HMASK   0x03 ///< layout alignment: mask of the horizontal alignment bits
+#define FAFF_ALIGN_TOP     0x00 ///< layout alignment: top edge of the box
+#define FAFF_ALIGN_MIDDLE  0x04 ///< layout alignment: vertically centred in the box
+#define FAFF_ALIGN_BOTTOM  0x08 ///< layout alignment: bottom edge of the box
+#define FAFF_ALIGN_VMASK   0x0c ///< layout alignment: mask of the vertical alignment bits
+
+#define FAFF_RUN_LENGTH 32 ///< maximum number of glyphs rendered together as one text run
+
 #define FAFF_FMT_NONE     0b0000000000000000 ///< format string: invalid
 #define FAFF_FMT_FLAGS    0b0000000000000001 ///< format string: flags mode
 #define FAFF_FMT_PLUS     0b0000000000000010 ///< format string: plus flag
@@ -72,18 +89,43 @@
 //  * at most 0x10fff characters
 //  * size of an value table entry at size 256x256:
 //      + 3 bytes character code
+//      + 4 bytes ink bounding box (optional)
 //      + 256 bitmask words, 32 bytes per word
-//      = 8195 bytes per entry
+//      = 8199 bytes per entry
+
+/** Data structure of a tile cache slot: one symbol pre-rendered in one style */
+typedef struct {
+	int32_t   code; ///< Unicode character code; -1 if the slot is unused
+	uint16_t  colour; ///< character colour of the tile
+	uint8_t   alpha; ///< character alpha value of the tile
+	uint16_t  colourBg; ///< character background colour of the tile
+	uint8_t   alphaBg; ///< character background alpha value of the tile
+	uint8_t   xMinInk,yMinInk,xMaxInk,yMaxInk; ///< box enclosing all foreground pixels (maximum exclusive)
+	uint32_t  use; ///< access time stamp, for least-recently-used replacement
+} FontFileTile;
 
 /** Data structure of a faFontFile */
 typedef struct {
 	uint8_t   width,height; ///< width and height of a character symbol 
 	uint32_t  nChars; ///< number of characters in the set
 	int32_t   *G; ///< intermediate table for minimal perfect hash lookup
-	uint8_t   *V; ///< value table with codes+symbol data
-	uint8_t   sizeVWord; ///< size of one V entry word; equals ((height-1)/8+1
-	uint16_t  sizeVEntry; ///< size of a V entry; equals width*((height-1)/8+1) + 3
+	uint8_t   *V; ///< value table with codes+symbol data; in paged mode the glyph cache with nCache entries
+	uint8_t   flags; ///< format flags (FAFF_FLAG_*); zero for files with signature 0xfa 0xff
+	uint8_t   sizeVWord; ///< size of one V entry word; equals (height-1)/8+1 (column-major) or (width-1)/8+1 (row-major)
+	uint8_t   sizeVHead; ///< offset of the symbol bitmap in a V entry; 3 (code) or 7 (code + ink bounding box)
+	uint16_t  sizeVEntry; ///< size of a V entry; equals sizeVHead + width*sizeVWord (column-major) or sizeVHead + height*sizeVWord (row-major)
 	int32_t   iReplChar; ///< V entry index of the replacement character (U+FFFD); please note: this is not the absolute byte position in V!
+	int       file; ///< file descriptor of the font file in paged mode; -1 otherwise
+	uint32_t  offsetV; ///< file position of the value table (paged mode)
+	uint16_t  nCache; ///< number of glyph cache slots in paged mode; 0 if V holds the whole value table
+	int32_t   *cacheIndex; ///< V entry index held by each cache slot, -1 if unused (paged mode)
+	uint32_t  *cacheUse; ///< access time stamp of each cache slot, for least-recently-used replacement (paged mode)
+	uint32_t  cacheClock; ///< access counter for cacheUse (paged mode)
+	uint16_t  nTiles; ///< number of tile cache slots; 0 if no tile cache is used
+	FontFileTile *tiles; ///< tile cache slots
+	uint16_t  *tileRgb565; ///< tile colour values, width*height per slot
+	uint8_t   *tileAlpha; ///< tile alpha values, width*height per slot
+	uint32_t  tileClock; ///< access counter for the tiles' time stamps
 	uint8_t   distChar; ///< horizontal distance between individual characters in pixels
 	uint8_t   distLine; ///< vertical distance between lines in pixels
 	uint8_t   tabWidth; ///< number of space characters used per tab character
@@ -94,6 +136,27 @@ typedef struct {
 	uint8_t   mode; ///< blend mode
 } FontFileData;
 
+/** Data structure of a text run: consecutive glyphs on one line, rendered row by row */
+typedef struct {
+	Point     start; ///< upper left corner of the first glyph
+	uint8_t   n; ///< number of glyphs in the run
+	int32_t   index[FAFF_RUN_LENGTH]; ///< V entry indices of the glyphs
+} FontFileRun;
+
+/** Data structure of a laid-out glyph */
+typedef struct {
+	int32_t   code; ///< Unicode character code
+	Point     p; ///< upper left corner of the glyph, relative to the layout origin
+} FontLayoutGlyph;
+
+/** Data structure of a text layout: glyphs with positions, created by fontFileMeasure() */
+typedef struct {
+	uint16_t  size; ///< capacity of the glyph array
+	uint16_t  n; ///< number of glyphs
+	FontLayoutGlyph *glyph; ///< glyph array
+	BoundingBox bb; ///< box enclosing all glyph cells, relative to the origin; max is exclusive (min + extent)
+} FontLayout;
+
 //------------------------------------------------------------------------------
 // function prototypes
 //------------------------------------------------------------------------------
@@ -118,7 +181,8 @@ FontFileData *fontFileConstruct();
 
 /** Destructor: free any allocated memory in a fontFileData structure.
  * 
- * This calls free on all pointers and on the fontFileData structure itself.
+ * This calls memoryFree() on all pointers and on the fontFileData structure itself.
+ * In paged mode, the font file is closed.
  * 
  * @param self Pointer to a pointer to a fontFileData structure.
  */
@@ -136,6 +200,12 @@ void fontFileDestruct(FontFileData **self);
 int32_t fontFileLookUpIndex(FontFileData *self, uint8_t *code);
 
 /** Read given file and populate the fiven FontFileData structure.
+ * 
+ * Both the original format (signature 0xfa 0xff, column-major symbols) and the
+ * extended format (signature 0xfa 0xfe, format flags FAFF_FLAG_*) created by
+ * "faFFTool.py create -r -i" are accepted. Row-major symbols are rendered line
+ * by line; with ink bounding boxes, empty rows and columns are skipped if the
+ * background is transparent.
  * 
  * @param self Pointer to a fontFileData structure.
  * @param filename Address of a filename string (char array).
@@ -144,6 +214,7 @@ int32_t fontFileLookUpIndex(FontFileData *self, uint8_t *code);
  *     - RET_FAFF_OPEN: opening the file failed; structure invalid.
  *     - RET_FAFF_READ: reading the file failed; structure invalid.
  *     - RET_FAFF_MAGIC: faFF signature not detected; structure invalid.
+ *     - RET_FAFF_FORMAT: unsupported format flags; structure invalid.
  *     - RET_FAFF_GTAB: creating G table failed; structure invalid.
  *     - RET_FAFF_VTAB: creating V table failed; structure invalid.
  *     - RET_FAFF_REPLCHAR: replacement character not found; structure invalid.
@@ -151,6 +222,25 @@ int32_t fontFileLookUpIndex(FontFileData *self, uint8_t *code);
  */
 int8_t fontFileRead(FontFileData *self, char *filename);
 
+/** Read given file in paged mode and populate the given FontFileData structure.
+ * 
+ * The G table is read completely, while V entries are fetched on demand from
+ * the file, which stays open until fontFileDestruct() or the next read. The
+ * most recently used nCache entries are held in a glyph cache. This allows
+ * fonts with large character sets that would not fit into memory otherwise.
+ * Text runs are split so that each part fits into the cache: use at least
+ * as many slots as there are different characters in a typical line.
+ * 
+ * If nCache is zero or not smaller than the number of characters, the whole
+ * V table is loaded, equal to fontFileRead().
+ * 
+ * @param self Pointer to a fontFileData structure.
+ * @param filename Address of a filename string (char array).
+ * @param nCache Number of glyph cache slots.
+ * @returns A signed byte (int8_t) with one of the return codes of fontFileRead().
+ */
+int8_t fontFileReadPaged(FontFileData *self, char *filename, uint16_t nCache);
+
 /** Font file reading wrapper function. Load the faFontFile with given filename.
  * 
  * Manages FontFileData automatically.
@@ -160,6 +250,37 @@ int8_t fontFileRead(FontFileData *self, char *filename);
  */
 FontFileData *fontFileLoad(char *filename);
 
+/** Font file reading wrapper function. Load the faFontFile with given filename
+ * in paged mode (cf. fontFileReadPaged()).
+ * 
+ * Manages FontFileData automatically.
+ * 
+ * @param filename Address of a filename string (char array).
+ * @param nCache Number of glyph cache slots.
+ * @returns A pointer to a FontFileData structure. Might be NULL if something went wrong.
+ */
+FontFileData *fontFileLoadPaged(char *filename, uint16_t nCache);
+
+
+/** Set up a tile cache with the given number of slots, replacing any existing
+ * tile cache of the given font.
+ * 
+ * A tile holds a symbol that was pre-rendered in colour, alpha, colourBg and
+ * alphaBg of the font as RGB565+alpha pixels. fontFilePrint() then blends the
+ * tiles of recently used characters row by row without look-up and bitmap
+ * decoding. Changing the colours creates new tiles, the least recently used
+ * ones are replaced. Changing the blend mode has no effect on the tiles.
+ * Each slot needs 3*width*height bytes. Reading another font file discards
+ * the tile cache.
+ * 
+ * @param self Pointer to a fontFileData structure with a font already read.
+ * @param nTiles Number of tile cache slots; 0 removes the tile cache.
+ * @returns A signed byte (int8_t) with one of the following return codes:
+ *     - RET_FAFF_OK: tile cache set up.
+ *     - RET_FAFF_ARGS: invalid arguments passed or no font read.
+ *     - RET_FAFF_BUFFER: allocating the tile cache failed; font has no tile cache.
+ */
+int8_t fontFileTileCacheSetup(FontFileData *self, uint16_t nTiles);
 
 /** Render a character string on a surface using a given bitmap font.
  * 
@@ -206,4 +327,88 @@ FontFileData *fontFileLoad(char *filename);
  */
 BoundingBox fontFilePrint(Surface *surface, SurfaceMod *mask, FontFileData *font, Point p, char *text, ...) ;
 
+/** Constructor: create a text layout with room for the given number of glyphs.
+ * 
+ * @param size Capacity of the layout in glyphs.
+ * @returns A pointer to a FontLayout structure or NULL if something went wrong.
+ */
+FontLayout *fontLayoutConstruct(uint16_t size);
+
+/** Destructor: free any allocated memory of a text layout.
+ * 
+ * @param layout Pointer to a pointer to a FontLayout structure.
+ */
+void fontLayoutDestruct(FontLayout **layout);
+
+/** Lay out a character string without rendering it.
+ * 
+ * The string is processed like in fontFilePrint(), including format
+ * placeholders and control characters; the resulting glyphs and their
+ * positions relative to the origin (0,0) replace the layout's contents. The
+ * layout can then be aligned (fontLayoutAlign()), compared to a previous
+ * layout (fontLayoutEqual()) and drawn (fontFileDraw()) any number of times.
+ * Positions depend on width, height, distChar, distLine and tabWidth of the
+ * font; colours and blend mode are applied when drawing.
+ * 
+ * @param layout Pointer to a FontLayout structure.
+ * @param font Pointer to a FontFileData structure.
+ * @param text Pointer to a char array; text to lay out, optionally followed by
+ *             arguments for the format placeholders (cf. fontFilePrint()).
+ * @returns A signed byte (int8_t) with one of the following return codes:
+ *     - RET_FAFF_OK: text laid out.
+ *     - RET_FAFF_ARGS: invalid arguments passed.
+ *     - RET_FAFF_BUFFER: layout too small; surplus glyphs were dropped.
+ */
+int8_t fontFileMeasure(FontLayout *layout, FontFileData *font, char *text, ...);
+
+/** Render a text layout on a surface.
+ * 
+ * Glyphs outside the surface are skipped; adjacent glyphs are rendered as
+ * text runs, like in fontFilePrint().
+ * 
+ * @param surface Pointer to a Surface structure.
+ * @param mask Pointer to a SurfaceMod structure where changes to the surface are recorded.
+ * @param font Pointer to a FontFileData structure; has to be the font used for fontFileMeasure().
+ * @param layout Pointer to a FontLayout structure.
+ * @param p A Point structure; position of the layout origin on the surface.
+ * @returns The layout's bounding box moved to p.
+ */
+BoundingBox fontFileDraw(Surface *surface, SurfaceMod *mask, FontFileData *font, FontLayout *layout, Point p);
+
+/** Calculate the origin at which a text layout is aligned inside a given box.
+ * 
+ * @param layout Pointer to a FontLayout structure.
+ * @param box A BoundingBox structure (inclusive coordinates, cf. boundingBoxGet()).
+ * @param align Combination of FAFF_ALIGN_* values, one horizontal and one vertical.
+ * @returns A Point structure to be passed to fontFileDraw().
+ */
+Point fontLayoutAlign(FontLayout *layout, BoundingBox box, uint8_t align);
+
+/** Compare two text layouts.
+ * 
+ * Equal layouts produce equal output with the same font and position, so a
+ * label whose layout did not change since the last frame need not be redrawn.
+ * 
+ * @param layout Pointer to a FontLayout structure.
+ * @param other Pointer to another FontLayout structure.
+ * @returns true if both layouts contain the same glyphs at the same positions.
+ */
+bool fontLayoutEqual(FontLayout *layout, FontLayout *other);
+
+#ifdef FAPROFILE
+/** Print a compact profiling overlay onto a surface (cf. faProfile.h).
+ * 
+ * One line per probe called in the last frame (average and maximum per frame
+ * in kilocycles), followed by the frame time and the counters. Lines not
+ * fitting onto the surface are skipped. The overlay itself is counted by
+ * probe PROFILE_FONT_PRINT of the next frame.
+ * 
+ * @param surface Pointer to a Surface structure.
+ * @param mask Pointer to a SurfaceMod structure where changes to the surface are recorded.
+ * @param font Pointer to a FontFileData structure.
+ * @param p Upper left corner of the overlay.
+ */
+void fontFileDrawProfile(Surface *surface, SurfaceMod *mask, FontFileData *font, Point p);
+#endif // FAPROFILE
+
 #endif // _FAFONTFILE_H
@@ -1,7 +1,7 @@
 /**
  * @file
  * @author Frank Abelbeck <frank.abelbeck@googlemail.com>
- * @version 2020-02-06
+ * @version 2026-10-14
  * 
  * @section License
  * 
@@ -23,70 +23,117 @@
  * Framebuffer management routines for the card10 badge.
  */
 
-#include <stdlib.h> // uses: malloc(), free()
+#include <string.h> // uses: memcpy()
+#include <errno.h> // uses: EINVAL
 #include "epicardium.h" // access to disp_framebuffer
 #include "faFramebuffer.h"
 #include "faSurface.h" // access to surface structures
+#include "faMemory.h" // uses: memoryAlloc(), memoryFree()
+#include "faProfile.h" // uses: PROFILE_SCOPE(), PROFILE_COUNT()
 
 union disp_framebuffer *framebufferConstruct(uint16_t colour) {
 	// allocate framebuffer memory
-	union disp_framebuffer *fb = (union disp_framebuffer*)malloc(sizeof(union disp_framebuffer));
+	union disp_framebuffer *fb = (union disp_framebuffer*)memoryAlloc(sizeof(union disp_framebuffer));
 	framebufferClear(fb,colour);
 	return fb;
 }
 
 void framebufferDestruct(union disp_framebuffer **fb) {
-	free(*fb);
+	memoryFree(*fb);
 	*fb = NULL;
 }
 
+//------------------------------------------------------------------------------
+// word-wide framebuffer access
+//------------------------------------------------------------------------------
+
+// note: framebuffer index addressing is reversed and bytes are swapped, i.e.
+// surface pixels i and i+1 map to the 32-bit word at byte offset 2*(N-2-i),
+// which equals the byte-reversed (REV) word of both pixels in surface memory;
+// i must be even, and so is every tile start since tiles are 8 pixels wide
+
+/* Copy an even number of pixels from src to the framebuffer, starting at display index i. */
+static inline void framebufferCopyPixels(union disp_framebuffer *framebuffer, const uint16_t *src, uint16_t i, uint16_t n) {
+	uint8_t *dst = &framebuffer->raw[((DISP_WIDTH * DISP_HEIGHT - 2 - i) << 1)];
+	uint32_t word;
+	for (; n > 1; n -= 2) {
+		memcpy(&word,src,4);
+		word = __builtin_bswap32(word);
+		memcpy(dst,&word,4);
+		src += 2;
+		dst -= 4;
+	}
+}
+
 void framebufferClear(union disp_framebuffer *framebuffer, uint16_t colour) {
 	if (framebuffer != NULL) {
-		// fill framebuffer with given colour
-		// note: framebuffer index addressing is reversed!
-		uint32_t iFramebuffer = 2*DISP_WIDTH*DISP_HEIGHT-1;
-		do {
-			framebuffer->raw[iFramebuffer--] = colour & 0xff; // swap bytes
-			framebuffer->raw[iFramebuffer--] = colour >> 8;   // (according to epicardium doc)
-		} while (iFramebuffer > 1);
+		// fill framebuffer with given colour, two byte-swapped pixels per word
+		uint32_t word = (uint16_t)((colour >> 8) | (colour << 8)) * 0x00010001u;
+		uint8_t *dst = framebuffer->raw;
+		for (uint16_t i = 0; i < (DISP_WIDTH * DISP_HEIGHT) >> 1; i++) {
+			memcpy(dst,&word,4);
+			dst += 4;
+		}
 	}
 }
 
 void framebufferCopySurface(union disp_framebuffer *framebuffer, Surface *surface) {
-	if (framebuffer == NULL || surface == NULL) return;
-	uint32_t iSurface = 0;
-	uint32_t iFramebuffer = ((DISP_HEIGHT * DISP_WIDTH) << 1) - 1;
-	do {
-		framebuffer->raw[iFramebuffer--] = surface->rgb565[iSurface] & 0xff;
-		framebuffer->raw[iFramebuffer--] = surface->rgb565[iSurface] >> 8;
-		iSurface++;
-	} while (iFramebuffer > 1);
+	PROFILE_SCOPE(PROFILE_FB_COPY);
+	if (framebuffer == NULL || surface == NULL || surface->width != DISP_WIDTH || surface->height != DISP_HEIGHT) return;
+	if (surface->stride == DISP_WIDTH) {
+		framebufferCopyPixels(framebuffer,surface->rgb565,0,DISP_WIDTH * DISP_HEIGHT);
+	} else {
+		// view or sub-surface: copy row by row
+		for (uint8_t y = 0; y < DISP_HEIGHT; y++)
+			framebufferCopyPixels(framebuffer,&surface->rgb565[y * surface->stride],y * DISP_WIDTH,DISP_WIDTH);
+	}
 }
 
 void framebufferUpdateFromSurface(union disp_framebuffer *framebuffer, Surface *surface, SurfaceMod *mask) {
+	PROFILE_SCOPE(PROFILE_FB_UPDATE);
 	if (framebuffer == NULL || surface == NULL || mask == NULL || surface->width != DISP_WIDTH || surface->height != DISP_HEIGHT || DISP_HEIGHT > mask->height) return;
 	
+	const uint32_t bitmaskWidth = 0xffffffffu >> (32 - ((DISP_WIDTH + 7) >> 3));
 	uint32_t bitmask;
-	uint8_t x;
-	uint32_t iFramebuffer = ((DISP_WIDTH * DISP_HEIGHT) << 1) - 1;
-	uint16_t iSurface = 0;
-	for (uint8_t y = 0; y < surface->height; y++) {
-		bitmask = mask->tile[y >> 3];
-		if (bitmask == 0) {
-			// empty bitmask: nothing to do for this and the next seven rows
-			iSurface += surface->width << 3;
-			iFramebuffer -= surface->width << 4;
-			y += 7;
-			continue;
-		}
-		for (x = 0; x < surface->width; x++) {
-			if ((1 << (x >> 3)) & bitmask) {
-				framebuffer->raw[iFramebuffer--] = surface->rgb565[iSurface] & 0xff;
-				framebuffer->raw[iFramebuffer--] = surface->rgb565[iSurface] >> 8;
-			} else {
-				iFramebuffer -= 2;
+	uint8_t  y,yMax,xTile,nTile;
+	uint16_t iSurface,iDisplay;
+	for (uint8_t iTile = 0; iTile < (DISP_HEIGHT + 7) >> 3; iTile++) {
+		bitmask = mask->tile[iTile] & bitmaskWidth;
+		yMax = (iTile << 3) + 8;
+		if (yMax > DISP_HEIGHT) yMax = DISP_HEIGHT;
+		// copy whole tiles: one bit test per eight pixels and row
+		while (bitmask != 0) {
+			xTile = __builtin_ctz(bitmask);
+			bitmask &= bitmask - 1;
+			iSurface = (iTile << 3) * surface->stride + (xTile << 3);
+			iDisplay = (iTile << 3) * DISP_WIDTH + (xTile << 3);
+			nTile = ((xTile << 3) + 8 > DISP_WIDTH) ? DISP_WIDTH - (xTile << 3) : 8;
+			for (y = iTile << 3; y < yMax; y++) {
+				framebufferCopyPixels(framebuffer,&surface->rgb565[iSurface],iDisplay,nTile);
+				iSurface += surface->stride;
+				iDisplay += DISP_WIDTH;
 			}
-			iSurface++;
+		}
+	}
+}
+
+void framebufferUpdateFromBand(union disp_framebuffer *framebuffer, Surface *band, uint8_t y, uint32_t bitmask) {
+	PROFILE_SCOPE(PROFILE_FB_UPDATE);
+	if (framebuffer == NULL || band == NULL || band->width != DISP_WIDTH || y + band->height > DISP_HEIGHT) return;
+	
+	bitmask &= 0xffffffffu >> (32 - ((DISP_WIDTH + 7) >> 3));
+	uint8_t  row,xTile,nTile;
+	uint16_t iBand,iDisplay;
+	while (bitmask != 0) {
+		xTile = __builtin_ctz(bitmask);
+		bitmask &= bitmask - 1;
+		iBand = xTile << 3;
+		iDisplay = y * DISP_WIDTH + (xTile << 3);
+		nTile = ((xTile << 3) + 8 > DISP_WIDTH) ? DISP_WIDTH - (xTile << 3) : 8;
+		for (row = 0; row < band->height; row++) {
+			framebufferCopyPixels(framebuffer,&band->rgb565[iBand],iDisplay,nTile);
+			iBand += band->stride;
+			iDisplay += DISP_WIDTH;
 		}
 	}
 }
@@ -95,6 +142,8 @@ void framebufferUpdateFromSurface(union disp_framebuffer *framebuffer, Surface *
  * returns either 0 on success or EBUSY (display already locked).
  */
 int framebufferRedraw(union disp_framebuffer *fb) {
+	PROFILE_SCOPE(PROFILE_FB_REDRAW);
+	PROFILE_COUNT(PROFILE_TILES,FRAMEBUFFER_TILES);
 	// lock display
 	int retval = epic_disp_open();
 	if (retval != 0) return retval;
@@ -106,3 +155,188 @@ int framebufferRedraw(union disp_framebuffer *fb) {
 	epic_disp_close();
 	return retval;
 }
+
+// internal helper function: number of tiles marked in mask inside the display area
+static uint16_t framebufferCountTiles(SurfaceMod *mask) {
+	uint16_t nTiles = 0;
+	uint8_t iMax = (((mask->height < DISP_HEIGHT) ? mask->height : DISP_HEIGHT) + 7) >> 3;
+	for (uint8_t i = 0; i < iMax; i++) nTiles += __builtin_popcount(mask->tile[i] & (0xffffffffu >> (32 - ((DISP_WIDTH + 7) >> 3))));
+	return nTiles;
+}
+
+// internal helper function: transfer the whole framebuffer (mask NULL) or the
+// nTiles tiles marked in mask; the display has to be locked already
+static int framebufferSend(union disp_framebuffer *fb, SurfaceMod *mask, uint16_t nTiles) {
+	PROFILE_SCOPE(PROFILE_FB_REDRAW);
+	PROFILE_COUNT(PROFILE_TILES,(mask != NULL) ? nTiles : FRAMEBUFFER_TILES);
+#ifdef FAFRAMEBUFFER_PARTIAL
+	if (mask != NULL && nTiles <= FRAMEBUFFER_PARTIAL_LIMIT) {
+		BoundingBox rects[FRAMEBUFFER_MAX_RECTS];
+		uint16_t band[DISP_WIDTH << 3]; // one tile row, native RGB565
+		uint8_t nRects = surfaceModGetRects(mask,rects,FRAMEBUFFER_MAX_RECTS);
+		int32_t x,y,yBand,xMax,yMax,yBandMax;
+		uint16_t iBand,iFramebuffer;
+		int retval = 0;
+		
+		for (uint8_t i = 0; i < nRects && retval == 0; i++) {
+			xMax = (rects[i].max.x < DISP_WIDTH)  ? rects[i].max.x : DISP_WIDTH - 1;
+			yMax = (rects[i].max.y < DISP_HEIGHT) ? rects[i].max.y : DISP_HEIGHT - 1;
+			if (rects[i].min.x > xMax || rects[i].min.y > yMax) continue;
+			// transfer rectangle in bands of at most eight rows;
+			// note: framebuffer index addressing is reversed and byte-swapped!
+			for (yBand = rects[i].min.y; yBand <= yMax && retval == 0; yBand += 8) {
+				yBandMax = (yBand + 7 < yMax) ? yBand + 7 : yMax;
+				iBand = 0;
+				for (y = yBand; y <= yBandMax; y++) {
+					iFramebuffer = DISP_WIDTH * DISP_HEIGHT - 1 - (y * DISP_WIDTH + rects[i].min.x);
+					for (x = rects[i].min.x; x <= xMax; x++) {
+						band[iBand++] = ((uint16_t)fb->raw[iFramebuffer << 1] << 8) | fb->raw[(iFramebuffer << 1) + 1];
+						iFramebuffer--;
+					}
+				}
+				retval = epic_disp_blit(rects[i].min.x,yBand,xMax - rects[i].min.x + 1,yBandMax - yBand + 1,band,EPIC_RGB565);
+			}
+		}
+		if (retval == 0) retval = epic_disp_update();
+		return retval;
+	}
+#endif
+	return epic_disp_framebuffer(fb);
+}
+
+/* Send only the modified parts of given framebuffer to the display; see header
+ * for the decision between skipping, partial and full transfer.
+ */
+int framebufferRedrawMask(union disp_framebuffer *fb, SurfaceMod *mask) {
+	if (mask == NULL) return framebufferRedraw(fb);
+	
+	// count modified tiles; nothing modified means nothing to transfer
+	uint16_t nTiles = framebufferCountTiles(mask);
+	if (nTiles == 0) return 0;
+	
+	// lock display, transfer and unlock
+	int retval = epic_disp_open();
+	if (retval != 0) return retval;
+	retval = framebufferSend(fb,mask,nTiles);
+	epic_disp_close();
+	return retval;
+}
+
+//------------------------------------------------------------------------------
+// presenter: double-buffered display transfer with frame pacing
+//------------------------------------------------------------------------------
+
+// internal helper function: copy the tiles marked in mask (all if NULL) from one framebuffer to another
+static void framebufferCopyTiles(union disp_framebuffer *destination, union disp_framebuffer *source, SurfaceMod *mask) {
+	if (mask == NULL) {
+		memcpy(destination->raw,source->raw,sizeof(destination->raw));
+		return;
+	}
+	const uint32_t bitmaskWidth = 0xffffffffu >> (32 - ((DISP_WIDTH + 7) >> 3));
+	uint32_t bitmask;
+	uint8_t  y,yMax,xTile,nTile;
+	uint16_t offset;
+	uint8_t  iMax = (((mask->height < DISP_HEIGHT) ? mask->height : DISP_HEIGHT) + 7) >> 3;
+	for (uint8_t iTile = 0; iTile < iMax; iTile++) {
+		bitmask = mask->tile[iTile] & bitmaskWidth;
+		yMax = (iTile << 3) + 8;
+		if (yMax > DISP_HEIGHT) yMax = DISP_HEIGHT;
+		while (bitmask != 0) {
+			xTile = __builtin_ctz(bitmask);
+			bitmask &= bitmask - 1;
+			nTile = ((xTile << 3) + 8 > DISP_WIDTH) ? DISP_WIDTH - (xTile << 3) : 8;
+			// reversed addressing: the pixels of a tile row are one contiguous byte range
+			for (y = iTile << 3; y < yMax; y++) {
+				offset = (DISP_WIDTH * DISP_HEIGHT - (y * DISP_WIDTH + (xTile << 3)) - nTile) << 1;
+				memcpy(&destination->raw[offset],&source->raw[offset],nTile << 1);
+			}
+		}
+	}
+}
+
+Presenter *presenterConstruct(uint16_t colour, uint8_t fps, bool doubleBuffered) {
+	Presenter *presenter = (Presenter*)memoryAlloc(sizeof(Presenter));
+	if (presenter == NULL) return NULL;
+	presenter->buffer[0] = framebufferConstruct(colour);
+	presenter->buffer[1] = (doubleBuffered) ? framebufferConstruct(colour) : presenter->buffer[0];
+	presenter->stale = surfaceModConstruct(DISP_HEIGHT);
+	presenter->back = 0;
+	presenter->isStaleAll = false;
+	presenter->isOpen = false;
+	presenter->nFrames = 0;
+	presenter->nLate = 0;
+	presenterSetFps(presenter,fps);
+	if (presenter->buffer[0] == NULL || presenter->buffer[1] == NULL || presenter->stale == NULL) {
+		presenterDestruct(&presenter);
+		return NULL;
+	}
+	// keep the display locked across frames; retried by presenterPresent() if busy
+	presenter->isOpen = (epic_disp_open() == 0);
+	return presenter;
+}
+
+void presenterDestruct(Presenter **self) {
+	if (*self == NULL) return;
+	if ((*self)->isOpen) epic_disp_close();
+	if ((*self)->buffer[1] != (*self)->buffer[0]) framebufferDestruct(&(*self)->buffer[1]);
+	framebufferDestruct(&(*self)->buffer[0]);
+	surfaceModDestruct(&(*self)->stale);
+	memoryFree(*self);
+	*self = NULL;
+}
+
+void presenterSetFps(Presenter *presenter, uint8_t fps) {
+	if (presenter == NULL) return;
+	presenter->interval = (fps > 0) ? 1000 / fps : 0;
+	presenter->timeDue = 0;
+}
+
+union disp_framebuffer *presenterBegin(Presenter *presenter, bool overwrite) {
+	if (presenter == NULL) return NULL;
+	union disp_framebuffer *back = presenter->buffer[presenter->back];
+	// catch up with the frame presented from the other buffer
+	if (!overwrite && back != presenter->buffer[presenter->back ^ 1])
+		framebufferCopyTiles(back,presenter->buffer[presenter->back ^ 1],(presenter->isStaleAll) ? NULL : presenter->stale);
+	surfaceModClear(presenter->stale);
+	presenter->isStaleAll = false;
+	return back;
+}
+
+int presenterPresent(Presenter *presenter, SurfaceMod *mask) {
+	if (presenter == NULL) return -EINVAL;
+	
+	// pacing: sleep until the frame is due; every late frame restarts the schedule
+	if (presenter->interval > 0) {
+		uint64_t now = epic_rtc_get_milliseconds();
+		if (presenter->timeDue > now) {
+			epic_sleep((uint32_t)(presenter->timeDue - now));
+			presenter->timeDue += presenter->interval;
+		} else {
+			if (presenter->timeDue != 0 && now > presenter->timeDue) presenter->nLate++;
+			presenter->timeDue = now + presenter->interval;
+		}
+	}
+	presenter->nFrames++;
+	
+	// nothing modified: neither transfer nor swap
+	uint16_t nTiles = (mask != NULL) ? framebufferCountTiles(mask) : 0;
+	if (mask != NULL && nTiles == 0) return 0;
+	
+	int retval = 0;
+	if (!presenter->isOpen) {
+		retval = epic_disp_open();
+		if (retval != 0) return retval;
+		presenter->isOpen = true;
+	}
+	retval = framebufferSend(presenter->buffer[presenter->back],mask,nTiles);
+	
+	// swap: the other buffer misses the tiles of this frame
+	if (presenter->buffer[1] != presenter->buffer[0]) {
+		presenter->back ^= 1;
+		if (mask == NULL)
+			presenter->isStaleAll = true;
+		else
+			surfaceModMerge(presenter->stale,mask);
+	}
+	return retval;
+}
@@ -3,7 +3,7 @@
 /**
  * @file
  * @author Frank Abelbeck <frank.abelbeck@googlemail.com>
- * @version 2020-02-06
+ * @version 2026-10-14
  * 
  * @section License
  * 
@@ -28,6 +28,40 @@
 #include "epicardium.h" // access to disp_framebuffer
 #include "faSurface.h" // access to surface structures
 
+//------------------------------------------------------------------------------
+// constants
+//------------------------------------------------------------------------------
+#define FRAMEBUFFER_MAX_RECTS     8   ///< maximum number of rectangles in a partial display update
+#define FRAMEBUFFER_PARTIAL_LIMIT 100 ///< maximum number of modified tiles (of 200) for a partial display update
+#define FRAMEBUFFER_TILES         (((DISP_WIDTH + 7) >> 3) * ((DISP_HEIGHT + 7) >> 3)) ///< number of 8x8 tiles of the display
+
+//------------------------------------------------------------------------------
+// data structures
+//------------------------------------------------------------------------------
+
+/** Data structure of a presenter: framebuffers, display lock and frame pacing.
+ * 
+ * Frames are rendered into the back buffer (cf. presenterBegin()) and sent by
+ * presenterPresent(), which keeps the display locked across frames and sleeps
+ * until the next frame is due if a target frame rate is set. With double
+ * buffering, the buffers are swapped after each transfer, so that rendering
+ * never touches the buffer being transferred; the back buffer catches up with
+ * the tiles of the previous frame in presenterBegin(). Note that the Epicardium
+ * display calls return only after the transfer, so a second buffer pays off
+ * only with asynchronous transfers; single buffering saves its memory.
+ */
+typedef struct {
+	union disp_framebuffer *buffer[2]; ///< Framebuffers; both point to the same buffer if single-buffered.
+	SurfaceMod *stale;  ///< Tiles of the back buffer missing the last presented frame.
+	uint8_t  back;      ///< Index of the back buffer.
+	bool     isStaleAll; ///< True if the whole back buffer misses the last presented frame.
+	bool     isOpen;    ///< True if the presenter holds the display lock.
+	uint16_t interval;  ///< Target frame interval in milliseconds (0: no pacing).
+	uint64_t timeDue;   ///< Time the next frame is due (cf. epic_rtc_get_milliseconds(); 0: not yet scheduled).
+	uint32_t nFrames;   ///< Number of presented frames.
+	uint32_t nLate;     ///< Number of frames presented after they were due.
+} Presenter;
+
 /** Constructor: create a new framebuffer structure.
  * 
  * @param colour A 16-bit colour value (RGB565) with which to initialise the framebuffer area.
@@ -69,6 +103,19 @@ void framebufferCopySurface(union disp_framebuffer *framebuffer, Surface *surfac
  */
 void framebufferUpdateFromSurface(union disp_framebuffer *framebuffer, Surface *surface, SurfaceMod *mask);
 
+/** Update a band of display rows from a display-wide band surface.
+ * Does nothing if the band surface is not as wide as the framebuffer or does
+ * not fit below row y.
+ * 
+ * Works in place, modifies given framebuffer structure!
+ * 
+ * @param framebuffer pointer to a framebuffer structure.
+ * @param band Pointer to a Surface holding display rows y to y + band->height - 1.
+ * @param y First display row of the band; should be a multiple of 8 (tile row).
+ * @param bitmask Tiles of the band to copy, bit n for columns 8n to 8n+7 (cf. SurfaceMod).
+ */
+void framebufferUpdateFromBand(union disp_framebuffer *framebuffer, Surface *band, uint8_t y, uint32_t bitmask);
+
 /** Send the contents of a given framebuffer to the display.
  *
  * @param framebuffer pointer to a framebuffer.
@@ -76,4 +123,67 @@ void framebufferUpdateFromSurface(union disp_framebuffer *framebuffer, Surface *
  */
 int framebufferRedraw(union disp_framebuffer *fb);
 
+/** Send the modified parts of a given framebuffer to the display.
+ * 
+ * If no tile is marked in mask, the display is not touched at all. Otherwise
+ * the whole framebuffer is sent via framebufferRedraw().
+ * 
+ * If FAFRAMEBUFFER_PARTIAL is defined at compile time and at most
+ * FRAMEBUFFER_PARTIAL_LIMIT tiles are marked, the marked tiles are merged into
+ * at most FRAMEBUFFER_MAX_RECTS rectangles, which are sent with epic_disp_blit()
+ * in bands of up to eight rows, followed by epic_disp_update(). Use this with
+ * firmware that supports windowed display transfers.
+ * 
+ * The mask has to cover every change since the last transfer, e.g. the changes
+ * of the current frame merged with the tiles restored after the previous frame
+ * (cf. surfaceModMerge()).
+ * 
+ * @param framebuffer pointer to a framebuffer.
+ * @param mask Pointer to a SurfaceMod structure; if NULL, the whole framebuffer is sent.
+ * @returns either 0 (success) or EBUSY (display already locked).
+ */
+int framebufferRedrawMask(union disp_framebuffer *fb, SurfaceMod *mask);
+
+/** Constructor: create a presenter with one or two framebuffers and lock the display.
+ * While the presenter exists, the display stays locked; send frames via
+ * presenterPresent() only.
+ * @param colour A 16-bit colour value (RGB565) with which to initialise the framebuffers.
+ * @param fps Target frame rate (0: present frames immediately).
+ * @param doubleBuffered If true, two framebuffers are used alternately.
+ * @returns A pointer to a Presenter structure or NULL if something went wrong.
+ */
+Presenter *presenterConstruct(uint16_t colour, uint8_t fps, bool doubleBuffered);
+
+/** Destructor: unlock the display and free the framebuffers.
+ * @param self Pointer to a pointer to a Presenter structure; set to NULL.
+ */
+void presenterDestruct(Presenter **self);
+
+/** Set the target frame rate; the schedule restarts with the next frame.
+ * @param presenter Pointer to a Presenter structure.
+ * @param fps Target frame rate (0: present frames immediately).
+ */
+void presenterSetFps(Presenter *presenter, uint8_t fps);
+
+/** Start a frame: get the back buffer to render into.
+ * With double buffering, the tiles changed by the previous frame are copied
+ * from the other buffer first, so that the back buffer shows the current
+ * display contents and may be updated incrementally.
+ * @param presenter Pointer to a Presenter structure.
+ * @param overwrite If true, the caller rewrites every pixel (e.g. framebufferCopySurface()) and copying is skipped.
+ * @returns A pointer to the back buffer.
+ */
+union disp_framebuffer *presenterBegin(Presenter *presenter, bool overwrite);
+
+/** Finish a frame: wait until it is due, then send the back buffer to the display.
+ * The transfer follows framebufferRedrawMask(): nothing is sent if mask marks
+ * no tile, partial transfers are used if FAFRAMEBUFFER_PARTIAL is defined.
+ * Frames presented after they were due are counted in nLate; the schedule then
+ * restarts instead of rushing to catch up.
+ * @param presenter Pointer to a Presenter structure.
+ * @param mask Pointer to a SurfaceMod structure with the changes of this frame; if NULL, the whole framebuffer is sent.
+ * @returns either 0 (success), EBUSY (display locked by someone else) or EINVAL (presenter is NULL).
+ */
+int presenterPresent(Presenter *presenter, SurfaceMod *mask);
+
 #endif // _FAFRAMEBUFFER_H
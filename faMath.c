@@ -0,0 +1,62 @@
+/**
+ * @file
+ * @author Frank Abelbeck <frank.abelbeck@googlemail.com>
+ * @version 2026-10-14
+ * 
+ * @section License
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * @section Description
+ * 
+ * Fixed-point mathematics for the card10 badge: lookup tables.
+ */
+
+#include "faMath.h"
+
+// >>> [round(math.sin(math.pi*x/180)*1024) for x in range(0,91)]
+const int16_t mathTableSine[91] = {
+	    0,    18,    36,    54,    71,    89,   107,   125,   143,   160,
+	  178,   195,   213,   230,   248,   265,   282,   299,   316,   333,
+	  350,   367,   384,   400,   416,   433,   449,   465,   481,   496,
+	  512,   527,   543,   558,   573,   587,   602,   616,   630,   644,
+	  658,   672,   685,   698,   711,   724,   737,   749,   761,   773,
+	  784,   796,   807,   818,   828,   839,   849,   859,   868,   878,
+	  887,   896,   904,   912,   920,   928,   935,   943,   949,   956,
+	  962,   968,   974,   979,   984,   989,   994,   998,  1002,  1005,
+	 1008,  1011,  1014,  1016,  1018,  1020,  1022,  1023,  1023,  1024,
+	 1024
+};
+
+// >>> [round(math.tan(math.pi*x/180)*1024) for x in range(0,46)]
+const int16_t mathTableTangent[46] = {
+	    0,    18,    36,    54,    72,    90,   108,   126,   144,   162,
+	  181,   199,   218,   236,   255,   274,   294,   313,   333,   353,
+	  373,   393,   414,   435,   456,   477,   499,   522,   544,   568,
+	  591,   615,   640,   665,   691,   717,   744,   772,   800,   829,
+	  859,   890,   922,   955,   989,  1024
+};
+
+// >>> [round(180*math.acos(x/1024)/math.pi) for x in range(-1024,1025,16)]
+const uint8_t mathTableArcusCosine[129] = {
+	  180,   170,   166,   162,   160,   157,   155,   153,   151,   149,   148,   146,   144,   143,   141,   140,
+	  139,   137,   136,   135,   133,   132,   131,   130,   129,   128,   126,   125,   124,   123,   122,   121,
+	  120,   119,   118,   117,   116,   115,   114,   113,   112,   111,   110,   109,   108,   107,   106,   105,
+	  104,   104,   103,   102,   101,   100,    99,    98,    97,    96,    95,    94,    94,    93,    92,    91,
+	   90,    89,    88,    87,    86,    86,    85,    84,    83,    82,    81,    80,    79,    78,    77,    76,
+	   76,    75,    74,    73,    72,    71,    70,    69,    68,    67,    66,    65,    64,    63,    62,    61,
+	   60,    59,    58,    57,    56,    55,    54,    52,    51,    50,    49,    48,    47,    45,    44,    43,
+	   41,    40,    39,    37,    36,    34,    32,    31,    29,    27,    25,    23,    20,    18,    14,    10,
+	    0
+};
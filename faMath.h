@@ -0,0 +1,141 @@
+#ifndef _FAMATH_H
+#define _FAMATH_H
+/**
+ * @file
+ * @author Frank Abelbeck <frank.abelbeck@googlemail.com>
+ * @version 2026-10-14
+ * 
+ * @section License
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * @section Description
+ * 
+ * Fixed-point mathematics for the card10 badge. Fractional values are
+ * normalised to MATH_ONE (i.e. 1.0 is 1024, -0.5 is -512), angles are given in
+ * whole degrees. Trigonometric functions are inline table lookups; the tables
+ * reside in faMath.c.
+ */
+
+#include <stdint.h> // uses: int8_t, uint8_t, int16_t, uint16_t, int32_t
+
+//------------------------------------------------------------------------------
+// constants
+//------------------------------------------------------------------------------
+#define MATH_SHIFT 10 ///< number of fractional bits of fixed-point values
+#define MATH_ONE   (1 << MATH_SHIFT) ///< fixed-point value of 1.0
+
+//------------------------------------------------------------------------------
+// lookup tables
+//------------------------------------------------------------------------------
+extern const int16_t mathTableSine[91]; ///< sin(x) for x in 0..90 degrees, normalised to MATH_ONE
+extern const int16_t mathTableTangent[46]; ///< tan(x) for x in 0..45 degrees, normalised to MATH_ONE
+extern const uint8_t mathTableArcusCosine[129]; ///< acos(x) in degrees for x in -1024..1024, step 16
+
+//------------------------------------------------------------------------------
+// inline functions
+//------------------------------------------------------------------------------
+
+/** Multiply two fixed-point values.
+ * 
+ * @param a Fixed-point value, normalised to MATH_ONE.
+ * @param b Fixed-point value, normalised to MATH_ONE.
+ * @returns a*b, normalised to MATH_ONE (rounded towards minus infinity).
+ */
+static inline int32_t mathMul(int32_t a, int32_t b) {
+	return (a * b) >> MATH_SHIFT;
+}
+
+/** Map an angle to range [0,360[.
+ * 
+ * @param x Angle in degrees.
+ * @returns Equivalent angle in range [0,360[.
+ */
+static inline int16_t mathNormaliseAngle(int16_t x) {
+	x %= 360;
+	return (x < 0) ? x + 360 : x;
+}
+
+/** Calculate the sine of x.
+ * 
+ * @param x Angle in degrees, any value.
+ * @returns sin(x) normalised to MATH_ONE.
+ */
+static inline int16_t mathSine(int16_t x) {
+	x = mathNormaliseAngle(x);
+	if (x < 90)  return mathTableSine[x];
+	if (x < 180) return mathTableSine[180 - x];
+	if (x < 270) return -mathTableSine[x - 180];
+	return -mathTableSine[360 - x];
+}
+
+/** Calculate the cosine of x.
+ * 
+ * @param x Angle in degrees, any value.
+ * @returns cos(x) normalised to MATH_ONE.
+ */
+static inline int16_t mathCosine(int16_t x) {
+	x = mathNormaliseAngle(x);
+	if (x < 90)  return mathTableSine[90 - x];
+	if (x < 180) return -mathTableSine[x - 90];
+	if (x < 270) return -mathTableSine[270 - x];
+	return mathTableSine[x - 270];
+}
+
+/** Calculate sine and cosine of x with one angle reduction.
+ * 
+ * @param x Angle in degrees, any value.
+ * @param sine Pointer to a variable receiving sin(x), normalised to MATH_ONE.
+ * @param cosine Pointer to a variable receiving cos(x), normalised to MATH_ONE.
+ */
+static inline void mathSineCosine(int16_t x, int16_t *sine, int16_t *cosine) {
+	x = mathNormaliseAngle(x);
+	if (x < 90) {
+		*sine   =  mathTableSine[x];
+		*cosine =  mathTableSine[90 - x];
+	} else if (x < 180) {
+		*sine   =  mathTableSine[180 - x];
+		*cosine = -mathTableSine[x - 90];
+	} else if (x < 270) {
+		*sine   = -mathTableSine[x - 180];
+		*cosine = -mathTableSine[270 - x];
+	} else {
+		*sine   = -mathTableSine[360 - x];
+		*cosine =  mathTableSine[x - 270];
+	}
+}
+
+/** Calculate the tangent for x in range [-45,45].
+ * 
+ * @param x Angle in degrees.
+ * @returns tan(x) normalised to MATH_ONE; -MATH_ONE if x < -45; +MATH_ONE if x > 45.
+ */
+static inline int16_t mathTangent45(int16_t x) {
+	if (x <= -45) return -MATH_ONE;
+	if (x >= 45) return MATH_ONE;
+	return (x < 0) ? -mathTableTangent[-x] : mathTableTangent[x];
+}
+
+/** Calculate the arcus cosine for x in range [-MATH_ONE,MATH_ONE].
+ * 
+ * @param x Fixed-point value, normalised to MATH_ONE.
+ * @returns acos(x) in degrees [0,180].
+ */
+static inline int16_t mathArcusCosine(int16_t x) {
+	if (x < -MATH_ONE) return 180;
+	if (x >  MATH_ONE) return 0;
+	return mathTableArcusCosine[(x >> 4) + 64];
+}
+
+#endif // _FAMATH_H
@@ -0,0 +1,172 @@
+/**
+ * @file
+ * @author Frank Abelbeck <frank.abelbeck@googlemail.com>
+ * @version 2026-10-14
+ * 
+ * @section License
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * @section Description
+ * 
+ * Memory management for the card10 badge: an optional arena for all library
+ * allocations.
+ */
+
+#include <stdlib.h> // uses: malloc(), free()
+#include <stdint.h> // uses: int8_t, uint8_t, uint32_t, uintptr_t
+
+#include "faMemory.h"
+
+//------------------------------------------------------------------------------
+// arena state
+//------------------------------------------------------------------------------
+
+// header in front of each block; size includes the header
+typedef struct {
+	uint32_t size;
+	uint32_t isUsed;
+} MemoryBlock;
+
+// arena: persistent blocks occupy [0,end), transient blocks occupy [top,size)
+typedef struct {
+	uint8_t  *base;
+	uint32_t size;
+	uint32_t end;
+	uint32_t top;
+} MemoryArena;
+
+static MemoryArena arena = {NULL,0,0,0};
+
+// size of a block holding the given number of bytes, header included;
+// returns 0 if the request does not fit into the arena at all
+static uint32_t memoryBlockSize(uint32_t size) {
+	if (size > arena.size) return 0;
+	return ((size + MEMORY_ALIGN - 1) & ~(uint32_t)(MEMORY_ALIGN - 1)) + sizeof(MemoryBlock);
+}
+
+//------------------------------------------------------------------------------
+// public functions
+//------------------------------------------------------------------------------
+
+// install or detach an arena
+int8_t memoryArenaSetup(void *region, uint32_t size) {
+	if (arena.base != NULL && (arena.end != 0 || arena.top != arena.size)) return RET_MEMORY_INUSE;
+	if (region == NULL) {
+		arena.base = NULL;
+		arena.size = arena.end = arena.top = 0;
+		return RET_MEMORY_OK;
+	}
+	// align start and size of the region to MEMORY_ALIGN
+	uint32_t offset = (MEMORY_ALIGN - ((uintptr_t)region & (MEMORY_ALIGN - 1))) & (MEMORY_ALIGN - 1);
+	if (size < offset + 2*sizeof(MemoryBlock)) return RET_MEMORY_ARGS;
+	arena.base = (uint8_t*)region + offset;
+	arena.size = (size - offset) & ~(uint32_t)(MEMORY_ALIGN - 1);
+	arena.end = 0;
+	arena.top = arena.size;
+	return RET_MEMORY_OK;
+}
+
+// persistent allocation: first fit among the blocks below end, else append a block
+void *memoryAlloc(uint32_t size) {
+	if (arena.base == NULL) return malloc(size);
+	uint32_t sizeBlock = memoryBlockSize(size);
+	if (sizeBlock == 0) return NULL;
+	MemoryBlock *block;
+	uint32_t offset = 0;
+	while (offset < arena.end) {
+		block = (MemoryBlock*)(arena.base + offset);
+		if (!block->isUsed && block->size >= sizeBlock) {
+			// split block if the remainder can hold a header and some data
+			if (block->size - sizeBlock >= 2*sizeof(MemoryBlock)) {
+				MemoryBlock *rest = (MemoryBlock*)(arena.base + offset + sizeBlock);
+				rest->size = block->size - sizeBlock;
+				rest->isUsed = 0;
+				block->size = sizeBlock;
+			}
+			block->isUsed = 1;
+			return (uint8_t*)block + sizeof(MemoryBlock);
+		}
+		offset += block->size;
+	}
+	if (arena.top - arena.end < sizeBlock) return NULL;
+	block = (MemoryBlock*)(arena.base + arena.end);
+	block->size = sizeBlock;
+	block->isUsed = 1;
+	arena.end += sizeBlock;
+	return (uint8_t*)block + sizeof(MemoryBlock);
+}
+
+// transient allocation: push a block onto the stack at the top of the arena
+void *memoryAllocTransient(uint32_t size) {
+	if (arena.base == NULL) return malloc(size);
+	uint32_t sizeBlock = memoryBlockSize(size);
+	if (sizeBlock == 0 || arena.top - arena.end < sizeBlock) return NULL;
+	arena.top -= sizeBlock;
+	MemoryBlock *block = (MemoryBlock*)(arena.base + arena.top);
+	block->size = sizeBlock;
+	block->isUsed = 1;
+	return (uint8_t*)block + sizeof(MemoryBlock);
+}
+
+// release a block: decide by address whether it is persistent, transient or foreign
+void memoryFree(void *ptr) {
+	if (ptr == NULL) return;
+	uint8_t *p = (uint8_t*)ptr;
+	if (arena.base == NULL || p < arena.base || p >= arena.base + arena.size) {
+		free(ptr);
+		return;
+	}
+	MemoryBlock *block = (MemoryBlock*)(p - sizeof(MemoryBlock));
+	block->isUsed = 0;
+	uint32_t offset = (uint32_t)(p - arena.base) - sizeof(MemoryBlock);
+	if (offset < arena.end) {
+		// persistent block: merge runs of free blocks, then trim the last free block
+		MemoryBlock *previous = NULL;
+		offset = 0;
+		while (offset < arena.end) {
+			block = (MemoryBlock*)(arena.base + offset);
+			if (!block->isUsed && previous != NULL && !previous->isUsed) {
+				previous->size += block->size;
+			} else {
+				previous = block;
+			}
+			offset += block->size;
+		}
+		if (previous != NULL && !previous->isUsed) arena.end -= previous->size;
+	} else {
+		// transient block: pop all free blocks on top of the stack
+		while (arena.top < arena.size) {
+			block = (MemoryBlock*)(arena.base + arena.top);
+			if (block->isUsed) break;
+			arena.top += block->size;
+		}
+	}
+}
+
+// mark: current top of the transient stack
+uint32_t memoryMarkTransient(void) {
+	return arena.top;
+}
+
+// release all transient blocks below a mark
+void memoryReleaseTransient(uint32_t mark) {
+	if (arena.base == NULL || mark > arena.size || mark < arena.top) return;
+	arena.top = mark;
+}
+
+// free space between persistent and transient blocks
+uint32_t memoryAvailable(void) {
+	return arena.top - arena.end;
+}
@@ -0,0 +1,111 @@
+#ifndef _FAMEMORY_H
+#define _FAMEMORY_H
+/**
+ * @file
+ * @author Frank Abelbeck <frank.abelbeck@googlemail.com>
+ * @version 2026-10-14
+ * 
+ * @section License
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * @section Description
+ * 
+ * Memory management for the card10 badge: an optional arena for all library
+ * allocations.
+ * 
+ * By default, all library functions allocate memory via malloc(). If an app
+ * passes a memory region to memoryArenaSetup() at startup, surface planes,
+ * masks, font tables, meshes and framebuffers are carved out of this region
+ * instead, as well as any transient decoder state (Huffman tables, scanline and
+ * file buffers, inflate window). This avoids fragmentation of the system heap
+ * and makes memory use deterministic.
+ * 
+ * Persistent blocks are allocated first-fit from the bottom of the region and
+ * merged with adjacent free blocks when released. Transient blocks are stacked
+ * from the top of the region downwards; a freed transient block is reclaimed
+ * as soon as all blocks allocated after it are freed as well, or all at once
+ * with memoryReleaseTransient().
+ */
+
+#include <stdint.h> // uses: int8_t, uint32_t
+
+//------------------------------------------------------------------------------
+// constants
+//------------------------------------------------------------------------------
+#define RET_MEMORY_OK     0 ///< function returned successfully
+#define RET_MEMORY_ARGS  -1 ///< invalid arguments passed
+#define RET_MEMORY_INUSE -2 ///< arena still holds allocated blocks
+
+#define MEMORY_ALIGN 8 ///< alignment of all blocks in the arena; block headers take as many bytes
+
+//------------------------------------------------------------------------------
+// function prototypes
+//------------------------------------------------------------------------------
+
+/** Install a memory region as arena for all subsequent library allocations.
+ * 
+ * Call this once at startup, before any library structure is created. Blocks
+ * allocated via malloc() before that are still released correctly.
+ * 
+ * @param region Pointer to the memory region; NULL detaches the current arena, i.e. returns to malloc().
+ * @param size Size of the region in bytes.
+ * @returns RET_MEMORY_OK on success, RET_MEMORY_ARGS if the region is too small, RET_MEMORY_INUSE if the current arena still holds blocks.
+ */
+int8_t memoryArenaSetup(void *region, uint32_t size);
+
+/** Allocate a persistent block, e.g. for surface planes.
+ * 
+ * @param size Number of bytes.
+ * @returns A pointer to a block of memory or NULL if something went wrong.
+ */
+void *memoryAlloc(uint32_t size);
+
+/** Allocate a transient block, e.g. for decoder state.
+ * 
+ * @param size Number of bytes.
+ * @returns A pointer to a block of memory or NULL if something went wrong.
+ */
+void *memoryAllocTransient(uint32_t size);
+
+/** Release a block allocated with memoryAlloc() or memoryAllocTransient().
+ * 
+ * Does nothing if ptr is NULL.
+ * 
+ * @param ptr Pointer to a block of memory.
+ */
+void memoryFree(void *ptr);
+
+/** Return a mark describing the current state of the transient stack.
+ * 
+ * @returns A mark to be passed to memoryReleaseTransient(); 0 if no arena is installed.
+ */
+uint32_t memoryMarkTransient(void);
+
+/** Release all transient blocks allocated after a mark in one step.
+ * 
+ * These blocks must no longer be used, i.e. structures referring to them must
+ * not be destructed afterwards. Has no effect if no arena is installed.
+ * 
+ * @param mark A mark as returned by memoryMarkTransient().
+ */
+void memoryReleaseTransient(uint32_t mark);
+
+/** Return the number of bytes between persistent and transient blocks.
+ * 
+ * @returns Number of unused bytes at the arena's centre (free persistent blocks are not counted); 0 if no arena is installed.
+ */
+uint32_t memoryAvailable(void);
+
+#endif // _FAMEMORY_H
@@ -0,0 +1,241 @@
+/**
+ * @file
+ * @author Frank Abelbeck <frank.abelbeck@googlemail.com>
+ * @version 2026-10-14
+ * 
+ * @section License
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * @section Description
+ * 
+ * Triangle mesh rendering routines for the card10 badge.
+ */
+
+#include <stddef.h> // uses: NULL
+#include "faMesh.h"
+#include "faMath.h" // uses: mathSineCosine()
+#include "faMemory.h" // uses: memoryAlloc(), memoryFree()
+
+#define MESH_ONE  (1 << MESH_SUBPIXEL_BITS) // one pixel in sub-pixel units
+#define MESH_HALF (1 << (MESH_SUBPIXEL_BITS - 1)) // half a pixel in sub-pixel units
+
+//------------------------------------------------------------------------------
+// construction and destruction
+//------------------------------------------------------------------------------
+
+Mesh *meshConstruct(uint16_t nVertices, uint16_t nTriangles) {
+	Mesh *mesh = (Mesh*)memoryAlloc(sizeof(Mesh));
+	if (mesh == NULL) return NULL;
+	mesh->nVertices = nVertices;
+	mesh->nTriangles = nTriangles;
+	mesh->vertices = (Point3D*)memoryAlloc(nVertices*sizeof(Point3D));
+	mesh->indices = (uint16_t*)memoryAlloc(3*nTriangles*sizeof(uint16_t));
+	mesh->colour = (uint16_t*)memoryAlloc(nTriangles*sizeof(uint16_t));
+	mesh->alpha = (uint8_t*)memoryAlloc(nTriangles);
+	mesh->projected = (Point*)memoryAlloc(nVertices*sizeof(Point));
+	mesh->valid = (uint8_t*)memoryAlloc(nVertices);
+	if (mesh->vertices == NULL || mesh->indices == NULL || mesh->colour == NULL ||
+	    mesh->alpha == NULL || mesh->projected == NULL || mesh->valid == NULL) meshDestruct(&mesh);
+	return mesh;
+}
+
+void meshDestruct(Mesh **mesh) {
+	memoryFree((*mesh)->vertices);
+	memoryFree((*mesh)->indices);
+	memoryFree((*mesh)->colour);
+	memoryFree((*mesh)->alpha);
+	memoryFree((*mesh)->projected);
+	memoryFree((*mesh)->valid);
+	memoryFree(*mesh);
+	*mesh = NULL;
+}
+
+//------------------------------------------------------------------------------
+// transformation
+//------------------------------------------------------------------------------
+
+Matrix3D getMatrix3DRotate(int16_t roll, int16_t pitch, int16_t yaw) {
+	int16_t cosRoll,cosPitch,cosYaw,sinRoll,sinPitch,sinYaw;
+	mathSineCosine(roll,&sinRoll,&cosRoll);
+	mathSineCosine(pitch,&sinPitch,&cosPitch);
+	mathSineCosine(yaw,&sinYaw,&cosYaw);
+	Matrix3D m;
+	m.xx = (cosPitch*cosYaw) >> 10;
+	m.xy = (-cosRoll*sinYaw + ((sinRoll*sinPitch*cosYaw) >> 10)) >> 10;
+	m.xz = ( sinRoll*sinYaw + ((cosRoll*sinPitch*cosYaw) >> 10)) >> 10;
+	m.yx = (cosPitch*sinYaw) >> 10;
+	m.yy = ( cosRoll*cosYaw + ((sinRoll*sinPitch*sinYaw) >> 10)) >> 10;
+	m.yz = (-sinRoll*cosYaw + ((cosRoll*sinPitch*sinYaw) >> 10)) >> 10;
+	m.zx = -sinPitch;
+	m.zy = (sinRoll*cosPitch) >> 10;
+	m.zz = (cosRoll*cosPitch) >> 10;
+	m.xw = 0;
+	m.yw = 0;
+	m.zw = 0;
+	return m;
+}
+
+Point3D mulMatrix3DPoint3D(Matrix3D m, Point3D p) {
+	Point3D result;
+	result.x = (int32_t)(((int64_t)m.xx*p.x + (int64_t)m.xy*p.y + (int64_t)m.xz*p.z) >> 10) + m.xw;
+	result.y = (int32_t)(((int64_t)m.yx*p.x + (int64_t)m.yy*p.y + (int64_t)m.yz*p.z) >> 10) + m.yw;
+	result.z = (int32_t)(((int64_t)m.zx*p.x + (int64_t)m.zy*p.y + (int64_t)m.zz*p.z) >> 10) + m.zw;
+	return result;
+}
+
+//------------------------------------------------------------------------------
+// rasterisation
+//------------------------------------------------------------------------------
+
+// floor division for positive divisors
+static inline int64_t meshDivFloor(int64_t n, int64_t d) {
+	return (n >= 0) ? n / d : -((-n + d - 1) / d);
+}
+
+// edge walker: tracks q = ceil(N/D) with N = (a.x - HALF)*den + (yc - a.y)*dx,
+// i.e. the first pixel whose centre lies on or right of the edge at row centre
+// yc, as quotient and remainder (N = q*D - r, 0 <= r < D); stepping one row
+// down adds S = ONE*dx to N
+typedef struct {
+	int32_t q,r,D,qs,rs;
+} MeshEdge;
+
+static void meshEdgeSetup(MeshEdge *edge, Point a, Point b, int32_t yc) {
+	int32_t den = b.y - a.y;
+	int32_t dx = b.x - a.x;
+	int64_t N = (int64_t)(a.x - MESH_HALF) * den + (int64_t)(yc - a.y) * dx;
+	int32_t S = dx * MESH_ONE;
+	edge->D = den * MESH_ONE;
+	edge->q = (int32_t)-meshDivFloor(-N,edge->D);
+	edge->r = (int32_t)((int64_t)edge->q * edge->D - N);
+	edge->qs = (int32_t)meshDivFloor(S,edge->D);
+	edge->rs = S - edge->qs * edge->D;
+}
+
+static inline void meshEdgeStep(MeshEdge *edge) {
+	edge->q += edge->qs;
+	edge->r -= edge->rs;
+	if (edge->r < 0) {
+		edge->q++;
+		edge->r += edge->D;
+	}
+}
+
+void meshFillTriangle(Surface *surface, Point p0, Point p1, Point p2, uint16_t colour, uint8_t alpha, uint8_t mode, SurfaceMod *mask) {
+	if (surface == NULL || mask == NULL) return;
+	Point pTemp;
+
+	// sort points from smallest to largest y component
+	if (p0.y > p1.y) { pTemp = p0; p0 = p1; p1 = pTemp; }
+	if (p1.y > p2.y) { pTemp = p1; p1 = p2; p2 = pTemp; }
+	if (p0.y > p1.y) { pTemp = p0; p0 = p1; p1 = pTemp; }
+
+	// side of p1 relative to the long edge p0p2; zero means no area
+	int64_t area = (int64_t)(p1.x - p0.x) * (p2.y - p0.y) - (int64_t)(p2.x - p0.x) * (p1.y - p0.y);
+	if (area == 0) return;
+	bool isLongLeft = (area > 0);
+
+	// rows whose centre lies in [p0.y,p2.y): top edges are inside, bottom edges are not
+	int32_t y     = (int32_t)-meshDivFloor(-(int64_t)(p0.y - MESH_HALF),MESH_ONE);
+	int32_t yMid  = (int32_t)-meshDivFloor(-(int64_t)(p1.y - MESH_HALF),MESH_ONE);
+	int32_t yStop = (int32_t)-meshDivFloor(-(int64_t)(p2.y - MESH_HALF),MESH_ONE);
+	if (y < 0) y = 0;
+	if (yStop > surface->height) yStop = surface->height;
+	if (y >= yStop) return;
+
+	MeshEdge edgeLong,edgeShort;
+	MeshEdge *edgeLeft  = isLongLeft ? &edgeLong : &edgeShort;
+	MeshEdge *edgeRight = isLongLeft ? &edgeShort : &edgeLong;
+	meshEdgeSetup(&edgeLong,p0,p2,y * MESH_ONE + MESH_HALF);
+	if (y < yMid)
+		meshEdgeSetup(&edgeShort,p0,p1,y * MESH_ONE + MESH_HALF);
+	else
+		meshEdgeSetup(&edgeShort,p1,p2,y * MESH_ONE + MESH_HALF);
+
+	int32_t xStart,xStop;
+	for (; y < yStop; y++) {
+		if (y == yMid) meshEdgeSetup(&edgeShort,p1,p2,y * MESH_ONE + MESH_HALF);
+		// pixels with centres in [left edge, right edge), clipped to the surface
+		xStart = (edgeLeft->q < 0) ? 0 : edgeLeft->q;
+		xStop = (edgeRight->q > surface->width) ? surface->width : edgeRight->q;
+		if (xStart < xStop) surfaceModSetRow(mask,y,surfaceBlendSpanColour(surface,xStart,y,xStop - xStart,colour,alpha,mode));
+		meshEdgeStep(&edgeLong);
+		meshEdgeStep(&edgeShort);
+	}
+}
+
+//------------------------------------------------------------------------------
+// mesh rendering
+//------------------------------------------------------------------------------
+
+BoundingBox meshDraw(Surface *surface, Mesh *mesh, Matrix3D transform, MeshCamera camera, uint8_t cull, uint8_t mode, SurfaceMod *mask) {
+	BoundingBox bb = boundingBoxCreate(0,0,0,0);
+	if (surface == NULL || mesh == NULL || mask == NULL) return bb;
+
+	uint16_t i;
+	Point3D p;
+	int64_t coord;
+	int32_t zNear = (camera.zNear > 0) ? camera.zNear : 1;
+
+	// transform and project each vertex once
+	for (i = 0; i < mesh->nVertices; i++) {
+		p = mulMatrix3DPoint3D(transform,mesh->vertices[i]);
+		mesh->valid[i] = (p.z >= zNear);
+		if (!mesh->valid[i]) continue;
+		coord = ((int64_t)camera.x0 << MESH_SUBPIXEL_BITS) + (((int64_t)camera.scaleX * p.x) << MESH_SUBPIXEL_BITS) / p.z;
+		if (coord < -MESH_LIMIT) coord = -MESH_LIMIT; else if (coord > MESH_LIMIT) coord = MESH_LIMIT;
+		mesh->projected[i].x = (int32_t)coord;
+		coord = ((int64_t)camera.y0 << MESH_SUBPIXEL_BITS) + (((int64_t)camera.scaleY * p.y) << MESH_SUBPIXEL_BITS) / p.z;
+		if (coord < -MESH_LIMIT) coord = -MESH_LIMIT; else if (coord > MESH_LIMIT) coord = MESH_LIMIT;
+		mesh->projected[i].y = (int32_t)coord;
+	}
+
+	Point p0,p1,p2;
+	int64_t area;
+	bool isEmpty = true;
+	uint16_t *index = mesh->indices;
+	for (i = 0; i < mesh->nTriangles; i++, index += 3) {
+		if (!mesh->valid[index[0]] || !mesh->valid[index[1]] || !mesh->valid[index[2]]) continue;
+		p0 = mesh->projected[index[0]];
+		p1 = mesh->projected[index[1]];
+		p2 = mesh->projected[index[2]];
+
+		// orientation on the display (y pointing down): negative = counter-clockwise = front face
+		area = (int64_t)(p1.x - p0.x) * (p2.y - p0.y) - (int64_t)(p2.x - p0.x) * (p1.y - p0.y);
+		if (area == 0 || (cull == MESH_CULL_BACK && area > 0) || (cull == MESH_CULL_FRONT && area < 0)) continue;
+
+		// extend bounding box (pixel coordinates)
+		if (isEmpty) {
+			bb.min.x = bb.max.x = p0.x >> MESH_SUBPIXEL_BITS;
+			bb.min.y = bb.max.y = p0.y >> MESH_SUBPIXEL_BITS;
+			isEmpty = false;
+		}
+		if ((p0.x >> MESH_SUBPIXEL_BITS) < bb.min.x) bb.min.x = p0.x >> MESH_SUBPIXEL_BITS;
+		if ((p1.x >> MESH_SUBPIXEL_BITS) < bb.min.x) bb.min.x = p1.x >> MESH_SUBPIXEL_BITS;
+		if ((p2.x >> MESH_SUBPIXEL_BITS) < bb.min.x) bb.min.x = p2.x >> MESH_SUBPIXEL_BITS;
+		if ((p0.y >> MESH_SUBPIXEL_BITS) < bb.min.y) bb.min.y = p0.y >> MESH_SUBPIXEL_BITS;
+		if ((p1.y >> MESH_SUBPIXEL_BITS) < bb.min.y) bb.min.y = p1.y >> MESH_SUBPIXEL_BITS;
+		if ((p2.y >> MESH_SUBPIXEL_BITS) < bb.min.y) bb.min.y = p2.y >> MESH_SUBPIXEL_BITS;
+		if ((p0.x >> MESH_SUBPIXEL_BITS) > bb.max.x) bb.max.x = p0.x >> MESH_SUBPIXEL_BITS;
+		if ((p1.x >> MESH_SUBPIXEL_BITS) > bb.max.x) bb.max.x = p1.x >> MESH_SUBPIXEL_BITS;
+		if ((p2.x >> MESH_SUBPIXEL_BITS) > bb.max.x) bb.max.x = p2.x >> MESH_SUBPIXEL_BITS;
+		if ((p0.y >> MESH_SUBPIXEL_BITS) > bb.max.y) bb.max.y = p0.y >> MESH_SUBPIXEL_BITS;
+		if ((p1.y >> MESH_SUBPIXEL_BITS) > bb.max.y) bb.max.y = p1.y >> MESH_SUBPIXEL_BITS;
+		if ((p2.y >> MESH_SUBPIXEL_BITS) > bb.max.y) bb.max.y = p2.y >> MESH_SUBPIXEL_BITS;
+
+		meshFillTriangle(surface,p0,p1,p2,mesh->colour[i],mesh->alpha[i],mode,mask);
+	}
+	return bb;
+}
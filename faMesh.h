@@ -0,0 +1,159 @@
+#ifndef _FAMESH_H
+#define _FAMESH_H
+/**
+ * @file
+ * @author Frank Abelbeck <frank.abelbeck@googlemail.com>
+ * @version 2026-10-14
+ * 
+ * @section License
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * @section Description
+ * 
+ * Triangle mesh rendering routines for the card10 badge: transform and project
+ * the vertices of a mesh once, cull back faces and fill the triangles span by
+ * span, following a top-left fill rule.
+ */
+
+#include <stdint.h> // uses: int8_t, uint8_t, int16_t, uint16_t, uint32_t
+#include "faSurfaceBase.h"
+
+//------------------------------------------------------------------------------
+// constants
+//------------------------------------------------------------------------------
+#define MESH_CULL_NONE  0 ///< culling: draw all triangles
+#define MESH_CULL_BACK  1 ///< culling: skip triangles appearing clockwise on the display (back faces)
+#define MESH_CULL_FRONT 2 ///< culling: skip triangles appearing counter-clockwise on the display (front faces)
+
+#define MESH_SUBPIXEL_BITS 4 ///< number of fractional bits of projected vertex coordinates
+#define MESH_LIMIT (1 << 19) ///< projected coordinates are clamped to +/- this value (sub-pixel units)
+
+//------------------------------------------------------------------------------
+// data structures
+//------------------------------------------------------------------------------
+
+/** Data structure of a point in three-dimensional model space. */
+typedef struct {
+	int32_t x,y,z;
+} Point3D;
+
+/** Data structure of an affine transformation in three-dimensional space.
+ * Components xx..zz are normalised to 1024 (i.e. -0.5 would be -512), the
+ * translation components xw, yw and zw are given in model units.
+ */
+typedef struct {
+	int32_t xx,xy,xz,xw;
+	int32_t yx,yy,yz,yw;
+	int32_t zx,zy,zz,zw;
+} Matrix3D;
+
+/** Data structure of a perspective projection: a transformed point (x,y,z)
+ * appears on the display at (x0 + scaleX*x/z, y0 + scaleY*y/z).
+ */
+typedef struct {
+	int32_t x0,y0; ///< display position of the view axis in pixels
+	int32_t scaleX,scaleY; ///< projection scale factors
+	int32_t zNear; ///< minimum z value; triangles with vertices closer to the camera are skipped
+} MeshCamera;
+
+/** Data structure of a triangle mesh. */
+typedef struct {
+	uint16_t nVertices; ///< number of vertices
+	uint16_t nTriangles; ///< number of triangles
+	Point3D  *vertices; ///< vertex array, model coordinates
+	uint16_t *indices; ///< index array, three vertex indices per triangle; counter-clockwise order defines the front face
+	uint16_t *colour; ///< colour of each triangle (RGB565)
+	uint8_t  *alpha; ///< alpha value of each triangle
+	Point    *projected; ///< scratch array: projected vertices in sub-pixel units (cf. MESH_SUBPIXEL_BITS)
+	uint8_t  *valid; ///< scratch array: non-zero if a projected vertex lies in front of the near plane
+} Mesh;
+
+//------------------------------------------------------------------------------
+// function prototypes
+//------------------------------------------------------------------------------
+
+/** Constructor: create a mesh with the given numbers of vertices and triangles.
+ * 
+ * Vertices, indices, colours and alpha values are not initialised.
+ * 
+ * @param nVertices Number of vertices.
+ * @param nTriangles Number of triangles.
+ * @returns A pointer to a Mesh structure or NULL if something went wrong.
+ */
+Mesh *meshConstruct(uint16_t nVertices, uint16_t nTriangles);
+
+/** Destructor: free any allocated memory of a mesh.
+ * 
+ * @param mesh Pointer to a pointer to a Mesh structure.
+ */
+void meshDestruct(Mesh **mesh);
+
+/** Calculate a Matrix3D structure for the following operation:
+ * rotation according to the yaw-pitch-roll convention, i.e. first rotate
+ * around z by yaw, then around y' by pitch, then around x'' by roll.
+ * 
+ * @param roll Angle in degrees.
+ * @param pitch Angle in degrees.
+ * @param yaw Angle in degrees.
+ * @returns A transformation Matrix3D without translation.
+ */
+Matrix3D getMatrix3DRotate(int16_t roll, int16_t pitch, int16_t yaw);
+
+/** Multiply a Matrix3D with a Point3D.
+ * 
+ * @param m A Matrix3D.
+ * @param p A Point3D.
+ * @returns A Point3D, result of m*p.
+ */
+Point3D mulMatrix3DPoint3D(Matrix3D m, Point3D p);
+
+/** Fill a triangle whose vertices are given in sub-pixel units.
+ * 
+ * Pixels are covered if their centre lies inside the triangle. Centres on a
+ * top or left edge are inside, centres on a bottom or right edge are not, so
+ * triangles sharing an edge never blend a pixel twice. Each row is blended as
+ * one span.
+ * 
+ * @param surface Pointer to a Surface structure.
+ * @param p0 First vertex, sub-pixel units (cf. MESH_SUBPIXEL_BITS).
+ * @param p1 Second vertex, sub-pixel units.
+ * @param p2 Third vertex, sub-pixel units.
+ * @param colour A 16-bit colour value (RGB565).
+ * @param alpha An 8-bit alpha value.
+ * @param mode A mode as defined by BLEND_*
+ * @param mask Pointer to a SurfaceMod structure where changes to the surface are recorded.
+ */
+void meshFillTriangle(Surface *surface, Point p0, Point p1, Point p2, uint16_t colour, uint8_t alpha, uint8_t mode, SurfaceMod *mask);
+
+/** Render a mesh on a surface.
+ * 
+ * Each vertex is transformed and projected once. Triangles with a vertex in
+ * front of the camera's near plane are skipped, others are culled according
+ * to their orientation on the display and filled with meshFillTriangle().
+ * Triangles are drawn in index order, without depth sorting: use back-face
+ * culling for convex meshes.
+ * 
+ * @param surface Pointer to a Surface structure.
+ * @param mesh Pointer to a Mesh structure.
+ * @param transform A Matrix3D, applied to all vertices before projection.
+ * @param camera A MeshCamera structure.
+ * @param cull One of MESH_CULL_*.
+ * @param mode A mode as defined by BLEND_*
+ * @param mask Pointer to a SurfaceMod structure where changes to the surface are recorded.
+ * @returns A BoundingBox structure enclosing all drawn triangles.
+ */
+BoundingBox meshDraw(Surface *surface, Mesh *mesh, Matrix3D transform, MeshCamera camera, uint8_t cull, uint8_t mode, SurfaceMod *mask);
+
+#endif // _FAMESH_H
@@ -0,0 +1,122 @@
+/**
+ * @file
+ * @author Frank Abelbeck <frank.abelbeck@googlemail.com>
+ * @version 2026-10-14
+ * 
+ * @section License
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * @section Description
+ * 
+ * Optional profiling for the card10 badge; compiled only if FAPROFILE is defined.
+ */
+
+#include "faProfile.h"
+
+#ifdef FAPROFILE
+
+#include <stdio.h> // uses: printf()
+#include <string.h> // uses: memset()
+
+//------------------------------------------------------------------------------
+// profiling state
+//------------------------------------------------------------------------------
+
+uint32_t profileValue[PROFILE_CHANNELS];
+uint16_t profileCalls[PROFILE_CHANNELS];
+
+// rolling window: values of the last PROFILE_WINDOW frames, ring buffer
+static uint32_t profileHistory[PROFILE_CHANNELS][PROFILE_WINDOW];
+static uint16_t profileCallsLast[PROFILE_CHANNELS];
+static uint8_t  profileIndex = 0;
+static uint8_t  profileFrames = 0;
+static uint32_t profileFrameStart = 0;
+
+static const char *profileNames[PROFILE_CHANNELS] = {
+	"compose","composePP","blendPos","point","line","triangle","rect","circular",
+	"font","fbCopy","fbUpdate","redraw","png","frame","pixels","tiles"
+};
+
+//------------------------------------------------------------------------------
+// public functions
+//------------------------------------------------------------------------------
+
+bool profileInit(void) {
+	memset(profileValue,0,sizeof(profileValue));
+	memset(profileCalls,0,sizeof(profileCalls));
+	memset(profileCallsLast,0,sizeof(profileCallsLast));
+	profileIndex = 0;
+	profileFrames = 0;
+#if defined(__ARM_ARCH)
+	// enable trace (DEMCR.TRCENA), then the cycle counter (DWT_CTRL.CYCCNTENA);
+	// DWT_CTRL.NOCYCCNT is set if there is no cycle counter
+	PROFILE_DEMCR |= 1u << 24;
+	if (PROFILE_DWT_CTRL & (1u << 25)) return false;
+	PROFILE_DWT_CYCCNT = 0;
+	PROFILE_DWT_CTRL |= 1u;
+#endif
+	profileFrameStart = profileCycles();
+	return true;
+}
+
+void profileFrame(void) {
+	uint32_t now = profileCycles();
+	profileValue[PROFILE_FRAME_TIME] = now - profileFrameStart;
+	profileCalls[PROFILE_FRAME_TIME] = 1;
+	profileFrameStart = now;
+	for (uint8_t i = 0; i < PROFILE_CHANNELS; i++) {
+		profileHistory[i][profileIndex] = profileValue[i];
+		profileCallsLast[i] = profileCalls[i];
+		profileValue[i] = 0;
+		profileCalls[i] = 0;
+	}
+	profileIndex = (profileIndex + 1) % PROFILE_WINDOW;
+	if (profileFrames < PROFILE_WINDOW) profileFrames++;
+}
+
+bool profileGetStats(uint8_t channel, ProfileStats *stats) {
+	if (channel >= PROFILE_CHANNELS || stats == NULL || profileFrames == 0) return false;
+	uint64_t sum = 0;
+	uint32_t value;
+	stats->min = UINT32_MAX;
+	stats->max = 0;
+	for (uint8_t i = 0; i < profileFrames; i++) {
+		value = profileHistory[channel][i];
+		sum += value;
+		if (value < stats->min) stats->min = value;
+		if (value > stats->max) stats->max = value;
+	}
+	stats->avg = (uint32_t)(sum / profileFrames);
+	stats->calls = profileCallsLast[channel];
+	stats->nFrames = profileFrames;
+	return true;
+}
+
+const char *profileGetName(uint8_t channel) {
+	return (channel < PROFILE_CHANNELS) ? profileNames[channel] : "?";
+}
+
+void profilePrint(void) {
+	ProfileStats stats;
+	printf("profile over %u frames: min/avg/max per frame, calls in last frame\n",(unsigned int)profileFrames);
+	for (uint8_t i = 0; i < PROFILE_CHANNELS; i++) {
+		// skip probes not called during the window
+		if (!profileGetStats(i,&stats) || stats.max == 0) continue;
+		printf("%-10s %10lu %10lu %10lu %6u\n",profileGetName(i),
+			(unsigned long)stats.min,(unsigned long)stats.avg,(unsigned long)stats.max,(unsigned int)stats.calls);
+	}
+}
+
+#endif // FAPROFILE
@@ -0,0 +1,207 @@
+#ifndef _FAPROFILE_H
+#define _FAPROFILE_H
+/**
+ * @file
+ * @author Frank Abelbeck <frank.abelbeck@googlemail.com>
+ * @version 2026-10-14
+ * 
+ * @section License
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * @section Description
+ * 
+ * Optional profiling for the card10 badge: cycle counts of the library's hot
+ * entry points and per-frame counters, with rolling statistics.
+ * 
+ * Profiling is compiled out by default. If FAPROFILE is defined at compile
+ * time, the probed functions measure their run time with the DWT cycle
+ * counter of the Cortex-M4 (on other targets, e.g. a host build, with a
+ * nanosecond clock instead). Each probe sums up cycles and calls until the app
+ * closes a frame with profileFrame(); min/avg/max are taken over the last
+ * PROFILE_WINDOW frames. Nested probes measure inclusive time.
+ * 
+ * Apps use the PROFILE_* macros, which expand to nothing without FAPROFILE:
+ * 
+ *    PROFILE_INIT();              // once at startup
+ *    ...draw and present a frame...
+ *    PROFILE_FRAME();             // once per frame
+ *    PROFILE_PRINT();             // e.g. on exit: table on the console
+ */
+
+#include <stdint.h> // uses: uint8_t, uint16_t, uint32_t
+#include <stdbool.h> // uses: bool
+
+//------------------------------------------------------------------------------
+// constants
+//------------------------------------------------------------------------------
+#ifndef PROFILE_WINDOW
+#define PROFILE_WINDOW 16 ///< number of frames covered by the rolling statistics
+#endif
+
+#define PROFILE_COMPOSE        0 ///< probe: compose(), composeClip(), composeOffset()
+#define PROFILE_COMPOSE_PP     1 ///< probe: composePP()
+#define PROFILE_BLEND_POSITION 2 ///< probe: surfaceBlendPosition()
+#define PROFILE_DRAW_POINT     3 ///< probe: surfaceDrawPoint()
+#define PROFILE_DRAW_LINE      4 ///< probe: surfaceDrawLine()
+#define PROFILE_DRAW_TRIANGLE  5 ///< probe: surfaceDrawTriangle()
+#define PROFILE_DRAW_RECTANGLE 6 ///< probe: surfaceDrawRectangle()
+#define PROFILE_DRAW_CIRCULAR  7 ///< probe: surfaceDrawCircle(), surfaceDrawDisc(), surfaceDrawArc(), surfaceDrawSector()
+#define PROFILE_FONT_PRINT     8 ///< probe: fontFilePrint(), fontFileDraw()
+#define PROFILE_FB_COPY        9 ///< probe: framebufferCopySurface()
+#define PROFILE_FB_UPDATE     10 ///< probe: framebufferUpdateFromSurface(), framebufferUpdateFromBand()
+#define PROFILE_FB_REDRAW     11 ///< probe: display transfers (framebufferRedraw(), framebufferRedrawMask(), presenterPresent())
+#define PROFILE_PNG_READ      12 ///< probe: pngDataRead(), pngDataReadIndexed()
+#define PROFILE_FRAME_TIME    13 ///< cycles between two calls of profileFrame()
+#define PROFILE_PIXELS        14 ///< counter: pixels blended
+#define PROFILE_TILES         15 ///< counter: tiles transferred to the display
+#define PROFILE_CHANNELS      16 ///< number of probes and counters
+
+//------------------------------------------------------------------------------
+// data structures
+//------------------------------------------------------------------------------
+
+/** Data structure of the rolling statistics of a probe or counter. */
+typedef struct {
+	uint32_t min;   ///< Minimum value per frame (cycles or count).
+	uint32_t avg;   ///< Average value per frame.
+	uint32_t max;   ///< Maximum value per frame.
+	uint16_t calls; ///< Number of calls in the last frame (probes only).
+	uint8_t  nFrames; ///< Number of frames covered (at most PROFILE_WINDOW).
+} ProfileStats;
+
+/** Data structure of a running probe, cf. PROFILE_SCOPE(). */
+typedef struct {
+	uint8_t  channel; ///< Probe, one of PROFILE_*.
+	uint32_t start;   ///< Cycle counter at probe start.
+} ProfileScope;
+
+//------------------------------------------------------------------------------
+// instrumentation
+//------------------------------------------------------------------------------
+
+#ifdef FAPROFILE
+
+extern uint32_t profileValue[PROFILE_CHANNELS]; ///< Cycles or counts of the current frame.
+extern uint16_t profileCalls[PROFILE_CHANNELS]; ///< Calls of the current frame.
+
+#if defined(__ARM_ARCH)
+#define PROFILE_DWT_CTRL   (*(volatile uint32_t*)0xe0001000) ///< DWT control register
+#define PROFILE_DWT_CYCCNT (*(volatile uint32_t*)0xe0001004) ///< DWT cycle counter
+#define PROFILE_DEMCR      (*(volatile uint32_t*)0xe000edfc) ///< debug exception and monitor control register
+
+/** Return the current value of the cycle counter.
+ * 
+ * @returns The DWT cycle counter.
+ */
+static inline uint32_t profileCycles(void) {
+	return PROFILE_DWT_CYCCNT;
+}
+#else
+#include <time.h> // uses: clock_gettime(), CLOCK_MONOTONIC
+
+/** Return the current value of the cycle counter.
+ * 
+ * @returns A monotonic clock in nanoseconds (hosts without DWT).
+ */
+static inline uint32_t profileCycles(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return (uint32_t)ts.tv_sec * 1000000000u + (uint32_t)ts.tv_nsec;
+}
+#endif
+
+/** Start a probe; use PROFILE_SCOPE() instead.
+ * 
+ * @param channel Probe, one of PROFILE_*.
+ * @returns A ProfileScope structure.
+ */
+static inline ProfileScope profileScopeBegin(uint8_t channel) {
+	ProfileScope scope = { channel, profileCycles() };
+	return scope;
+}
+
+/** Stop a probe and add its cycles to the current frame; called automatically
+ * when a variable declared by PROFILE_SCOPE() goes out of scope.
+ * 
+ * @param scope Pointer to a ProfileScope structure.
+ */
+static inline void profileScopeEnd(ProfileScope *scope) {
+	profileValue[scope->channel] += profileCycles() - scope->start;
+	profileCalls[scope->channel]++;
+}
+
+/** Measure the rest of the enclosing block, including all of its return paths. */
+#define PROFILE_SCOPE(channel) ProfileScope profileScope __attribute__((cleanup(profileScopeEnd))) = profileScopeBegin(channel)
+/** Add n to a counter of the current frame. */
+#define PROFILE_COUNT(channel,n) (profileValue[channel] += (n))
+/** Enable the cycle counter, cf. profileInit(). */
+#define PROFILE_INIT() profileInit()
+/** Close the current frame, cf. profileFrame(). */
+#define PROFILE_FRAME() profileFrame()
+/** Print the statistics, cf. profilePrint(). */
+#define PROFILE_PRINT() profilePrint()
+
+#else
+
+#define PROFILE_SCOPE(channel)
+#define PROFILE_COUNT(channel,n)
+#define PROFILE_INIT()
+#define PROFILE_FRAME()
+#define PROFILE_PRINT()
+
+#endif // FAPROFILE
+
+//------------------------------------------------------------------------------
+// function prototypes (FAPROFILE only)
+//------------------------------------------------------------------------------
+
+#ifdef FAPROFILE
+
+/** Enable the cycle counter and reset all statistics.
+ * 
+ * @returns True if a cycle counter is available.
+ */
+bool profileInit(void);
+
+/** Close the current frame: move the values of all probes and counters into
+ * the rolling statistics and start a new frame.
+ */
+void profileFrame(void);
+
+/** Retrieve the rolling statistics of a probe or counter.
+ * 
+ * @param channel One of PROFILE_*.
+ * @param stats Pointer to a ProfileStats structure to be filled.
+ * @returns False if the channel is invalid or no frame has been closed yet.
+ */
+bool profileGetStats(uint8_t channel, ProfileStats *stats);
+
+/** Return a short name of a probe or counter, e.g. for printing.
+ * 
+ * @param channel One of PROFILE_*.
+ * @returns A pointer to a null-terminated string; "?" if the channel is invalid.
+ */
+const char *profileGetName(uint8_t channel);
+
+/** Print the statistics of all probes called during the window and of all
+ * counters on the console, in cycles (or nanoseconds on hosts).
+ * 
+ * An on-screen overlay is drawn by fontFileDrawProfile() (faFontFile).
+ */
+void profilePrint(void);
+
+#endif // FAPROFILE
+
+#endif // _FAPROFILE_H
@@ -1,7 +1,7 @@
 /**
  * @file
  * @author Frank Abelbeck <frank.abelbeck@googlemail.com>
- * @version 2020-02-06
+ * @version 2026-10-14
  * 
  * @section License
  * 
@@ -26,10 +26,12 @@
 #include "epicardium.h" // uses epic_file* functions
 
 #include <stdint.h> // uses: int8_t, uint8_t, int16_t, uint16_t, uint32_t
-#include <stdlib.h> // uses: malloc(), free()
 #include <stdbool.h> // uses: bool, true, false
 #include <stdio.h> // uses: SEEK_CUR
+#include <string.h> // uses: memcpy()
 #include "faReadPng.h"
+#include "faMemory.h" // uses: memoryAlloc(), memoryAllocTransient(), memoryFree()
+#include "faProfile.h" // uses: PROFILE_SCOPE()
 
 //------------------------------------------------------------------------------
 // methods for PngData structures
@@ -38,27 +40,47 @@
 // PngData constructor: create and initialise a PngData structure
 PngData* pngDataConstruct() {
 	PngData *pngdata = NULL;
-	pngdata = (PngData*)malloc(sizeof(PngData));
+	pngdata = (PngData*)memoryAllocTransient(sizeof(PngData));
 	if (pngdata != NULL) {
+		pngdata->colourType = COLOURTYPE__GREY;
 		pngdata->sizePalette = 0;
 		pngdata->palette = NULL;
+		pngdata->paletteAlpha = NULL;
 		pngdata->scanlineCurrent = NULL;
 		pngdata->scanlinePrevious = NULL;
 		pngdata->funPixConv = NULL;
+		pngdata->funRowConv = NULL;
  		pngdata->file = -1;
 		pngdata->lenChunk = 0;
 		pngdata->typeChunk = CHUNK_UNKNOWN;
 		pngdata->state = STATE_BEGIN;
 		pngdata->isLastBlock = false;
-		pngdata->codesHuffmanLength = NULL;
-		pngdata->sizeCodesHuffmanLength = 0;
-		pngdata->codesHuffmanDistance = NULL;
-		pngdata->sizeCodesHuffmanDistance = 0;
+		pngdata->tableHuffman = NULL;
+		pngdata->tableLength = NULL;
+		pngdata->tableDistance = NULL;
+		pngdata->bitsRootLength = 0;
+		pngdata->bitsRootDistance = 0;
+		pngdata->lenStored = 0;
+		pngdata->width = 0;
+		pngdata->height = 0;
+		pngdata->bitDepth = 0;
+		pngdata->bytesPerPixel = 0;
+		pngdata->samplesPerPixel = 0;
+		pngdata->interlace = 0;
+		pngdata->opaque = false;
+		pngdata->sizeScanline = 0;
+		pngdata->row = 0;
 		pngdata->bitsRemaining = 0;
 		pngdata->bufferBits = 0;
 		pngdata->valueBufferBits = 0;
 		pngdata->bufferInflate = NULL;
-		pngdata->doDecoding = true;
+		pngdata->sizeWindow = 0;
+		pngdata->indexBufferInflate = 0;
+		pngdata->indexReading = 0;
+		pngdata->bufferFile = NULL;
+		pngdata->sizeBufferFile = 0;
+		pngdata->indexBufferFile = 0;
+		pngdata->numBufferFile = 0;
 	}
 	return pngdata;
 }
@@ -68,13 +90,14 @@ void pngDataDestruct(PngData **self) {
 	if ((*self)->file >= 0)
 		if (epic_file_close((*self)->file) >= 0)
 			(*self)->file = -1;
-	free((*self)->palette);
-	free((*self)->scanlineCurrent);
-	free((*self)->scanlinePrevious);
-	free((*self)->codesHuffmanLength);
-	free((*self)->codesHuffmanDistance);
-	free((*self)->bufferInflate);
-	free(*self);
+	memoryFree((*self)->palette);
+	memoryFree((*self)->paletteAlpha);
+	memoryFree((*self)->scanlineCurrent);
+	memoryFree((*self)->scanlinePrevious);
+	memoryFree((*self)->tableHuffman);
+	memoryFree((*self)->bufferInflate);
+	memoryFree((*self)->bufferFile);
+	memoryFree(*self);
 	*self = NULL;
 }
 
@@ -86,7 +109,7 @@ void pngDataDestruct(PngData **self) {
 RGBA5658 convertPixelGrey1(PngData *self, uint8_t x) {
 	RGBA5658 colour = {0,0};
 	uint16_t i = (x >> 3) + 1;
-	if (((self->scanlineCurrent[i] >> (x & 7)) & 1) == 1)
+	if (((self->scanlineCurrent[i] >> (7 - (x & 7))) & 1) == 1)
 		colour.rgb565 = 0xffff;
 	else
 		colour.rgb565 = 0x0000;
@@ -97,7 +120,7 @@ RGBA5658 convertPixelGrey1(PngData *self, uint8_t x) {
 RGBA5658 convertPixelGrey2(PngData *self, uint8_t x) {
 	RGBA5658 colour = {0,0};
 	uint16_t i = (x >> 2) + 1;
-	uint8_t grey = 85 * ( (self->scanlineCurrent[i] >> (x & 3)) & 3 );
+	uint8_t grey = 85 * ( (self->scanlineCurrent[i] >> (6 - ((x & 3) << 1))) & 3 );
 	colour.rgb565 = ((grey >> 3) << 11) | ((grey >> 2) << 5) | (grey >> 3) ;
 	colour.alpha = 0xff;
 	return colour;
@@ -105,7 +128,7 @@ RGBA5658 convertPixelGrey2(PngData *self, uint8_t x) {
 
 RGBA5658 convertPixelGrey4(PngData *self, uint8_t x) {
 	uint16_t i = (x >> 1) + 1;
-	uint8_t grey = 17 * ( (self->scanlineCurrent[i] >> (x & 1)) & 15 );
+	uint8_t grey = 17 * ( (self->scanlineCurrent[i] >> (4 - ((x & 1) << 2))) & 15 );
 	RGBA5658 colour;
 	colour.rgb565 = ((grey >> 3) << 11) | ((grey >> 2) << 5) | (grey >> 3) ;
 	colour.alpha = 0xff;
@@ -131,33 +154,33 @@ RGBA5658 convertPixelGrey16(PngData *self, uint8_t x) {
 
 RGBA5658 convertPixelIndexed1(PngData *self, uint8_t x) {
 	uint16_t i = (x >> 3) + 1;
-	uint8_t indexPalette = (self->scanlineCurrent[i] >> (x & 7)) & 1;
+	uint8_t indexPalette = (self->scanlineCurrent[i] >> (7 - (x & 7))) & 1;
 	RGBA5658 colour = {0,0};
 	if (indexPalette <= self->sizePalette) {
 		colour.rgb565 = self->palette[indexPalette];
-		colour.alpha = 0xff;
+		colour.alpha = (self->paletteAlpha != NULL) ? self->paletteAlpha[indexPalette] : 0xff;
 	}
 	return colour;
 }
 
 RGBA5658 convertPixelIndexed2(PngData *self, uint8_t x) {
 	uint16_t i = (x >> 2) + 1;
-	uint8_t indexPalette = (self->scanlineCurrent[i] >> (x & 3)) & 3;
+	uint8_t indexPalette = (self->scanlineCurrent[i] >> (6 - ((x & 3) << 1))) & 3;
 	RGBA5658 colour = {0,0};
 	if (indexPalette <= self->sizePalette) {
 		colour.rgb565 = self->palette[indexPalette];
-		colour.alpha = 0xff;
+		colour.alpha = (self->paletteAlpha != NULL) ? self->paletteAlpha[indexPalette] : 0xff;
 	}
 	return colour;
 }
 
 RGBA5658 convertPixelIndexed4(PngData *self, uint8_t x) {
 	uint16_t i = (x >> 1) + 1;
-	uint8_t indexPalette = (self->scanlineCurrent[i] >> (x & 1)) & 15;
+	uint8_t indexPalette = (self->scanlineCurrent[i] >> (4 - ((x & 1) << 2))) & 15;
 	RGBA5658 colour = {0,0};
 	if (indexPalette <= self->sizePalette) {
 		colour.rgb565 = self->palette[indexPalette];
-		colour.alpha = 0xff;
+		colour.alpha = (self->paletteAlpha != NULL) ? self->paletteAlpha[indexPalette] : 0xff;
 	}
 	return colour;
 }
@@ -168,7 +191,7 @@ RGBA5658 convertPixelIndexed8(PngData *self, uint8_t x) {
 	RGBA5658 colour = {0,0};
 	if (indexPalette <= self->sizePalette) {
 		colour.rgb565 = self->palette[indexPalette];
-		colour.alpha = 0xff;
+		colour.alpha = (self->paletteAlpha != NULL) ? self->paletteAlpha[indexPalette] : 0xff;
 	}
 	return colour;
 }
@@ -203,7 +226,7 @@ RGBA5658 convertPixelGreyA16(PngData *self, uint8_t x) {
 	uint16_t i = x*4 + 1;
 	RGBA5658 colour;
 	uint16_t grey = (self->scanlineCurrent[i] << 8) | (self->scanlineCurrent[i+1]);
-	colour.rgb565 = ((grey >> 3) << 11) | ((grey >> 2) << 5) | (grey >> 3);
+	colour.rgb565 = ((grey >> 11) << 11) | ((grey >> 10) << 5) | (grey >> 11);
 	colour.alpha = ((self->scanlineCurrent[i+2] << 8) | self->scanlineCurrent[i+3]) >> 8;
 	return colour;
 }
@@ -226,19 +249,141 @@ RGBA5658 convertPixelRGBA16(PngData *self, uint8_t x) {
 	return colour;
 }
 
+//------------------------------------------------------------------------------
+// row conversion routines: one call per scanline, writing straight into the planes
+//------------------------------------------------------------------------------
+
+// internal helper function: convert a row of 8 or 16 bit samples; only the most
+// significant byte of each sample is used, as RGB565 and 8 bit alpha need no more;
+// grey and colour, with or without alpha are resolved at compile time
+static inline __attribute__((always_inline)) void convertRowSamples(const uint8_t *scanline, uint8_t width, uint8_t step, uint16_t *rgb565, uint8_t *alpha, const bool isColour, const bool hasAlpha, const uint8_t bytesPerSample) {
+	const uint8_t samplesPerPixel = ((isColour) ? 3 : 1) + ((hasAlpha) ? 1 : 0);
+	uint8_t r,g,b;
+	uint16_t i = 0;
+	for (uint8_t x = 0; x < width; x++) {
+		r = scanline[0];
+		g = (isColour) ? scanline[bytesPerSample]     : r;
+		b = (isColour) ? scanline[2 * bytesPerSample] : r;
+		rgb565[i] = ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
+		if (alpha != NULL) alpha[i] = (hasAlpha) ? scanline[(samplesPerPixel - 1) * bytesPerSample] : 0xff;
+		scanline += samplesPerPixel * bytesPerSample;
+		i += step;
+	}
+}
+
+// internal helper function: convert a row of packed 1, 2 or 4 bit samples, most
+// significant bits first; grey levels are scaled to 0..255, indices are looked up
+static inline __attribute__((always_inline)) void convertRowPacked(PngData *self, const uint8_t *scanline, uint8_t width, uint8_t step, uint16_t *rgb565, uint8_t *alpha, const uint8_t depth, const bool isIndexed) {
+	const uint8_t maskSample = (1 << depth) - 1;
+	uint8_t byte = 0;
+	uint8_t shift = 0;
+	uint8_t sample,grey;
+	uint16_t i = 0;
+	for (uint8_t x = 0; x < width; x++) {
+		if (shift == 0) {
+			byte = *scanline++;
+			shift = 8;
+		}
+		shift -= depth;
+		sample = (byte >> shift) & maskSample;
+		if (!isIndexed) {
+			grey = sample * (255 / maskSample);
+			rgb565[i] = ((grey >> 3) << 11) | ((grey >> 2) << 5) | (grey >> 3);
+			if (alpha != NULL) alpha[i] = 0xff;
+		} else if (sample <= self->sizePalette) {
+			rgb565[i] = self->palette[sample];
+			if (alpha != NULL) alpha[i] = (self->paletteAlpha != NULL) ? self->paletteAlpha[sample] : 0xff;
+		} else {
+			rgb565[i] = 0;
+			if (alpha != NULL) alpha[i] = 0;
+		}
+		i += step;
+	}
+}
+
+static void convertRowGrey1(PngData *self, const uint8_t *scanline, uint8_t width, uint8_t step, uint16_t *rgb565, uint8_t *alpha) {
+	convertRowPacked(self,scanline,width,step,rgb565,alpha,1,false);
+}
+
+static void convertRowGrey2(PngData *self, const uint8_t *scanline, uint8_t width, uint8_t step, uint16_t *rgb565, uint8_t *alpha) {
+	convertRowPacked(self,scanline,width,step,rgb565,alpha,2,false);
+}
+
+static void convertRowGrey4(PngData *self, const uint8_t *scanline, uint8_t width, uint8_t step, uint16_t *rgb565, uint8_t *alpha) {
+	convertRowPacked(self,scanline,width,step,rgb565,alpha,4,false);
+}
+
+static void convertRowGrey8(PngData *self, const uint8_t *scanline, uint8_t width, uint8_t step, uint16_t *rgb565, uint8_t *alpha) {
+	convertRowSamples(scanline,width,step,rgb565,alpha,false,false,1);
+}
+
+static void convertRowGrey16(PngData *self, const uint8_t *scanline, uint8_t width, uint8_t step, uint16_t *rgb565, uint8_t *alpha) {
+	convertRowSamples(scanline,width,step,rgb565,alpha,false,false,2);
+}
+
+static void convertRowIndexed1(PngData *self, const uint8_t *scanline, uint8_t width, uint8_t step, uint16_t *rgb565, uint8_t *alpha) {
+	convertRowPacked(self,scanline,width,step,rgb565,alpha,1,true);
+}
+
+static void convertRowIndexed2(PngData *self, const uint8_t *scanline, uint8_t width, uint8_t step, uint16_t *rgb565, uint8_t *alpha) {
+	convertRowPacked(self,scanline,width,step,rgb565,alpha,2,true);
+}
+
+static void convertRowIndexed4(PngData *self, const uint8_t *scanline, uint8_t width, uint8_t step, uint16_t *rgb565, uint8_t *alpha) {
+	convertRowPacked(self,scanline,width,step,rgb565,alpha,4,true);
+}
+
+static void convertRowIndexed8(PngData *self, const uint8_t *scanline, uint8_t width, uint8_t step, uint16_t *rgb565, uint8_t *alpha) {
+	uint16_t i = 0;
+	uint8_t index;
+	for (uint8_t x = 0; x < width; x++) {
+		index = scanline[x];
+		if (index <= self->sizePalette) {
+			rgb565[i] = self->palette[index];
+			if (alpha != NULL) alpha[i] = (self->paletteAlpha != NULL) ? self->paletteAlpha[index] : 0xff;
+		} else {
+			rgb565[i] = 0;
+			if (alpha != NULL) alpha[i] = 0;
+		}
+		i += step;
+	}
+}
+
+static void convertRowRGB8(PngData *self, const uint8_t *scanline, uint8_t width, uint8_t step, uint16_t *rgb565, uint8_t *alpha) {
+	convertRowSamples(scanline,width,step,rgb565,alpha,true,false,1);
+}
+
+static void convertRowRGB16(PngData *self, const uint8_t *scanline, uint8_t width, uint8_t step, uint16_t *rgb565, uint8_t *alpha) {
+	convertRowSamples(scanline,width,step,rgb565,alpha,true,false,2);
+}
+
+static void convertRowGreyA8(PngData *self, const uint8_t *scanline, uint8_t width, uint8_t step, uint16_t *rgb565, uint8_t *alpha) {
+	convertRowSamples(scanline,width,step,rgb565,alpha,false,true,1);
+}
+
+static void convertRowGreyA16(PngData *self, const uint8_t *scanline, uint8_t width, uint8_t step, uint16_t *rgb565, uint8_t *alpha) {
+	convertRowSamples(scanline,width,step,rgb565,alpha,false,true,2);
+}
+
+static void convertRowRGBA8(PngData *self, const uint8_t *scanline, uint8_t width, uint8_t step, uint16_t *rgb565, uint8_t *alpha) {
+	convertRowSamples(scanline,width,step,rgb565,alpha,true,true,1);
+}
+
+static void convertRowRGBA16(PngData *self, const uint8_t *scanline, uint8_t width, uint8_t step, uint16_t *rgb565, uint8_t *alpha) {
+	convertRowSamples(scanline,width,step,rgb565,alpha,true,true,2);
+}
+
 //------------------------------------------------------------------------------
 // chunk handling
 //------------------------------------------------------------------------------
 
-// read and decode chunk type and chunk length
-int8_t readChunkHeader(PngData *self) {
-	// read length (32 Bit Big Endian)
-	uint8_t buffer32[4];
-	if (epic_file_read(self->file,&buffer32,4) != 4) return RET_FAPNG_READ;
+// decode chunk type and chunk length from eight header bytes
+int8_t parseChunkHeader(PngData *self, uint8_t *buffer32) {
+	// length (32 Bit Big Endian)
 	self->lenChunk = (uint32_t)BIGENDIAN32(buffer32);
+	buffer32 += 4;
 	
-	// read and parse type string (4 chars)
-	if (epic_file_read(self->file,&buffer32,4) != 4) return RET_FAPNG_READ;
+	// parse type string (4 chars)
 	// primitive prefix tree instead of using strncmp()
 	self->typeChunk = CHUNK_UNKNOWN;
 	switch (buffer32[0]) {
@@ -269,6 +414,13 @@ int8_t readChunkHeader(PngData *self) {
 					break;
 			}
 			break;
+		case 116:
+			// t___
+			if (buffer32[1] == 82 && buffer32[2] == 78 && buffer32[3] == 83) {
+				// tRNS
+				self->typeChunk = CHUNK_TRNS;
+			}
+			break;
 		case 80:
 			// P____
 			if (buffer32[1] == 76 && buffer32[2] == 84 && buffer32[3] == 69) {
@@ -281,6 +433,29 @@ int8_t readChunkHeader(PngData *self) {
 	return RET_FAPNG_OK;
 }
 
+// read and decode chunk type and chunk length
+int8_t readChunkHeader(PngData *self) {
+	// read length and type with one request
+	uint8_t buffer64[8];
+	if (epic_file_read(self->file,buffer64,8) != 8) return RET_FAPNG_READ;
+	return parseChunkHeader(self,buffer64);
+}
+
+// read the palette alpha values of a tRNS chunk; chunks of other colour types are skipped
+// (a reused PngData may still hold the palette of a previous indexed image)
+int8_t readChunkTRNS(PngData *self) {
+	if (self->colourType != COLOURTYPE__INDEXED || self->palette == NULL || self->paletteAlpha != NULL) return RET_FAPNG_OK;
+	// entries without alpha value are opaque
+	uint16_t sizePalette = (uint16_t)self->sizePalette + 1;
+	uint16_t numBytes = (self->lenChunk < sizePalette) ? (uint16_t)self->lenChunk : sizePalette;
+	self->paletteAlpha = (uint8_t*)memoryAllocTransient(sizePalette);
+	if (self->paletteAlpha == NULL) return RET_FAPNG_MALLOC_PALETTE;
+	memset(self->paletteAlpha,0xff,sizePalette);
+	if (epic_file_read(self->file,self->paletteAlpha,numBytes) != numBytes) return RET_FAPNG_READ;
+	self->lenChunk -= numBytes;
+	return RET_FAPNG_OK;
+}
+
 // skip bytes until the given chunk type is encountered
 int8_t seekChunk(PngData *self, uint8_t typeChunkRequested) {
 	int8_t retval;
@@ -288,6 +463,11 @@ int8_t seekChunk(PngData *self, uint8_t typeChunkRequested) {
 		if (epic_file_seek(self->file,self->lenChunk+4,SEEK_CUR) != 0) return RET_FAPNG_SEEK;
 		retval = readChunkHeader(self);
 		if (retval != RET_FAPNG_OK) return retval;
+		if (self->typeChunk == CHUNK_TRNS) {
+			self->opaque = false;
+			retval = readChunkTRNS(self);
+			if (retval != RET_FAPNG_OK) return retval;
+		}
 	} while (self->typeChunk != typeChunkRequested);
 	return RET_FAPNG_OK;
 }
@@ -296,124 +476,118 @@ int8_t seekChunk(PngData *self, uint8_t typeChunkRequested) {
 // IDAT chunk reading functions; if reaching end of chunk: skip to next IDAT 
 //------------------------------------------------------------------------------
 
+// refill the file buffer from the current IDAT chunk; skip to the next IDAT chunk if exhausted
+int8_t refillBufferIDAT(PngData *self) {
+	int8_t retval;
+	uint8_t buffer96[12];
+	while (self->lenChunk == 0) {
+		// chunk exhausted: read CRC of this chunk and header of next chunk with one request
+		if (epic_file_read(self->file,buffer96,12) != 12) return RET_FAPNG_READ;
+		retval = parseChunkHeader(self,&buffer96[4]);
+		if (retval != RET_FAPNG_OK) return retval;
+		if (self->typeChunk != CHUNK_IDAT) {
+			// ancillary chunk between IDAT chunks (rare): seek
+			retval = seekChunk(self,CHUNK_IDAT);
+			if (retval != RET_FAPNG_OK) return retval;
+		}
+	}
+	// read no more than the chunk holds, so that the file position stays at the chunk's CRC
+	uint16_t numBytes = (self->lenChunk < self->sizeBufferFile) ? (uint16_t)self->lenChunk : self->sizeBufferFile;
+	if (epic_file_read(self->file,self->bufferFile,numBytes) != numBytes) return RET_FAPNG_READ;
+	self->lenChunk -= numBytes;
+	self->indexBufferFile = 0;
+	self->numBufferFile = numBytes;
+	return RET_FAPNG_OK;
+}
+
 // skip to next byte boundary
 void skipRemainingBits(PngData *self) {
-	self->bitsRemaining = 0;
+	self->bufferBits >>= self->bitsRemaining & 7;
+	self->bitsRemaining &= ~7;
 	self->valueBufferBits = 0;
 }
 
-// read numBytes byte from self->file
+// read numBytes byte from the IDAT stream; starts at a byte boundary
 int8_t readBytesIDAT(PngData *self, uint8_t *buffer, uint16_t numBytes) {
 	uint16_t numBytesRead = 0;
-	uint16_t numBytesRemaining = numBytes;
+	uint16_t numBytesCopy;
 	int8_t retval;
-	do {
-		if (self->lenChunk < numBytesRemaining) {
-			// chunk holds fewer bytes than needed:
-			// read only lenChunk bytes, update bytes counters and seek new IDAT chunk
-			if ((uint32_t)epic_file_read(self->file,&buffer[numBytesRead],self->lenChunk) != self->lenChunk) return RET_FAPNG_READ;
-			numBytesRemaining -= self->lenChunk;
-			numBytesRead += self->lenChunk;
-			self->lenChunk = 0;
-			retval = seekChunk(self,CHUNK_IDAT);
+	skipRemainingBits(self);
+	// whole bytes still held by the bit accumulator come first
+	while (self->bitsRemaining > 0 && numBytesRead < numBytes) {
+		buffer[numBytesRead++] = (uint8_t)self->bufferBits;
+		self->bufferBits >>= 8;
+		self->bitsRemaining -= 8;
+	}
+	// copy the remaining bytes from the file buffer, refilling as needed
+	while (numBytesRead < numBytes) {
+		if (self->indexBufferFile >= self->numBufferFile) {
+			retval = refillBufferIDAT(self);
 			if (retval != RET_FAPNG_OK) return retval;
-		} else {
-			// chunk holds enough bytes to satisfy request:
-			// read request number of bytes and 
-			if ((uint32_t)epic_file_read(self->file,&buffer[numBytesRead],numBytesRemaining) != numBytesRemaining) return RET_FAPNG_READ;
-			numBytesRead += numBytesRemaining;
-			self->lenChunk -= numBytesRemaining;
-			numBytesRemaining = 0;
 		}
-	} while (numBytesRead < numBytes);
-	skipRemainingBits(self);
+		numBytesCopy = self->numBufferFile - self->indexBufferFile;
+		if (numBytesCopy > numBytes - numBytesRead) numBytesCopy = numBytes - numBytesRead;
+		memcpy(&buffer[numBytesRead],&self->bufferFile[self->indexBufferFile],numBytesCopy);
+		self->indexBufferFile += numBytesCopy;
+		numBytesRead += numBytesCopy;
+	}
 	return RET_FAPNG_OK;
 }
 
-// read numBits bits from self->file
-int8_t readBitsIDAT(PngData *self, uint8_t numBits) {
-	// preparation: limit numBits to range 0..32
-	numBits = (numBits > 32) ? 32 : numBits;
-	uint8_t bitsRead = 0;
+// make sure the bit accumulator holds at least numBits bits (numBits <= 25)
+int8_t fillBitsIDAT(PngData *self, uint8_t numBits) {
 	int8_t retval;
-	
-	// consume remaining bits and/or initialise bit value
-	if (self->bitsRemaining > 0) {
-		if (self->bitsRemaining >= numBits) {
-			// buffer holds enough bits
-			self->valueBufferBits = self->bufferBits & ((1 << numBits)-1);
-			self->bufferBits >>= numBits;
-			self->bitsRemaining -= numBits;
-			return RET_FAPNG_OK;
-		}
-		else {
-			// consume all remaining bits
-			self->valueBufferBits = self->bufferBits;
-			numBits -= self->bitsRemaining;
-			bitsRead = self->bitsRemaining;
-			self->bitsRemaining = 0;
-		}
-	} else {
-		self->valueBufferBits = 0;
-	}
-	
-	// read as many whole bytes as necessary
-	while (numBits > 8) {
-		if (self->lenChunk > 0) {
-			if (epic_file_read(self->file,&self->bufferBits,1) != 1) return RET_FAPNG_READ;
-			self->lenChunk--;
-			self->valueBufferBits |= self->bufferBits << bitsRead;
-			bitsRead += 8;
-			numBits -= 8;
-		} else {
-			// seek next chunk for more bytes
-			retval = seekChunk(self,CHUNK_IDAT);
+	while (self->bitsRemaining < numBits) {
+		if (self->indexBufferFile >= self->numBufferFile) {
+			retval = refillBufferIDAT(self);
 			if (retval != RET_FAPNG_OK) return retval;
 		}
-	}
-	
-	// read remaining bits from next byte
-	if (numBits > 0) {
-		if (self->lenChunk == 0) {
-			// seek next chunk for more bytes
-			retval = seekChunk(self,CHUNK_IDAT);
-			if (retval != RET_FAPNG_OK) return retval;
-		}
-		if (epic_file_read(self->file,&self->bufferBits,1) != 1) return RET_FAPNG_READ;
-		self->lenChunk--;
-		self->bitsRemaining = 8 - numBits;
-		self->valueBufferBits |= (self->bufferBits & ((1 << numBits)-1)) << bitsRead;
-		self->bufferBits >>= numBits;
+		self->bufferBits |= (uint32_t)self->bufferFile[self->indexBufferFile++] << self->bitsRemaining;
+		self->bitsRemaining += 8;
 	}
 	return RET_FAPNG_OK;
 }
 
-int8_t checkCode(PngData *self, uint16_t lenCodes, uint32_t *codes) {
-	// codes are ordered with ascending bit length
-	// iterate over all codes, read bits as needed, check value match, write code into valueBufferBits
+// read numBits bits from the IDAT stream
+int8_t readBitsIDAT(PngData *self, uint8_t numBits) {
 	int8_t retval;
-	uint8_t lenCode;
-	uint8_t bitsRead = 0;
-	uint8_t lenCodeCurrent = 0;
-	uint16_t valueCode = 0;
-	for (uint16_t i=0; i<lenCodes; i++) {
-		// check current code's bit lengths; if greater, get additional bits from file
-		lenCode = EXTRACTLENGTH(codes[i]);
-		if (lenCode > lenCodeCurrent) {
-			retval = readBitsIDAT(self,lenCode - lenCodeCurrent);
-			if (retval != RET_FAPNG_OK) return retval;
-			valueCode |= self->valueBufferBits << bitsRead;
-			bitsRead += lenCode - lenCodeCurrent;
-			lenCodeCurrent = lenCode;
-		}
-		// check if extracted bit value matches code value; if so, set symbol and exit
-		if (EXTRACTBITS(codes[i]) == valueCode) {
-			self->valueBufferBits = EXTRACTSYMBOL(codes[i]);
-			return RET_FAPNG_OK;
-		}
+	uint32_t value;
+	
+	// preparation: limit numBits to range 0..32; the accumulator holds
+	// at most 32 bits, so requests above 24 bits are split
+	numBits = (numBits > 32) ? 32 : numBits;
+	if (numBits > 24) {
+		retval = readBitsIDAT(self,16);
+		if (retval != RET_FAPNG_OK) return retval;
+		value = self->valueBufferBits;
+		retval = readBitsIDAT(self,numBits - 16);
+		if (retval != RET_FAPNG_OK) return retval;
+		self->valueBufferBits = value | (self->valueBufferBits << 16);
+		return RET_FAPNG_OK;
 	}
-	// fell through: no code matches bit pattern at current file position: error
-	return RET_FAPNG_CODE_NOT_FOUND;
+	
+	retval = fillBitsIDAT(self,numBits);
+	if (retval != RET_FAPNG_OK) return retval;
+	self->valueBufferBits = self->bufferBits & ((1u << numBits) - 1);
+	self->bufferBits >>= numBits;
+	self->bitsRemaining -= numBits;
+	return RET_FAPNG_OK;
+}
+
+// decode the next Huffman-coded symbol: one peek, one (or two) table reads
+int8_t decodeSymbol(PngData *self, const uint16_t *table, uint8_t bitsRoot) {
+	// peek at the longest possible code; never exceeds the zlib stream,
+	// since the stream always ends with four ADLER32 bytes
+	int8_t retval = fillBitsIDAT(self,15);
+	if (retval != RET_FAPNG_OK) return retval;
+	uint16_t entry = table[self->bufferBits & ((1u << bitsRoot) - 1)];
+	if (HUFFMAN_ISLINK(entry))
+		entry = table[HUFFMAN_OFFSET(entry) + ((self->bufferBits >> bitsRoot) & ((1u << HUFFMAN_SUBBITS(entry)) - 1))];
+	if (entry == 0) return RET_FAPNG_CODE_NOT_FOUND;
+	self->bufferBits >>= HUFFMAN_LENGTH(entry);
+	self->bitsRemaining -= HUFFMAN_LENGTH(entry);
+	self->valueBufferBits = HUFFMAN_SYMBOL(entry);
+	return RET_FAPNG_OK;
 }
 
 
@@ -421,93 +595,168 @@ int8_t checkCode(PngData *self, uint16_t lenCodes, uint32_t *codes) {
 // zlib/deflate algorithms: inflate IDAT data
 //------------------------------------------------------------------------------
 
-// generate a Huffman code alphabet from given lenths
-int8_t generateHuffmanCodes(uint16_t numLengths, uint8_t *lengths, uint32_t **codeStruct, uint16_t *sizeCodeStruct) {
-	// rationale: longest bit lengths for...
-	// ...length codes: 9 bits (static huffman), 7 bits (dynamic huffman)
-	// ...distance codes: 15 bits
-	// => 15 bits maximum
-	uint8_t bl_count[] = {0,0,0,0,0, 0,0,0,0,0, 0,0,0,0,0};
-	uint16_t next_code[] = {0, 0,0,0,0,0, 0,0,0,0,0, 0,0,0,0,0};
-	uint16_t i,k,l,length,codebits;
-	uint32_t entry;
-	uint32_t *codes;
-	
-	codes = (uint32_t*)malloc(numLengths*sizeof(uint32_t));
-	if (codes == NULL) return RET_FAPNG_MALLOC_CODE;
-	for (i=0;i<numLengths;i++) codes[i] = 0xffffffff; // pre-set unused codes with highest value (sorting shifts them down)
+// Huffman table of the static lit/len alphabet (RFC 1951, 3.2.6), 9 root bits
+static const uint16_t tableFixedLength[512] = {
+	0x0f00,0x1050,0x1010,0x1118,0x0f10,0x1070,0x1030,0x12c0,0x0f08,0x1060,0x1020,0x12a0,
+	0x1000,0x1080,0x1040,0x12e0,0x0f04,0x1058,0x1018,0x1290,0x0f14,0x1078,0x1038,0x12d0,
+	0x0f0c,0x1068,0x1028,0x12b0,0x1008,0x1088,0x1048,0x12f0,0x0f02,0x1054,0x1014,0x111c,
+	0x0f12,0x1074,0x1034,0x12c8,0x0f0a,0x1064,0x1024,0x12a8,0x1004,0x1084,0x1044,0x12e8,
+	0x0f06,0x105c,0x101c,0x1298,0x0f16,0x107c,0x103c,0x12d8,0x0f0e,0x106c,0x102c,0x12b8,
+	0x100c,0x108c,0x104c,0x12f8,0x0f01,0x1052,0x1012,0x111a,0x0f11,0x1072,0x1032,0x12c4,
+	0x0f09,0x1062,0x1022,0x12a4,0x1002,0x1082,0x1042,0x12e4,0x0f05,0x105a,0x101a,0x1294,
+	0x0f15,0x107a,0x103a,0x12d4,0x0f0d,0x106a,0x102a,0x12b4,0x100a,0x108a,0x104a,0x12f4,
+	0x0f03,0x1056,0x1016,0x111e,0x0f13,0x1076,0x1036,0x12cc,0x0f0b,0x1066,0x1026,0x12ac,
+	0x1006,0x1086,0x1046,0x12ec,0x0f07,0x105e,0x101e,0x129c,0x0f17,0x107e,0x103e,0x12dc,
+	0x0f0f,0x106e,0x102e,0x12bc,0x100e,0x108e,0x104e,0x12fc,0x0f00,0x1051,0x1011,0x1119,
+	0x0f10,0x1071,0x1031,0x12c2,0x0f08,0x1061,0x1021,0x12a2,0x1001,0x1081,0x1041,0x12e2,
+	0x0f04,0x1059,0x1019,0x1292,0x0f14,0x1079,0x1039,0x12d2,0x0f0c,0x1069,0x1029,0x12b2,
+	0x1009,0x1089,0x1049,0x12f2,0x0f02,0x1055,0x1015,0x111d,0x0f12,0x1075,0x1035,0x12ca,
+	0x0f0a,0x1065,0x1025,0x12aa,0x1005,0x1085,0x1045,0x12ea,0x0f06,0x105d,0x101d,0x129a,
+	0x0f16,0x107d,0x103d,0x12da,0x0f0e,0x106d,0x102d,0x12ba,0x100d,0x108d,0x104d,0x12fa,
+	0x0f01,0x1053,0x1013,0x111b,0x0f11,0x1073,0x1033,0x12c6,0x0f09,0x1063,0x1023,0x12a6,
+	0x1003,0x1083,0x1043,0x12e6,0x0f05,0x105b,0x101b,0x1296,0x0f15,0x107b,0x103b,0x12d6,
+	0x0f0d,0x106b,0x102b,0x12b6,0x100b,0x108b,0x104b,0x12f6,0x0f03,0x1057,0x1017,0x111f,
+	0x0f13,0x1077,0x1037,0x12ce,0x0f0b,0x1067,0x1027,0x12ae,0x1007,0x1087,0x1047,0x12ee,
+	0x0f07,0x105f,0x101f,0x129e,0x0f17,0x107f,0x103f,0x12de,0x0f0f,0x106f,0x102f,0x12be,
+	0x100f,0x108f,0x104f,0x12fe,0x0f00,0x1050,0x1010,0x1118,0x0f10,0x1070,0x1030,0x12c1,
+	0x0f08,0x1060,0x1020,0x12a1,0x1000,0x1080,0x1040,0x12e1,0x0f04,0x1058,0x1018,0x1291,
+	0x0f14,0x1078,0x1038,0x12d1,0x0f0c,0x1068,0x1028,0x12b1,0x1008,0x1088,0x1048,0x12f1,
+	0x0f02,0x1054,0x1014,0x111c,0x0f12,0x1074,0x1034,0x12c9,0x0f0a,0x1064,0x1024,0x12a9,
+	0x1004,0x1084,0x1044,0x12e9,0x0f06,0x105c,0x101c,0x1299,0x0f16,0x107c,0x103c,0x12d9,
+	0x0f0e,0x106c,0x102c,0x12b9,0x100c,0x108c,0x104c,0x12f9,0x0f01,0x1052,0x1012,0x111a,
+	0x0f11,0x1072,0x1032,0x12c5,0x0f09,0x1062,0x1022,0x12a5,0x1002,0x1082,0x1042,0x12e5,
+	0x0f05,0x105a,0x101a,0x1295,0x0f15,0x107a,0x103a,0x12d5,0x0f0d,0x106a,0x102a,0x12b5,
+	0x100a,0x108a,0x104a,0x12f5,0x0f03,0x1056,0x1016,0x111e,0x0f13,0x1076,0x1036,0x12cd,
+	0x0f0b,0x1066,0x1026,0x12ad,0x1006,0x1086,0x1046,0x12ed,0x0f07,0x105e,0x101e,0x129d,
+	0x0f17,0x107e,0x103e,0x12dd,0x0f0f,0x106e,0x102e,0x12bd,0x100e,0x108e,0x104e,0x12fd,
+	0x0f00,0x1051,0x1011,0x1119,0x0f10,0x1071,0x1031,0x12c3,0x0f08,0x1061,0x1021,0x12a3,
+	0x1001,0x1081,0x1041,0x12e3,0x0f04,0x1059,0x1019,0x1293,0x0f14,0x1079,0x1039,0x12d3,
+	0x0f0c,0x1069,0x1029,0x12b3,0x1009,0x1089,0x1049,0x12f3,0x0f02,0x1055,0x1015,0x111d,
+	0x0f12,0x1075,0x1035,0x12cb,0x0f0a,0x1065,0x1025,0x12ab,0x1005,0x1085,0x1045,0x12eb,
+	0x0f06,0x105d,0x101d,0x129b,0x0f16,0x107d,0x103d,0x12db,0x0f0e,0x106d,0x102d,0x12bb,
+	0x100d,0x108d,0x104d,0x12fb,0x0f01,0x1053,0x1013,0x111b,0x0f11,0x1073,0x1033,0x12c7,
+	0x0f09,0x1063,0x1023,0x12a7,0x1003,0x1083,0x1043,0x12e7,0x0f05,0x105b,0x101b,0x1297,
+	0x0f15,0x107b,0x103b,0x12d7,0x0f0d,0x106b,0x102b,0x12b7,0x100b,0x108b,0x104b,0x12f7,
+	0x0f03,0x1057,0x1017,0x111f,0x0f13,0x1077,0x1037,0x12cf,0x0f0b,0x1067,0x1027,0x12af,
+	0x1007,0x1087,0x1047,0x12ef,0x0f07,0x105f,0x101f,0x129f,0x0f17,0x107f,0x103f,0x12df,
+	0x0f0f,0x106f,0x102f,0x12bf,0x100f,0x108f,0x104f,0x12ff
+};
+
+// Huffman table of the static distance alphabet, 5 root bits
+static const uint16_t tableFixedDistance[32] = {
+	0x0a00,0x0a10,0x0a08,0x0a18,0x0a04,0x0a14,0x0a0c,0x0a1c,0x0a02,0x0a12,0x0a0a,0x0a1a,
+	0x0a06,0x0a16,0x0a0e,0x0a1e,0x0a01,0x0a11,0x0a09,0x0a19,0x0a05,0x0a15,0x0a0d,0x0a1d,
+	0x0a03,0x0a13,0x0a0b,0x0a1b,0x0a07,0x0a17,0x0a0f,0x0a1f
+};
+
+// base values and number of extra bits of length symbols 257..285
+static const uint16_t baseLength[29] = {3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258};
+static const uint8_t  extraLength[29] = {0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0};
+
+// base values and number of extra bits of distance symbols 0..29
+static const uint16_t baseDistance[30] = {1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769,1025,1537,2049,3073,4097,6145,8193,12289,16385,24577};
+static const uint8_t  extraDistance[30] = {0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13};
+
+// order of code length code lengths (RFC 1951, 3.2.7)
+static const uint8_t orderCodeLength[19] = {16,17,18,0,8,7,9,6,10,5,11,4,12,3,13,2,14,1,15};
+
+// reverse the lowest len bits of code
+static inline uint16_t reverseBits(uint16_t code, uint8_t len) {
+	// algorithm: swap odd and even bits, swap bit pairs, swap nibbles, swap bytes
+	code = ((code >> 1) & 0x5555) | ((code << 1) & 0xaaaa);
+	code = ((code >> 2) & 0x3333) | ((code << 2) & 0xcccc);
+	code = ((code >> 4) & 0x0f0f) | ((code << 4) & 0xf0f0);
+	code = ((code >> 8) & 0x00ff) | ((code << 8) & 0xff00);
+	return code >> (16 - len);
+}
+
+// build a Huffman lookup table from given code lengths
+int8_t buildHuffmanTable(uint16_t numLengths, const uint8_t *lengths, uint16_t *table, uint16_t sizeTable, uint8_t bitsRoot) {
+	uint16_t count[16] = {0};
+	uint16_t nextCode[16];
+	uint16_t codeFirst[16];
+	uint16_t i,k,code,sizeRoot,offset,step;
+	uint8_t  len,lenMax = 0;
+	int32_t  left;
 	
-	// algorithm: ref. to RFC 1951, 3.2.2 
-	// step 1: count number of codes for each code length
-	for (i=0; i < numLengths; i++)
-		bl_count[lengths[i]]++;
+	// algorithm: ref. to RFC 1951, 3.2.2
+	// step 1: count number of codes for each code length; reject over-subscribed sets
+	for (i = 0; i < numLengths; i++) {
+		count[lengths[i]]++;
+		if (lengths[i] > lenMax) lenMax = lengths[i];
+	}
+	count[0] = 0;
+	left = 1;
+	for (len = 1; len <= 15; len++) {
+		left = (left << 1) - count[len];
+		if (left < 0) return RET_FAPNG_HUFFMAN_TABLE;
+	}
 	
 	// step 2: find numerical value of smallest code for each code length
-	uint16_t code = 0;
-	bl_count[0] = 0;
-	for (i=1; i <= 15; i++) {
-		code = (code + bl_count[i-1]) << 1;
-		next_code[i] = code;
+	code = 0;
+	for (len = 1; len <= 15; len++) {
+		code = (code + count[len-1]) << 1;
+		codeFirst[len] = code;
 	}
 	
-	// step 3: assign numerical values to all codes;
-	*sizeCodeStruct = 0;
-	for (i=0; i < numLengths; i++) {
-		if (lengths[i] != 0) {
-			length = lengths[i];
-			codebits = next_code[length];
-			next_code[length]++;
-			
-			// convert length, codebits and symbol i to a 32 bit uint
-			entry = PACKCODE(length,codebits,i);
-			
-			// copy into codes, sorted (length bits are msb, thus sorted from small to large lengths)
-			// kind of insertion sorting, online during list building
-			
-			k = 0;
-			while (k < i && entry > codes[k]) k++; // look for insertion place
-			if (k < i) {
-				// shift remaining entries up to free kth place: swap places
-				// (an empty entry is shifted down to position k)
-				for (l=i; l>k; l--) {
-					codes[l]   ^= codes[l-1];
-					codes[l-1] ^= codes[l];
-					codes[l]   ^= codes[l-1];
-				}
+	// clear root table
+	sizeRoot = 1 << bitsRoot;
+	if (sizeRoot > sizeTable) return RET_FAPNG_HUFFMAN_TABLE;
+	for (i = 0; i < sizeRoot; i++) table[i] = 0;
+	
+	// codes longer than bitsRoot: find the longest code per root entry
+	// (kept in the root entry for now), then assign sub-tables
+	if (lenMax > bitsRoot) {
+		for (len = 0; len <= 15; len++) nextCode[len] = codeFirst[len];
+		for (i = 0; i < numLengths; i++) {
+			len = lengths[i];
+			if (len <= bitsRoot) {
+				if (len > 0) nextCode[len]++;
+				continue;
 			}
-			codes[k] = entry; // insert at k
-			*sizeCodeStruct += 1;
+			k = reverseBits(nextCode[len]++,len) & (sizeRoot - 1);
+			if (table[k] < len - bitsRoot) table[k] = len - bitsRoot;
+		}
+		offset = sizeRoot;
+		for (k = 0; k < sizeRoot; k++) {
+			if (table[k] == 0) continue;
+			step = 1 << table[k];
+			if (offset + step > sizeTable) return RET_FAPNG_HUFFMAN_TABLE;
+			table[k] = HUFFMAN_LINK(table[k],offset);
+			for (i = offset; i < offset + step; i++) table[i] = 0;
+			offset += step;
 		}
 	}
-	// reverse code bits in order to use the normal little endian read routine
-	for (i=0; i < numLengths; i++) {
-		// extract length and codebits from the entry
-		length = EXTRACTLENGTH(codes[i]);
-		codebits = EXTRACTBITS(codes[i]);
-		
-		// algorithm: swap odd and even bits, swap bit pairs, swap nibbles, swap bytes
-		codebits = ((codebits >> 1) & 0x5555) | ((codebits << 1) & 0xaaaa);
-		codebits = ((codebits >> 2) & 0x3333) | ((codebits << 2) & 0xcccc);
-		codebits = ((codebits >> 4) & 0x0f0f) | ((codebits << 4) & 0xf0f0);
-		codebits = ((codebits >> 8) & 0x00ff) | ((codebits << 8) & 0xff00);
-		
-		// shift codebits down and trim them to the required bit length
- 		codebits >>= 16-length;
- 		codebits &= (1 << length) - 1;
-		
-		// set new entry: clear bits 8..23 and OR the new codebits to them
- 		codes[i] &= 0xff0001ff;
-  		codes[i] |= ((uint32_t)codebits & 0x7fff) << 9;
+	
+	// step 3: assign numerical values to all codes and fill the table;
+	// codes are read LSB first, thus entries are indexed by reversed code bits
+	for (len = 0; len <= 15; len++) nextCode[len] = codeFirst[len];
+	for (i = 0; i < numLengths; i++) {
+		len = lengths[i];
+		if (len == 0) continue;
+		code = reverseBits(nextCode[len]++,len);
+		if (len <= bitsRoot) {
+			for (k = code; k < sizeRoot; k += 1 << len) table[k] = HUFFMAN_LEAF(len,i);
+		} else {
+			offset = HUFFMAN_OFFSET(table[code & (sizeRoot - 1)]);
+			step = 1 << HUFFMAN_SUBBITS(table[code & (sizeRoot - 1)]);
+			for (k = code >> bitsRoot; k < step; k += 1 << (len - bitsRoot)) table[offset + k] = HUFFMAN_LEAF(len,i);
+		}
 	}
-	// create codeStruct, copy defined codes and adjust size var (free old one if not NULL)
-	if (*codeStruct != NULL) free(*codeStruct);
-	*codeStruct = (uint32_t*)malloc(*sizeCodeStruct*sizeof(uint32_t));
-	if (*codeStruct == NULL) return RET_FAPNG_MALLOC_CODE;
-	for (i=0;i<*sizeCodeStruct;i++) (*codeStruct)[i] = codes[i];
-	free(codes);
 	return RET_FAPNG_OK;
 }
 
+// move decoded bytes from the INFLATE buffer to the scanline; returns true if the scanline is complete
+static inline bool drainBufferInflate(PngData *self, uint16_t numBytes, uint16_t *numBytesToRead) {
+	// note: since reading index is always behind buffer front, checking for equality suffices
+	while (self->indexReading != self->indexBufferInflate) {
+		self->scanlineCurrent[numBytes - *numBytesToRead] = self->bufferInflate[self->indexReading];
+		self->indexReading = (self->indexReading + 1) & (self->sizeWindow - 1);
+		if (--(*numBytesToRead) == 0) return true;
+	}
+	return false;
+}
+
 // read numBytes from self->file into self->scanlineCurrent, decoding zlib/DEFLATE data on the fly
 int8_t readScanline(PngData *self, uint16_t numBytes) {
 	int8_t retval;
@@ -520,23 +769,26 @@ int8_t readScanline(PngData *self, uint16_t numBytes) {
 	// if chunk end is reached, seek next IDAT chunk or fail
 	//
 	// buffer management for huffman decoding:
-	//  - size according to sizeWindow (max 32k)
-	//  - indexDecoding: buffer position for next decoded byte
+	//  - size according to sizeWindow (max 32k), allocated once per zlib stream
+	//  - indexBufferInflate: buffer position for next decoded byte
 	//  - indexReading: buffer position for next requested byte
 	//  - ring buffer: index increment modulo size, eg.
-	//       indexDecoding = (indexDecoding+1 < size) ? indexDecoding + 1 : 0
+	//       indexDecoding = (indexDecoding+1) & (size-1)
+	//  - the window persists across DEFLATE blocks (back references may cross blocks)
 	//
 	// huffman decoding: every decoding operation must be finished;
 	// thus it might happen that more bytes are decoded than read
 	uint8_t buffer32[4];
-	uint8_t *lengths;
-	uint16_t length,distance;
-	uint8_t extraBits;
+	uint8_t lengths[286+30];
+	uint16_t length,distance,numLit,numDist,numCodeLen,numStored;
 	uint32_t indexCopy;
 	
 	uint16_t numBytesToRead = numBytes;
 	uint16_t i;
 	while (self->state != STATE_EXIT) {
+		// bytes left over from previous decoding operations come first
+		if (drainBufferInflate(self,numBytes,&numBytesToRead)) return RET_FAPNG_OK;
+		
 		switch (self->state) {
 			case STATE_BEGIN:
 				// start of first IDAT chunk = start of zlib stream (RFC 1950, 2.2)
@@ -552,6 +804,17 @@ int8_t readScanline(PngData *self, uint16_t numBytes) {
 				// check FLG; bit 5 should not be set (no preset dictionary!)
 				if ((buffer32[1] & 0x20) == 0x20) return RET_FAPNG_PRESET_DICT;
 				
+				// allocate zlib buffer and dynamic Huffman tables once
+				memoryFree(self->bufferInflate);
+				self->bufferInflate = (uint8_t*)memoryAllocTransient(self->sizeWindow);
+				if (self->bufferInflate == NULL) return RET_FAPNG_MALLOC_BUFFER_INFLATE;
+				self->indexBufferInflate = 0;
+				self->indexReading = 0;
+				if (self->tableHuffman == NULL) {
+					self->tableHuffman = (uint16_t*)memoryAllocTransient((PNG_SIZE_TABLE_LENGTH + PNG_SIZE_TABLE_DISTANCE) * sizeof(uint16_t));
+					if (self->tableHuffman == NULL) return RET_FAPNG_MALLOC_CODE;
+				}
+				
 				// what follows is compressed data according to RFC 1951
 				self->state = STATE_DEFL_BEGIN;
 				break;
@@ -562,7 +825,6 @@ int8_t readScanline(PngData *self, uint16_t numBytes) {
 				// otherwise skip zlib's ADLER32 checksum and exit
 				retval = readBytesIDAT(self,buffer32,4);
 				if (retval != RET_FAPNG_OK) return retval;
-				free(self->bufferInflate);
 				self->state = STATE_EXIT;
 				return RET_FAPNG_OK;
 				
@@ -595,287 +857,130 @@ int8_t readScanline(PngData *self, uint16_t numBytes) {
 				break;
 			
 			case STATE_DEFL_STAT_HUFFMAN:
-				// allocate zlib buffer
-				if (self->sizeWindow == 0) return RET_FAPNG_ZLIB_WINSIZE;
-				self->bufferInflate = (uint8_t*)malloc(self->sizeWindow);
-				if (self->bufferInflate == NULL) return RET_FAPNG_MALLOC_BUFFER_INFLATE;
-				self->indexBufferInflate = 0;
-				self->indexReading = 0;
-				// calculate static huffman code alphabets
-				// create huffman code structure using the bit lengths defined in RFC 1951, 3.2.6
-				lengths = (uint8_t*)malloc(288);
-				if (lengths == NULL) return RET_FAPNG_MALLOC_CODE;
-				for (i=0; i<=143; i++) lengths[i] = 8;
-				for (i=144; i<=255; i++) lengths[i] = 9;
-				for (i=256; i<=279; i++) lengths[i] = 7;
-				for (i=280; i<=287; i++) lengths[i] = 8;
-				
-				retval = generateHuffmanCodes(288,lengths,&self->codesHuffmanLength,&self->sizeCodesHuffmanLength);
-				if (retval != RET_FAPNG_OK) return retval;
-				free(lengths);
-				
-				lengths = (uint8_t*)malloc(32);
-				if (lengths == NULL) return RET_FAPNG_MALLOC_CODE;
-				for (i=0; i<32; i++) lengths[i] = 5;
-				retval = generateHuffmanCodes(32,lengths,&self->codesHuffmanDistance,&self->sizeCodesHuffmanDistance);
-				if (retval != RET_FAPNG_OK) return retval;
-				free(lengths);
-				
-				// start decoding
-				self->indexBufferInflate = 0;
-				self->indexReading = 0;
-				self->doDecoding = true;
+				// static huffman code alphabets: precomputed tables
+				self->tableLength = tableFixedLength;
+				self->bitsRootLength = 9;
+				self->tableDistance = tableFixedDistance;
+				self->bitsRootDistance = 5;
 				self->state = STATE_DEFL_HUFFMAN_DECODE;
 				break;
 			
 			case STATE_DEFL_DYN_HUFFMAN:
-				// allocate zlib buffer
-				if (self->sizeWindow == 0) return RET_FAPNG_ZLIB_WINSIZE;
-				self->bufferInflate = (uint8_t*)malloc(self->sizeWindow);
-				if (self->bufferInflate == NULL) return RET_FAPNG_MALLOC_BUFFER_INFLATE;
-				self->indexBufferInflate = 0;
-				self->indexReading = 0;
 				// extract huffman code alphabets from block
 				// cf. RFC 1951:
 				//  - read 5 bits HLIT = number of lit/len codes - 257
 				//  - read 5 bits HDIST = number of dist codes - 1
 				//  - read 4 bits HCLEN = number of code length codes - 4
-				retval = readBitsIDAT(self,5);
-				if (retval != RET_FAPNG_OK) return retval;
-				uint16_t numLit = self->valueBufferBits + 257;
-				retval = readBitsIDAT(self,5);
+				retval = readBitsIDAT(self,14);
 				if (retval != RET_FAPNG_OK) return retval;
-				uint8_t numDist = self->valueBufferBits + 1;
-				retval = readBitsIDAT(self,4);
-				if (retval != RET_FAPNG_OK) return retval;
-				uint8_t numCodeLen = self->valueBufferBits + 4;
-				// read code length code lengths
-				lengths = (uint8_t*)calloc(19,1);
-				if (lengths == NULL) return RET_FAPNG_MALLOC_CODE;
-				for (i=0; i< numCodeLen; i++) {
+				numLit = (self->valueBufferBits & 0x1f) + 257;
+				numDist = ((self->valueBufferBits >> 5) & 0x1f) + 1;
+				numCodeLen = (self->valueBufferBits >> 10) + 4;
+				if (numLit > 286 || numDist > 30) return RET_FAPNG_LENGTHS_OVERFLOW;
+				
+				// read code length code lengths and build their table
+				// (stored in the distance table memory; 7 bits, no sub-tables)
+				for (i = 0; i < 19; i++) lengths[i] = 0;
+				for (i = 0; i < numCodeLen; i++) {
 					retval = readBitsIDAT(self,3);
 					if (retval != RET_FAPNG_OK) return retval;
-					switch (i) {
-						case 0:
-							lengths[16] = self->valueBufferBits;
-							break;
-						case 1:
-							lengths[17] = self->valueBufferBits;
-							break;
-						case 2:
-							lengths[18] = self->valueBufferBits;
-							break;
-						case 3:
-							lengths[0] = self->valueBufferBits;
-							break;
-						case 4:
-							lengths[8] = self->valueBufferBits;
-							break;
-						case 5:
-							lengths[7] = self->valueBufferBits;
-							break;
-						case 6:
-							lengths[9] = self->valueBufferBits;
-							break;
-						case 7:
-							lengths[6] = self->valueBufferBits;
-							break;
-						case 8:
-							lengths[10] = self->valueBufferBits;
-							break;
-						case 9:
-							lengths[5] = self->valueBufferBits;
-							break;
-						case 10:
-							lengths[11] = self->valueBufferBits;
-							break;
-						case 11:
-							lengths[4] = self->valueBufferBits;
-							break;
-						case 12:
-							lengths[12] = self->valueBufferBits;
-							break;
-						case 13:
-							lengths[3] = self->valueBufferBits;
-							break;
-						case 14:
-							lengths[13] = self->valueBufferBits;
-							break;
-						case 15:
-							lengths[2] = self->valueBufferBits;
-							break;
-						case 16:
-							lengths[14] = self->valueBufferBits;
-							break;
-						case 17:
-							lengths[1] = self->valueBufferBits;
-							break;
-						case 18:
-							lengths[15] = self->valueBufferBits;
-							break;
-					}
-					if (retval != RET_FAPNG_OK) return retval;
+					lengths[orderCodeLength[i]] = (uint8_t)self->valueBufferBits;
 				}
-				// build alphabet from code length code lengths
-				retval = generateHuffmanCodes(19,lengths,&self->codesHuffmanLength,&self->sizeCodesHuffmanLength);
+				retval = buildHuffmanTable(19,lengths,&self->tableHuffman[PNG_SIZE_TABLE_LENGTH],PNG_SIZE_TABLE_DISTANCE,7);
 				if (retval != RET_FAPNG_OK) return retval;
-				free(lengths);
+				
 				// decode combined lengths for lit/len and distance alphabets
-				// using the codes in codesHuffmanLength
-				lengths = (uint8_t*)calloc(numLit+numDist,1);
-				if (lengths == NULL) return RET_FAPNG_MALLOC_CODE;
 				i = 0;
 				while (i < numLit+numDist) {
-					retval = checkCode(self,19,self->codesHuffmanLength);
+					retval = decodeSymbol(self,&self->tableHuffman[PNG_SIZE_TABLE_LENGTH],7);
 					if (retval != RET_FAPNG_OK) return retval;
 					if (self->valueBufferBits < 16) {
 						// code 0..15: just add this value as length
-						lengths[i] = (uint8_t)self->valueBufferBits;
-						i++;
-					} else if (self->valueBufferBits == 16) {
+						lengths[i++] = (uint8_t)self->valueBufferBits;
+						continue;
+					}
+					if (self->valueBufferBits == 16) {
 						// code 16: copy previous lengths x times; x = next 2 bits + 3
 						if (i == 0) return RET_FAPNG_INVALID_CODE_LEN_CODE;
 						retval = readBitsIDAT(self,2);
-						if (retval != RET_FAPNG_OK) return retval;
-						for (self->valueBufferBits += 3; self->valueBufferBits > 0; self->valueBufferBits--) {
-							lengths[i] = lengths[i-1];
-							i++;
-							if (i > numLit+numDist) return RET_FAPNG_LENGTHS_OVERFLOW;
-						}
+						length = self->valueBufferBits + 3;
+						buffer32[0] = lengths[i-1];
 					} else if (self->valueBufferBits == 17) {
 						// code 17: repeat length 0, x times; x = next 3 bits + 3
-						// since lengths is initialised with zeros, just skip the next x lengths
 						retval = readBitsIDAT(self,3);
-						if (retval != RET_FAPNG_OK) return retval;
-						i += self->valueBufferBits + 3;
-						if (i > numLit+numDist) return RET_FAPNG_LENGTHS_OVERFLOW;
-					} else if (self->valueBufferBits == 18) {
+						length = self->valueBufferBits + 3;
+						buffer32[0] = 0;
+					} else {
 						// code 18: repeat length 0, x times; x = next 7 bits + 11
-						// since lengths is initialised with zeros, just skip the next x lengths
 						retval = readBitsIDAT(self,7);
-						if (retval != RET_FAPNG_OK) return retval;
-						i += self->valueBufferBits + 11;
-						if (i > numLit+numDist) return RET_FAPNG_LENGTHS_OVERFLOW;
+						length = self->valueBufferBits + 11;
+						buffer32[0] = 0;
 					}
+					if (retval != RET_FAPNG_OK) return retval;
+					if (i + length > numLit+numDist) return RET_FAPNG_LENGTHS_OVERFLOW;
+					while (length-- > 0) lengths[i++] = buffer32[0];
 				}
-				// all lengths fields are now set up: build code alphabets, de-allocate lengths memory
-				retval = generateHuffmanCodes(numLit,lengths,&self->codesHuffmanLength,&self->sizeCodesHuffmanLength);
+				
+				// all lengths fields are now set up: build lookup tables
+				retval = buildHuffmanTable(numLit,lengths,self->tableHuffman,PNG_SIZE_TABLE_LENGTH,9);
 				if (retval != RET_FAPNG_OK) return retval;
-				retval = generateHuffmanCodes(numDist,&lengths[numLit],&self->codesHuffmanDistance,&self->sizeCodesHuffmanDistance);
+				retval = buildHuffmanTable(numDist,&lengths[numLit],&self->tableHuffman[PNG_SIZE_TABLE_LENGTH],PNG_SIZE_TABLE_DISTANCE,6);
 				if (retval != RET_FAPNG_OK) return retval;
-				free(lengths);
+				self->tableLength = self->tableHuffman;
+				self->bitsRootLength = 9;
+				self->tableDistance = &self->tableHuffman[PNG_SIZE_TABLE_LENGTH];
+				self->bitsRootDistance = 6;
 				
 				// head on to huffman decoding
-				self->indexBufferInflate = 0;
-				self->indexReading = 0;
-				self->doDecoding = true;
 				self->state = STATE_DEFL_HUFFMAN_DECODE;
 				break;
 			
 			case STATE_DEFL_HUFFMAN_DECODE:
-				while (self->doDecoding) {
- 					// prior to decoding: try to read from buffer
+				while (true) {
+					// prior to decoding: try to read from buffer
 					// decoding might yield more bytes than needed, thus read
 					// until buffer is exhausted (reading index reached front index)
 					// or the requested number of bytes was read
-					// note: since reading index is always behind buffer front, checking for equality suffices
-					while (self->indexReading != self->indexBufferInflate) {
-						self->scanlineCurrent[numBytes-numBytesToRead] = self->bufferInflate[self->indexReading];
-						self->indexReading = (self->indexReading + 1) & (self->sizeWindow-1);
-						numBytesToRead--;
-						if (numBytesToRead == 0) return RET_FAPNG_OK;
-					}
+					if (drainBufferInflate(self,numBytes,&numBytesToRead)) return RET_FAPNG_OK;
 					
 					// retrieve length symbol
-					retval = checkCode(self,self->sizeCodesHuffmanLength,self->codesHuffmanLength);
+					retval = decodeSymbol(self,self->tableLength,self->bitsRootLength);
 					if (retval != RET_FAPNG_OK) return retval;
 					if  (self->valueBufferBits < 256) {
 						// literal symbol found: just append symbol to buffer
 						// wrap around index if reaching end of buffer (ring buffer)
 						self->bufferInflate[self->indexBufferInflate] = self->valueBufferBits;
 						self->indexBufferInflate = (self->indexBufferInflate + 1) & (self->sizeWindow-1);
+						continue;
 					}
-					else if (self->valueBufferBits == 256) {
-						// stop symbol found: break from loop
-						self->doDecoding = false;
-					}
-					else {
-						// length symbol found
-						// step 1: decode length
-						length = self->valueBufferBits;
-						if (length < 265) {
-							// length symbol 257..264 represent length 3..10 without extra distance bits
-							length -= 254;
-						} else if (length < 285) {
-							// code      bits    length
-							// -----------------------------
-							// 265-268   1       11,13,15,17
-							// 269-272   2       19,23,27,31
-							// 273-276   3       35,43,51,59
-							// 277-280   4       67,83,99,115
-							// 281-284   5       131,163,195,227
-							//
-							// => extraBits = (symbol-261) / 4
-							// => length = (1<<(extraBits+2)) + 3 + ((symbol-261) & 3)*(1<<(extraBits))
-							length -= 261;
-							extraBits = length / 4;
-							length = (1<<(extraBits+2)) + 3 + (length & 3)*(1<<(extraBits));
-							retval = readBitsIDAT(self,extraBits);
-							if (retval != RET_FAPNG_OK) return retval;
-							length += self->valueBufferBits;
-						} else if (length == 285) {
-							length = 258;
-						} else return RET_FAPNG_INVALID_LENGTH_CODE;
-						
-						// step 2: decode distance
-						retval = checkCode(self,self->sizeCodesHuffmanDistance,self->codesHuffmanDistance);
-						if (retval != RET_FAPNG_OK) return retval;
-						distance = self->valueBufferBits;
-						if (distance < 4) {
-							// first four codes + 1 => distance
-							distance++;
-						} else if (distance < 30) {
-							// code   bits  distance
-							// ------------------------
-							// 4,5    1     5,7
-							// 6,7    2     9,13
-							// 8,9    3     17,25
-							// 10,11  4     33,49
-							// 12,13  5     65,97
-							// 14,15  6     129,193
-							// 16,17  7     257,385
-							// 18,19  8     513,769
-							// 20,21  9     1025,1537
-							// 22,23  10    2049,3073
-							// 24,25  11    4097,6145
-							// 26,27  12    8193,12289
-							// 28,29  13    16385,24577
-							//
-							// => extraBits = (symbol-2) / 2
-							// => distance = (1<<(extraBits+1))+1 + ((symbol-2) & 1)*(1<<extraBits)
-							distance -= 2;
-							extraBits = distance / 2;
-							distance = (1<<(extraBits+1)) + 1 + (distance & 1)*(1<<extraBits);
-							retval = readBitsIDAT(self,extraBits);
-							if (retval != RET_FAPNG_OK) return retval;
-							distance += self->valueBufferBits;
-						} else return RET_FAPNG_INVALID_DISTANCE_CODE;
-						
-						// step 3: go back distance and copy length bytes to buffer front
-						// since it's a ring buffer, check crossing lower boundary (index==0)
-						if (self->indexBufferInflate >= distance) {
-							// subtraction would not violate lower boundary, proceed
-							indexCopy = self->indexBufferInflate - distance;
-						} else {
-							// subtract from end and add current index
-							indexCopy = self->sizeWindow - distance + self->indexBufferInflate;
-						}
-						while (length > 0) {
-							self->bufferInflate[self->indexBufferInflate] = self->bufferInflate[indexCopy];
-							self->indexBufferInflate = (self->indexBufferInflate + 1) & (self->sizeWindow-1);
-							indexCopy = (indexCopy + 1) & (self->sizeWindow-1);
-							length--;
-						}
+					// stop symbol found: break from loop
+					if (self->valueBufferBits == 256) break;
+					
+					// length symbol found
+					// step 1: decode length
+					i = self->valueBufferBits - 257;
+					if (i >= 29) return RET_FAPNG_INVALID_LENGTH_CODE;
+					retval = readBitsIDAT(self,extraLength[i]);
+					if (retval != RET_FAPNG_OK) return retval;
+					length = baseLength[i] + self->valueBufferBits;
+					
+					// step 2: decode distance
+					retval = decodeSymbol(self,self->tableDistance,self->bitsRootDistance);
+					if (retval != RET_FAPNG_OK) return retval;
+					i = self->valueBufferBits;
+					if (i >= 30) return RET_FAPNG_INVALID_DISTANCE_CODE;
+					retval = readBitsIDAT(self,extraDistance[i]);
+					if (retval != RET_FAPNG_OK) return retval;
+					distance = baseDistance[i] + self->valueBufferBits;
+					
+					// step 3: go back distance and copy length bytes to buffer front
+					// since it's a ring buffer, indices wrap around
+					indexCopy = (self->indexBufferInflate - distance) & (self->sizeWindow-1);
+					while (length > 0) {
+						self->bufferInflate[self->indexBufferInflate] = self->bufferInflate[indexCopy];
+						self->indexBufferInflate = (self->indexBufferInflate + 1) & (self->sizeWindow-1);
+						indexCopy = (indexCopy + 1) & (self->sizeWindow-1);
+						length--;
 					}
 				}
 				self->state = STATE_DEFL_END;
@@ -888,31 +993,27 @@ int8_t readScanline(PngData *self, uint16_t numBytes) {
 				// buffer holds LEN and NLEN (1s complement of LEN) in little endian order
 				// calculate values and compare 1s complement
 				// if lengths fit, head on to reading uncompressed bytes
-				self->sizeWindow = LITTLEENDIAN16(buffer32);
-				if (self->sizeWindow != (uint16_t)~LITTLEENDIAN16(&buffer32[2])) return RET_FAPNG_NOCOMP_LEN;
+				self->lenStored = LITTLEENDIAN16(buffer32);
+				if (self->lenStored != (uint16_t)~LITTLEENDIAN16(&buffer32[2])) return RET_FAPNG_NOCOMP_LEN;
 				self->state = STATE_DEFL_NO_COMPRESSION_READ;
 				break;
 			
 			case STATE_DEFL_NO_COMPRESSION_READ:
-				// read uncompressed bytes
-				if (self->sizeWindow >= numBytesToRead) {
-					// requested number of bytes fits into
-					// currently available number of uncompressed bytes 
-					retval = readBytesIDAT(self,&self->scanlineCurrent[numBytes - numBytesToRead],numBytesToRead);
-					if (retval != RET_FAPNG_OK) return retval;
-					self->sizeWindow -= numBytesToRead;
-					numBytesToRead = 0;
-					return RET_FAPNG_OK;
-				} else {
-					// read as many bytes as possible and terminate block
-					// it should follow another block with the remaining bytes
-					// see state STATE_DEFL_END --> STATE_DEFL_BEGIN
-					retval = readBytesIDAT(self,&self->scanlineCurrent[numBytes - numBytesToRead],self->sizeWindow);
-					if (retval != RET_FAPNG_OK) return retval;
-					numBytesToRead -= self->sizeWindow;
-					self->sizeWindow = 0;
+				// read uncompressed bytes through the INFLATE buffer (later blocks
+				// might refer to them); read up to the end of the ring buffer, but
+				// never fill it completely: a full ring would look empty
+				if (self->lenStored == 0) {
 					self->state = STATE_DEFL_END;
+					break;
 				}
+				numStored = self->sizeWindow - 1 - ((self->indexBufferInflate - self->indexReading) & (self->sizeWindow - 1));
+				if (numStored > self->sizeWindow - self->indexBufferInflate) numStored = self->sizeWindow - self->indexBufferInflate;
+				if (numStored > self->lenStored) numStored = self->lenStored;
+				if (numStored > numBytesToRead) numStored = numBytesToRead;
+				retval = readBytesIDAT(self,&self->bufferInflate[self->indexBufferInflate],numStored);
+				if (retval != RET_FAPNG_OK) return retval;
+				self->indexBufferInflate = (self->indexBufferInflate + numStored) & (self->sizeWindow-1);
+				self->lenStored -= numStored;
 				break;
 		}
 	}
@@ -934,13 +1035,20 @@ uint16_t PaethPredictor(uint16_t a, uint16_t b, uint16_t c) {
 	return c;
 }
 
-// central PNG reading function
-int8_t pngDataRead(PngData *self, char *filename, Surface *image) {
-	if (image == NULL) return RET_FAPNG_MALLOC_IMAGE;
-	
+// open a PNG file, parse its header and palette and prepare IDAT decoding
+int8_t pngDataOpen(PngData *self, char *filename) {
 	// local vars
 	int8_t   retval;
-	uint8_t  magicBytes[8] = {0};
+	uint8_t  magicBytes[13] = {0};
+	uint16_t k;
+	
+	// a reused PngData: close the previous file and restart the decoder
+	if (self->file >= 0) epic_file_close(self->file);
+	self->typeChunk = CHUNK_UNKNOWN;
+	self->lenChunk = 0;
+	self->state = STATE_BEGIN;
+	self->isLastBlock = false;
+	self->lenStored = 0;
 	
 	// open file
 	self->file = epic_file_open(filename,"rb");
@@ -959,90 +1067,100 @@ int8_t pngDataRead(PngData *self, char *filename, Surface *image) {
 	if (retval != RET_FAPNG_OK) return retval;
 	if (self->typeChunk != CHUNK_IHDR) return RET_FAPNG_HEADER;
 	
-	// parse header:
-	//  - first reading pass: 4 byte width, 4 byte height,
-	//  - second reading pass: 1 byte each for bit depth, colour type, compression method, filter method, interlace method
-	if (epic_file_read(self->file,magicBytes,8) != 8) return RET_FAPNG_READ;
-	self->lenChunk -= 8;
+	// parse header with one request:
+	//  - 4 byte width, 4 byte height,
+	//  - 1 byte each for bit depth, colour type, compression method, filter method, interlace method
+	if (epic_file_read(self->file,magicBytes,13) != 13) return RET_FAPNG_READ;
+	self->lenChunk -= 13;
 	uint32_t tmp = (uint32_t)BIGENDIAN32(&magicBytes[0]);
 	if (tmp == 0 || tmp > 255) return RET_FAPNG_DIMENSIONS;
-	image->width = (uint8_t)tmp;
+	self->width = (uint8_t)tmp;
 	tmp = (uint32_t)BIGENDIAN32(&magicBytes[4]);
 	if (tmp == 0 || tmp > 255) return RET_FAPNG_DIMENSIONS;
-	image->height = (uint8_t)tmp;
+	self->height = (uint8_t)tmp;
 	
-	if (epic_file_read(self->file,magicBytes,5) != 5) return RET_FAPNG_READ;
-	self->lenChunk -= 5;
+	// magicBytes[8]  = bit depth (1,2,4,8,16)
+	// magicBytes[9]  = colour type (0,2,3,4,6)
+	// magicBytes[10] = compression method, must be 0
+	// magicBytes[11] = filter method, must be 0
+	// magicBytes[12] = interlace method, either 0=none or 1=Adam7
+	if (magicBytes[10]) return RET_FAPNG_COMPRESSION_METHOD;
+	if (magicBytes[11]) return RET_FAPNG_FILTER_METHOD;
+	if (magicBytes[12] > 1) return RET_FAPNG_INTERLACE_METHOD;
+	self->bitDepth = magicBytes[8];
+	self->interlace = magicBytes[12];
+	self->colourType = magicBytes[9];
+	uint8_t bitDepth = self->bitDepth;
+	// colour types without alpha channel are opaque unless a tRNS chunk follows
+	self->opaque = (magicBytes[9] == COLOURTYPE__GREY || magicBytes[9] == COLOURTYPE__RGB || magicBytes[9] == COLOURTYPE__INDEXED);
 	
-	// magicBytes[0] = bit depth (1,2,4,8,16)
-	// magicBytes[1] = colour type (0,2,3,4,6)
-	// magicBytes[2] = compression method, must be 0
-	// magicBytes[3] = filter method, must be 0
-	// magicBytes[4] = interlace method, either 0=none or 1=Adam7
-	if (magicBytes[2]) return RET_FAPNG_COMPRESSION_METHOD;
-	if (magicBytes[3]) return RET_FAPNG_FILTER_METHOD;
-	if (magicBytes[4] > 1) return RET_FAPNG_INTERLACE_METHOD;
-	uint8_t bitDepth = magicBytes[0];
-	uint8_t pass = magicBytes[4];
-	uint8_t bytesPerPixel;
-	uint8_t samplesPerPixel;
-	uint16_t k;
-	
-	switch (magicBytes[1]) {
+	switch (magicBytes[9]) {
 		// process colour type + bit depth combinations
 		case COLOURTYPE__GREY:
-			samplesPerPixel = 1;
-			bytesPerPixel = 1;
+			self->samplesPerPixel = 1;
+			self->bytesPerPixel = 1;
 			switch (bitDepth) {
 				case 1:
 					self->funPixConv = convertPixelGrey1;
+					self->funRowConv = convertRowGrey1;
 					break;
 				case 2:
 					self->funPixConv = convertPixelGrey2;
+					self->funRowConv = convertRowGrey2;
 					break;
 				case 4:
 					self->funPixConv = convertPixelGrey4;
+					self->funRowConv = convertRowGrey4;
 					break;
 				case 8:
 					self->funPixConv = convertPixelGrey8;
+					self->funRowConv = convertRowGrey8;
 					break;
 				case 16:
 					self->funPixConv = convertPixelGrey16;
+					self->funRowConv = convertRowGrey16;
+					self->bytesPerPixel = 2;
 					break;
 				default:
 					return RET_FAPNG_BIT_DEPTH;
 			}
 			break;
 		case COLOURTYPE__RGB:
-			samplesPerPixel = 3;
+			self->samplesPerPixel = 3;
 			switch (bitDepth) {
 				case 8:
 					self->funPixConv = convertPixelRGB8;
-					bytesPerPixel = 3;
+					self->funRowConv = convertRowRGB8;
+					self->bytesPerPixel = 3;
 					break;
 				case 16:
 					self->funPixConv = convertPixelRGB16;
-					bytesPerPixel = 6;
+					self->funRowConv = convertRowRGB16;
+					self->bytesPerPixel = 6;
 					break;
 				default:
 					return RET_FAPNG_BIT_DEPTH;
 			}
 			break;
 		case COLOURTYPE__INDEXED:
-			samplesPerPixel = 1;
-			bytesPerPixel = 1;
+			self->samplesPerPixel = 1;
+			self->bytesPerPixel = 1;
 			switch (bitDepth) {
 				case 1:
 					self->funPixConv = convertPixelIndexed1;
+					self->funRowConv = convertRowIndexed1;
 					break;
 				case 2:
 					self->funPixConv = convertPixelIndexed2;
+					self->funRowConv = convertRowIndexed2;
 					break;
 				case 4:
 					self->funPixConv = convertPixelIndexed4;
+					self->funRowConv = convertRowIndexed4;
 					break;
 				case 8:
 					self->funPixConv = convertPixelIndexed8;
+					self->funRowConv = convertRowIndexed8;
 					break;
 				default:
 					return RET_FAPNG_BIT_DEPTH;
@@ -1052,7 +1170,10 @@ int8_t pngDataRead(PngData *self, char *filename, Surface *image) {
 			if (retval != RET_FAPNG_OK) return retval;
 			// note: seekChunk/readChunkHeader have already ensured correct PLTE length
 			self->sizePalette = (uint8_t)((self->lenChunk / 3) - 1); // min 1, max 256, fitting into one byte (0..255)
-			self->palette = (uint16_t*)malloc(sizeof(uint16_t) * self->sizePalette + 2); // +2: account for normalised size
+			memoryFree(self->palette);
+			memoryFree(self->paletteAlpha);
+			self->paletteAlpha = NULL;
+			self->palette = (uint16_t*)memoryAllocTransient(sizeof(uint16_t) * self->sizePalette + 2); // +2: account for normalised size
 			if (self->palette == NULL) return RET_FAPNG_MALLOC_PALETTE;
 			for (k=0; k <= self->sizePalette; k++) {
 				// read palette entries from chunk; the checks above ensure
@@ -1063,30 +1184,34 @@ int8_t pngDataRead(PngData *self, char *filename, Surface *image) {
 			}
 			break;
 		case COLOURTYPE__GREY_A:
-			samplesPerPixel = 2;
+			self->samplesPerPixel = 2;
 			switch (bitDepth) {
 				case 8:
 					self->funPixConv = convertPixelGreyA8;
-					bytesPerPixel = 2;
+					self->funRowConv = convertRowGreyA8;
+					self->bytesPerPixel = 2;
 					break;
 				case 16:
 					self->funPixConv = convertPixelGreyA16;
-					bytesPerPixel = 4;
+					self->funRowConv = convertRowGreyA16;
+					self->bytesPerPixel = 4;
 					break;
 				default:
 					return RET_FAPNG_BIT_DEPTH;
 			}
 			break;
 		case COLOURTYPE__RGB_A:
-			samplesPerPixel = 4;
+			self->samplesPerPixel = 4;
 			switch (bitDepth) {
 				case 8:
 					self->funPixConv = convertPixelRGBA8;
-					bytesPerPixel = 4;
+					self->funRowConv = convertRowRGBA8;
+					self->bytesPerPixel = 4;
 					break;
 				case 16:
 					self->funPixConv = convertPixelRGBA16;
-					bytesPerPixel = 8;
+					self->funRowConv = convertRowRGBA16;
+					self->bytesPerPixel = 8;
 					break;
 				default:
 					return RET_FAPNG_BIT_DEPTH;
@@ -1095,189 +1220,310 @@ int8_t pngDataRead(PngData *self, char *filename, Surface *image) {
 		default:
 			return RET_FAPNG_COLOUR_TYPE;
 	}
-	// memorise bit depth and calculate worst-case scanline buffer size
-	uint16_t sizeScanline = SCANLINEBYTES(image->width,samplesPerPixel,bitDepth);
+	// calculate worst-case scanline buffer size
+	self->sizeScanline = SCANLINEBYTES(self->width,self->samplesPerPixel,bitDepth);
 	
 	// look for first IDAT chunk
 	retval = seekChunk(self,CHUNK_IDAT);
 	if (retval != RET_FAPNG_OK) return retval;
 	
-	// no image data yet: allocate memory for the image, with 16-bit pixels and one 8-bit alpha channel
-	if (image->rgb565 != NULL) free(image->rgb565);
-	image->rgb565 = (uint16_t*)malloc((image->width * image->height) << 1);
-	if (image->rgb565 == NULL) return RET_FAPNG_MALLOC_IMAGE;
-	
-	if (image->alpha != NULL) free(image->alpha);
-	image->alpha = (uint8_t*)malloc(image->width * image->height);
-	if (image->alpha == NULL) return RET_FAPNG_MALLOC_IMAGE;
+	// allocate file buffer for IDAT reading (kept if already allocated)
+	if (self->bufferFile == NULL) {
+		self->bufferFile = (uint8_t*)memoryAllocTransient(PNG_SIZE_BUFFER_FILE);
+		if (self->bufferFile == NULL) return RET_FAPNG_MALLOC_BUFFER_FILE;
+		self->sizeBufferFile = PNG_SIZE_BUFFER_FILE;
+	}
+	self->indexBufferFile = 0;
+	self->numBufferFile = 0;
+	self->bitsRemaining = 0;
+	self->bufferBits = 0;
 	
 	// allocate scanline buffers (largest dimension, kind of memory pool)
 	// w*spp*bpp --> bits --> bytes + 1 filter type byte
-	if (self->scanlineCurrent != NULL) free(self->scanlineCurrent);
+	memoryFree(self->scanlineCurrent);
 	self->scanlineCurrent = NULL;
-	if (self->scanlinePrevious != NULL) free(self->scanlinePrevious);
+	memoryFree(self->scanlinePrevious);
 	self->scanlinePrevious = NULL;
 	
-	self->scanlineCurrent = (uint8_t*)malloc(sizeScanline);
+	self->scanlineCurrent = (uint8_t*)memoryAllocTransient(self->sizeScanline);
 	if (self->scanlineCurrent == NULL) return RET_FAPNG_MALLOC_SCANLINE;
 	
-	self->scanlinePrevious = (uint8_t*)malloc(sizeScanline);
+	self->scanlinePrevious = (uint8_t*)memoryAllocTransient(self->sizeScanline);
 	if (self->scanlinePrevious == NULL) {
-		free(self->scanlineCurrent);
+		memoryFree(self->scanlineCurrent);
 		self->scanlineCurrent = NULL;
 		return RET_FAPNG_MALLOC_SCANLINE;
 	}
+	for (k = 0; k < self->sizeScanline; k++) self->scanlinePrevious[k] = 0;
+	self->row = 0;
+	return RET_FAPNG_OK;
+}
+
+// internal helper function: Paeth predictor on bytes, p = a + b - c
+static inline uint8_t paethPredictByte(uint8_t a, uint8_t b, uint8_t c) {
+	int16_t pa = (int16_t)b - c;
+	int16_t pb = (int16_t)a - c;
+	int16_t pc = pa + pb;
+	if (pa < 0) pa = -pa;
+	if (pb < 0) pb = -pb;
+	if (pc < 0) pc = -pc;
+	if (pa <= pb && pa <= pc) return a;
+	if (pb <= pc) return b;
+	return c;
+}
+
+// internal helper function: undo the filter of a scanline (byte 0 = filter type);
+// the filter distance bpp is a compile-time constant in each specialisation, and
+// the first bpp bytes, which have no left neighbour, are handled separately
+static inline __attribute__((always_inline)) int8_t unfilterScanline(uint8_t *current, const uint8_t *previous, uint16_t size, const uint8_t bpp) {
+	uint16_t k;
+	const uint16_t sizeFirst = (bpp + 1 < size) ? bpp + 1 : size;
+	switch (current[0]) {
+		case FILTER_NONE:
+			break;
+		case FILTER_SUB:
+			for (k = sizeFirst; k < size; k++) current[k] += current[k - bpp];
+			break;
+		case FILTER_UP:
+			for (k = 1; k < size; k++) current[k] += previous[k];
+			break;
+		case FILTER_AVG:
+			for (k = 1; k < sizeFirst; k++) current[k] += previous[k] >> 1;
+			for (; k < size; k++) current[k] += (uint8_t)(((uint16_t)current[k - bpp] + previous[k]) >> 1);
+			break;
+		case FILTER_PAETH:
+			// without left neighbours, the predictor is the byte above
+			for (k = 1; k < sizeFirst; k++) current[k] += previous[k];
+			for (; k < size; k++) current[k] += paethPredictByte(current[k - bpp],previous[k],previous[k - bpp]);
+			break;
+		default:
+			return RET_FAPNG_FILTER_TYPE;
+	}
+	return RET_FAPNG_OK;
+}
+
+// decode and de-filter the next scanline of sizeScanlineCurrent bytes;
+// afterwards the scanline is in scanlinePrevious (buffers are swapped)
+int8_t decodeScanline(PngData *self, uint16_t sizeScanlineCurrent) {
+	uint8_t  *tmpPtr;
+	
+	// 1) request bytes needed for the current pass and fill scanlineCurrent
+	int8_t retval = readScanline(self,sizeScanlineCurrent);
+	if (retval != RET_FAPNG_OK) return retval;
+	
+	// 2) apply filter type (byte0) to all bytes in scanlineCurrent,
+	// with a loop specialised for the filter distance
+	switch (self->bytesPerPixel) {
+		case 1:
+			retval = unfilterScanline(self->scanlineCurrent,self->scanlinePrevious,sizeScanlineCurrent,1);
+			break;
+		case 2:
+			retval = unfilterScanline(self->scanlineCurrent,self->scanlinePrevious,sizeScanlineCurrent,2);
+			break;
+		case 3:
+			retval = unfilterScanline(self->scanlineCurrent,self->scanlinePrevious,sizeScanlineCurrent,3);
+			break;
+		case 4:
+			retval = unfilterScanline(self->scanlineCurrent,self->scanlinePrevious,sizeScanlineCurrent,4);
+			break;
+		case 6:
+			retval = unfilterScanline(self->scanlineCurrent,self->scanlinePrevious,sizeScanlineCurrent,6);
+			break;
+		case 8:
+			retval = unfilterScanline(self->scanlineCurrent,self->scanlinePrevious,sizeScanlineCurrent,8);
+			break;
+		default:
+			retval = RET_FAPNG_BIT_DEPTH;
+	}
+	if (retval != RET_FAPNG_OK) return retval;
+	
+	// 3) swap scanline buffers
+	tmpPtr = self->scanlinePrevious;
+	self->scanlinePrevious = self->scanlineCurrent;
+	self->scanlineCurrent = tmpPtr;
+	return RET_FAPNG_OK;
+}
+
+// decode the next row of a non-interlaced image and convert it to pixels
+int8_t pngDataReadRow(PngData *self, uint16_t *rgb565, uint8_t *alpha) {
+	if (self->interlace) return RET_FAPNG_INTERLACED;
+	if (self->row >= self->height) return RET_FAPNG_ROWS;
+	int8_t retval = decodeScanline(self,self->sizeScanline);
+	if (retval != RET_FAPNG_OK) return retval;
+	self->row++;
+	
+	// convert the decoded row (in scanlinePrevious, after the filter type byte)
+	self->funRowConv(self,&self->scanlinePrevious[1],self->width,1,rgb565,alpha);
+	return RET_FAPNG_OK;
+}
+
+// streaming PNG reading function: hand every row to a callback
+int8_t pngDataReadRows(PngData *self, char *filename, PngRowCallback callback, void *context) {
+	if (callback == NULL) return RET_FAPNG_ARGS;
+	int8_t retval = pngDataOpen(self,filename);
+	if (retval != RET_FAPNG_OK) return retval;
+	if (self->interlace) return RET_FAPNG_INTERLACED;
+	
+	// one row of pixels, reused for every row
+	uint16_t *rgb565 = (uint16_t*)memoryAllocTransient(self->width * sizeof(uint16_t));
+	uint8_t  *alpha = (uint8_t*)memoryAllocTransient(self->width);
+	if (rgb565 == NULL || alpha == NULL) {
+		memoryFree(rgb565);
+		memoryFree(alpha);
+		return RET_FAPNG_MALLOC_IMAGE;
+	}
+	for (uint8_t y = 0; y < self->height; y++) {
+		retval = pngDataReadRow(self,rgb565,alpha);
+		if (retval != RET_FAPNG_OK) break;
+		if (!callback(context,y,self->width,rgb565,alpha)) {
+			retval = RET_FAPNG_ABORTED;
+			break;
+		}
+	}
+	memoryFree(rgb565);
+	memoryFree(alpha);
+	return retval;
+}
+
+// Adam7 pass geometry: first column, first row, column step, row step
+static const uint8_t adam7Pass[7][4] = { {0,0,8,8}, {4,0,8,8}, {0,4,4,8}, {2,0,4,4}, {0,2,2,4}, {1,0,2,2}, {0,1,1,2} };
+
+// internal helper function: number of pixels per row of an Adam7 pass (0..6)
+static inline uint8_t adam7PassWidth(uint8_t pass, uint8_t width) {
+	if (width <= adam7Pass[pass][0]) return 0;
+	return (uint8_t)((width - adam7Pass[pass][0] + adam7Pass[pass][2] - 1) / adam7Pass[pass][2]);
+}
+
+// central PNG reading function
+int8_t pngDataRead(PngData *self, char *filename, Surface *image) {
+	PROFILE_SCOPE(PROFILE_PNG_READ);
+	if (image == NULL) return RET_FAPNG_MALLOC_IMAGE;
+	
+	int8_t retval = pngDataOpen(self,filename);
+	if (retval != RET_FAPNG_OK) return retval;
+	
+	// allocate memory for the image, with 16-bit pixels and one 8-bit alpha channel;
+	// images without transparency yield opaque surfaces without alpha channel;
+	// a premultiplied image keeps its flag and is premultiplied after decoding
+	const bool premultiplied = (image->flags & SURFACE_FLAG_PREMULTIPLIED) != 0;
+	surfaceReleasePlanes(image);
+	image->width = self->width;
+	image->height = self->height;
+	image->stride = self->width;
+	image->rgb565 = (uint16_t*)memoryAlloc((image->width * image->height) << 1);
+	if (image->rgb565 == NULL) return RET_FAPNG_MALLOC_IMAGE;
+	
+	if (!self->opaque) {
+		image->alpha = (uint8_t*)memoryAlloc(image->width * image->height);
+		if (image->alpha == NULL) return RET_FAPNG_MALLOC_IMAGE;
+	}
 	
-	// deal with interlacing (stored in magicBytes[4])
-	// interlace method = 0: no interlacing, thus pass=0, startNewPass sets current dimensions to image dimensions
-	// interlace method = 1: ADAM7 interlacing, thus pass=1, startNewPass sets current dimensions to first pass dimensions
-	// current dimensions (of subimage, if interlaced) determine processed scanline width
-	uint8_t x = 0;
-	uint8_t x0 = 0;
 	uint8_t y = 0;
+	if (self->interlace == 0) {
+		// no interlacing: decode row by row directly into the image
+		for (y = 0; y < image->height; y++) {
+			retval = pngDataReadRow(self,&image->rgb565[y * image->width],(image->alpha != NULL) ? &image->alpha[y * image->width] : NULL);
+			if (retval != RET_FAPNG_OK) return retval;
+		}
+		if (premultiplied) surfacePremultiply(image);
+		return RET_FAPNG_OK;
+	}
+	
+	// ADAM7 interlacing: seven passes with their own dimensions;
+	// current dimensions (of subimage) determine processed scanline width
+	uint8_t pass;
+	uint8_t x0 = 0;
 	uint8_t dx = 1;
 	uint8_t dy = 1;
 	uint8_t widthCurrent = image->width;
-	uint16_t pixX,pixA,pixB,pixC;
+	uint16_t k;
 	uint16_t sizeScanlineCurrent;
 	uint16_t indexImage;
-	uint8_t *tmpPtr;
-	RGBA5658 colour;
 	
-	do {
+	for (pass = 0; pass < 7; pass++) {
 		// for every pass...
 		// calculate new dimensions, clear scanlinePrevious
-		switch (pass) {
-			case 0:
-				x0 = 0;
-				y  = 0;
-				dx = 1;
-				dy = 1;
-				widthCurrent = image->width;
-				break;
-			case 1:
-				x0 = 0;
-				y  = 0;
-				dx = 8;
-				dy = 8;
-				widthCurrent = ((image->width - 1) >> 3) + 1;
-				break;
-			case 2:
-				x0 = 4;
-				y  = 0;
-				dx = 8;
-				dy = 8;
-				widthCurrent = ((image->width - 5) >> 3) + 1;
-				break;
-			case 3:
-				x0 = 0;
-				y  = 4;
-				dx = 4;
-				dy = 8;
-				widthCurrent = ((image->width - 1) >> 2) + 1;
-				break;
-			case 4:
-				x0 = 2;
-				y  = 0;
-				dx = 4;
-				dy = 4;
-				widthCurrent = ((image->width - 3) >> 2) + 1;
-				break;
-			case 5:
-				x0 = 0;
-				y  = 2;
-				dx = 2;
-				dy = 4;
-				widthCurrent = ((image->width - 1) >> 1) + 1;
-				break;
-			case 6:
-				x0 = 1;
-				y  = 0;
-				dx = 2;
-				dy = 2;
-				widthCurrent = ((image->width - 2) >> 1) + 1;
-				break;
-			case 7:
-				x0 = 0;
-				y  = 1;
-				dx = 1;
-				dy = 2;
-				widthCurrent = image->width;
-				break;
-		}
-// 		widthCurrent = (image->width - 1 - x0) / dx +1;
+		widthCurrent = adam7PassWidth(pass,image->width);
+		if (widthCurrent == 0) continue; // empty passes have no scanlines
+		x0 = adam7Pass[pass][0];
+		y  = adam7Pass[pass][1];
+		dx = adam7Pass[pass][2];
+		dy = adam7Pass[pass][3];
 		
 		// calculate scanline buffer length for given dimensions and clear previous scanline
-		sizeScanlineCurrent = SCANLINEBYTES(widthCurrent,samplesPerPixel,bitDepth);
-		for (k = 0; k < sizeScanlineCurrent; k++) self->scanlinePrevious[x] = 0;
+		sizeScanlineCurrent = SCANLINEBYTES(widthCurrent,self->samplesPerPixel,self->bitDepth);
+		for (k = 0; k < sizeScanlineCurrent; k++) self->scanlinePrevious[k] = 0;
 		
 		// (y was already initialised)
 		for (; y < image->height; y += dy) {
-			// for every image row in the current subimage...
-			// 1) request bytes needed for the current pass and fill scanlineCurrent
-			retval = readScanline(self,sizeScanlineCurrent);
+			// for every image row in the current subimage: decode and de-filter
+			retval = decodeScanline(self,sizeScanlineCurrent);
 			if (retval != RET_FAPNG_OK) return retval;
 			
-			// 2) apply filter type (byte0) to all bytes in scanlineCurrent
-			switch (self->scanlineCurrent[0]) {
-				case FILTER_SUB:
-					for (k = 1; k < sizeScanlineCurrent; k++) {
-						pixX = (uint16_t)self->scanlineCurrent[k];
-						pixA = (k - bytesPerPixel > 0)? (uint16_t)self->scanlineCurrent[k - bytesPerPixel] : 0;
-						self->scanlineCurrent[k] = (uint8_t)(pixX + pixA);
-					}
-					break;
-				case FILTER_UP:
-					for (k = 1; k < sizeScanlineCurrent; k++) {
-						pixX = (uint16_t)self->scanlineCurrent[k];
-						pixB = (uint16_t)self->scanlinePrevious[k];
-						self->scanlineCurrent[k] = (uint8_t)((pixX + pixB) & 0xff);
-					}
-					break;
-				case FILTER_AVG:
-					for (k = 1; k < sizeScanlineCurrent; k++){
-						pixX = (uint16_t)self->scanlineCurrent[k];
-						pixA = (k - bytesPerPixel > 0)? (uint16_t)self->scanlineCurrent[k - bytesPerPixel] : 0;
-						pixB = (uint16_t)self->scanlinePrevious[k];
-						self->scanlineCurrent[k] = (uint8_t)((pixX + ((pixA+pixB)>>1)) & 0xff);
-					}
-					break;
-				case FILTER_PAETH:
-					for (k = 1; k < sizeScanlineCurrent; k++) {
-						pixX = (uint16_t)self->scanlineCurrent[k];
-						if (k - bytesPerPixel > 0) {
-							pixA = (uint16_t)self->scanlineCurrent[k - bytesPerPixel];
-							pixC = (uint16_t)self->scanlinePrevious[k - bytesPerPixel];
-						} else {
-							pixA = 0;
-							pixC = 0;
-						}
-						pixB = (uint16_t)self->scanlinePrevious[k];
-						self->scanlineCurrent[k] = (uint8_t)((pixX + PaethPredictor(pixA,pixB,pixC)) & 0xff);
-					}
-					break;
-				case FILTER_NONE:
-					break;
-				default:
-					return RET_FAPNG_FILTER_TYPE;
-			}
-			
-			// 3) convert scanline bytes to pixels
+			// convert scanline bytes to every dx-th pixel (decoded row is in scanlinePrevious)
 			indexImage = y * image->width + x0;
-			for (x = 0; x < widthCurrent; x++) {
-				colour = self->funPixConv(self,x);
-				image->rgb565[indexImage] = colour.rgb565;
-				image->alpha[indexImage] = colour.alpha; 
-				indexImage += dx;
-			}
-			// 4) swap scanline buffers
-			tmpPtr = self->scanlinePrevious;
-			self->scanlinePrevious = self->scanlineCurrent;
-			self->scanlineCurrent = tmpPtr;
+			self->funRowConv(self,&self->scanlinePrevious[1],widthCurrent,dx,&image->rgb565[indexImage],(image->alpha != NULL) ? &image->alpha[indexImage] : NULL);
 		}
-		pass = (pass > 0) ? pass + 1 : 8;
-	} while (pass < 8);
+	}
 	
+	if (premultiplied) surfacePremultiply(image);
+	return RET_FAPNG_OK;
+}
+
+// indexed PNG reading function: keep the packed indices of each scanline
+int8_t pngDataReadIndexed(PngData *self, char *filename, SurfaceIndexed **image) {
+	PROFILE_SCOPE(PROFILE_PNG_READ);
+	if (image == NULL) return RET_FAPNG_ARGS;
+	*image = NULL;
+	int8_t retval = pngDataOpen(self,filename);
+	if (retval != RET_FAPNG_OK) return retval;
+	if (self->colourType != COLOURTYPE__INDEXED) return RET_FAPNG_NOT_INDEXED;
+	
+	// persistent copy of the palette; the surface holds the only reference
+	Palette *palette = paletteConstruct((uint16_t)self->sizePalette + 1,self->paletteAlpha != NULL);
+	if (palette == NULL) return RET_FAPNG_MALLOC_PALETTE;
+	for (uint16_t k = 0; k <= self->sizePalette; k++)
+		paletteSetEntry(palette,k,self->palette[k],(self->paletteAlpha != NULL) ? self->paletteAlpha[k] : 0xff);
+	SurfaceIndexed *indexed = surfaceIndexedConstruct(self->width,self->height,self->bitDepth,palette);
+	paletteDestruct(&palette);
+	if (indexed == NULL) return RET_FAPNG_MALLOC_IMAGE;
+	
+	uint8_t y;
+	if (self->interlace == 0) {
+		// no interlacing: de-filtered scanlines already have the surface layout
+		for (y = 0; y < indexed->height; y++) {
+			retval = decodeScanline(self,self->sizeScanline);
+			if (retval != RET_FAPNG_OK) break;
+			memcpy(&indexed->index[y * indexed->stride],&self->scanlinePrevious[1],indexed->stride);
+		}
+	} else {
+		// ADAM7 interlacing: scatter the indices of each pass
+		uint8_t x,xImage,widthCurrent;
+		uint16_t k,sizeScanlineCurrent;
+		SurfaceIndexed scanline = { 0, 1, 0, indexed->depth, NULL, NULL };
+		for (uint8_t pass = 0; pass < 7 && retval == RET_FAPNG_OK; pass++) {
+			widthCurrent = adam7PassWidth(pass,indexed->width);
+			if (widthCurrent == 0) continue; // empty passes have no scanlines
+			sizeScanlineCurrent = SCANLINEBYTES(widthCurrent,1,self->bitDepth);
+			for (k = 0; k < sizeScanlineCurrent; k++) self->scanlinePrevious[k] = 0;
+			for (y = adam7Pass[pass][1]; y < indexed->height; y += adam7Pass[pass][3]) {
+				retval = decodeScanline(self,sizeScanlineCurrent);
+				if (retval != RET_FAPNG_OK) break;
+				// view the decoded scanline as a one-row indexed surface
+				scanline.index = &self->scanlinePrevious[1];
+				xImage = adam7Pass[pass][0];
+				for (x = 0; x < widthCurrent; x++) {
+					surfaceIndexedSetIndex(indexed,xImage,y,surfaceIndexedGetIndex(&scanline,x,0));
+					xImage += adam7Pass[pass][2];
+				}
+			}
+		}
+	}
+	if (retval != RET_FAPNG_OK) {
+		surfaceIndexedDestruct(&indexed);
+		return retval;
+	}
+	*image = indexed;
 	return RET_FAPNG_OK;
 }
 
@@ -1302,3 +1548,143 @@ Surface *pngDataLoad(char *filename) {
 	}
 }
 
+SurfaceIndexed *pngDataLoadIndexed(char *filename) {
+	SurfaceIndexed *image = NULL;
+	PngData *data = pngDataConstruct();
+	if (data == NULL) return NULL;
+	
+	pngDataReadIndexed(data,filename,&image);
+	pngDataDestruct(&data);
+	return image;
+}
+
+//------------------------------------------------------------------------------
+// decoded surface cache
+//------------------------------------------------------------------------------
+
+// store a 32 bit integer in little endian order
+static inline void storeLittleEndian32(uint8_t *buffer, uint32_t value) {
+	buffer[0] = value & 0xff;
+	buffer[1] = (value >> 8) & 0xff;
+	buffer[2] = (value >> 16) & 0xff;
+	buffer[3] = value >> 24;
+}
+
+// derive the cache key of a PNG file: size, IHDR CRC and CRC of the chunk before IEND
+int8_t pngCacheKey(char *filename, PngCacheKey *key) {
+	struct epic_stat stat;
+	uint8_t buffer[33];
+	if (epic_file_stat(filename,&stat) != 0 || stat.size < 57) return RET_FAPNG_OPEN;
+	key->size = stat.size;
+	
+	int file = epic_file_open(filename,"rb");
+	if (file < 0) return RET_FAPNG_OPEN;
+	// magic bytes (8) + IHDR chunk (4+4+13+4): CRC at offset 29
+	int8_t retval = RET_FAPNG_OK;
+	if (epic_file_read(file,buffer,33) != 33) {
+		retval = RET_FAPNG_READ;
+	} else {
+		key->crcHeader = (uint32_t)BIGENDIAN32(&buffer[29]);
+		// IEND chunk (12 bytes) terminates the file; the four bytes before it
+		// hold the CRC of the last data chunk, which covers the end of the image data
+		if (epic_file_seek(file,stat.size - 16,SEEK_SET) != 0) {
+			retval = RET_FAPNG_SEEK;
+		} else if (epic_file_read(file,buffer,4) != 4) {
+			retval = RET_FAPNG_READ;
+		} else {
+			key->crcData = (uint32_t)BIGENDIAN32(buffer);
+		}
+	}
+	epic_file_close(file);
+	return retval;
+}
+
+// read a cache file, if it matches the given key
+int8_t pngCacheRead(char *filenameCache, PngCacheKey *key, Surface *image) {
+	if (image == NULL) return RET_FAPNG_MALLOC_IMAGE;
+	uint8_t header[PNG_CACHE_SIZE_HEADER];
+	int file = epic_file_open(filenameCache,"rb");
+	if (file < 0) return RET_FAPNG_OPEN;
+	
+	int8_t retval = RET_FAPNG_CACHE;
+	uint16_t numPixels;
+	if (epic_file_read(file,header,PNG_CACHE_SIZE_HEADER) == PNG_CACHE_SIZE_HEADER && \
+		header[0] == 'f' && header[1] == 'a' && header[2] == 'P' && header[3] == PNG_CACHE_VERSION && \
+		header[4] != 0 && header[5] != 0 && \
+		(uint32_t)LITTLEENDIAN32(&header[8])  == key->size && \
+		(uint32_t)LITTLEENDIAN32(&header[12]) == key->crcHeader && \
+		(uint32_t)LITTLEENDIAN32(&header[16]) == key->crcData) {
+		// key matches: read both planes with one request each
+		numPixels = header[4] * header[5];
+		surfaceReleasePlanes(image);
+		image->width = header[4];
+		image->height = header[5];
+		image->stride = header[4];
+		image->rgb565 = (uint16_t*)memoryAlloc(numPixels << 1);
+		image->alpha = (header[6] & PNG_CACHE_FLAG_OPAQUE) ? NULL : (uint8_t*)memoryAlloc(numPixels);
+		if (image->rgb565 == NULL || (image->alpha == NULL && !(header[6] & PNG_CACHE_FLAG_OPAQUE))) {
+			retval = RET_FAPNG_MALLOC_IMAGE;
+		} else if (epic_file_read(file,image->rgb565,numPixels << 1) == (numPixels << 1) && \
+			(image->alpha == NULL || epic_file_read(file,image->alpha,numPixels) == numPixels)) {
+			retval = RET_FAPNG_OK;
+		}
+	}
+	epic_file_close(file);
+	return retval;
+}
+
+// write a cache file for the given key and image
+int8_t pngCacheWrite(char *filenameCache, PngCacheKey *key, Surface *image) {
+	if (image == NULL || image->rgb565 == NULL) return RET_FAPNG_MALLOC_IMAGE;
+	uint8_t header[PNG_CACHE_SIZE_HEADER] = {'f','a','P',PNG_CACHE_VERSION,image->width,image->height,(image->alpha == NULL) ? PNG_CACHE_FLAG_OPAQUE : 0,0};
+	storeLittleEndian32(&header[8],key->size);
+	storeLittleEndian32(&header[12],key->crcHeader);
+	storeLittleEndian32(&header[16],key->crcData);
+	
+	int file = epic_file_open(filenameCache,"wb");
+	if (file < 0) return RET_FAPNG_OPEN;
+	// note: planes are stored in native byte order
+	uint16_t numPixels = image->width * image->height;
+	int8_t retval = RET_FAPNG_OK;
+	if (epic_file_write(file,header,PNG_CACHE_SIZE_HEADER) != PNG_CACHE_SIZE_HEADER) {
+		retval = RET_FAPNG_WRITE;
+	} else if (image->stride == image->width) {
+		if (epic_file_write(file,image->rgb565,numPixels << 1) != (numPixels << 1) || \
+			(image->alpha != NULL && epic_file_write(file,image->alpha,numPixels) != numPixels)) retval = RET_FAPNG_WRITE;
+	} else {
+		// view: write plane rows one by one
+		uint8_t y;
+		for (y = 0; y < image->height && retval == RET_FAPNG_OK; y++)
+			if (epic_file_write(file,&image->rgb565[y * image->stride],image->width << 1) != (image->width << 1)) retval = RET_FAPNG_WRITE;
+		for (y = 0; y < image->height && retval == RET_FAPNG_OK && image->alpha != NULL; y++)
+			if (epic_file_write(file,&image->alpha[y * image->stride],image->width) != image->width) retval = RET_FAPNG_WRITE;
+	}
+	epic_file_close(file);
+	return retval;
+}
+
+Surface *pngDataLoadCached(char *filename) {
+	// cache file name: filename + PNG_CACHE_SUFFIX
+	size_t lenFilename = strlen(filename);
+	char *filenameCache = (char*)memoryAllocTransient(lenFilename + sizeof(PNG_CACHE_SUFFIX));
+	if (filenameCache == NULL) return pngDataLoad(filename);
+	memcpy(filenameCache,filename,lenFilename);
+	memcpy(&filenameCache[lenFilename],PNG_CACHE_SUFFIX,sizeof(PNG_CACHE_SUFFIX));
+	
+	PngCacheKey key;
+	Surface *image = NULL;
+	if (pngCacheKey(filename,&key) == RET_FAPNG_OK) {
+		// try the cache first
+		image = surfaceConstruct();
+		if (image != NULL && pngCacheRead(filenameCache,&key,image) != RET_FAPNG_OK) surfaceDestruct(&image);
+		// cache missing or stale: decode and (re-)write the cache; a failed write is not an error
+		if (image == NULL) {
+			image = pngDataLoad(filename);
+			if (image != NULL) pngCacheWrite(filenameCache,&key,image);
+		}
+	} else {
+		image = pngDataLoad(filename);
+	}
+	memoryFree(filenameCache);
+	return image;
+}
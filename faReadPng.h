@@ -3,7 +3,7 @@
 /**
  * @file
  * @author Frank Abelbeck <frank.abelbeck@googlemail.com>
- * @version 2020-02-06
+ * @version 2026-10-14
  * 
  * @section License
  * 
@@ -65,18 +65,45 @@
 #define RET_FAPNG_INVALID_CODE_LEN_CODE -25 ///< invalid code length code 16 (at beginning, no code to copy)
 #define RET_FAPNG_INVALID_LENGTH_CODE   -26 ///< invalid length code (not in range 0..285)
 #define RET_FAPNG_INVALID_DISTANCE_CODE -27 ///< invalid distance code (not in range 0..29)
-#define RET_FAPNG_LENGTHS_OVERFLOW      -28 ///< too many lengths while decoding dynamic Huffman alphabet
+#define RET_FAPNG_LENGTHS_OVERFLOW      -28 ///< too many lengths while decoding dynamic Huffman alphabet, or too many lit/len or distance codes
 #define RET_FAPNG_CODE_NOT_FOUND        -29 ///< no code matches bit pattern at current file position
 
+#define RET_FAPNG_MALLOC_BUFFER_FILE    -30 ///< allocation of IDAT file buffer failed
+#define RET_FAPNG_HUFFMAN_TABLE         -31 ///< invalid Huffman code lengths (over-subscribed) or table overflow
+
+#define RET_FAPNG_CACHE                 -32 ///< cache file invalid or stale
+#define RET_FAPNG_WRITE                 -33 ///< writing the cache file failed
+
+#define RET_FAPNG_INTERLACED            -34 ///< row streaming requested for an interlaced image
+#define RET_FAPNG_ROWS                  -35 ///< all rows of the image have already been read
+#define RET_FAPNG_ARGS                  -36 ///< invalid arguments passed
+#define RET_FAPNG_ABORTED               -37 ///< row callback requested to stop decoding
+#define RET_FAPNG_NOT_INDEXED           -38 ///< indexed reading requested for an image of another colour type
+
 //------------------------------------------------------------------------------
 // various constants
 //------------------------------------------------------------------------------
 
+#ifndef PNG_SIZE_BUFFER_FILE
+#define PNG_SIZE_BUFFER_FILE 1024 ///< size of the IDAT file buffer in bytes (one file read per buffer fill); range 1..65535
+#endif
+
+#define PNG_SIZE_TABLE_LENGTH   852 ///< lit/len Huffman table entries: 9 root bits, 286 symbols, max. 15 bits (zlib's ENOUGH bound)
+#define PNG_SIZE_TABLE_DISTANCE 592 ///< distance Huffman table entries: 6 root bits, 30 symbols, max. 15 bits (zlib's ENOUGH bound)
+
+#ifndef PNG_CACHE_SUFFIX
+#define PNG_CACHE_SUFFIX ".cache" ///< suffix appended to a PNG filename to get its cache filename
+#endif
+#define PNG_CACHE_VERSION     2  ///< version byte of the cache file format
+#define PNG_CACHE_SIZE_HEADER 20 ///< size of the cache file header in bytes
+#define PNG_CACHE_FLAG_OPAQUE 0x01 ///< cache file flag: opaque surface, no alpha plane stored
+
 #define CHUNK_UNKNOWN 0 ///< unknown PNG chunk type
 #define CHUNK_IHDR    1 ///< PNG header chunk type
 #define CHUNK_PLTE    2 ///< PNG palette chunk type
 #define CHUNK_IDAT    3 ///< PNG image data chunk type
 #define CHUNK_IEND    4 ///< PNG end chunk type
+#define CHUNK_TRNS    5 ///< PNG transparency chunk type
 
 #define COLOURTYPE__GREY    0 ///< PNG colourtype greyscale
 #define COLOURTYPE__RGB     2 ///< PNG colourtype RGB
@@ -125,6 +152,14 @@
  */
 #define BIGENDIAN16(x)            ( (x)[0] << 8  | (x)[1] )
 
+/** Convert integer array x to a 32 bit integer assuming little endianness.
+ * 
+ * @param x An array of at least four bytes (uint8_t); behaviour undefined for
+ * smaller arrays; fifth byte and following will be ignored.
+ * @returns An integer (uint32_t).
+ */
+#define LITTLEENDIAN32(x)         ( (x)[0] | (x)[1] << 8 | (x)[2] << 16 | (uint32_t)(x)[3] << 24 )
+
 /** Convert integer array x to an integer assuming little endianness.
  * 
  * @param x An array of at least two bytes (uint8_t); behaviour undefined for
@@ -165,42 +200,71 @@
  */
 #define ABS(x)                    ( ((x) < 0) ? -(x) : (x) )
 
-/** Pack information into a code alphabet entry.
+/** Pack a leaf into a Huffman lookup table entry.
  *
- * Internal code alphabet entry decoding: each uint32_t code entry consists of...
+ * Internal Huffman table entry layout: each uint16_t entry is either...
+ * 
+ *     leaf:    15 14 13 12 11 10 9 8 7 6 5 4 3 2 1 0
+ *               0 `----´ `-------´ `---------------´
+ *            unused     length      symbol value
+ *                       (4 bits)      (9 bits)
+ * 
+ *     link:    15 14 13 12 11 10 9 8 7 6 5 4 3 2 1 0
+ *               1 `---------´ `--------------------´
+ *                sub-table bits   sub-table offset
+ *                   (4 bits)         (11 bits)
  * 
- *     31 30 29 28 27 26 25 24 23 22 21 20 19 18 17 16 15 14 13 12 11 10 9 8 7 6 5 4 3 2 1 0
- *     `---------´ `---------´ `-----------------------------------------´ `---------------´
- *        unused     length         code bits in little endian order          symbol value
- *       (4 bits)   (4 bits)                   (15 bits)                        (9 bits)
+ * ...or zero (no code matches the bit pattern). The length of a leaf
+ * is the total code length, i.e. including the root bits.
  * 
- * @param len Number of code bits (clipped to 4 bits).
- * @param bits Code bits as little endian value (clipped to 15 bits).
- * @param symbol Corresponding symbol value (clipped to 9 bits).
- * @returns A uint32_t integer.
+ * @param len Number of code bits (1..15).
+ * @param symbol Corresponding symbol value (0..511).
+ * @returns A uint16_t integer.
  */
-#define PACKCODE(len,bits,symbol) ( (uint32_t) ( (((len) & 0x0f) << 24) | (((bits) & 0x7fff) << 9) | ((symbol) & 0x1ff) ) )
+#define HUFFMAN_LEAF(len,symbol)  ( (uint16_t) ( (((len) & 0x0f) << 9) | ((symbol) & 0x1ff) ) )
 
-/** Retrieve length information from a code alphabet entry.
+/** Pack a sub-table link into a Huffman lookup table entry.
  * 
- * @param x A code entry integer value (uint32_t).
- * @returns An integer in range 0..15.
+ * @param bits Number of index bits of the sub-table (1..15).
+ * @param offset Table index of the sub-table (0..2047).
+ * @returns A uint16_t integer.
  */
-#define EXTRACTLENGTH(x)          ( (uint8_t)  (((x) & 0x0f000000) >> 24) )
+#define HUFFMAN_LINK(bits,offset) ( (uint16_t) ( 0x8000 | (((bits) & 0x0f) << 11) | ((offset) & 0x07ff) ) )
 
-/** Retrieve code bits information from a code alphabet entry.
+/** Check if a Huffman lookup table entry is a sub-table link.
  * 
- * @param x A code entry integer value (uint32_t).
- * @returns An integer in range 0..32767.
+ * @param x A table entry (uint16_t).
+ * @returns Non-zero if x is a link.
  */
-#define EXTRACTBITS(x)            ( (uint16_t) (((x) & 0x00fffe00) >> 9)  )
+#define HUFFMAN_ISLINK(x)         ( (x) & 0x8000 )
 
-/** Retrieve symbol information from a code alphabet entry.
+/** Retrieve code length information from a Huffman table leaf.
  * 
- * @param x A code entry integer value (uint32_t).
+ * @param x A table entry (uint16_t).
+ * @returns An integer in range 0..15.
+ */
+#define HUFFMAN_LENGTH(x)         ( (uint8_t)  (((x) >> 9) & 0x0f) )
+
+/** Retrieve symbol information from a Huffman table leaf.
+ * 
+ * @param x A table entry (uint16_t).
  * @returns An integer in range 0..511.
  */
-#define EXTRACTSYMBOL(x)          ( (uint16_t) ( (x) & 0x000001ff)        )
+#define HUFFMAN_SYMBOL(x)         ( (uint16_t) ((x) & 0x01ff) )
+
+/** Retrieve the number of sub-table index bits from a Huffman table link.
+ * 
+ * @param x A table entry (uint16_t).
+ * @returns An integer in range 0..15.
+ */
+#define HUFFMAN_SUBBITS(x)        ( (uint8_t)  (((x) >> 11) & 0x0f) )
+
+/** Retrieve the sub-table offset from a Huffman table link.
+ * 
+ * @param x A table entry (uint16_t).
+ * @returns An integer in range 0..2047.
+ */
+#define HUFFMAN_OFFSET(x)         ( (uint16_t) ((x) & 0x07ff) )
 
 //------------------------------------------------------------------------------
 // PNG reader data structures ("self", image and pixel data)
@@ -208,14 +272,17 @@
 
 /** Data structure of processing state variables. */
 typedef struct PngData {
+	uint8_t   colourType; ///< Colour type of the current image, one of COLOURTYPE__*.
 	// palette data
 	uint8_t   sizePalette; ///< Number of palette entries minus 1.
 	uint16_t  *palette; ///< Palette data (address of a RGB565 colour array). 
+	uint8_t   *paletteAlpha; ///< Palette alpha values from a tRNS chunk (address of a byte array; NULL if there is none).
 	// scanline data: size and bytes, double-buffered (previous and current, needed for de-filtering)
 	uint8_t   *scanlineCurrent; ///< Current scanline data (address of a byte array).
 	uint8_t   *scanlinePrevious; ///< Previous scanline data (address of a byte array).
 	uint8_t   samplesPerPixel; ///< Number of samples per pixel.
 	RGBA5658  (*funPixConv)(struct PngData*,uint8_t); ///< Address of a pixel conversion function.
+	void      (*funRowConv)(struct PngData*,const uint8_t*,uint8_t,uint8_t,uint16_t*,uint8_t*); ///< Address of a row conversion function: (self, scanline without filter byte, number of pixels, pixel step, rgb565 plane, alpha plane or NULL).
 	// chunk and file management
 // 	FILE      *file; ///< Address of a file stream.
 	int       file; ///< Address of a file stream.
@@ -224,20 +291,55 @@ typedef struct PngData {
 	// zlib management
 	uint8_t   state; ///< Number of current zlib/DEFLATE decoding state
 	bool      isLastBlock; ///< Boolean indicating if the currently processed block is the last.
-	uint32_t  *codesHuffmanLength; ///< Huffman length code alphabet (address of an array of uint32_t).
-	uint32_t  *codesHuffmanDistance; ///< Huffman distance code alphabet (address of an array of uint32_t).
-	uint16_t  sizeCodesHuffmanLength; ///< Number of entries in Huffman length code alphabet.
-	uint16_t  sizeCodesHuffmanDistance; ///< Number of entries in Huffman distance code alphabet.
+	uint16_t  *tableHuffman; ///< Memory of the dynamic Huffman tables: PNG_SIZE_TABLE_LENGTH lit/len entries, followed by PNG_SIZE_TABLE_DISTANCE distance entries.
+	const uint16_t *tableLength; ///< Current lit/len Huffman lookup table (dynamic or static).
+	const uint16_t *tableDistance; ///< Current distance Huffman lookup table (dynamic or static).
+	uint8_t   bitsRootLength; ///< Number of root index bits of tableLength.
+	uint8_t   bitsRootDistance; ///< Number of root index bits of tableDistance.
 	uint8_t   bitsRemaining; ///< Number of unprocessed bits left in bit buffer.
-	uint8_t   bufferBits; ///< Recently read byte that serves a bit buffer.
+	uint32_t  bufferBits; ///< Bit accumulator; holds bitsRemaining unprocessed bits, LSB first.
 	uint32_t  valueBufferBits; ///< Integer value of the bits read the last time readBitsIDAT() was called.
 	uint32_t  indexBufferInflate; ///< Index of next free byte in INFLATE buffer.
 	uint32_t  indexReading; ///< Index of next byte yet-to-read in INFLATE buffer.
 	uint16_t  sizeWindow; ///< Number of bytes in INFLATE buffer.
 	uint8_t   *bufferInflate; ///< INFLATE buffer (address of an array of bytes).
-	bool      doDecoding; ///< Boolean indicating that zlib/DEFLATE decoding should continue.
+	uint16_t  lenStored; ///< Number of bytes left in the current uncompressed DEFLATE block.
+	// image properties and decoding progress
+	uint8_t   width; ///< Image width in pixels.
+	uint8_t   height; ///< Image height in pixels.
+	uint8_t   bitDepth; ///< Number of bits per sample.
+	uint8_t   bytesPerPixel; ///< Number of bytes per pixel, rounded up to 1 (filter distance).
+	uint8_t   interlace; ///< Interlace method, 0 (none) or 1 (Adam7).
+	bool      opaque; ///< True if the image carries no transparency (neither alpha channel nor tRNS chunk).
+	uint16_t  sizeScanline; ///< Size of a full-width scanline in bytes, including the filter type byte.
+	uint8_t   row; ///< Number of rows already read via pngDataReadRow().
+	// IDAT file buffer
+	uint8_t   *bufferFile; ///< IDAT file buffer (address of an array of bytes).
+	uint16_t  sizeBufferFile; ///< Size of the IDAT file buffer in bytes.
+	uint16_t  indexBufferFile; ///< Index of next unprocessed byte in IDAT file buffer.
+	uint16_t  numBufferFile; ///< Number of valid bytes in IDAT file buffer.
 } PngData;
 
+/** Row callback of pngDataReadRows().
+ * 
+ * Planes are only valid during the call; copy what has to be kept.
+ * 
+ * @param context Address passed to pngDataReadRows().
+ * @param y Row number.
+ * @param width Number of pixels in the row.
+ * @param rgb565 Address of the row's RGB565 pixels.
+ * @param alpha Address of the row's alpha values.
+ * @returns true to continue decoding, false to stop.
+ */
+typedef bool (*PngRowCallback)(void *context, uint8_t y, uint8_t width, const uint16_t *rgb565, const uint8_t *alpha);
+
+/** Key of a decoded surface cache file; identifies the source PNG file. */
+typedef struct {
+	uint32_t  size; ///< Size of the PNG file in bytes.
+	uint32_t  crcHeader; ///< CRC of the IHDR chunk.
+	uint32_t  crcData; ///< CRC of the last chunk before IEND (usually the last IDAT chunk).
+} PngCacheKey;
+
 //------------------------------------------------------------------------------
 // function prototypes
 //------------------------------------------------------------------------------
@@ -245,6 +347,9 @@ typedef struct PngData {
 /** Constructor: create and initialise a PngData structure.
  * 
  * This initialises all pointers to NULL, sets sizes to zero and resets states.
+ * The structure and all decoder buffers are transient blocks (cf. faMemory.h);
+ * if an arena is installed, destruct the structure once an image is read so
+ * that the arena can reclaim them.
  * 
  * @returns An initialised PngData structure.
  */
@@ -252,7 +357,7 @@ PngData* pngDataConstruct();
 
 /** Destructor: free any allocated memory of a PngData structure.
  * 
- * This calls free on all pointers (and fclose on file) and on the pngData structure itself.
+ * This calls memoryFree() on all pointers (and fclose on file) and on the pngData structure itself.
  * 
  * @param self A PngData structure.
  */
@@ -377,6 +482,20 @@ RGBA5658 convertPixelRGBA8(PngData *self, uint8_t x);
  * @returns An RGBA5658 pixel information structure.
  */
 RGBA5658 convertPixelRGBA16(PngData *self, uint8_t x);
+/** Decode a chunk header from eight bytes (length and type).
+ * 
+ * This function sets self->lenChunk and self->typeChunk and does the same
+ * sanity checking as readChunkHeader().
+ * 
+ * @param self Address of a PngData structure.
+ * @param buffer32 Address of an array of at least eight bytes.
+ * @returns A signed byte (int8_t) with one of the following return codes:
+ *     - RET_FAPNG_OK: header successfully decoded.
+ *     - RET_FAPNG_HEADER: invalid IHDR length.
+ *     - RET_FAPNG_PALETTE: invalid PLTE length.
+ */
+int8_t parseChunkHeader(PngData *self, uint8_t *buffer32);
+
 /** Read the chunk header at current file position.
  * 
  * This function sets self->lenChunk and self->typeChunk and does some
@@ -406,15 +525,46 @@ int8_t readChunkHeader(PngData *self);
  */
 int8_t seekChunk(PngData *self, uint8_t typeChunkRequested);
 
+/** Read the contents of a tRNS chunk, called by seekChunk().
+ * 
+ * For indexed images, the alpha values of the palette entries are stored in
+ * paletteAlpha; entries beyond the chunk stay opaque. tRNS chunks of other
+ * colour types are left unread (and skipped by seekChunk()).
+ * 
+ * @param self Address of a PngData structure; the current chunk is a tRNS chunk.
+ * @returns A signed byte (int8_t) with one of the following return codes:
+ *     - RET_FAPNG_OK: chunk successfully read or not needed.
+ *     - RET_FAPNG_MALLOC_PALETTE: failed to allocate palette alpha memory.
+ *     - RET_FAPNG_READ: reading from file failed.
+ */
+int8_t readChunkTRNS(PngData *self);
+
+/** Refill the IDAT file buffer from the current IDAT chunk.
+ * If chunk is exhausted, this function skips to next IDAT chunk; the CRC of
+ * the exhausted chunk and the next chunk header are read with one request.
+ * 
+ * At most self->sizeBufferFile bytes are read, but never beyond the end of
+ * the current chunk.
+ * 
+ * @param self Address of a PngData structure.
+ * @returns A signed byte (int8_t) with one of the following return codes:
+ *     - RET_FAPNG_OK: buffer successfully refilled.
+ *     - RET_FAPNG_READ: reading the file failed.
+ *     - any error reported by parseChunkHeader().
+ *     - any error reported by seekChunk().
+ */
+int8_t refillBufferIDAT(PngData *self);
+
 /** Skip remaining bits in order to continue at a byte boundary.
- * If chunk is exhausted, this function skips to next IDAT chunk.
+ * Whole bytes in the bit accumulator are kept.
  * 
  * @param self Address of a PngData structure.
  */
 void skipRemainingBits(PngData *self);
 
 /** Read numBytes bytes from the current chunk into the given byte buffer.
- * If chunk is exhausted, this function skips to next IDAT chunk.
+ * Skips to the next byte boundary first. If chunk is exhausted, this function
+ * skips to next IDAT chunk.
  * 
  * The caller is responsible for having allocated enough buffer memory.
  * 
@@ -423,8 +573,7 @@ void skipRemainingBits(PngData *self);
  * @param numBytes Number of bytes to read; uint16_t, range 0..0xffff.
  * @returns A signed byte (int8_t) with one of the following return codes:
  *     - RET_FAPNG_OK: all bytes successfully read.
- *     - RET_FAPNG_READ: reading the file failed.
- *     - any error reported by seekChunk().
+ *     - any error reported by refillBufferIDAT().
  */
 int8_t readBytesIDAT(PngData *self, uint8_t *buffer, uint16_t numBytes);
 
@@ -434,38 +583,57 @@ int8_t readBytesIDAT(PngData *self, uint8_t *buffer, uint16_t numBytes);
  * The (little endian) value of the bits is stored in self->valueBufferBits.
  * 
  * @param self Address of a PngData structure.
- * @param numBits Number of bits to read; uint8_t, range 0..0xff.
+ * @param numBits Number of bits to read; uint8_t, range 0..32 (larger values are clipped).
  * @returns A signed byte (int8_t) with one of the following return codes:
  *     - RET_FAPNG_OK: all bytes successfully read.
- *     - RET_FAPNG_READ: reading the file failed.
- *     - any error reported by seekChunk().
+ *     - any error reported by refillBufferIDAT().
  */
 int8_t readBitsIDAT(PngData *self, uint8_t numBits);
 
-/** Look for a known bit code sequence at current file position.
+/** Make sure the bit accumulator holds at least numBits bits.
  * If chunk is exhausted, this function skips to next IDAT chunk.
  * 
  * @param self Address of a PngData structure.
- * @param lenCodes Number of codes in given alphabet.
- * @param codes Address of an array of codes (packed into uint32_ts).
+ * @param numBits Number of bits; range 0..25.
  * @returns A signed byte (int8_t) with one of the following return codes:
- *     - RET_FAPNG_OK: all bytes successfully read.
+ *     - RET_FAPNG_OK: enough bits available.
+ *     - any error reported by refillBufferIDAT().
+ */
+int8_t fillBitsIDAT(PngData *self, uint8_t numBits);
+
+/** Decode the Huffman-coded symbol at current stream position.
+ * 
+ * Peeks at the next 15 bits, looks them up in the root table and, for long
+ * codes, in the linked sub-table, and consumes the code's bits. The symbol
+ * is stored in self->valueBufferBits.
+ * 
+ * @param self Address of a PngData structure.
+ * @param table Address of a Huffman lookup table (cf. buildHuffmanTable()).
+ * @param bitsRoot Number of root index bits of the table.
+ * @returns A signed byte (int8_t) with one of the following return codes:
+ *     - RET_FAPNG_OK: symbol successfully decoded.
  *     - RET_FAPNG_CODE_NOT_FOUND: no code matches the current bit sequence.
- *     - any error reported by readBitsIDAT().
+ *     - any error reported by fillBitsIDAT().
  */
-int8_t checkCode(PngData *self, uint16_t lenCodes, uint32_t *codes);
+int8_t decodeSymbol(PngData *self, const uint16_t *table, uint8_t bitsRoot);
 
-/** Generate a Huffman code alphabet from a set of bit lengths.
+/** Build a two-level Huffman lookup table from a set of code lengths.
+ * 
+ * The root table has 1<<bitsRoot entries, indexed by the next bitsRoot stream
+ * bits. Codes longer than bitsRoot are stored in sub-tables following the
+ * root table, linked from the root entry of their first bitsRoot bits.
+ * Incomplete code sets are accepted; unused entries are zero.
  * 
  * @param numLengths Number of lengths.
- * @param lengths Address of a uint8_t array of lengths.
- * @param codeStruct Pointer to the address of a code array. If codeStruct is not Null, free() is called and a new struct is allocated.
- * @param sizeCodeStruct Address of a uint16_t var to hold the number of generated codes (i.e. the size of codeStruct).
+ * @param lengths Address of a uint8_t array of lengths (0..15, 0 = unused symbol).
+ * @param table Address of a uint16_t array with sizeTable entries.
+ * @param sizeTable Number of available table entries.
+ * @param bitsRoot Number of root index bits (1..11).
  * @returns A signed byte (int8_t) with one of the following return codes:
- *     - RET_FAPNG_OK: all bytes successfully read.
- *     - RET_FAPNG_MALLOC_CODE: failed to allocate code alphabet memory.
+ *     - RET_FAPNG_OK: table successfully built.
+ *     - RET_FAPNG_HUFFMAN_TABLE: over-subscribed code lengths or table too small.
  */
-int8_t generateHuffmanCodes(uint16_t numLengths, uint8_t *lengths, uint32_t **codeStruct, uint16_t *sizeCodeStruct);
+int8_t buildHuffmanTable(uint16_t numLengths, const uint8_t *lengths, uint16_t *table, uint16_t sizeTable, uint8_t bitsRoot);
 
 /** Read a new scanline from the file by trying to decode zlib/DEFLATE data
  *  from IDAT chunks. Seeks next IDAT chunk if current chunk gets exhausted.
@@ -480,7 +648,7 @@ int8_t generateHuffmanCodes(uint16_t numLengths, uint8_t *lengths, uint32_t **co
  *     - RET_FAPNG_PRESET_DICT: zlib stream features preset dictionary (shall not appear in PNG).
  *     - RET_FAPNG_DEFLATE_COMPRESSION: invalid DEFLATE compression type.
  *     - RET_FAPNG_MALLOC_BUFFER_INFLATE: failed to allocate decode window memory.
- *     - RET_FAPNG_MALLOC_CODE: failed to allocate code alphabet memory.
+ *     - RET_FAPNG_MALLOC_CODE: failed to allocate Huffman table memory.
  *     - RET_FAPNG_INVALID_CODE_LEN_CODE: encountered code length code 16 at beginning of block.
  *     - RET_FAPNG_LENGTHS_OVERFLOW: created more lengths from codes length codes than announced.
  *     - RET_FAPNG_INVALID_LENGTH_CODE: encountered invalid length code (most unlikely!).
@@ -489,8 +657,8 @@ int8_t generateHuffmanCodes(uint16_t numLengths, uint8_t *lengths, uint32_t **co
  *     - any error reported by seekChunk().
  *     - any error reported by readBytesIDAT().
  *     - any error reported by readBitsIDAT().
- *     - any error reported by generateHuffmanCodes().
- *     - any error reported by checkCode().
+ *     - any error reported by buildHuffmanTable().
+ *     - any error reported by decodeSymbol().
  */
 int8_t readScanline(PngData *self, uint16_t numBytes);
 
@@ -505,10 +673,83 @@ int8_t readScanline(PngData *self, uint16_t numBytes);
  */
 uint16_t PaethPredictor(uint16_t a, uint16_t b, uint16_t c);
 
+/** Open a PNG file and prepare it for decoding.
+ * 
+ * Checks signature and header, reads any palette and seeks the first IDAT
+ * chunk. Sets self->width, self->height, self->interlace etc. and allocates
+ * the scanline and file buffers; no image memory is allocated. Rows can
+ * then be fetched with pngDataReadRow().
+ * 
+ * A PngData structure may be reused for several files: any previously opened
+ * file is closed, the decoder restarts and self->colourType tells whether the
+ * palette belongs to the current image.
+ * 
+ * @param self Address of a PngData structure.
+ * @param filename Address of a filename string (char array).
+ * @returns A signed byte (int8_t) with one of the following return codes:
+ *     - RET_FAPNG_OK: file opened, ready to decode.
+ *     - any error code of pngDataRead() except RET_FAPNG_FILTER_TYPE and the readScanline() errors.
+ */
+int8_t pngDataOpen(PngData *self, char *filename);
+
+/** Decode and de-filter the next scanline.
+ * 
+ * Applies the scanline's filter and swaps the scanline buffers afterwards,
+ * i.e. the decoded scanline is found in self->scanlinePrevious. The filter
+ * loops are specialised for each filter distance (self->bytesPerPixel).
+ * 
+ * @param self Address of a PngData structure.
+ * @param sizeScanlineCurrent Number of scanline bytes, including the filter type byte.
+ * @returns A signed byte (int8_t) with one of the following return codes:
+ *     - RET_FAPNG_OK: scanline successfully decoded.
+ *     - RET_FAPNG_FILTER_TYPE: invalid filter type value.
+ *     - any error reported by readScanline().
+ */
+int8_t decodeScanline(PngData *self, uint16_t sizeScanlineCurrent);
+
+/** Decode the next row of an image opened with pngDataOpen().
+ * 
+ * Only non-interlaced images can be streamed. Memory needed: the INFLATE
+ * window, two scanlines and the file buffer, but no image planes.
+ * 
+ * @param self Address of a PngData structure.
+ * @param rgb565 Address of an array of at least self->width RGB565 pixels.
+ * @param alpha Address of an array of at least self->width alpha values; might be NULL.
+ * @returns A signed byte (int8_t) with one of the following return codes:
+ *     - RET_FAPNG_OK: row successfully decoded.
+ *     - RET_FAPNG_INTERLACED: image is interlaced.
+ *     - RET_FAPNG_ROWS: all rows already read.
+ *     - any error reported by decodeScanline().
+ */
+int8_t pngDataReadRow(PngData *self, uint16_t *rgb565, uint8_t *alpha);
+
+/** Streaming PNG reading function. Decode the file with given filename and
+ *  hand every row to a callback, e.g. to blit it, downsample it or to
+ *  convert it to another format, without allocating a full surface.
+ * 
+ * @param self Address of a PngData structure.
+ * @param filename Address of a filename string (char array).
+ * @param callback Address of a row callback function.
+ * @param context Address handed to the callback.
+ * @returns A signed byte (int8_t) with one of the following return codes:
+ *     - RET_FAPNG_OK: all rows successfully decoded.
+ *     - RET_FAPNG_ARGS: callback is NULL.
+ *     - RET_FAPNG_INTERLACED: image is interlaced (use pngDataRead()).
+ *     - RET_FAPNG_MALLOC_IMAGE: failed allocating the row buffers.
+ *     - RET_FAPNG_ABORTED: callback returned false.
+ *     - any error reported by pngDataOpen().
+ *     - any error reported by pngDataReadRow().
+ */
+int8_t pngDataReadRows(PngData *self, char *filename, PngRowCallback callback, void *context);
+
 /** Central PNG reading function. Reads file with given filename and creates
  *  an Image structure. Uses given PngData structure for state information
  *  and tracking of allocated memory.
  * 
+ * Images without transparency (colour types grey, RGB and indexed without tRNS
+ * chunk) yield opaque surfaces, i.e. no alpha plane is allocated. If image has
+ * flag SURFACE_FLAG_PREMULTIPLIED set, colours are premultiplied after decoding.
+ * 
  * @param self Address of a PngData structure; 
  * @param filename Address of a filename string (char array).
  * @param image Address of an Image structure. Any allocated image memory will be freed and rewritten.
@@ -527,6 +768,7 @@ uint16_t PaethPredictor(uint16_t a, uint16_t b, uint16_t c);
  *     - RET_FAPNG_COLOUR_TYPE: invalid colour type value.
  *     - RET_FAPNG_MALLOC_IMAGE: failed allocating image memory.
  *     - RET_FAPNG_MALLOC_SCANLINE: failed allocating scanline buffer memory.
+ *     - RET_FAPNG_MALLOC_BUFFER_FILE: failed allocating IDAT file buffer memory.
  *     - RET_FAPNG_FILTER_TYPE: invalid filter type value.
  *     - any error reported by readChunkHeader().
  *     - any error reported by seekChunk().
@@ -543,4 +785,105 @@ int8_t pngDataRead(PngData *self, char *filename, Surface *image);
  */
 Surface *pngDataLoad(char *filename);
 
+/** Indexed PNG reading function. Reads an indexed image (colour type 3)
+ *  without expanding it: the surface keeps the 1, 2, 4 or 8 bit indices of the
+ *  file and a palette with the PLTE colours and tRNS alpha values.
+ * 
+ * @param self Address of a PngData structure.
+ * @param filename Address of a filename string (char array).
+ * @param image Address of a pointer that receives the new indexed surface (NULL if something went wrong).
+ * @returns A signed byte (int8_t) with one of the following return codes:
+ *     - RET_FAPNG_OK: image successfully read.
+ *     - RET_FAPNG_ARGS: image is NULL.
+ *     - RET_FAPNG_NOT_INDEXED: the image is not indexed (use pngDataRead()).
+ *     - RET_FAPNG_MALLOC_PALETTE: failed to allocate palette memory.
+ *     - RET_FAPNG_MALLOC_IMAGE: failed to allocate the surface.
+ *     - any error code of pngDataRead().
+ */
+int8_t pngDataReadIndexed(PngData *self, char *filename, SurfaceIndexed **image);
+
+/** Indexed PNG reading wrapper function. Load the indexed PNG file with given filename.
+ * 
+ * Manages PngData automatically.
+ * 
+ * @param filename Address of a filename string (char array).
+ * @returns A pointer to an indexed surface. Might be NULL if something went wrong.
+ */
+SurfaceIndexed *pngDataLoadIndexed(char *filename);
+
+/** Derive the cache key of a PNG file.
+ * 
+ * Needs the file size and two small reads: the IHDR CRC at the beginning and
+ * the CRC of the last chunk before IEND at the end of the file. Since these
+ * CRCs cover header and final image data, any re-encoded file yields a
+ * different key with high probability.
+ * 
+ * @param filename Address of a filename string (char array).
+ * @param key Address of a PngCacheKey structure to fill.
+ * @returns A signed byte (int8_t) with one of the following return codes:
+ *     - RET_FAPNG_OK: key successfully derived.
+ *     - RET_FAPNG_OPEN: file not found, too small or not opened.
+ *     - RET_FAPNG_READ: reading from file failed.
+ *     - RET_FAPNG_SEEK: seeking in file failed.
+ */
+int8_t pngCacheKey(char *filename, PngCacheKey *key);
+
+/** Read a decoded surface cache file.
+ * 
+ * Cache file layout (PNG_CACHE_SIZE_HEADER header bytes, integers little endian):
+ * 
+ *     offset  size  content
+ *     0       3     signature "faP"
+ *     3       1     format version (PNG_CACHE_VERSION)
+ *     4       1     width
+ *     5       1     height
+ *     6       1     flags (PNG_CACHE_FLAG_*)
+ *     7       1     reserved (0)
+ *     8       4     key: PNG file size
+ *     12      4     key: IHDR CRC
+ *     16      4     key: CRC of last chunk before IEND
+ *     20      2*w*h RGB565 plane (native byte order)
+ *     ...     w*h   alpha plane (omitted if flag PNG_CACHE_FLAG_OPAQUE is set)
+ * 
+ * The planes are read with one request each. Opaque surfaces are restored
+ * without alpha plane.
+ * 
+ * @param filenameCache Address of the cache filename string (char array).
+ * @param key Address of the PngCacheKey structure of the source PNG.
+ * @param image Address of a Surface structure. Any allocated image memory will be freed and rewritten.
+ * @returns A signed byte (int8_t) with one of the following return codes:
+ *     - RET_FAPNG_OK: image successfully read.
+ *     - RET_FAPNG_OPEN: failed opening the cache file.
+ *     - RET_FAPNG_CACHE: cache file invalid, truncated or stale (key mismatch).
+ *     - RET_FAPNG_MALLOC_IMAGE: invalid Surface pointer or failed allocating image memory.
+ */
+int8_t pngCacheRead(char *filenameCache, PngCacheKey *key, Surface *image);
+
+/** Write a decoded surface cache file (cf. pngCacheRead()).
+ * 
+ * Colours are written as they are; cache files of premultiplied surfaces are
+ * read as straight surfaces.
+ * 
+ * @param filenameCache Address of the cache filename string (char array).
+ * @param key Address of the PngCacheKey structure of the source PNG.
+ * @param image Address of a Surface structure.
+ * @returns A signed byte (int8_t) with one of the following return codes:
+ *     - RET_FAPNG_OK: cache file successfully written.
+ *     - RET_FAPNG_OPEN: failed opening the cache file.
+ *     - RET_FAPNG_WRITE: failed writing the cache file.
+ *     - RET_FAPNG_MALLOC_IMAGE: invalid Surface.
+ */
+int8_t pngCacheWrite(char *filenameCache, PngCacheKey *key, Surface *image);
+
+/** PNG reading wrapper function with decoded surface cache.
+ * 
+ * Like pngDataLoad(), but first tries the cache file filename+PNG_CACHE_SUFFIX.
+ * If the cache file is missing or stale, the PNG is decoded and the cache
+ * file is (re-)written; failing to write it is silently ignored.
+ * 
+ * @param filename Address of a filename string (char array).
+ * @returns A pointer to a surface with the image bitmap data. Might be NULL if something went wrong.
+ */
+Surface *pngDataLoadCached(char *filename);
+
 #endif // _FAREADPNG_H
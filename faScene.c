@@ -0,0 +1,254 @@
+/**
+ * @file
+ * @author Frank Abelbeck <frank.abelbeck@googlemail.com>
+ * @version 2026-10-14
+ * 
+ * @section License
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * @section Description
+ * 
+ * Layered scene compositor for the card10 badge.
+ */
+
+#include <stddef.h> // uses: NULL
+#include <string.h> // uses: memcmp()
+#include "faScene.h"
+#include "faFramebuffer.h" // uses: framebufferUpdateFromSurface()
+#include "faMemory.h" // uses: memoryAlloc(), memoryFree()
+
+//------------------------------------------------------------------------------
+// constructor and destructor functions
+//------------------------------------------------------------------------------
+
+// Scene constructor: allocate layer array, canvas and masks
+Scene *sceneConstruct(uint8_t maxLayers, uint16_t colour) {
+	Scene *scene = (Scene*)memoryAlloc(sizeof(Scene));
+	if (scene == NULL) return NULL;
+	scene->nLayers = 0;
+	scene->maxLayers = maxLayers;
+	scene->isInvalid = true;
+	scene->colour = colour;
+	scene->layers = (SceneLayer*)memoryAlloc(maxLayers * sizeof(SceneLayer));
+	scene->canvas = surfaceSetupOpaque(DISP_WIDTH,DISP_HEIGHT);
+	scene->damage = surfaceModConstruct(DISP_HEIGHT);
+	scene->scratch = surfaceModConstruct(DISP_HEIGHT);
+	if ((scene->layers == NULL && maxLayers > 0) || scene->canvas == NULL || scene->damage == NULL || scene->scratch == NULL) {
+		sceneDestruct(&scene);
+		return NULL;
+	}
+	return scene;
+}
+
+// Scene destructor: free everything owned by the scene
+void sceneDestruct(Scene **scene) {
+	memoryFree((*scene)->layers);
+	if ((*scene)->canvas != NULL) surfaceDestruct(&(*scene)->canvas);
+	if ((*scene)->damage != NULL) surfaceModDestruct(&(*scene)->damage);
+	if ((*scene)->scratch != NULL) surfaceModDestruct(&(*scene)->scratch);
+	memoryFree(*scene);
+	*scene = NULL;
+}
+
+//------------------------------------------------------------------------------
+// layer functions
+//------------------------------------------------------------------------------
+
+// internal helper function: append a visible, changed layer of given type
+static SceneLayer *sceneAddLayer(Scene *scene, uint8_t type) {
+	if (scene == NULL || scene->nLayers >= scene->maxLayers) return NULL;
+	SceneLayer *layer = &scene->layers[scene->nLayers++];
+	layer->type = type;
+	layer->flags = SCENE_LAYER_FLAG_VISIBLE | SCENE_LAYER_FLAG_CHANGED;
+	layer->alpha = 255;
+	layer->mode = BLEND_OVER;
+	layer->p = createPoint(0,0);
+	layer->matrix = getMatrixTranslate(0,0);
+	layer->surface = NULL;
+	layer->font = NULL;
+	layer->layout = NULL;
+	layer->footprint = boundingBoxCreate(0,0,-1,-1);
+	return layer;
+}
+
+SceneLayer *sceneAddSurface(Scene *scene, Surface *surface, Point p, uint8_t mode) {
+	if (surface == NULL) return NULL;
+	SceneLayer *layer = sceneAddLayer(scene,SCENE_LAYER_SURFACE);
+	if (layer != NULL) {
+		layer->surface = surface;
+		layer->p = p;
+		layer->mode = mode;
+	}
+	return layer;
+}
+
+SceneLayer *sceneAddSprite(Scene *scene, Surface *sprite, Matrix matrix, uint8_t alpha, uint8_t mode) {
+	if (sprite == NULL) return NULL;
+	SceneLayer *layer = sceneAddLayer(scene,SCENE_LAYER_SPRITE);
+	if (layer != NULL) {
+		layer->surface = sprite;
+		layer->matrix = matrix;
+		layer->alpha = alpha;
+		layer->mode = mode;
+	}
+	return layer;
+}
+
+SceneLayer *sceneAddText(Scene *scene, FontFileData *font, FontLayout *layout, Point p) {
+	if (font == NULL || layout == NULL) return NULL;
+	SceneLayer *layer = sceneAddLayer(scene,SCENE_LAYER_TEXT);
+	if (layer != NULL) {
+		layer->font = font;
+		layer->layout = layout;
+		layer->p = p;
+	}
+	return layer;
+}
+
+// setters: mark the layer only if something actually changes
+void sceneLayerSetPosition(SceneLayer *layer, Point p) {
+	if (layer == NULL || (layer->p.x == p.x && layer->p.y == p.y)) return;
+	layer->p = p;
+	layer->flags |= SCENE_LAYER_FLAG_CHANGED;
+}
+
+void sceneLayerSetMatrix(SceneLayer *layer, Matrix matrix) {
+	if (layer == NULL || memcmp(&layer->matrix,&matrix,sizeof(Matrix)) == 0) return;
+	layer->matrix = matrix;
+	layer->flags |= SCENE_LAYER_FLAG_CHANGED;
+}
+
+void sceneLayerSetAlpha(SceneLayer *layer, uint8_t alpha) {
+	if (layer == NULL || layer->alpha == alpha) return;
+	layer->alpha = alpha;
+	layer->flags |= SCENE_LAYER_FLAG_CHANGED;
+}
+
+void sceneLayerSetVisible(SceneLayer *layer, bool isVisible) {
+	if (layer == NULL || ((layer->flags & SCENE_LAYER_FLAG_VISIBLE) != 0) == isVisible) return;
+	layer->flags ^= SCENE_LAYER_FLAG_VISIBLE;
+	layer->flags |= SCENE_LAYER_FLAG_CHANGED;
+}
+
+void sceneLayerTouch(SceneLayer *layer) {
+	if (layer != NULL) layer->flags |= SCENE_LAYER_FLAG_CHANGED;
+}
+
+void sceneInvalidate(Scene *scene) {
+	if (scene != NULL) scene->isInvalid = true;
+}
+
+//------------------------------------------------------------------------------
+// rendering
+//------------------------------------------------------------------------------
+
+// internal helper function: canvas area covered by a layer in its current state;
+// returns false if the layer does not cover any canvas pixel
+static bool sceneLayerFootprint(SceneLayer *layer, BoundingBox *bb) {
+	switch (layer->type) {
+		case SCENE_LAYER_SURFACE:
+			*bb = boundingBoxCreate(layer->p.x,layer->p.y,layer->p.x + layer->surface->width - 1,layer->p.y + layer->surface->height - 1);
+			break;
+		case SCENE_LAYER_SPRITE:
+			*bb = composeBoundingBox(layer->surface,layer->matrix,boundingBoxGet(layer->surface));
+			break;
+		case SCENE_LAYER_TEXT:
+			// layout box: max is exclusive
+			*bb = boundingBoxCreate(layer->p.x + layer->layout->bb.min.x,layer->p.y + layer->layout->bb.min.y,layer->p.x + layer->layout->bb.max.x - 1,layer->p.y + layer->layout->bb.max.y - 1);
+			if (layer->layout->n == 0) return false;
+			break;
+		default:
+			return false;
+	}
+	if (bb->min.x < 0) bb->min.x = 0;
+	if (bb->min.y < 0) bb->min.y = 0;
+	if (bb->max.x >= DISP_WIDTH) bb->max.x = DISP_WIDTH - 1;
+	if (bb->max.y >= DISP_HEIGHT) bb->max.y = DISP_HEIGHT - 1;
+	return bb->min.x <= bb->max.x && bb->min.y <= bb->max.y;
+}
+
+// internal helper function: mark all tiles touched by a (clipped, non-empty) box
+static void sceneMarkBox(SurfaceMod *mask, BoundingBox bb) {
+	uint32_t bitmask = ((2u << (bb.max.x >> 3)) - 1) & ~((1u << (bb.min.x >> 3)) - 1);
+	for (int32_t y = bb.min.y & ~7; y <= bb.max.y; y += 8) surfaceModSetRow(mask,y,bitmask);
+}
+
+// internal helper function: redraw a layer inside a canvas rectangle;
+// view is the canvas area of rect
+static void sceneLayerDraw(Scene *scene, SceneLayer *layer, Surface *view, BoundingBox rect) {
+	switch (layer->type) {
+		case SCENE_LAYER_SURFACE:
+			surfaceBlendPosition(layer->surface,view,createPoint(layer->p.x - rect.min.x,layer->p.y - rect.min.y),layer->mode,scene->scratch);
+			break;
+		case SCENE_LAYER_SPRITE:
+			// drawn on the canvas with a clip box: shifting the matrix would change its rounding
+			composeClip(scene->canvas,layer->surface,scene->canvas,layer->matrix,layer->alpha,layer->mode,boundingBoxGet(layer->surface),rect,scene->scratch);
+			break;
+		case SCENE_LAYER_TEXT:
+			fontFileDraw(view,scene->scratch,layer->font,layer->layout,createPoint(layer->p.x - rect.min.x,layer->p.y - rect.min.y));
+			break;
+	}
+}
+
+uint8_t sceneRender(Scene *scene, union disp_framebuffer *framebuffer, SurfaceMod *mask) {
+	if (scene == NULL) return 0;
+	BoundingBox rects[SCENE_MAX_RECTS];
+	BoundingBox bb;
+	SceneLayer *layer;
+	Surface *view;
+	uint8_t i,k,nRects;
+	
+	// damage: footprints of all changed layers in the last and in this frame
+	surfaceModClear(scene->damage);
+	if (scene->isInvalid) sceneMarkBox(scene->damage,boundingBoxGet(scene->canvas));
+	for (i = 0; i < scene->nLayers; i++) {
+		layer = &scene->layers[i];
+		if (!(layer->flags & SCENE_LAYER_FLAG_CHANGED) && !scene->isInvalid) continue;
+		if (layer->flags & SCENE_LAYER_FLAG_DRAWN) sceneMarkBox(scene->damage,layer->footprint);
+		layer->flags &= ~(SCENE_LAYER_FLAG_CHANGED | SCENE_LAYER_FLAG_DRAWN);
+		if ((layer->flags & SCENE_LAYER_FLAG_VISIBLE) && sceneLayerFootprint(layer,&bb)) {
+			sceneMarkBox(scene->damage,bb);
+			layer->footprint = bb;
+			layer->flags |= SCENE_LAYER_FLAG_DRAWN;
+		}
+	}
+	scene->isInvalid = false;
+	
+	// recomposite each damaged rectangle bottom to top
+	nRects = surfaceModGetRects(scene->damage,rects,SCENE_MAX_RECTS);
+	for (k = 0; k < nRects; k++) {
+		if (rects[k].max.x >= DISP_WIDTH) rects[k].max.x = DISP_WIDTH - 1;
+		if (rects[k].max.y >= DISP_HEIGHT) rects[k].max.y = DISP_HEIGHT - 1;
+		view = surfaceView(scene->canvas,rects[k]);
+		if (view == NULL) {
+			// out of memory: try again with the whole canvas next frame
+			scene->isInvalid = true;
+			continue;
+		}
+		surfaceClear(view,scene->colour,255);
+		for (i = 0; i < scene->nLayers; i++) {
+			layer = &scene->layers[i];
+			if (!(layer->flags & SCENE_LAYER_FLAG_DRAWN) || \
+				layer->footprint.min.x > rects[k].max.x || layer->footprint.max.x < rects[k].min.x || \
+				layer->footprint.min.y > rects[k].max.y || layer->footprint.max.y < rects[k].min.y) continue;
+			sceneLayerDraw(scene,layer,view,rects[k]);
+		}
+		surfaceDestruct(&view);
+	}
+	
+	if (framebuffer != NULL) framebufferUpdateFromSurface(framebuffer,scene->canvas,scene->damage);
+	if (mask != NULL) surfaceModMerge(mask,scene->damage);
+	return nRects;
+}
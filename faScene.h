@@ -0,0 +1,192 @@
+#ifndef _FASCENE_H
+#define _FASCENE_H
+/**
+ * @file
+ * @author Frank Abelbeck <frank.abelbeck@googlemail.com>
+ * @version 2026-10-14
+ * 
+ * @section License
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * @section Description
+ * 
+ * Layered scene compositor for the card10 badge: a scene owns an ordered list
+ * of layers (surfaces, transformed sprites, text layouts) and a display-sized
+ * canvas. Each frame, only the areas covered by changed layers, before and
+ * after the change, are recomposited bottom to top and sent to the framebuffer.
+ * 
+ * Layers refer to surfaces, fonts and layouts owned by the app. After changing
+ * their contents, call sceneLayerTouch(); position, matrix, alpha and visibility
+ * are changed via the sceneLayerSet*() functions, which keep track themselves.
+ */
+
+#include <stdint.h> // uses: int8_t, uint8_t, uint16_t
+#include <stdbool.h> // uses: bool, true, false
+
+#include "epicardium.h" // uses: union disp_framebuffer
+#include "faSurfaceBase.h"
+#include "faSurface.h" // uses: Matrix
+#include "faFontFile.h" // uses: FontFileData, FontLayout
+
+//------------------------------------------------------------------------------
+// constants
+//------------------------------------------------------------------------------
+#define SCENE_LAYER_SURFACE 0 ///< layer type: surface at a position (e.g. a background)
+#define SCENE_LAYER_SPRITE  1 ///< layer type: surface transformed by a matrix (cf. compose())
+#define SCENE_LAYER_TEXT    2 ///< layer type: text layout at a position (cf. fontFileDraw())
+
+#define SCENE_LAYER_FLAG_VISIBLE 0x01 ///< layer flag: layer is drawn
+#define SCENE_LAYER_FLAG_CHANGED 0x02 ///< layer flag: layer changed since the last frame
+#define SCENE_LAYER_FLAG_DRAWN   0x04 ///< layer flag: footprint holds the area covered in the last frame
+
+#define SCENE_MAX_RECTS 8 ///< maximum number of rectangles recomposited per frame (cf. surfaceModGetRects())
+
+//------------------------------------------------------------------------------
+// data structures
+//------------------------------------------------------------------------------
+
+/** Data structure of a scene layer. */
+typedef struct {
+	uint8_t type;  ///< One of SCENE_LAYER_*.
+	uint8_t flags; ///< Combination of SCENE_LAYER_FLAG_* values.
+	uint8_t alpha; ///< Transparency of a sprite layer (cf. compose()).
+	uint8_t mode;  ///< Blend mode of surface and sprite layers, as defined by BLEND_*.
+	Point   p;     ///< Upper left corner of surface and text layers.
+	Matrix  matrix; ///< Transformation of a sprite layer.
+	Surface *surface; ///< Surface of surface and sprite layers.
+	FontFileData *font; ///< Font of a text layer.
+	FontLayout *layout; ///< Layout of a text layer.
+	BoundingBox footprint; ///< Canvas area covered in the last frame (inclusive).
+} SceneLayer;
+
+/** Data structure of a scene. */
+typedef struct {
+	uint8_t    nLayers;   ///< Number of layers.
+	uint8_t    maxLayers; ///< Capacity of the layer array.
+	bool       isInvalid; ///< True if the whole canvas has to be recomposited.
+	uint16_t   colour;    ///< Colour of canvas areas not covered by any layer (RGB565).
+	SceneLayer *layers;   ///< Layer array, bottom to top.
+	Surface    *canvas;   ///< Composited scene; opaque, display-sized.
+	SurfaceMod *damage;   ///< Tiles recomposited in the last frame.
+	SurfaceMod *scratch;  ///< Modification mask passed to the drawing functions.
+} Scene;
+
+//------------------------------------------------------------------------------
+// function prototypes
+//------------------------------------------------------------------------------
+
+/** Constructor: create a scene without layers.
+ * 
+ * @param maxLayers Maximum number of layers.
+ * @param colour Colour of canvas areas not covered by any layer (RGB565).
+ * @returns A pointer to a Scene structure or NULL if something went wrong.
+ */
+Scene *sceneConstruct(uint8_t maxLayers, uint16_t colour);
+
+/** Destructor: free any allocated memory of a scene.
+ * 
+ * Surfaces, fonts and layouts referred to by layers are not freed.
+ * 
+ * @param scene Pointer to a pointer to a Scene structure.
+ */
+void sceneDestruct(Scene **scene);
+
+/** Add a surface layer on top of the scene.
+ * 
+ * @param scene Pointer to a Scene structure.
+ * @param surface Pointer to a Surface structure.
+ * @param p Upper left corner on the canvas.
+ * @param mode A mode as defined by BLEND_*
+ * @returns A pointer to the new SceneLayer structure or NULL if the scene is full.
+ */
+SceneLayer *sceneAddSurface(Scene *scene, Surface *surface, Point p, uint8_t mode);
+
+/** Add a sprite layer on top of the scene.
+ * 
+ * @param scene Pointer to a Scene structure.
+ * @param sprite Pointer to a Surface structure.
+ * @param matrix Transformation from sprite to canvas coordinates (cf. compose()).
+ * @param alpha Transparency of the sprite.
+ * @param mode A mode as defined by BLEND_*, optionally combined with BLEND_FLAG_BILINEAR.
+ * @returns A pointer to the new SceneLayer structure or NULL if the scene is full.
+ */
+SceneLayer *sceneAddSprite(Scene *scene, Surface *sprite, Matrix matrix, uint8_t alpha, uint8_t mode);
+
+/** Add a text layer on top of the scene.
+ * 
+ * @param scene Pointer to a Scene structure.
+ * @param font Pointer to a FontFileData structure; colours are taken from the font when drawing.
+ * @param layout Pointer to a FontLayout structure, measured with font (cf. fontFileMeasure()).
+ * @param p Origin of the layout on the canvas.
+ * @returns A pointer to the new SceneLayer structure or NULL if the scene is full.
+ */
+SceneLayer *sceneAddText(Scene *scene, FontFileData *font, FontLayout *layout, Point p);
+
+/** Move a surface or text layer.
+ * 
+ * @param layer Pointer to a SceneLayer structure.
+ * @param p Upper left corner (surface) or origin (text) on the canvas.
+ */
+void sceneLayerSetPosition(SceneLayer *layer, Point p);
+
+/** Set the transformation of a sprite layer.
+ * 
+ * @param layer Pointer to a SceneLayer structure.
+ * @param matrix Transformation from sprite to canvas coordinates.
+ */
+void sceneLayerSetMatrix(SceneLayer *layer, Matrix matrix);
+
+/** Set the transparency of a sprite layer.
+ * 
+ * @param layer Pointer to a SceneLayer structure.
+ * @param alpha Transparency of the sprite.
+ */
+void sceneLayerSetAlpha(SceneLayer *layer, uint8_t alpha);
+
+/** Show or hide a layer.
+ * 
+ * @param layer Pointer to a SceneLayer structure.
+ * @param isVisible True if the layer should be drawn.
+ */
+void sceneLayerSetVisible(SceneLayer *layer, bool isVisible);
+
+/** Mark a layer as changed, e.g. after drawing on its surface, measuring its
+ * layout again or changing its font's colours.
+ * 
+ * @param layer Pointer to a SceneLayer structure.
+ */
+void sceneLayerTouch(SceneLayer *layer);
+
+/** Mark the whole canvas for recomposition in the next frame.
+ * 
+ * @param scene Pointer to a Scene structure.
+ */
+void sceneInvalidate(Scene *scene);
+
+/** Recomposite all changed areas of a scene and update the framebuffer.
+ * 
+ * The old and new footprints of all changed layers are collected in tiles and
+ * merged into at most SCENE_MAX_RECTS rectangles (cf. surfaceModGetRects());
+ * each rectangle is cleared and all layers overlapping it are redrawn, bottom
+ * to top. The result equals a full recomposition of the scene.
+ * 
+ * @param scene Pointer to a Scene structure.
+ * @param framebuffer Pointer to a framebuffer where changed tiles are copied to; may be NULL.
+ * @param mask Pointer to a SurfaceMod structure where changed tiles are recorded, e.g. for framebufferRedrawMask(); may be NULL.
+ * @returns The number of recomposited rectangles (0 if nothing changed).
+ */
+uint8_t sceneRender(Scene *scene, union disp_framebuffer *framebuffer, SurfaceMod *mask);
+
+#endif // _FASCENE_H
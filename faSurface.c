@@ -1,7 +1,7 @@
 /**
  * @file
  * @author Frank Abelbeck <frank.abelbeck@googlemail.com>
- * @version 2020-02-12
+ * @version 2026-10-14
  * 
  * @section License
  * 
@@ -25,11 +25,14 @@
  * This reduces load of homogeneous coordinate transformation significantly.
  */
 
-#include <stdlib.h> // uses: malloc(), free()
+#include <stddef.h> // uses: NULL
 #include <stdint.h> // uses: int8_t, uint8_t, int16_t, uint16_t, uint32_t
+#include <stdbool.h> // uses: bool, true, false
 
 #include "faSurface.h"
 #include "faSurfaceBase.h"
+#include "faMath.h" // uses: mathSineCosine()
+#include "faProfile.h" // uses: PROFILE_SCOPE()
 
 //------------------------------------------------------------------------------
 // matrix manipulation functions
@@ -101,9 +104,8 @@ Matrix invertMatrix(Matrix m) {
 // construct a matrix: rotation about arbitrary pivot point
 Matrix getMatrixRotate(int16_t angle) {
 	Matrix result;
-	angle = (360 + (angle % 360)) % 360;
-	int16_t ca = surfaceCosine(angle); 
-	int16_t sa = surfaceSine(angle); 
+	int16_t ca,sa;
+	mathSineCosine(angle,&sa,&ca);
 	result.xx = ca;
 	result.xy = -sa;
 	result.xz = 0;
@@ -165,28 +167,39 @@ Matrix getMatrixShearY(int16_t factor) {
 // surface composition functions
 //------------------------------------------------------------------------------
 
-// paint sprite transformed by given matrix on surface, using given transparency value and blend mode
-BoundingBox compose(Surface *surface, Surface *sprite, Surface *destination, Matrix matrix, uint8_t alpha, uint8_t mode, BoundingBox boundingBoxSprite, SurfaceMod *mask) {
-	// 2020-01-09: move from "3 shears" to "general affine transformation", i.e. p' = A*p
-	//             problem: interpolation
-	//             anti-aliasing/interpolation via blendFractional() does not work
-	// 2020-01-12: solution works, but shows non-interpolation pattern
-	// 2020-01-13: try other way 'round: parameter "matrix" and "matrixInverse"
-	//              - calculate surface bounding box with matrix
-	//              - iteratore over surface coordinates of the bounding box
-	//              - calculate p = A^-1 * p', i.e. get sprite coordinates and paint surface coordinates accordingly
-	// 2020-01-20: introduced boundingBoxSprite parameter
-	// 2020-02-03: changed to SurfaceMod update mask handling
-	// 2020-02-05: removed boundingBox return value, using mask parameter instead
-	// 2020-02-06: re-introduced boundingBox return value
-	// 2020-02-11: new meaning of return value: bounding box of _unclipped_ sprite; removing explicit coordinate rounding
-	
-	// sanity check: bail out if invalid parameters were given
-	if (surface == NULL || sprite == NULL || destination == NULL || mask == NULL || \
-		surface->width != destination->width || surface->height != destination->height || 
-		mask->height != surface->height)
-		return boundingBoxCreate(0,0,0,0);
-	
+// floor and ceiling of n/d for any signs of n and d (C division truncates towards zero)
+static inline int32_t divFloor(int32_t n, int32_t d) {
+	int32_t q = n / d;
+	if ((n % d != 0) && ((n < 0) != (d < 0))) q--;
+	return q;
+}
+
+static inline int32_t divCeil(int32_t n, int32_t d) {
+	return -divFloor(-n,d);
+}
+
+// narrow the range [*xStart,*xStop] to all integers x with L <= a*x + c <= H;
+// the range becomes empty (*xStart > *xStop) if there is no such x
+static void composeClipLinear(int32_t a, int32_t c, int32_t L, int32_t H, int32_t *xStart, int32_t *xStop) {
+	int32_t x0,x1;
+	if (a == 0) {
+		// constant over the row: either all or no x
+		if (c < L || c > H) *xStop = *xStart - 1;
+		return;
+	}
+	if (a > 0) {
+		x0 = divCeil(L - c,a);
+		x1 = divFloor(H - c,a);
+	} else {
+		x0 = divCeil(H - c,a);
+		x1 = divFloor(L - c,a);
+	}
+	if (x0 > *xStart) *xStart = x0;
+	if (x1 < *xStop) *xStop = x1;
+}
+
+// bounding box of a sprite area transformed by matrix (rounded like the sampling in compose())
+BoundingBox composeBoundingBox(Surface *sprite, Matrix matrix, BoundingBox boundingBoxSprite) {
 	Point pMin,pMax,pMod;
 	BoundingBox bb;
 	
@@ -224,58 +237,149 @@ BoundingBox compose(Surface *surface, Surface *sprite, Surface *destination, Mat
 	if (pMod.y < pMin.y) pMin.y = pMod.y; else if (pMod.y > pMax.y) pMax.y = pMod.y;
 	
 	// divide by 1024 and round if necessary
-	// check that at least part of the bounding box overlaps with the surface
 	bb.min.x = (pMin.x >> 10) + (((pMin.x & 1023) >= 512) ? 1 : 0);
 	bb.max.x = (pMax.x >> 10) + (((pMax.x & 1023) >= 512) ? 1 : 0);
 	bb.min.y = (pMin.y >> 10) + (((pMin.y & 1023) >= 512) ? 1 : 0);
 	bb.max.y = (pMax.y >> 10) + (((pMax.y & 1023) >= 512) ? 1 : 0);
-	if (bb.min.x >= surface->width || bb.max.x < 0 || bb.min.y >= surface->height || bb.max.y < 0) return bb;
+	return bb;
+}
+
+// paint sprite transformed by given matrix on surface, using given transparency value and blend mode
+BoundingBox compose(Surface *surface, Surface *sprite, Surface *destination, Matrix matrix, uint8_t alpha, uint8_t mode, BoundingBox boundingBoxSprite, SurfaceMod *mask) {
+	if (surface == NULL) return boundingBoxCreate(0,0,0,0);
+	return composeClip(surface,sprite,destination,matrix,alpha,mode,boundingBoxSprite,boundingBoxGet(surface),mask);
+}
+
+// internal composition function: matrix and clip box refer to canvas coordinates,
+// surface pixel (x,y) is canvas pixel (x + offset.x, y + offset.y)
+static BoundingBox composeRegion(Surface *surface, Surface *sprite, Surface *destination, Matrix matrix, uint8_t alpha, uint8_t mode, BoundingBox boundingBoxSprite, BoundingBox clip, Point offset, SurfaceMod *mask) {
+	PROFILE_SCOPE(PROFILE_COMPOSE);
+	// 2020-01-09: move from "3 shears" to "general affine transformation", i.e. p' = A*p
+	//             problem: interpolation
+	//             anti-aliasing/interpolation via blendFractional() does not work
+	// 2020-01-12: solution works, but shows non-interpolation pattern
+	// 2020-01-13: try other way 'round: parameter "matrix" and "matrixInverse"
+	//              - calculate surface bounding box with matrix
+	//              - iteratore over surface coordinates of the bounding box
+	//              - calculate p = A^-1 * p', i.e. get sprite coordinates and paint surface coordinates accordingly
+	// 2020-01-20: introduced boundingBoxSprite parameter
+	// 2020-02-03: changed to SurfaceMod update mask handling
+	// 2020-02-05: removed boundingBox return value, using mask parameter instead
+	// 2020-02-06: re-introduced boundingBox return value
+	// 2020-02-11: new meaning of return value: bounding box of _unclipped_ sprite; removing explicit coordinate rounding
+	// 2026-10-14: sampled pixels are gathered into runs and blended via surfaceBlendSpan()
+	// 2026-10-14: incremental sprite coordinates per row (DDA), rows clipped analytically
+	//             to the sprite's footprint; optional bilinear sampling (BLEND_FLAG_BILINEAR)
+	
+	// sanity check: bail out if invalid parameters were given
+	if (surface == NULL || sprite == NULL || destination == NULL || mask == NULL || \
+		surface->width != destination->width || surface->height != destination->height || 
+		mask->height != surface->height)
+		return boundingBoxCreate(0,0,0,0);
+	
+	// new bounding box = bounding box sprite transformed by matrix
+	if (boundingBoxSprite.min.x < 0) boundingBoxSprite.min.x = 0;
+	if (boundingBoxSprite.min.y < 0) boundingBoxSprite.min.y = 0;
+	if (boundingBoxSprite.max.x >= sprite->width) boundingBoxSprite.max.x = sprite->width-1;
+	if (boundingBoxSprite.max.y >= sprite->height) boundingBoxSprite.max.y = sprite->height-1;
+	BoundingBox bb = composeBoundingBox(sprite,matrix,boundingBoxSprite);
+	
+	// check that at least part of the bounding box overlaps with the surface and the clip box
+	if (clip.min.x < offset.x) clip.min.x = offset.x;
+	if (clip.min.y < offset.y) clip.min.y = offset.y;
+	if (clip.max.x >= offset.x + surface->width) clip.max.x = offset.x + surface->width - 1;
+	if (clip.max.y >= offset.y + surface->height) clip.max.y = offset.y + surface->height - 1;
+	if (bb.min.x > clip.max.x || bb.max.x < clip.min.x || bb.min.y > clip.max.y || bb.max.y < clip.min.y) return bb;
 	
-	// clip bounding box to surface area
-	uint8_t xMin = (bb.min.x < 0) ? 0 : bb.min.x;
-	uint8_t yMin = (bb.min.y < 0) ? 0 : bb.min.y;
-	uint8_t xMax = (bb.max.x > surface->width) ? surface->width - 1 : bb.max.x;
-	uint8_t yMax = (bb.max.y > surface->height) ? surface->height - 1 : bb.max.y;
+	// clip bounding box to the clip box
+	const int32_t xMin = (bb.min.x < clip.min.x) ? clip.min.x : bb.min.x;
+	const int32_t yMin = (bb.min.y < clip.min.y) ? clip.min.y : bb.min.y;
+	const int32_t xMax = (bb.max.x > clip.max.x) ? clip.max.x : bb.max.x;
+	const int32_t yMax = (bb.max.y > clip.max.y) ? clip.max.y : bb.max.y;
 	
 	// calculate inverse of transformation matrix
 	Matrix inverse = invertMatrix(matrix);
 	
-	// iterate over boundingBox area of surface
-	uint8_t  x,y;
-	uint16_t iSurface = yMin * surface->width + xMin;
-	uint16_t diSurface = surface->width - (xMax - xMin + 1);
-	uint16_t iSprite;
-	uint32_t bitmask;
+	// iterate over boundingBox area of surface row by row (destination = sprite op surface);
+	// sprite coordinates u,v (normalised to 1024) advance by a constant delta per
+	// x step: inverse.xx and inverse.yx; with rounding bias 512 added, u >> 10
+	// and v >> 10 are the nearest sprite pixel (cf. mulMatrixPoint())
+	int32_t uMin = boundingBoxSprite.min.x << 10;
+	int32_t uMax = (boundingBoxSprite.max.x << 10) + 1023;
+	int32_t vMin = boundingBoxSprite.min.y << 10;
+	int32_t vMax = (boundingBoxSprite.max.y << 10) + 1023;
+	const bool bilinear = (mode & BLEND_FLAG_BILINEAR) != 0;
+	mode &= BLEND_MASK_MODE;
+	if (sprite->flags & SURFACE_FLAG_PREMULTIPLIED) mode |= BLEND_FLAG_PREMULTIPLIED; // sampled colours stay premultiplied
+	int32_t u,v,u0,v0,xStart,xStop,y;
+	uint8_t  x,len;
+	
+	// run table: if transparent pixels keep the destination, nearest-neighbour
+	// sampling is restricted to the sprite's ink box and, for rows of constant
+	// v (no rotation or shear), to the ink extent of the sampled sprite row
+	const SurfaceRuns *runs = (!bilinear && sprite->runs != NULL && sprite != destination && surfaceBlendSkipsTransparent(mode)) ? sprite->runs : NULL;
+	const SurfaceRun *runFirst,*runLast;
+	if (runs != NULL) {
+		if (runs->nRuns == 0) return bb;
+		if (uMin < (runs->xMin << 10)) uMin = runs->xMin << 10;
+		if (uMax > (runs->xMax << 10) + 1023) uMax = (runs->xMax << 10) + 1023;
+		if (vMin < (runs->yMin << 10)) vMin = runs->yMin << 10;
+		if (vMax > (runs->yMax << 10) + 1023) vMax = (runs->yMax << 10) + 1023;
+	}
+	uint16_t runColour[256];
+	uint8_t  runAlpha[256];
+	uint8_t  *alphaRun = (sprite->alpha != NULL) ? runAlpha : NULL; // opaque sprite: no alpha run
 	for (y = yMin; y <= yMax; y++) {
-		bitmask = 0;
-		for (x = xMin; x <= xMax; x++) {
-			// calculate sprite coordinates:
-			// 1) apply inverse matrix
-			pMod.x = x << 10;
-			pMod.y = y << 10;
-			pMod = mulMatrixPoint(inverse,pMod);
-			// 2) de-normalise and round
-			pMod.x = (pMod.x >> 10) + (((pMod.x & 1023) >= 512) ? 1 : 0);
-			pMod.y = (pMod.y >> 10) + (((pMod.y & 1023) >= 512) ? 1 : 0);
-			// 3) check that the sprite coordinates are inside the sprite's bounding box
-			if (pMod.x >= boundingBoxSprite.min.x && pMod.y >= boundingBoxSprite.min.y && \
-				pMod.x <= boundingBoxSprite.max.x && pMod.y <= boundingBoxSprite.max.y) {
-				// 4) calculate pixel index
-				iSprite = pMod.y * sprite->width + pMod.x;
-				// 5) blend pixel (destination = sprite op surface) and add pixel to mask if destination was changed
-				if (surfacePixelBlend(
-					sprite->rgb565[iSprite],(alpha * sprite->alpha[iSprite]) >> 8,
-					surface->rgb565[iSurface],surface->alpha[iSurface],
-					&destination->rgb565[iSurface],&destination->alpha[iSurface],
-					mode)) bitmask |= 1 << (x >> 3); // pixel changed: mark in bitmask
+		// one matrix multiplication per row: sprite coordinates at x = 0
+		u0 = inverse.xy * y + inverse.xz + 512;
+		v0 = inverse.yy * y + inverse.yz + 512;
+		// clip row to the sprite's footprint: all remaining pixels are inside
+		xStart = xMin;
+		xStop = xMax;
+		composeClipLinear(inverse.xx,u0,uMin,uMax,&xStart,&xStop);
+		composeClipLinear(inverse.yx,v0,vMin,vMax,&xStart,&xStop);
+		if (xStart > xStop) continue;
+		if (runs != NULL && inverse.yx == 0) {
+			// whole row samples sprite row v0 >> 10: skip it if empty, clip it to the row's runs
+			if (runs->row[v0 >> 10] == runs->row[(v0 >> 10) + 1]) continue;
+			runFirst = &runs->run[runs->row[v0 >> 10]];
+			runLast = &runs->run[runs->row[(v0 >> 10) + 1] - 1];
+			composeClipLinear(inverse.xx,u0,runFirst->x << 10,((runLast->x + runLast->len - 1) << 10) + 1023,&xStart,&xStop);
+			if (xStart > xStop) continue;
+		}
+		
+		// sample the sprite into a run and blend it as one span
+		u = u0 + inverse.xx * xStart;
+		v = v0 + inverse.yx * xStart;
+		len = xStop - xStart + 1;
+		if (bilinear) {
+			for (x = 0; x < len; x++) {
+				surfaceSampleBilinear(sprite,&boundingBoxSprite,u - 512,v - 512,&runColour[x],&runAlpha[x]);
+				u += inverse.xx;
+				v += inverse.yx;
+			}
+		} else {
+			for (x = 0; x < len; x++) {
+				runColour[x] = sprite->rgb565[(v >> 10) * sprite->stride + (u >> 10)];
+				if (alphaRun != NULL) alphaRun[x] = sprite->alpha[(v >> 10) * sprite->stride + (u >> 10)];
+				u += inverse.xx;
+				v += inverse.yx;
 			}
-			// next pixel
-			iSurface++;
 		}
-		// skip remainder of line and beginning of next line (xMax --> width, xMin)
-		surfaceModSetRow(mask,y,bitmask);
-		iSurface += diSurface;
+		surfaceModSetRow(mask,y - offset.y,surfaceBlendSpan(runColour,alphaRun,alpha,surface,destination,xStart - offset.x,y - offset.y,len,mode));
 	}
 	
 	return bb;
 }
+
+// compose(), restricted to the pixels of the destination inside a clip box
+BoundingBox composeClip(Surface *surface, Surface *sprite, Surface *destination, Matrix matrix, uint8_t alpha, uint8_t mode, BoundingBox boundingBoxSprite, BoundingBox clip, SurfaceMod *mask) {
+	return composeRegion(surface,sprite,destination,matrix,alpha,mode,boundingBoxSprite,clip,createPoint(0,0),mask);
+}
+
+// compose() onto surfaces showing a part of a larger canvas, starting at offset
+BoundingBox composeOffset(Surface *surface, Surface *sprite, Surface *destination, Matrix matrix, uint8_t alpha, uint8_t mode, BoundingBox boundingBoxSprite, Point offset, SurfaceMod *mask) {
+	if (surface == NULL) return boundingBoxCreate(0,0,0,0);
+	return composeRegion(surface,sprite,destination,matrix,alpha,mode,boundingBoxSprite,
+		boundingBoxCreate(offset.x,offset.y,offset.x + surface->width - 1,offset.y + surface->height - 1),offset,mask);
+}
@@ -139,16 +139,68 @@ Matrix getMatrixShearY(int16_t factor);
  *    ACM New York, NY, USA, 1984; pp. 253-259.
  *    https://doi.org/10.1145%2F800031.808606
  * 
+ * Sprite coordinates are stepped incrementally along each row, and each row is
+ * clipped to the sprite's footprint beforehand. By default the nearest sprite
+ * pixel is sampled; add BLEND_FLAG_BILINEAR to mode for bilinear sampling
+ * (smoother scaling and rotation at higher cost).
+ * 
  * @param surface Pointer to a Surface.
  * @param sprite Pointer to a Surface.
  * @param destination Pointer to a Surface.
  * @param matrix 3-by-3 Transformation Matrix structure.
  * @param alpha Transparency of the sprite during composition (multiplied with the sprite's own transparency).
- * @param mode A mode as defined by BLEND_*
+ * @param mode A mode as defined by BLEND_*, optionally combined with BLEND_FLAG_BILINEAR.
  * @param boundingBoxSprite BoundingBox of the sprite are that should be displayed; use getBoundingBoxSurface(sprite) to display the entire sprite.
  * @param mask Pointer to a SurfaceMod structure where changes to the surface are recorded.
  * @returns A BoundingBox structure describing the smalles box enclosing the sprite on the surface.
  */
 BoundingBox compose(Surface *surface, Surface *sprite, Surface *destination, Matrix matrix, uint8_t alpha, uint8_t mode, BoundingBox boundingBoxSprite, SurfaceMod *mask);
 
+/** Compose a sprite with a surface like compose(), but only write destination
+ * pixels inside a clip box.
+ * 
+ * Pixels inside the clip box are the same as with compose(), so a composition
+ * can be redone region by region without seams.
+ * 
+ * @param surface Pointer to a Surface.
+ * @param sprite Pointer to a Surface.
+ * @param destination Pointer to a Surface.
+ * @param matrix 3-by-3 Transformation Matrix structure.
+ * @param alpha Transparency of the sprite during composition (multiplied with the sprite's own transparency).
+ * @param mode A mode as defined by BLEND_*, optionally combined with BLEND_FLAG_BILINEAR.
+ * @param boundingBoxSprite BoundingBox of the sprite are that should be displayed.
+ * @param clip BoundingBox of the destination area that may be written (inclusive).
+ * @param mask Pointer to a SurfaceMod structure where changes to the surface are recorded.
+ * @returns A BoundingBox structure describing the smalles box enclosing the sprite on the surface.
+ */
+BoundingBox composeClip(Surface *surface, Surface *sprite, Surface *destination, Matrix matrix, uint8_t alpha, uint8_t mode, BoundingBox boundingBoxSprite, BoundingBox clip, SurfaceMod *mask);
+
+/** Compose a sprite with a surface that shows only a part of a larger canvas.
+ * 
+ * Surface pixel (x,y) corresponds to canvas pixel (x + offset.x, y + offset.y);
+ * the matrix refers to canvas coordinates. Pixels are the same as with compose()
+ * on the whole canvas, so a canvas can be rendered band by band without seams.
+ * 
+ * @param surface Pointer to a Surface.
+ * @param sprite Pointer to a Surface.
+ * @param destination Pointer to a Surface.
+ * @param matrix 3-by-3 Transformation Matrix structure (canvas coordinates).
+ * @param alpha Transparency of the sprite during composition (multiplied with the sprite's own transparency).
+ * @param mode A mode as defined by BLEND_*, optionally combined with BLEND_FLAG_BILINEAR.
+ * @param boundingBoxSprite BoundingBox of the sprite are that should be displayed.
+ * @param offset Canvas position of the surface's top-left pixel.
+ * @param mask Pointer to a SurfaceMod structure where changes to the surface are recorded.
+ * @returns A BoundingBox structure describing the smalles box enclosing the sprite on the canvas.
+ */
+BoundingBox composeOffset(Surface *surface, Surface *sprite, Surface *destination, Matrix matrix, uint8_t alpha, uint8_t mode, BoundingBox boundingBoxSprite, Point offset, SurfaceMod *mask);
+
+/** Calculate the box enclosing all pixels compose() would write for a sprite.
+ * 
+ * @param sprite Pointer to a Surface.
+ * @param matrix 3-by-3 Transformation Matrix structure.
+ * @param boundingBoxSprite BoundingBox of the sprite area that should be displayed.
+ * @returns A BoundingBox structure (inclusive, not clipped to any surface).
+ */
+BoundingBox composeBoundingBox(Surface *sprite, Matrix matrix, BoundingBox boundingBoxSprite);
+
 #endif // _FASURFACE_H
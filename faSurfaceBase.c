@@ -1,7 +1,7 @@
 /**
  * @file
  * @author Frank Abelbeck <frank.abelbeck@googlemail.com>
- * @version 2020-02-14
+ * @version 2026-10-14
  * 
  * @section License
  * 
@@ -23,12 +23,15 @@
  * Graphics surface management routines for the card10 badge: base library
  */
 
-#include <stdlib.h> // uses: malloc(), free()
 #include <stdint.h> // uses: int8_t, uint8_t, int16_t, uint16_t, uint32_t
 #include <stdio.h>  // uses printf() for printInt() function
 #include <stdbool.h> // uses: true, false, bool
+#include <string.h> // uses: memcpy(), memmove(), memset()
 
 #include "faSurfaceBase.h"
+#include "faMemory.h" // uses: memoryAlloc(), memoryFree()
+#include "faMath.h" // uses: table-based trigonometry
+#include "faProfile.h" // uses: PROFILE_SCOPE(), PROFILE_COUNT()
 
 //------------------------------------------------------------------------------
 // surface/framebuffer constructor and destructor functions
@@ -37,102 +40,332 @@
 // Surface constructor: create and initialise an Surface structure
 Surface *surfaceConstruct() {
 	Surface *surface = NULL;
-	surface = (Surface*)malloc(sizeof(Surface));
+	surface = (Surface*)memoryAlloc(sizeof(Surface));
 	if (surface != NULL) {
 		surface->width = 0;
 		surface->height = 0;
+		surface->stride = 0;
+		surface->flags = 0;
 		surface->rgb565 = NULL;
 		surface->alpha = NULL;
+		surface->shares = NULL;
+		surface->runs = NULL;
 	}
 	return surface;
 }
 
 // Surface destructor: clear any allocated memory and deallocate structure
 void surfaceDestruct(Surface **self) {
-	free((*self)->rgb565);
-	free((*self)->alpha);
-	free(*self);
+	surfaceReleasePlanes(*self);
+	memoryFree(*self);
 	*self = NULL;
 }
 
+// release planes: free them unless they are shared or belong to a parent
+void surfaceReleasePlanes(Surface *surface) {
+	if (surface == NULL) return;
+	surfaceReleaseRuns(surface);
+	if (!(surface->flags & SURFACE_FLAG_VIEW) && (surface->shares == NULL || --(*surface->shares) == 0)) {
+		memoryFree(surface->rgb565);
+		memoryFree(surface->alpha);
+		memoryFree(surface->shares);
+	}
+	surface->width = 0;
+	surface->height = 0;
+	surface->stride = 0;
+	surface->flags = 0;
+	surface->rgb565 = NULL;
+	surface->alpha = NULL;
+	surface->shares = NULL;
+}
+
 // Surface initialiser: create structure and allocate surface memory
 Surface *surfaceSetup(uint8_t width, uint8_t height) {
+	Surface *surface = surfaceSetupOpaque(width,height);
+	if (surface == NULL) return NULL;
+	if (width > 0 && height > 0) {
+		surface->alpha = (uint8_t*)memoryAlloc(width*height);
+		if (surface->alpha == NULL) {
+			surfaceDestruct(&surface);
+			return NULL;
+		}
+	}
+	return surface;
+}
+
+// Surface initialiser: create structure and allocate colour memory only
+Surface *surfaceSetupOpaque(uint8_t width, uint8_t height) {
 	Surface *surface = surfaceConstruct();
 	if (surface == NULL) return NULL;
 	surface->width = width;
 	surface->height = height;
+	surface->stride = width;
 	if (width > 0 && height > 0) {
-		surface->rgb565 = (uint16_t*)malloc(width*height*2);
+		surface->rgb565 = (uint16_t*)memoryAlloc(width*height*2);
 		if (surface->rgb565 == NULL) {
 			surfaceDestruct(&surface);
 			return NULL;
 		}
-		surface->alpha = (uint8_t*)malloc(width*height);
-		if (surface->alpha == NULL) {
-			surfaceDestruct(&surface);
-			return NULL;
-		}
 	}
 	return surface;
 }
 
-// Surface initialiser: create structure and allocate surface memory
+// Surface initialiser: surface with alpha plane and premultiplied colours
+Surface *surfaceSetupPremultiplied(uint8_t width, uint8_t height) {
+	Surface *surface = surfaceSetup(width,height);
+	if (surface != NULL) surface->flags |= SURFACE_FLAG_PREMULTIPLIED;
+	return surface;
+}
+
+// internal helper function: copy the planes of a surface row by row into
+// contiguous planes (stride = width); alpha is skipped if NULL
+static void surfaceCopyRows(Surface *surface, uint16_t *rgb565, uint8_t *alpha) {
+	uint16_t iSource = 0;
+	uint16_t i = 0;
+	for (uint8_t y = 0; y < surface->height; y++) {
+		memcpy(&rgb565[i],&surface->rgb565[iSource],surface->width << 1);
+		if (alpha != NULL) memcpy(&alpha[i],&surface->alpha[iSource],surface->width);
+		i += surface->width;
+		iSource += surface->stride;
+	}
+}
+
+// Surface initialiser: share the planes of a surface, or copy them if that's not possible
 Surface *surfaceClone(Surface *surface) {
 	if (surface == NULL) return NULL;
-	Surface *surfaceClone = surfaceSetup(surface->width,surface->height);
+	Surface *surfaceClone;
+	if (surface->rgb565 != NULL && !(surface->flags & (SURFACE_FLAG_VIEW | SURFACE_FLAG_VIEWED))) {
+		// copy-on-write: count the surfaces sharing the planes
+		if (surface->shares == NULL) {
+			surface->shares = (uint16_t*)memoryAlloc(sizeof(uint16_t));
+			if (surface->shares != NULL) *surface->shares = 1;
+		}
+		if (surface->shares != NULL && *surface->shares < UINT16_MAX) {
+			surfaceClone = surfaceConstruct();
+			if (surfaceClone == NULL) return NULL;
+			*surfaceClone = *surface;
+			surfaceClone->runs = NULL;
+			(*surface->shares)++;
+			return surfaceClone;
+		}
+	}
+	surfaceClone = (surface->alpha == NULL) ?
+		surfaceSetupOpaque(surface->width,surface->height) :
+		surfaceSetup(surface->width,surface->height);
 	if (surfaceClone == NULL) return NULL;
-	uint16_t i = surface->width*surface->height;
-	do {
-		i--;
-		surfaceClone->rgb565[i] = surface->rgb565[i];
-		surfaceClone->alpha[i] = surface->alpha[i];
-	} while (i > 0);
+	surfaceClone->flags |= surface->flags & SURFACE_FLAG_PREMULTIPLIED;
+	if (surfaceClone->rgb565 == NULL) return surfaceClone;
+	surfaceCopyRows(surface,surfaceClone->rgb565,surfaceClone->alpha);
 	return surfaceClone;
 }
 
+// Surface initialiser: point into the planes of a parent surface
+Surface *surfaceView(Surface *parent, BoundingBox rect) {
+	if (parent == NULL || parent->rgb565 == NULL) return NULL;
+	if (rect.min.x < 0) rect.min.x = 0;
+	if (rect.min.y < 0) rect.min.y = 0;
+	if (rect.max.x >= parent->width) rect.max.x = parent->width - 1;
+	if (rect.max.y >= parent->height) rect.max.y = parent->height - 1;
+	if (rect.min.x > rect.max.x || rect.min.y > rect.max.y) return NULL;
+	// writes through the view must not reach clones of the parent;
+	// unsharing also drops the parent's run table (views are writable)
+	if (!surfaceUnshare(parent)) return NULL;
+	Surface *view = surfaceConstruct();
+	if (view == NULL) return NULL;
+	uint16_t i = rect.min.y * parent->stride + rect.min.x;
+	view->width = rect.max.x - rect.min.x + 1;
+	view->height = rect.max.y - rect.min.y + 1;
+	view->stride = parent->stride;
+	view->flags = SURFACE_FLAG_VIEW | (parent->flags & SURFACE_FLAG_PREMULTIPLIED);
+	view->rgb565 = &parent->rgb565[i];
+	view->alpha = (parent->alpha != NULL) ? &parent->alpha[i] : NULL;
+	parent->flags |= SURFACE_FLAG_VIEWED;
+	return view;
+}
+
+// copy-on-write: give a surface its own planes if they are shared
+bool surfaceUnshare(Surface *surface) {
+	if (surface->runs != NULL) surfaceReleaseRuns(surface);
+	if (surface->shares == NULL) return true;
+	if (*surface->shares > 1) {
+		uint16_t *rgb565 = (uint16_t*)memoryAlloc(surface->width*surface->height*2);
+		uint8_t  *alpha = (surface->alpha != NULL) ? (uint8_t*)memoryAlloc(surface->width*surface->height) : NULL;
+		if (rgb565 == NULL || (surface->alpha != NULL && alpha == NULL)) {
+			memoryFree(rgb565);
+			memoryFree(alpha);
+			return false;
+		}
+		surfaceCopyRows(surface,rgb565,alpha);
+		(*surface->shares)--;
+		surface->rgb565 = rgb565;
+		surface->alpha = alpha;
+		surface->stride = surface->width;
+	} else {
+		// all other clones are gone
+		memoryFree(surface->shares);
+	}
+	surface->shares = NULL;
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// premultiplied alpha
+//------------------------------------------------------------------------------
+
+// internal helper function: multiply all channels of a colour by alpha/255
+static inline uint16_t surfacePremultiplyColour(uint16_t colour, uint8_t alpha) {
+	return (uint16_t)((DIV255(GETRED(colour) * alpha) << 11) | (DIV255(GETGREEN(colour) * alpha) << 5) | DIV255(GETBLUE(colour) * alpha));
+}
+
+void surfacePremultiply(Surface *surface) {
+	if (surface == NULL || (surface->flags & SURFACE_FLAG_PREMULTIPLIED) || !surfaceUnshare(surface)) return;
+	surface->flags |= SURFACE_FLAG_PREMULTIPLIED;
+	// opaque surfaces look the same in both representations
+	if (surface->alpha == NULL) return;
+	uint16_t i = 0;
+	uint8_t x;
+	for (uint8_t y = 0; y < surface->height; y++) {
+		for (x = 0; x < surface->width; x++)
+			if (surface->alpha[i + x] != 255) surface->rgb565[i + x] = surfacePremultiplyColour(surface->rgb565[i + x],surface->alpha[i + x]);
+		i += surface->stride;
+	}
+}
+
+//------------------------------------------------------------------------------
+// run tables
+//------------------------------------------------------------------------------
+
+// internal helper function: run type of a pixel; 0 = transparent, 1 = translucent, 2 = opaque
+static inline uint8_t surfaceRunType(Surface *surface, uint16_t i) {
+	if (surface->alpha == NULL || surface->alpha[i] == 255) return 2;
+	return (surface->alpha[i] == 0) ? 0 : 1;
+}
+
+// build run table: first pass counts runs, second pass fills table and ink box;
+// structure, row index and runs share one memory block
+bool surfaceBuildRuns(Surface *surface) {
+	if (surface == NULL || surface->rgb565 == NULL) return false;
+	surfaceReleaseRuns(surface);
+	uint16_t nRuns = 0;
+	uint16_t i;
+	uint8_t  x,y,type,typePrevious;
+	for (y = 0; y < surface->height; y++) {
+		i = y * surface->stride;
+		typePrevious = 0;
+		for (x = 0; x < surface->width; x++, i++) {
+			type = surfaceRunType(surface,i);
+			if (type != 0 && type != typePrevious) nRuns++;
+			typePrevious = type;
+		}
+	}
+	
+	SurfaceRuns *runs = (SurfaceRuns*)memoryAlloc(sizeof(SurfaceRuns) + (surface->height + 1) * sizeof(uint16_t) + nRuns * sizeof(SurfaceRun));
+	if (runs == NULL) return false;
+	runs->nRuns = nRuns;
+	runs->row = (uint16_t*)(runs + 1);
+	runs->run = (SurfaceRun*)(runs->row + surface->height + 1);
+	runs->xMin = runs->yMin = 255;
+	runs->xMax = runs->yMax = 0;
+	SurfaceRun *run = NULL;
+	nRuns = 0;
+	for (y = 0; y < surface->height; y++) {
+		runs->row[y] = nRuns;
+		i = y * surface->stride;
+		typePrevious = 0;
+		for (x = 0; x < surface->width; x++, i++) {
+			type = surfaceRunType(surface,i);
+			if (type != 0) {
+				if (type != typePrevious) {
+					run = &runs->run[nRuns++];
+					run->x = x;
+					run->len = 0;
+					run->isOpaque = (type == 2);
+					if (x < runs->xMin) runs->xMin = x;
+				}
+				run->len++;
+				if (x > runs->xMax) runs->xMax = x;
+				if (y < runs->yMin) runs->yMin = y;
+				runs->yMax = y;
+			}
+			typePrevious = type;
+		}
+	}
+	runs->row[surface->height] = nRuns;
+	surface->runs = runs;
+	return true;
+}
+
+void surfaceReleaseRuns(Surface *surface) {
+	if (surface == NULL) return;
+	memoryFree(surface->runs);
+	surface->runs = NULL;
+}
+
+bool surfaceBlendSkipsTransparent(uint8_t mode) {
+	mode &= BLEND_MASK_MODE;
+	return mode == BLEND_OVER || mode == BLEND_ATOP || mode == BLEND_XOR || mode == BLEND_PLUS;
+}
+
 void surfaceClear(Surface *surface, uint16_t colour, uint8_t alpha) {
-	if (surface == NULL || surface->rgb565 == NULL || surface->alpha == NULL) return;
-	uint16_t i = surface->width*surface->height;
-	do {
-		i--;
-		surface->rgb565[i] = colour;
-		surface->alpha[i] = alpha;
-	} while (i > 0);
+	if (surface == NULL || surface->rgb565 == NULL || !surfaceUnshare(surface)) return;
+	if (surface->alpha != NULL && (surface->flags & SURFACE_FLAG_PREMULTIPLIED)) colour = surfacePremultiplyColour(colour,alpha);
+	uint16_t i = 0;
+	uint8_t x;
+	for (uint8_t y = 0; y < surface->height; y++) {
+		for (x = 0; x < surface->width; x++) surface->rgb565[i + x] = colour;
+		if (surface->alpha != NULL) memset(&surface->alpha[i],alpha,surface->width);
+		i += surface->stride;
+	}
 }
 
 void surfaceCopyMask(Surface *source, Surface *destination, SurfaceMod *mask) {
 	// sanity check: surfaces should exist and dimensions should match
 	if (source == NULL || destination == NULL || mask == NULL || source->width != destination->width || source->height != destination->height || source->height > mask->height) return;
+	// shared planes: destination already equals source
+	if (destination->rgb565 == source->rgb565 && destination->alpha == source->alpha) return;
+	if (!surfaceUnshare(destination)) return;
 	
 	uint32_t bitmask;
-	uint8_t x;
-	uint16_t i = 0;
-	for (uint8_t y = 0; y < source->height; y++) {
-		bitmask = mask->tile[y >> 3];
-		if (bitmask == 0) {
-			// empty bitmask: nothing to do for this and the next seven rows
-			i += source->width << 3;
-			y += 7;
-			continue;
-		}
-		for (x = 0; x < source->width; x++) {
-			if ((1 << (x >> 3)) & bitmask) {
-				destination->rgb565[i] = source->rgb565[i];
-				destination->alpha[i]  = source->alpha[i];
+	uint8_t xTile,nTile,y,yMax;
+	uint16_t iSource,iDestination;
+	for (uint8_t iTile = 0; iTile < (source->height + 7) >> 3; iTile++) {
+		// copy whole tile rows of eight pixels; empty bitmasks are skipped
+		bitmask = mask->tile[iTile];
+		yMax = (iTile << 3) + 8;
+		if (yMax > source->height) yMax = source->height;
+		while (bitmask != 0) {
+			xTile = __builtin_ctz(bitmask);
+			bitmask &= bitmask - 1;
+			if ((xTile << 3) >= source->width) break;
+			nTile = ((xTile << 3) + 8 > source->width) ? source->width - (xTile << 3) : 8;
+			iSource = (iTile << 3) * source->stride + (xTile << 3);
+			iDestination = (iTile << 3) * destination->stride + (xTile << 3);
+			for (y = iTile << 3; y < yMax; y++) {
+				memcpy(&destination->rgb565[iDestination],&source->rgb565[iSource],nTile << 1);
+				// opaque source: destination alpha becomes 255; opaque destination: no alpha to copy
+				if (destination->alpha != NULL) {
+					if (source->alpha != NULL) {
+						memcpy(&destination->alpha[iDestination],&source->alpha[iSource],nTile);
+					} else {
+						memset(&destination->alpha[iDestination],255,nTile);
+					}
+				}
+				iSource += source->stride;
+				iDestination += destination->stride;
 			}
-			i++;
 		}
 	}
 }
 
 void surfaceBlendPosition(Surface *source, Surface *destination, Point p, uint8_t mode, SurfaceMod *mask) {
+	PROFILE_SCOPE(PROFILE_BLEND_POSITION);
 	// sanity check: surfaces and mask should exist
 	if (source == NULL || destination == NULL || mask == NULL ) return;
+	if (source->flags & SURFACE_FLAG_PREMULTIPLIED) mode |= BLEND_FLAG_PREMULTIPLIED;
 	
 	int16_t xStartSource,yStartSource,xStartDestination,yStartDestination,width,height;
-	uint8_t x,y,xDestination;
-	uint16_t iSource,iDestination,diSource,diDestination;
-	uint32_t bitmask;
+	uint8_t y;
+	uint16_t iSource;
 	
 	// edit starting point and dimensions so that rendering starts
 	// and ends inside the visible surface area
@@ -153,7 +386,7 @@ void surfaceBlendPosition(Surface *source, Surface *destination, Point p, uint8_
 	if (p.y < 0) {
 		yStartSource = -p.y;
 		yStartDestination = 0;
-		height += p.x;
+		height += p.y;
 	} else { 
 		yStartSource = 0;
 		yStartDestination = p.y;
@@ -162,30 +395,36 @@ void surfaceBlendPosition(Surface *source, Surface *destination, Point p, uint8_
 		height = destination->height - yStartDestination;
 	}
 	
-	if (width > 0 && height > 0) {
-		// character at least partial visible: draw it
-		iSource = yStartSource * source->width + xStartSource;
-		diSource = source->width - width;
-		iDestination = yStartDestination * destination->width + xStartDestination;
-		diDestination = destination->width - width;
+	if (width > 0 && height > 0 && source->runs != NULL && source != destination && surfaceBlendSkipsTransparent(mode)) {
+		// run table: blend only the visible parts of each run; opaque runs
+		// are blended without alpha row, i.e. copied in mode over
+		const int16_t xStopSource = xStartSource + width;
+		SurfaceRun *run;
+		int16_t xRun,xRunStop;
+		uint32_t bitmask;
 		for (y = 0; y < height; y++) {
 			bitmask = 0;
-			xDestination = xStartDestination;
-			for (x = 0; x < width; x++) {
-				// blend foreground colour
-				if (surfacePixelBlend(
-						source->rgb565[iSource],source->alpha[iSource],
-						destination->rgb565[iDestination],destination->alpha[iDestination],
-						&destination->rgb565[iDestination],&destination->alpha[iDestination],
-						mode)) bitmask |= 1 << (xDestination >> 3); // pixel changed: mark in bitmask
-				iSource++;
-				iDestination++;
-				xDestination++;
+			iSource = (yStartSource + y) * source->stride;
+			for (uint16_t k = source->runs->row[yStartSource + y]; k < source->runs->row[yStartSource + y + 1]; k++) {
+				run = &source->runs->run[k];
+				xRun = (run->x < xStartSource) ? xStartSource : run->x;
+				xRunStop = (run->x + run->len > xStopSource) ? xStopSource : run->x + run->len;
+				if (xRun >= xRunStop) continue;
+				bitmask |= surfaceBlendSpan(
+					&source->rgb565[iSource + xRun],(run->isOpaque) ? NULL : &source->alpha[iSource + xRun],255,
+					destination,destination,xRun - xStartSource + xStartDestination,yStartDestination + y,xRunStop - xRun,mode);
 			}
-			surfaceModSetRow(mask,yStartDestination,bitmask);
+			surfaceModSetRow(mask,yStartDestination + y,bitmask);
+		}
+	} else if (width > 0 && height > 0) {
+		// source at least partial visible: blend it row by row
+		iSource = yStartSource * source->stride + xStartSource;
+		for (y = 0; y < height; y++) {
+			surfaceModSetRow(mask,yStartDestination,surfaceBlendSpan(
+				&source->rgb565[iSource],(source->alpha != NULL) ? &source->alpha[iSource] : NULL,255,
+				destination,destination,xStartDestination,yStartDestination,width,mode));
 			yStartDestination++;
-			iSource += diSource;
-			iDestination += diDestination;
+			iSource += source->stride;
 		}
 	}
 }
@@ -218,11 +457,11 @@ BoundingBox boundingBoxGet(Surface *surface) {
 }
 
 SurfaceMod *surfaceModConstruct(uint8_t height) {
-	SurfaceMod *mask = (SurfaceMod*)malloc(sizeof(SurfaceMod));
+	SurfaceMod *mask = (SurfaceMod*)memoryAlloc(sizeof(SurfaceMod));
 	mask->height = 0;
 	mask->tile = NULL;
 	if (height > 0) {
-		mask->tile = (uint32_t*)malloc((height >> 1) + 4); // size = 4*(height/8 + 1);
+		mask->tile = (uint32_t*)memoryAlloc((height >> 1) + 4); // size = 4*(height/8 + 1);
 		if (mask->tile != NULL) {
 			mask->height = height;
 			surfaceModClear(mask);
@@ -235,18 +474,85 @@ SurfaceMod *surfaceModConstruct(uint8_t height) {
 
 void surfaceModDestruct(SurfaceMod **mask) {
 	if (mask == NULL) return;
-	free((*mask)->tile);
-	free((*mask));
+	memoryFree((*mask)->tile);
+	memoryFree((*mask));
 	*mask = NULL;
 }
 
 /* clear mask by setting used to zero */
 void surfaceModClear(SurfaceMod *mask) {
 	if (mask == NULL) return;
-	uint8_t iMax = mask->height >> 3;
+	uint8_t iMax = (mask->height + 7) >> 3;
 	for (uint8_t i = 0; i < iMax; i++) mask->tile[i] = 0;
 }
 
+void surfaceModMerge(SurfaceMod *mask, SurfaceMod *other) {
+	if (mask == NULL || other == NULL) return;
+	uint8_t iMax = (((mask->height < other->height) ? mask->height : other->height) + 7) >> 3;
+	for (uint8_t i = 0; i < iMax; i++) mask->tile[i] |= other->tile[i];
+}
+
+uint8_t surfaceModGetRects(SurfaceMod *mask, BoundingBox *rects, uint8_t maxRects) {
+	if (mask == NULL || rects == NULL || maxRects == 0) return 0;
+	
+	uint8_t  nRects = 0;
+	uint8_t  iMax = (mask->height + 7) >> 3;
+	uint8_t  i,j,bitStart,bitCount;
+	uint32_t bitmask,run;
+	int32_t  xMin,xMax,yMin,yMax,area,areaBest;
+	BoundingBox bb;
+	
+	for (i = 0; i < iMax; i++) {
+		bitmask = mask->tile[i];
+		yMin = i << 3;
+		yMax = yMin + 7;
+		while (bitmask != 0) {
+			// extract next run of consecutive modified tiles in this tile row
+			bitStart = __builtin_ctz(bitmask);
+			run = ~(bitmask >> bitStart);
+			bitCount = (run == 0) ? 32 - bitStart : __builtin_ctz(run);
+			bitmask &= (bitCount + bitStart >= 32) ? 0 : ~0u << (bitCount + bitStart);
+			xMin = bitStart << 3;
+			xMax = ((bitStart + bitCount) << 3) - 1;
+			
+			// rectangle ending in the tile row above with identical columns: extend it
+			for (j = 0; j < nRects; j++) {
+				if (rects[j].max.y == yMin - 1 && rects[j].min.x == xMin && rects[j].max.x == xMax) {
+					rects[j].max.y = yMax;
+					break;
+				}
+			}
+			if (j < nRects) continue;
+			
+			if (nRects < maxRects) {
+				// free slot: start a new rectangle
+				rects[nRects++] = boundingBoxCreate(xMin,yMin,xMax,yMax);
+			} else {
+				// no free slot: merge with the rectangle that grows least
+				areaBest = INT32_MAX;
+				for (j = 0; j < nRects; j++) {
+					bb.min.x = (rects[j].min.x < xMin) ? rects[j].min.x : xMin;
+					bb.min.y = (rects[j].min.y < yMin) ? rects[j].min.y : yMin;
+					bb.max.x = (rects[j].max.x > xMax) ? rects[j].max.x : xMax;
+					bb.max.y = (rects[j].max.y > yMax) ? rects[j].max.y : yMax;
+					area = (bb.max.x - bb.min.x + 1) * (bb.max.y - bb.min.y + 1) - \
+						(rects[j].max.x - rects[j].min.x + 1) * (rects[j].max.y - rects[j].min.y + 1);
+					if (area < areaBest) {
+						areaBest = area;
+						bitStart = j;
+					}
+				}
+				j = bitStart;
+				if (xMin < rects[j].min.x) rects[j].min.x = xMin;
+				if (yMin < rects[j].min.y) rects[j].min.y = yMin;
+				if (xMax > rects[j].max.x) rects[j].max.x = xMax;
+				if (yMax > rects[j].max.y) rects[j].max.y = yMax;
+			}
+		}
+	}
+	return nRects;
+}
+
 void surfaceModSetSeq(SurfaceMod *mask, uint8_t x, uint8_t y, uint8_t len) {
 	if (mask == NULL || y >= mask->height || len == 0) return;
 	// new bitmask = all bits below start bit  XOR  all bits up to and including stop bit
@@ -272,25 +578,211 @@ void surfaceModSetPixel(SurfaceMod *mask, uint8_t x, uint8_t y) {
 	mask->tile[y >> 3] |= 1 << (x >> 3);
 }
 
+//------------------------------------------------------------------------------
+// palettes and indexed surfaces
+//------------------------------------------------------------------------------
+
+// Palette constructor: structure and entries in one block
+Palette *paletteConstruct(uint16_t size, bool hasAlpha) {
+	if (size == 0 || size > 256) return NULL;
+	Palette *palette = (Palette*)memoryAlloc(sizeof(Palette) + size * ((hasAlpha) ? 3 : 2));
+	if (palette == NULL) return NULL;
+	palette->size = size;
+	palette->users = 1;
+	palette->rgb565 = (uint16_t*)(palette + 1);
+	memset(palette->rgb565,0,size * 2);
+	if (hasAlpha) {
+		palette->alpha = (uint8_t*)&palette->rgb565[size];
+		memset(palette->alpha,255,size);
+	} else {
+		palette->alpha = NULL;
+	}
+	return palette;
+}
+
+// Palette destructor: drop one reference, free the block with the last one
+void paletteDestruct(Palette **self) {
+	if (*self != NULL && --(*self)->users == 0) memoryFree(*self);
+	*self = NULL;
+}
+
+Palette *paletteRetain(Palette *palette) {
+	if (palette != NULL) palette->users++;
+	return palette;
+}
+
+void paletteSetEntry(Palette *palette, uint8_t index, uint16_t colour, uint8_t alpha) {
+	if (palette == NULL || index >= palette->size) return;
+	palette->rgb565[index] = colour;
+	if (palette->alpha != NULL) palette->alpha[index] = alpha;
+}
+
+void paletteRotate(Palette *palette, uint8_t first, uint8_t last) {
+	if (palette == NULL || first == last || first >= palette->size || last >= palette->size) return;
+	uint16_t colour = palette->rgb565[last];
+	uint8_t alpha = (palette->alpha != NULL) ? palette->alpha[last] : 255;
+	if (first < last) {
+		memmove(&palette->rgb565[first + 1],&palette->rgb565[first],(last - first) * 2);
+		if (palette->alpha != NULL) memmove(&palette->alpha[first + 1],&palette->alpha[first],last - first);
+	} else {
+		memmove(&palette->rgb565[last],&palette->rgb565[last + 1],(first - last) * 2);
+		if (palette->alpha != NULL) memmove(&palette->alpha[last],&palette->alpha[last + 1],first - last);
+	}
+	palette->rgb565[first] = colour;
+	if (palette->alpha != NULL) palette->alpha[first] = alpha;
+}
+
+// SurfaceIndexed constructor: structure, cleared index plane and palette reference
+SurfaceIndexed *surfaceIndexedConstruct(uint8_t width, uint8_t height, uint8_t depth, Palette *palette) {
+	if (depth != 1 && depth != 2 && depth != 4 && depth != 8) return NULL;
+	SurfaceIndexed *surface = (SurfaceIndexed*)memoryAlloc(sizeof(SurfaceIndexed));
+	if (surface == NULL) return NULL;
+	surface->width = width;
+	surface->height = height;
+	surface->depth = depth;
+	surface->stride = (uint8_t)(((uint16_t)width * depth + 7) >> 3);
+	surface->index = NULL;
+	surface->palette = (palette != NULL) ? paletteRetain(palette) : paletteConstruct(1 << depth,false);
+	if (surface->palette == NULL) {
+		surfaceIndexedDestruct(&surface);
+		return NULL;
+	}
+	if (width > 0 && height > 0) {
+		surface->index = (uint8_t*)memoryAlloc(surface->stride * height);
+		if (surface->index == NULL) {
+			surfaceIndexedDestruct(&surface);
+			return NULL;
+		}
+		memset(surface->index,0,surface->stride * height);
+	}
+	return surface;
+}
+
+// SurfaceIndexed destructor: free index plane and structure, release the palette
+void surfaceIndexedDestruct(SurfaceIndexed **self) {
+	if (*self == NULL) return;
+	memoryFree((*self)->index);
+	paletteDestruct(&(*self)->palette);
+	memoryFree(*self);
+	*self = NULL;
+}
+
+void surfaceIndexedSetPalette(SurfaceIndexed *surface, Palette *palette) {
+	if (surface == NULL || palette == NULL || palette == surface->palette) return;
+	paletteDestruct(&surface->palette);
+	surface->palette = paletteRetain(palette);
+}
+
+uint8_t surfaceIndexedGetIndex(SurfaceIndexed *surface, uint8_t x, uint8_t y) {
+	uint16_t bit = (uint16_t)x * surface->depth;
+	return (surface->index[y * surface->stride + (bit >> 3)] >> (8 - surface->depth - (bit & 7))) & ((1 << surface->depth) - 1);
+}
+
+void surfaceIndexedSetIndex(SurfaceIndexed *surface, uint8_t x, uint8_t y, uint8_t index) {
+	if (surface == NULL || x >= surface->width || y >= surface->height) return;
+	uint16_t bit = (uint16_t)x * surface->depth;
+	uint8_t shift = 8 - surface->depth - (bit & 7);
+	uint8_t maskIndex = (1 << surface->depth) - 1;
+	uint8_t *byte = &surface->index[y * surface->stride + (bit >> 3)];
+	*byte = (*byte & ~(maskIndex << shift)) | ((index & maskIndex) << shift);
+}
+
+void surfaceIndexedLookup(SurfaceIndexed *surface, uint8_t x, uint8_t y, uint8_t len, uint16_t *rgb565, uint8_t *alpha) {
+	const Palette *palette = surface->palette;
+	const uint8_t depth = surface->depth;
+	const uint8_t maskIndex = (1 << depth) - 1;
+	uint16_t bit = (uint16_t)x * depth;
+	const uint8_t *byte = &surface->index[y * surface->stride + (bit >> 3)];
+	uint8_t shift = 8 - depth - (bit & 7);
+	uint8_t index;
+	// indices beyond the palette: black; transparent if the palette has alpha values
+	const uint8_t alphaInvalid = (palette->alpha != NULL) ? 0 : 255;
+	for (uint8_t k = 0; k < len; k++) {
+		// fetch the next index, most significant bits first
+		index = (*byte >> shift) & maskIndex;
+		if (shift == 0) {
+			byte++;
+			shift = 8 - depth;
+		} else {
+			shift -= depth;
+		}
+		if (index < palette->size) {
+			rgb565[k] = palette->rgb565[index];
+			if (alpha != NULL) alpha[k] = (palette->alpha != NULL) ? palette->alpha[index] : 255;
+		} else {
+			rgb565[k] = 0;
+			if (alpha != NULL) alpha[k] = alphaInvalid;
+		}
+	}
+}
+
+void surfaceIndexedBlend(SurfaceIndexed *source, Surface *destination, Point p, uint8_t mode, SurfaceMod *mask) {
+	// sanity check: surfaces and mask should exist
+	if (source == NULL || destination == NULL || mask == NULL) return;
+	
+	int16_t xStartSource,yStartSource,xStartDestination,yStartDestination,width,height;
+	uint16_t rgb565[256];
+	uint8_t  alpha[256];
+	
+	// clip to the destination as surfaceBlendPosition() does
+	width = source->width;
+	if (p.x < 0) {
+		xStartSource = -p.x;
+		xStartDestination = 0;
+		width += p.x;
+	} else {
+		xStartSource = 0;
+		xStartDestination = p.x;
+	}
+	if (xStartDestination + width > destination->width) {
+		width = destination->width - xStartDestination;
+	}
+	
+	height = source->height;
+	if (p.y < 0) {
+		yStartSource = -p.y;
+		yStartDestination = 0;
+		height += p.y;
+	} else {
+		yStartSource = 0;
+		yStartDestination = p.y;
+	}
+	if (yStartDestination + height > destination->height) {
+		height = destination->height - yStartDestination;
+	}
+	if (width <= 0 || height <= 0) return;
+	
+	// palette lookup into a row buffer, then blending like any other span
+	const bool opaque = (source->palette->alpha == NULL);
+	for (uint8_t y = 0; y < height; y++) {
+		surfaceIndexedLookup(source,xStartSource,yStartSource + y,width,rgb565,(opaque) ? NULL : alpha);
+		surfaceModSetRow(mask,yStartDestination + y,surfaceBlendSpan(
+			rgb565,(opaque) ? NULL : alpha,255,
+			destination,destination,xStartDestination,yStartDestination + y,width,mode));
+	}
+}
+
+Surface *surfaceIndexedExpand(SurfaceIndexed *surface) {
+	if (surface == NULL) return NULL;
+	Surface *expanded = (surface->palette->alpha != NULL) ? surfaceSetup(surface->width,surface->height) : surfaceSetupOpaque(surface->width,surface->height);
+	if (expanded == NULL || surface->width == 0) return expanded;
+	for (uint8_t y = 0; y < surface->height; y++)
+		surfaceIndexedLookup(surface,0,y,surface->width,&expanded->rgb565[y * expanded->stride],(expanded->alpha != NULL) ? &expanded->alpha[y * expanded->stride] : NULL);
+	return expanded;
+}
+
 //------------------------------------------------------------------------------
 // drawing routines for geometric primitives
 //------------------------------------------------------------------------------
 
 BoundingBox surfaceDrawPoint(Surface *surface, Point p, uint16_t colour, uint8_t alpha, uint8_t mode, SurfaceMod *mask) {
+	PROFILE_SCOPE(PROFILE_DRAW_POINT);
 	BoundingBox bb = boundingBoxCreate(0,0,0,0);
 	if (surface == NULL || mask == NULL) return bb;
 	
 	if (p.x >= 0 && p.x < surface->width && p.y >= 0 && p.y < surface->height) {
-		// pixel visible, draw it
-		uint32_t i = p.y * surface->width + p.x;
-		if (surfacePixelBlend(
-			colour,alpha,
-			surface->rgb565[i],surface->alpha[i],
-			&surface->rgb565[i],&surface->alpha[i],
-			mode)) {
-			// blending changed the surface pixel; add single pixel entry
-			surfaceModSetPixel(mask,p.x,p.y);
-		}
+		// pixel visible, draw it as span of length one
+		surfaceModSetRow(mask,p.y,surfaceBlendSpanColour(surface,p.x,p.y,1,colour,alpha,mode));
 		bb.min = p;
 		bb.max = p;
 	}
@@ -298,7 +790,25 @@ BoundingBox surfaceDrawPoint(Surface *surface, Point p, uint16_t colour, uint8_t
 }
 
 
+// internal helper function: blend a horizontal span from x0 to x1 (inclusive)
+// in row y; clips the span to the surface area and records changes in mask
+static void surfaceDrawSpan(Surface *surface, int32_t x0, int32_t x1, int32_t y, uint16_t colour, uint8_t alpha, uint8_t mode, SurfaceMod *mask) {
+	int32_t x;
+	if (y < 0 || y >= surface->height) return;
+	if (x0 > x1) {
+		x = x0;
+		x0 = x1;
+		x1 = x;
+	}
+	if (x0 < 0) x0 = 0;
+	if (x1 >= surface->width) x1 = surface->width - 1;
+	if (x0 > x1) return;
+	surfaceModSetRow(mask,y,surfaceBlendSpanColour(surface,x0,y,x1-x0+1,colour,alpha,mode));
+}
+
+
 BoundingBox surfaceDrawLine(Surface *surface, Point p0, Point p1, uint16_t colour, uint8_t alpha, uint8_t mode, SurfaceMod *mask)  {
+	PROFILE_SCOPE(PROFILE_DRAW_LINE);
 	BoundingBox bb = boundingBoxCreate(0,0,0,0);
 	// simple implementation of the Bresenham line algorithm; first check validity of surface
 	if (surface == NULL || mask == NULL) return bb;
@@ -334,27 +844,19 @@ BoundingBox surfaceDrawLine(Surface *surface, Point p0, Point p1, uint16_t colou
 	
 	// setup error variables
 	int16_t error  = xDiff+yDiff;
-	int16_t error2, i;
-	uint32_t bitmask = 0;
+	int16_t error2;
+	int32_t xRun,xPrevious;
 	
-	// use x0,y0 as running coordinate pair, calculate new coordinates as long as p1.x,p1.y is not reached
+	// use x0,y0 as running coordinate pair, calculate new coordinates as long as p1.x,p1.y is not reached;
+	// pixels in the same row are collected as horizontal run and blended as one span
+	xRun = p0.x;
 	while (1) {
-		if (p0.x >= 0 && p0.x < surface->width && p0.y >= 0 && p0.y < surface->height) {
-			// pixel visible: calculate new index and record in mask if blending modified the surface
-			i = p0.y * surface->width + p0.x;	
-			if (surfacePixelBlend(
-				colour,alpha,
-				surface->rgb565[i],surface->alpha[i],
-				&surface->rgb565[i],&surface->alpha[i],
-				mode)
-			) bitmask |= 1 << (p0.x >> 3);
-		}
-		
 		if (p0.x == p1.x && p0.y == p1.y) {
-			surfaceModSetRow(mask,p0.y,bitmask); // prior to exit, set last bitmask
+			surfaceDrawSpan(surface,xRun,p0.x,p0.y,colour,alpha,mode,mask); // prior to exit, draw last run
 			break; // end is reached, let loop terminate
 		}
 		// update error term
+		xPrevious = p0.x;
 		error2 = error + error;
 		if (error2 > yDiff) {
 			// error inside yDiff bounds: step in x direction, update error term
@@ -362,11 +864,11 @@ BoundingBox surfaceDrawLine(Surface *surface, Point p0, Point p1, uint16_t colou
 			p0.x += xStep;
 		}
 		if (error2 < xDiff) {
-			surfaceModSetRow(mask,p0.y,bitmask);
-			bitmask = 0;
-			// error inside xDiff bounds: step in y direction, update error term
+			// error inside xDiff bounds: draw current run, step in y direction, update error term
+			surfaceDrawSpan(surface,xRun,xPrevious,p0.y,colour,alpha,mode,mask);
 			error += xDiff;
 			p0.y += yStep;
+			xRun = p0.x;
 		}
 	}
 	
@@ -374,477 +876,235 @@ BoundingBox surfaceDrawLine(Surface *surface, Point p0, Point p1, uint16_t colou
 }
 
 
-BoundingBox surfaceDrawCircle(Surface *surface, Point pm, uint16_t radius, uint16_t colour, uint8_t alpha, uint8_t mode, SurfaceMod *mask) {
-	BoundingBox bb = boundingBoxCreate(0,0,0,0);
-	// Bresenham-like algorithm, running from (x,y+radius) along the circle until (x==y)
-	// this is the octant 1 in the following ascii art (screen coordinates),
-	// running counter-clockwise from 90° to 45°
-	//
-	//   .  |  .
-	//    .5|6.
-	//   4 .|. 7
-	//  ----+---->
-	//   3 .|. 0
-	//    .2|1.
-	//   .  |  .
-	//      V
-	// every other octant can be reached using the circle's symmetry
-	if (surface == NULL || radius == 0) return bb;
+// internal helper functions for circular primitives: the shape is processed
+// row by row; per row, the midpoint circle criterion x*x + y*y <= r*r + r
+// yields the extent of a disc, and start/stop angles are converted into span
+// limits, so that each row boils down to at most four span blend operations
+
+#define SURFACE_ROW_INF 0x3fffffff // placeholder for an unlimited span end
+
+// floor/ceiling integer division for arbitrary signs
+static inline int32_t surfaceDivFloor(int32_t n, int32_t d) {
+	int32_t q = n / d;
+	if ((n % d != 0) && ((n < 0) != (d < 0))) q--;
+	return q;
+}
+
+static inline int32_t surfaceDivCeil(int32_t n, int32_t d) {
+	return -surfaceDivFloor(-n,d);
+}
+
+// return the largest x with x*x + y*y <= limit or -1 if there is none;
+// x is the result for a neighbouring row, so only few steps are needed
+static inline int32_t surfaceCircleExtent(int32_t x, int32_t y, int64_t limit) {
+	int64_t y2 = (int64_t)y * y;
+	while ((int64_t)(x + 1) * (x + 1) + y2 <= limit) x++;
+	while (x >= 0 && (int64_t)x * x + y2 > limit) x--;
+	return x;
+}
+
+// row interval of all x with s*(2x+1) <= k, i.e. the part of a row on or left
+// of a ray with direction (c,s) and k = c*(2y+1); the ray starts half a pixel
+// up-left of the centre, so that no pixel is hit by the apex itself
+static void surfaceRayRow(int32_t k, int32_t s, int32_t *xMin, int32_t *xMax) {
+	if (s > 0) {
+		*xMin = -SURFACE_ROW_INF;
+		*xMax = surfaceDivFloor(surfaceDivFloor(k,s) - 1,2);
+	} else if (s < 0) {
+		*xMin = surfaceDivCeil(surfaceDivCeil(k,s) - 1,2);
+		*xMax = SURFACE_ROW_INF;
+	} else if (k >= 0) {
+		*xMin = -SURFACE_ROW_INF;
+		*xMax = SURFACE_ROW_INF;
+	} else {
+		*xMin = SURFACE_ROW_INF;
+		*xMax = -SURFACE_ROW_INF;
+	}
+}
+
+// complement of a row interval returned by surfaceRayRow()
+static void surfaceRayRowInvert(int32_t *xMin, int32_t *xMax) {
+	if (*xMin > *xMax) {
+		*xMin = -SURFACE_ROW_INF;
+		*xMax = SURFACE_ROW_INF;
+	} else if (*xMin == -SURFACE_ROW_INF && *xMax == SURFACE_ROW_INF) {
+		*xMin = SURFACE_ROW_INF;
+		*xMax = -SURFACE_ROW_INF;
+	} else if (*xMin == -SURFACE_ROW_INF) {
+		*xMin = *xMax + 1;
+		*xMax = SURFACE_ROW_INF;
+	} else {
+		*xMax = *xMin - 1;
+		*xMin = -SURFACE_ROW_INF;
+	}
+}
+
+// bounding box of a ring sector: angle end points on both radii (the inner
+// ones collapse to the centre for pie slices) and the outer circle's extreme
+// points passed; enlarged by one pixel to account for rounding, but not beyond
+// the circle
+static BoundingBox surfaceSectorBox(Point pm, uint16_t radiusOuter, uint16_t radiusInner, int16_t angleStart, int16_t angleSweep) {
+	int16_t angleStop = (angleStart + angleSweep) % 360;
+	int32_t x[8],y[8];
+	uint8_t i,n = 4;
+	int16_t sStart,cStart,sStop,cStop;
+	mathSineCosine(angleStart,&sStart,&cStart);
+	mathSineCosine(angleStop,&sStop,&cStop);
+	x[0] = radiusOuter * cStart / MATH_ONE; y[0] = radiusOuter * sStart / MATH_ONE;
+	x[1] = radiusOuter * cStop  / MATH_ONE; y[1] = radiusOuter * sStop  / MATH_ONE;
+	x[2] = radiusInner * cStart / MATH_ONE; y[2] = radiusInner * sStart / MATH_ONE;
+	x[3] = radiusInner * cStop  / MATH_ONE; y[3] = radiusInner * sStop  / MATH_ONE;
+	// axis directions 0°, 90°, 180° and 270° passed by the sector
+	if ((360 - angleStart) % 360 <= angleSweep) { x[n] =  radiusOuter; y[n++] = 0; }
+	if ((450 - angleStart) % 360 <= angleSweep) { x[n] = 0; y[n++] =  radiusOuter; }
+	if ((540 - angleStart) % 360 <= angleSweep) { x[n] = -radiusOuter; y[n++] = 0; }
+	if ((630 - angleStart) % 360 <= angleSweep) { x[n] = 0; y[n++] = -radiusOuter; }
 	
-	int16_t error = 1 - radius;
-	int16_t ddE_x = 0;
-	int16_t ddE_y = -2 * radius;
-	uint32_t i;
-	Point p, pTemp;
+	BoundingBox bb = boundingBoxCreate(x[0],y[0],x[0],y[0]);
+	for (i = 1; i < n; i++) {
+		if (x[i] < bb.min.x) bb.min.x = x[i];
+		if (x[i] > bb.max.x) bb.max.x = x[i];
+		if (y[i] < bb.min.y) bb.min.y = y[i];
+		if (y[i] > bb.max.y) bb.max.y = y[i];
+	}
+	bb.min.x = (bb.min.x <= -radiusOuter) ? pm.x - radiusOuter : pm.x + bb.min.x - 1;
+	bb.min.y = (bb.min.y <= -radiusOuter) ? pm.y - radiusOuter : pm.y + bb.min.y - 1;
+	bb.max.x = (bb.max.x >=  radiusOuter) ? pm.x + radiusOuter : pm.x + bb.max.x + 1;
+	bb.max.y = (bb.max.y >=  radiusOuter) ? pm.y + radiusOuter : pm.y + bb.max.y + 1;
+	return bb;
+}
+
+// draw the part of a circle, a disc or a ring between two angles as spans
+// - isOutline: draw a one pixel wide circle of radiusOuter (radiusInner unused)
+// - otherwise: fill all pixels of disc radiusOuter outside of disc radiusInner-1
+// - angleStart, angleSweep: covered angle range [angleStart,angleStart+angleSweep[,
+//   angleStart in 0..359, angleSweep in 1..359; angleSweep 0 means full circle
+// - bb: bounding box of the shape, limits the rows to process
+static void surfaceDrawCircular(Surface *surface, Point pm, uint16_t radiusOuter, uint16_t radiusInner, bool isOutline, int16_t angleStart, int16_t angleSweep, BoundingBox bb, uint16_t colour, uint8_t alpha, uint8_t mode, SurfaceMod *mask) {
+	PROFILE_SCOPE(PROFILE_DRAW_CIRCULAR);
+	int32_t yMin = (bb.min.y < 0) ? 0 : bb.min.y;
+	int32_t yMax = (bb.max.y >= surface->height) ? surface->height - 1 : bb.max.y;
+	int64_t limitOuter = (int64_t)radiusOuter * radiusOuter + radiusOuter;
+	int64_t limitInner = (radiusInner > 0) ? (int64_t)(radiusInner - 1) * (radiusInner - 1) + radiusInner - 1 : -1;
 	
-	bb.min.x = pm.x - radius;
-	bb.max.x = pm.x + radius;
-	bb.min.y = pm.y - radius;
-	bb.max.y = pm.y + radius;
+	// ray directions of start and stop angle
+	int16_t sStart,cStart,sStop,cStop;
+	mathSineCosine(angleStart,&sStart,&cStart);
+	mathSineCosine(angleStart + angleSweep,&sStop,&cStop);
 	
-	p.x = 0;
-	p.y = radius;
-	do {
-		pTemp.y = pm.y + p.y;
-		if (pTemp.y >= 0 && pTemp.y < surface->height) {
-			pTemp.x = pm.x + p.x;
-			if (pTemp.x >= 0 && pTemp.x < surface->width) {
-				// set pixel in octant 1 (x+xMod,y+yMod)
-				// drawing direction: from 90° to 45°
-				i = pTemp.y * surface->width + pTemp.x;
-				if (surfacePixelBlend(
-					colour,alpha,
-					surface->rgb565[i],surface->alpha[i],
-					&surface->rgb565[i],&surface->alpha[i],
-					mode)) surfaceModSetPixel(mask,pTemp.x,pTemp.y);
-			}
-			pTemp.x = pm.x - p.x;
-			if (pTemp.x >= 0 && pTemp.x < surface->width) {
-				// set pixel in octant 2 (x-xMod,y+yMod)
-				// drawing direction: from 90° to 135°
-				i = pTemp.y * surface->width + pTemp.x;
-				if (surfacePixelBlend(
-					colour,alpha,
-					surface->rgb565[i],surface->alpha[i],
-					&surface->rgb565[i],&surface->alpha[i],
-					mode)) surfaceModSetPixel(mask,pTemp.x,pTemp.y);
-			}
-		}
+	int32_t xOuter = 0, xNext = 0, xInner = 0, xExcl;
+	int32_t ring[4],wedge[4],xStart,xStop,x0,x1,dy,k;
+	uint8_t nRing,nWedge,i,j;
+	for (int32_t y = yMin; y <= yMax; y++) {
+		dy = (y > pm.y) ? y - pm.y : pm.y - y;
+		xOuter = surfaceCircleExtent(xOuter,dy,limitOuter);
 		
-		pTemp.y = pm.y - p.y;
-		if (pTemp.y >= 0 && pTemp.y < surface->height) {
-			pTemp.x = pm.x + p.x;
-			if (pTemp.y >= 0 && pTemp.y < surface->height) {
-				// set pixel in octant 6 (x+xMod,y-yMod)
-				// drawing direction: from 270° to 315°
-				i = pTemp.y * surface->width + pTemp.x;
-				if (surfacePixelBlend(
-					colour,alpha,
-					surface->rgb565[i],surface->alpha[i],
-					&surface->rgb565[i],&surface->alpha[i],
-					mode)) surfaceModSetPixel(mask,pTemp.x,pTemp.y);
-			}
-			pTemp.x = pm.x - p.x;
-			if (pTemp.y >= 0 && pTemp.y < surface->height) {
-				// set pixel in octant 5 (x-xMod,y-yMod)
-				// drawing direction: from 270° to 225°
-				i = pTemp.y * surface->width + pTemp.x;
-				if (surfacePixelBlend(
-					colour,alpha,
-					surface->rgb565[i],surface->alpha[i],
-					&surface->rgb565[i],&surface->alpha[i],
-					mode)) surfaceModSetPixel(mask,pTemp.x,pTemp.y);
-			}
+		// pixels |x| <= xExcl are excluded: the inner disc or,
+		// for outlines, everything covered by the next row outwards
+		if (isOutline) {
+			xNext = surfaceCircleExtent(xNext,dy + 1,limitOuter);
+			xExcl = (xNext < xOuter) ? xNext : xOuter - 1;
+		} else {
+			xInner = surfaceCircleExtent(xInner,dy,limitInner);
+			xExcl = xInner;
 		}
-		
-		pTemp.y = pm.y + p.x;
-		if (pTemp.y >= 0 && pTemp.y < surface->height) {
-			pTemp.x = pm.x + p.y;
-			if (pTemp.y >= 0 && pTemp.y < surface->height) {
-				// set pixel in octant 0 (x+yMod,y+xMod)
-				// drawing direction: from 0° to 45°
-				i = pTemp.y * surface->width + pTemp.x;
-				if (surfacePixelBlend(
-					colour,alpha,
-					surface->rgb565[i],surface->alpha[i],
-					&surface->rgb565[i],&surface->alpha[i],
-					mode)) surfaceModSetPixel(mask,pTemp.x,pTemp.y);
-			}
-			pTemp.x = pm.x - p.y;
-			if (pTemp.y >= 0 && pTemp.y < surface->height) {
-				// set pixel in octant 3 (x-yMod,y+xMod)
-				// drawing direction: from 180° to 135°
-				i = pTemp.y * surface->width + pTemp.x;
-				if (surfacePixelBlend(
-					colour,alpha,
-					surface->rgb565[i],surface->alpha[i],
-					&surface->rgb565[i],&surface->alpha[i],
-					mode)) surfaceModSetPixel(mask,pTemp.x,pTemp.y);
-			}
+		if (xExcl < 0) {
+			ring[0] = -xOuter; ring[1] = xOuter;
+			nRing = 1;
+		} else {
+			ring[0] = -xOuter; ring[1] = -xExcl - 1;
+			ring[2] = xExcl + 1; ring[3] = xOuter;
+			nRing = 2;
 		}
 		
-		pTemp.y = pm.y - p.x;
-		if (pTemp.y >= 0 && pTemp.y < surface->height) {
-			pTemp.x = pm.x + p.y;
-			if (pTemp.y >= 0 && pTemp.y < surface->height) {
-				// set pixel in octant 7 (x+yMod,y-xMod)
-				// drawing direction: from 360° to 315°
-				i = pTemp.y * surface->width + pTemp.x;
-				if (surfacePixelBlend(
-					colour,alpha,
-					surface->rgb565[i],surface->alpha[i],
-					&surface->rgb565[i],&surface->alpha[i],
-					mode)) surfaceModSetPixel(mask,pTemp.x,pTemp.y);
+		// span limits of the angle range: intersection of the half-planes of
+		// both rays for sweeps less than 180°, otherwise their union
+		nWedge = 1;
+		if (angleSweep == 0) {
+			wedge[0] = -SURFACE_ROW_INF; wedge[1] = SURFACE_ROW_INF;
+		} else if (angleSweep == 180) {
+			// half-plane of the start ray; a pixel exactly on the dividing
+			// line only belongs to it if it lies on the start ray's side
+			k = cStart * (2 * (y - pm.y) + 1);
+			surfaceRayRow(k,sStart,&wedge[0],&wedge[1]);
+			if (sStart != 0 && k % sStart == 0 && ((k / sStart) & 1) && cStart * (k / sStart) + sStart * (2 * (y - pm.y) + 1) < 0) {
+				if (sStart > 0) wedge[1]--; else wedge[0]++;
 			}
-			pTemp.x = pm.x - p.y;
-			if (pTemp.y >= 0 && pTemp.y < surface->height) {
-				// set pixel in octant 4 (x-yMod,y-xMod)
-				// drawing direction: from 180° to 225°
-				i = pTemp.y * surface->width + pTemp.x;
-				if (surfacePixelBlend(
-					colour,alpha,
-					surface->rgb565[i],surface->alpha[i],
-					&surface->rgb565[i],&surface->alpha[i],
-					mode)) surfaceModSetPixel(mask,pTemp.x,pTemp.y);
+		} else {
+			k = 2 * (y - pm.y) + 1;
+			surfaceRayRow(cStart * k,sStart,&wedge[0],&wedge[1]);
+			surfaceRayRow(cStop * k,sStop,&wedge[2],&wedge[3]);
+			surfaceRayRowInvert(&wedge[2],&wedge[3]);
+			if (angleSweep < 180) {
+				if (wedge[2] > wedge[0]) wedge[0] = wedge[2];
+				if (wedge[3] < wedge[1]) wedge[1] = wedge[3];
+			} else if (wedge[0] > wedge[1]) {
+				wedge[0] = wedge[2]; wedge[1] = wedge[3];
+			} else if (wedge[2] <= wedge[3]) {
+				if (wedge[0] <= wedge[3] + 1 && wedge[2] <= wedge[1] + 1) {
+					if (wedge[2] < wedge[0]) wedge[0] = wedge[2];
+					if (wedge[3] > wedge[1]) wedge[1] = wedge[3];
+				} else {
+					nWedge = 2;
+				}
 			}
 		}
 		
-		// update error term to check which axis needs stepping
-		if (error >= 0) {
-			// error term positive:
-			// also reduce running y var (going von radius to 0) and updat error term
-			p.y--;
-			ddE_y += 2;
-			error += ddE_y;
+		// blend intersections of ring and angle range spans
+		for (i = 0; i < nRing; i++) {
+			for (j = 0; j < nWedge; j++) {
+				xStart = (ring[2*i] > wedge[2*j]) ? ring[2*i] : wedge[2*j];
+				xStop = (ring[2*i+1] < wedge[2*j+1]) ? ring[2*i+1] : wedge[2*j+1];
+				if (xStart > xStop) continue;
+				x0 = pm.x + xStart;
+				x1 = pm.x + xStop;
+				if (x1 < 0 || x0 >= surface->width) continue;
+				surfaceDrawSpan(surface,x0,x1,y,colour,alpha,mode,mask);
+			}
 		}
-		// increase x var and update error term
-		p.x++;
-		ddE_x += 2;
-		error += ddE_x + 1;
-	} while (p.x < p.y);
-	
+	}
+}
+
+// limit angles to 0..359 and return the sweep from start to stop
+static int16_t surfaceAngleSweep(int16_t *angleStart, int16_t angleStop) {
+	*angleStart = (360 + (*angleStart % 360)) % 360;
+	angleStop = (360 + (angleStop % 360)) % 360;
+	return (360 + angleStop - *angleStart) % 360;
+}
+
+BoundingBox surfaceDrawCircle(Surface *surface, Point pm, uint16_t radius, uint16_t colour, uint8_t alpha, uint8_t mode, SurfaceMod *mask) {
+	BoundingBox bb = boundingBoxCreate(0,0,0,0);
+	if (surface == NULL || radius == 0) return bb;
+	bb = boundingBoxCreate(pm.x - radius,pm.y - radius,pm.x + radius,pm.y + radius);
+	surfaceDrawCircular(surface,pm,radius,0,true,0,0,bb,colour,alpha,mode,mask);
 	return bb;
 }
 
 BoundingBox surfaceDrawDisc(Surface *surface, Point pm, uint16_t radius, uint16_t colour, uint8_t alpha, uint8_t mode, SurfaceMod *mask) {
 	BoundingBox bb = boundingBoxCreate(0,0,0,0);
-	// uses same Bresenham-like algorithm as used in surfaceDrawCircle,
-	// but draws horizontal lines inbetween, i.e. between edge pixels in
-	// sectors 5+6, 4+7, 3+8, 2+1 (see diagram):
-	//
-	//   .  |  .
-	//    .5|6.
-	//   4 .|. 7
-	//  ----+---->
-	//   3 .|. 0
-	//    .2|1.
-	//   .  |  .
-	//      V
-	//
-	// TODO: the approach below is not effective:
-	//  - only draw line if y switches
-	//  - otherwise record xStart and xEnd for each of the possible four scanlines
-	//
-	if (surface == NULL || radius == 0) return bb;
-	
-	int16_t  error = 1 - radius;
-	int16_t  ddE_x = 0;
-	int16_t  ddE_y = -2 * radius;
-	uint16_t i,iMax;
-	Point    p;
-	int16_t  xStart,xEnd;
-	int16_t  y;
-	uint32_t bitmask;
-	
-	bb.min.x = pm.x - radius;
-	bb.max.x = pm.x + radius;
-	bb.min.y = pm.y - radius;
-	bb.max.y = pm.y + radius;
-	
-	p.x = 0;
-	p.y = radius;
-	
-	do {
-		// update error term to check which axis needs stepping
-		if (error >= 0) {
-			// error term positive: y stepping imminent
-			// process horizontal lines 1 and 2 first
-			// #1: (pm.x-p.x, pm.y-p.y) --> (pm.x+p.x, pm.y-p.y)
-			// #2: (pm.x-p.x, pm.y+p.y) --> (pm.x+p.x, pm.y+p.y)
-			xStart = pm.x - p.x;
-			if (xStart < 0) xStart = 0;
-			xEnd = pm.x + p.x;
-			if (xEnd >= surface->width) xEnd = surface->width - 1;
-			y = pm.x - p.y;
-			if (y >= 0 && y < surface->height && xStart < surface->width && xEnd >= 0) {
-				i = y * surface->width;
-				iMax = i + xEnd;
-				bitmask = 0;
-				for (i += xStart; i <= iMax; i++) {
-					if (surfacePixelBlend(
-						colour,alpha,
-						surface->rgb565[i],surface->alpha[i],
-						&surface->rgb565[i],&surface->alpha[i],
-						mode)) bitmask |= 1 << (xStart >> 3);
-					xStart++;
-				}
-				surfaceModSetRow(mask,y,bitmask);
-			}
-			y = pm.x + p.y;
-			if (y >= 0 && y < surface->height && xStart < surface->width && xEnd >= 0) {
-				i = y * surface->width;
-				iMax = i + xEnd;
-				bitmask = 0;
-				for (i += xStart; i <= iMax; i++) {
-					if (surfacePixelBlend(
-						colour,alpha,
-						surface->rgb565[i],surface->alpha[i],
-						&surface->rgb565[i],&surface->alpha[i],
-						mode)) bitmask |= 1 << (xStart >> 3);
-					xStart++;
-				}
-				surfaceModSetRow(mask,y,bitmask);
-			}
-			// also reduce running y var (going von radius to 0) and update error term
-			p.y--;
-			ddE_y += 2;
-			error += ddE_y;
-		}
-		
-		// x stepping imminent: process horizontal lines 3 and 4
-		// #3: (pm.x-p.y, pm.y-p.x) --> (pm.x+p.y, pm.y-p.x)
-		// #4: (pm.x-p.y, pm.y+p.x) --> (pm.x+p.y, pm.y+p.x)
-		xStart = pm.x - p.y;
-		if (xStart < 0) xStart = 0;
-		xEnd = pm.x + p.y;
-		if (xEnd >= surface->width) xEnd = surface->width - 1;
-		y = pm.x - p.x;
-		if (y >= 0 && y < surface->height && xStart < surface->width && xEnd >= 0) {
-			i = y * surface->width;
-			iMax = i + xEnd;
-			bitmask = 0;
-			for (i += xStart; i <= iMax; i++) {
-				if (surfacePixelBlend(
-					colour,alpha,
-					surface->rgb565[i],surface->alpha[i],
-					&surface->rgb565[i],&surface->alpha[i],
-					mode)) bitmask |= 1 << (xStart >> 3);
-				xStart++;
-			}
-			surfaceModSetRow(mask,y,bitmask);
-		}
-		y = pm.x + p.x;
-		if (y >= 0 && y < surface->height && xStart < surface->width && xEnd >= 0) {
-			i = y * surface->width;
-			iMax = i + xEnd;
-			bitmask = 0;
-			for (i += xStart; i <= iMax; i++) {
-				if (surfacePixelBlend(
-					colour,alpha,
-					surface->rgb565[i],surface->alpha[i],
-					&surface->rgb565[i],&surface->alpha[i],
-					mode)) bitmask |= 1 << (xStart >> 3);
-				xStart++;
-			}
-			surfaceModSetRow(mask,y,bitmask);
-		}
-		
-		// increase x var and update error term
-		p.x++;
-		ddE_x += 2;
-		error += ddE_x + 1;
-	} while (p.x < p.y);
-	
+	if (surface == NULL || mask == NULL || radius == 0) return bb;
+	bb = boundingBoxCreate(pm.x - radius,pm.y - radius,pm.x + radius,pm.y + radius);
+	surfaceDrawCircular(surface,pm,radius,0,false,0,0,bb,colour,alpha,mode,mask);
 	return bb;
 }
 
 BoundingBox surfaceDrawArc(Surface *surface, Point pm, uint16_t radius, int16_t angleStart, int16_t angleStop, uint16_t colour, uint8_t alpha, uint8_t mode, SurfaceMod *mask) {
 	BoundingBox bb = boundingBoxCreate(0,0,0,0);
-	// Bresenham-like algorithm, running from (x,y+radius) along the circle until (x==y)
-	// this is the octant 1 in the following ascii art (screen coordinates),
-	// running counter-clockwise from 90° to 45°
-	//
-	//   .  |  .
-	//    .5|6.
-	//   4 .|. 7
-	//  ----+---->
-	//   3 .|. 0
-	//    .2|1.
-	//   .  |  .
-	//      V
-	// every other octant can be reached using the circle's symmetry
 	if (surface == NULL || radius == 0) return bb;
-	
-	int16_t error = 1 - radius;
-	int16_t ddE_x = 0;
-	int16_t ddE_y = -2 * radius;
-	uint32_t i;
-	int16_t xStart,xStop,yStart,yStop;
-	Point p, pTemp;
-	
-	p.x = 0;
-	p.y = radius;
-	
-	// Since this function should draw partial circles, we have to pre-calculate
-	// the start and stop coordinates
-	// limit angles to 0..359
-	angleStart = (360 + (angleStart % 360)) % 360;
-	angleStop = (360 + (angleStop % 360)) % 360;
-	
-	xStart = radius * surfaceCosine(angleStart) / 1024;
-	yStart = radius * surfaceSine(angleStart) / 1024;
-	xStop  = radius * surfaceCosine(angleStop)  / 1024;
-	yStop  = radius * surfaceSine(angleStop)  / 1024;
-	
-	
-	// --- TODO: modify circle bounding box to arc ---
-	
-	bb.min.x = pm.x - radius;
-	bb.max.x = pm.x + radius;
-	bb.min.y = pm.y - radius;
-	bb.max.y = pm.y + radius;
-	
-	// --- TODO: modify circle bounding box to arc ---
-	
-	// setup a bitmask for all octants and -- depending on angles -- set bits for octants that need processing
-	uint8_t octantStart = angleStart/45;
-	uint8_t octantStop = angleStop/45;
-	uint8_t octants = 0;
-	if (octantStop >= octantStart) {
-		octants = ((1 << (octantStop-octantStart+1))-1) << octantStart;
-	} else {
-		octants = ~(((1 << (octantStart-octantStop-1))-1) << (octantStop+1));
-	}
-	
-	do {
-		// paint pixel for all octants (use symmetry)
-		
-		pTemp.x = pm.x + p.x;
-		if (pTemp.x >= 0 && pTemp.x < surface->width) {
-			pTemp.y = pm.y + p.y;
-			// set pixel in octant 1 (x+xMod,y+yMod)
-			// drawing direction: from 90° to 45°
-			if (octants & 2 && pTemp.y >= 0 && pTemp.y < surface->height && \
-				(octantStart != 1 || p.x <= xStart) && (octantStop != 1 || p.x >= xStop) ) {
-				i = pTemp.y * surface->width + pTemp.x;
-				if (surfacePixelBlend(
-					colour,alpha,
-					surface->rgb565[i],surface->alpha[i],
-					&surface->rgb565[i],&surface->alpha[i],
-					mode)) surfaceModSetPixel(mask,pTemp.x,pTemp.y);
-			}
-			pTemp.y = pm.y - p.y;
-			// set pixel in octant 6 (x+xMod,y-yMod)
-			// drawing direction: from 270° to 315°
-			if (octants & 64 && pTemp.y >= 0 && pTemp.y < surface->height && \
-				(octantStart != 6 || p.x >= xStart) && (octantStop != 6 || p.x <= xStop) ) {
-				i = pTemp.y * surface->width + pTemp.x;
-				if (surfacePixelBlend(
-					colour,alpha,
-					surface->rgb565[i],surface->alpha[i],
-					&surface->rgb565[i],&surface->alpha[i],
-					mode)) surfaceModSetPixel(mask,pTemp.x,pTemp.y);
-			}
-		}
-		
-		pTemp.x = pm.x - p.x;
-		if (pTemp.x >= 0 && pTemp.x < surface->width) {
-			pTemp.y = pm.y + p.y;
-			// set pixel in octant 2 (x-xMod,y+yMod)
-			// drawing direction: from 90° to 135°
-			if (octants & 4 && pTemp.y >= 0 && pTemp.y < surface->height && \
-				(octantStart != 2 || -p.x <= xStart) && (octantStop != 2 || -p.x >= xStop) ) {
-				i = pTemp.y * surface->width + pTemp.x;
-				if (surfacePixelBlend(
-					colour,alpha,
-					surface->rgb565[i],surface->alpha[i],
-					&surface->rgb565[i],&surface->alpha[i],
-					mode)) surfaceModSetPixel(mask,pTemp.x,pTemp.y);
-			}
-			pTemp.y = pm.y - p.y;
-			// set pixel in octant 5 (x-xMod,y-yMod)
-			// drawing direction: from 270° to 225°
-			if (octants & 32 && pTemp.y >= 0 && pTemp.y < surface->height && \
-				(octantStart != 5 || -p.x >= xStart) && (octantStop != 5 || -p.x <= xStop) ) {
-				i = pTemp.y * surface->width + pTemp.x;
-				if (surfacePixelBlend(
-					colour,alpha,
-					surface->rgb565[i],surface->alpha[i],
-					&surface->rgb565[i],&surface->alpha[i],
-					mode)) surfaceModSetPixel(mask,pTemp.x,pTemp.y);
-			}
-		}
-		
-		pTemp.x = pm.x + p.y;
-		if (pTemp.x >= 0 && pTemp.x < surface->width) {
-			pTemp.y = pm.y + p.x;
-			// set pixel in octant 0 (x+yMod,y+xMod)
-			// drawing direction: from 0° to 45°
-			if (octants & 1 && pTemp.y >= 0 && pTemp.y < surface->height && \
-				(octantStart != 0 || p.x >= yStart) && (octantStop != 0 || p.x <= yStop) ) {
-				i = pTemp.y * surface->width + pTemp.x;
-				if (surfacePixelBlend(
-					colour,alpha,
-					surface->rgb565[i],surface->alpha[i],
-					&surface->rgb565[i],&surface->alpha[i],
-					mode)) surfaceModSetPixel(mask,pTemp.x,pTemp.y);
-			}
-			pTemp.y = pm.y - p.x;
-			// set pixel in octant 7 (x+yMod,y-xMod)
-			// drawing direction: from 360° to 315°
-			if (octants & 128 && pTemp.y >= 0 && pTemp.y < surface->height && \
-				(octantStart != 7 || -p.x >= yStart) && (octantStop != 7 || -p.x <= yStop) ) {
-				i = pTemp.y * surface->width + pTemp.x;
-				if (surfacePixelBlend(
-					colour,alpha,
-					surface->rgb565[i],surface->alpha[i],
-					&surface->rgb565[i],&surface->alpha[i],
-					mode)) surfaceModSetPixel(mask,pTemp.x,pTemp.y);
-			}
-		}
-		pTemp.x = pm.x - p.y;
-		if (pTemp.x >= 0 && pTemp.x < surface->width) {
-			pTemp.y = pm.y + p.x;
-			// set pixel in octant 3 (x-yMod,y+xMod)
-			// drawing direction: from 180° to 135°
-			if (octants & 8 && pTemp.y >= 0 && pTemp.y < surface->height && \
-				(octantStart != 3 || p.x <= yStart) && (octantStop != 3 || p.x >= yStop) ) {
-				i = pTemp.y * surface->width + pTemp.x;
-				if (surfacePixelBlend(
-					colour,alpha,
-					surface->rgb565[i],surface->alpha[i],
-					&surface->rgb565[i],&surface->alpha[i],
-					mode)) surfaceModSetPixel(mask,pTemp.x,pTemp.y);
-			}
-			pTemp.y = pm.y - p.x;
-			// set pixel in octant 4 (x-yMod,y-xMod)
-			// drawing direction: from 180° to 225°
-			if (octants & 16 && pTemp.y >= 0 && pTemp.y < surface->height && \
-				(octantStart != 4 || -p.x <= yStart) && (octantStop != 4 || -p.x >= yStop) ) {
-				i = pTemp.y * surface->width + pTemp.x;
-				if (surfacePixelBlend(
-					colour,alpha,
-					surface->rgb565[i],surface->alpha[i],
-					&surface->rgb565[i],&surface->alpha[i],
-					mode)) surfaceModSetPixel(mask,pTemp.x,pTemp.y);
-			}
-		}
-		
-		// update error term to check which axis needs stepping
-		if (error >= 0) {
-			p.y--;
-			ddE_y += 2;
-			error += ddE_y;
-		}
-		p.x++;
-		ddE_x += 2;
-		error += ddE_x + 1;
-		
-	} while (p.x < p.y);
-	
+	int16_t angleSweep = surfaceAngleSweep(&angleStart,angleStop);
+	bb = (angleSweep == 0) ? boundingBoxCreate(pm.x - radius,pm.y - radius,pm.x + radius,pm.y + radius) : surfaceSectorBox(pm,radius,radius,angleStart,angleSweep);
+	surfaceDrawCircular(surface,pm,radius,0,true,angleStart,angleSweep,bb,colour,alpha,mode,mask);
 	return bb;
 }
 
+BoundingBox surfaceDrawSector(Surface *surface, Point pm, uint16_t radiusOuter, uint16_t radiusInner, int16_t angleStart, int16_t angleStop, uint16_t colour, uint8_t alpha, uint8_t mode, SurfaceMod *mask) {
+	BoundingBox bb = boundingBoxCreate(0,0,0,0);
+	if (surface == NULL || mask == NULL || radiusOuter == 0 || radiusInner > radiusOuter) return bb;
+	int16_t angleSweep = surfaceAngleSweep(&angleStart,angleStop);
+	bb = (angleSweep == 0) ? boundingBoxCreate(pm.x - radiusOuter,pm.y - radiusOuter,pm.x + radiusOuter,pm.y + radiusOuter) : surfaceSectorBox(pm,radiusOuter,radiusInner,angleStart,angleSweep);
+	surfaceDrawCircular(surface,pm,radiusOuter,radiusInner,false,angleStart,angleSweep,bb,colour,alpha,mode,mask);
+	return bb;
+}
 
 
 // internal helper function; not for public use:
@@ -854,13 +1114,11 @@ BoundingBox surfaceDrawArc(Surface *surface, Point pm, uint16_t radius, int16_t
 // - assumes p0 and p1 have equal y values
 // iterate from p0.y to p2.y, compute edges p0p2 and p1p2 and fill space inbetween
 // this adapts the Bresenham implementation of surfaceDrawLine()
-void surfaceDrawTriangleFlatTop(Surface *surface, Point p0, Point p1, Point p2, uint16_t colour, uint8_t alpha, uint8_t mode, SurfaceMod *mask) {
+static void surfaceDrawTriangleFlatTop(Surface *surface, Point p0, Point p1, Point p2, uint16_t colour, uint8_t alpha, uint8_t mode, SurfaceMod *mask) {
 	int16_t xLeft,xRight,xLeftDiff,xRightDiff;
 	int16_t errorLeft,errorLeft2,errorRight,errorRight2;
 	int8_t  xLeftStep,xRightStep;
 	int16_t yDiff = p0.y - p2.y; // assumption: both start points have the same y value
-	uint16_t i,iRow,iMax;
-	uint32_t bitmask;
 	
 	// determine left and right edges
 	if (p0.x < p1.x) {
@@ -908,29 +1166,9 @@ void surfaceDrawTriangleFlatTop(Surface *surface, Point p0, Point p1, Point p2,
 	
 	// since all points are sorted vertically, only positive +1 y stepping is used
 	
-	iRow = p0.y * surface->width;
 	for (; p0.y <= p2.y; p0.y++) {
-		// check that at least a part of the line-to-draw is visible
-		if (xLeft < surface->width && xRight >= 0) {
-			// clip x at left and right surface border; re-use point x components as storage
-			p0.x = (xLeft < 0) ? 0 : xLeft;
-			p1.x = (xRight >= surface->width) ? surface->width - 1 : xRight;
-			
-			// draw horizontal line at current y
-			bitmask = 0;
-			iMax = iRow + p1.x;
-			for (i = iRow + p0.x; i <= iMax; i++) {
-				if (surfacePixelBlend(
-					colour,alpha,
-					surface->rgb565[i],surface->alpha[i],
-					&surface->rgb565[i],&surface->alpha[i],
-					mode
-				)) bitmask |= 1 << (p0.x >> 3);
-				p0.x++;
-			}
-			surfaceModSetRow(mask,p0.y,bitmask);
-		}
-		iRow += surface->width;
+		// draw horizontal line at current y (clipped to the surface area)
+		surfaceDrawSpan(surface,xLeft,xRight,p0.y,colour,alpha,mode,mask);
 		
 		// update error terms until a step in y direction is needed
 		do {
@@ -960,13 +1198,11 @@ void surfaceDrawTriangleFlatTop(Surface *surface, Point p0, Point p1, Point p2,
 // - assumes p1 and p2 have equal y values
 // iterate from p0.y to p2.y, compute edges p0p1 and p0p2 and fill space inbetween
 // this adapts the Bresenham implementation of surfaceDrawLine()
-void surfaceDrawTriangleFlatBottom(Surface *surface, Point p0, Point p1, Point p2, uint16_t colour, uint8_t alpha, uint8_t mode, SurfaceMod *mask) {
+static void surfaceDrawTriangleFlatBottom(Surface *surface, Point p0, Point p1, Point p2, uint16_t colour, uint8_t alpha, uint8_t mode, SurfaceMod *mask) {
 	int16_t xLeft,xRight,xLeftDiff,xRightDiff;
 	int16_t errorLeft,errorLeft2,errorRight,errorRight2;
 	int16_t yDiff = p0.y - p2.y; // assumption: both end points have the same y value
 	int8_t  xLeftStep,xRightStep;
-	uint16_t i,iRow,iMax;
-	uint32_t bitmask;
 	
 	// determine left and right edges; both edges share the same starting point p0
 	xLeft = p0.x;
@@ -1013,29 +1249,9 @@ void surfaceDrawTriangleFlatBottom(Surface *surface, Point p0, Point p1, Point p
 	// since all points are sorted vertically, only positive +1 y stepping is used
 	// but: different y values for end points p1 and p2! --> yLeftDiff, yRightDiff 
 	
-	iRow = p0.y * surface->width;
 	for (; p0.y <= p2.y; p0.y++) {
-		// check that at least a part of the line-to-draw is visible
-		if (xLeft < surface->width && xRight >= 0) {
-			// clip x at left and right surface border; re-use point x components as storage
-			p0.x = (xLeft < 0) ? 0 : xLeft;
-			p1.x = (xRight >= surface->width) ? surface->width - 1 : xRight;
-			
-			// draw horizontal line at current y
-			bitmask = 0;
-			iMax = iRow + p1.x;
-			for (i = iRow + p0.x; i <= iMax; i++) {
-				if (surfacePixelBlend(
-					colour,alpha,
-					surface->rgb565[i],surface->alpha[i],
-					&surface->rgb565[i],&surface->alpha[i],
-					mode
-				)) bitmask |= 1 << (p0.x >> 3);
-				p0.x++;
-			}
-			surfaceModSetRow(mask,p0.y,bitmask);
-		}
-		iRow += surface->width;
+		// draw horizontal line at current y (clipped to the surface area)
+		surfaceDrawSpan(surface,xLeft,xRight,p0.y,colour,alpha,mode,mask);
 		
 		// update error terms until a step in y direction is needed
 		do {
@@ -1060,6 +1276,7 @@ void surfaceDrawTriangleFlatBottom(Surface *surface, Point p0, Point p1, Point p
 
 
 BoundingBox surfaceDrawTriangle(Surface *surface, Point p0, Point p1, Point p2, uint16_t colour, uint8_t alpha, uint8_t mode, SurfaceMod *mask) {
+	PROFILE_SCOPE(PROFILE_DRAW_TRIANGLE);
 	BoundingBox bb = boundingBoxCreate(0,0,0,0);
 	// sanity check: bail out if surface or mask are invalid
 	if (surface == NULL || mask == NULL) return bb;
@@ -1103,19 +1320,7 @@ BoundingBox surfaceDrawTriangle(Surface *surface, Point p0, Point p1, Point p2,
 		if (p1.y == p2.y) {
 			// case 1: degenerated triangle as horizontal line
 			// draw line from bb.min.x to bb.max.x
-			uint16_t i = bb.min.y * surface->width;
-			uint16_t iMax = i + bb.max.x;
-			uint32_t bitmask = 0;
-			p0.x = bb.min.x;
-			for (i += bb.min.x; i <= iMax; i++) {
-				if (surfacePixelBlend(
-					colour,alpha,
-					surface->rgb565[i],surface->alpha[i],
-					&surface->rgb565[i],&surface->alpha[i],
-					mode)) bitmask |= 1 << (p0.x >> 3);
-				p0.x++;
-			}
-			surfaceModSetRow(mask, bb.min.y, bitmask);
+			surfaceDrawSpan(surface,bb.min.x,bb.max.x,bb.min.y,colour,alpha,mode,mask);
 		} else {
 			// case 2: triangle standing on tip, base line parallel to x axis (=flat top triangle)
 			surfaceDrawTriangleFlatTop(surface,p0,p1,p2,colour,alpha,mode,mask);
@@ -1150,6 +1355,7 @@ BoundingBox surfaceDrawTriangle(Surface *surface, Point p0, Point p1, Point p2,
 
 
 BoundingBox surfaceDrawRectangle(Surface *surface, Point p0, Point p1, uint16_t colour, uint8_t alpha, uint8_t mode, SurfaceMod *mask) {
+	PROFILE_SCOPE(PROFILE_DRAW_RECTANGLE);
 	if (surface == NULL || mask == NULL) return boundingBoxCreate(0,0,0,0);
 	
 	// populate bounding box, ensure min < max; exit if not visible
@@ -1176,22 +1382,8 @@ BoundingBox surfaceDrawRectangle(Surface *surface, Point p0, Point p1, uint16_t
 	uint8_t xMax = (bb.max.x < surface->width) ? bb.max.x : surface->width - 1;
 	uint8_t yMax = (bb.max.y < surface->height) ? bb.max.y : surface->height - 1;
 	
-	uint8_t x,y;
-	uint32_t bitmask;
-	uint16_t i = yMin * surface->width + xMin;
-	uint16_t di = surface->width - xMax + xMin - 1;
-	for (y = yMin; y <= yMax; y++) {
-		bitmask = 0;
-		for (x = xMin; x <= xMax; x++) {
-			if (surfacePixelBlend(
-				colour,alpha,
-				surface->rgb565[i],surface->alpha[i],
-				&surface->rgb565[i],&surface->alpha[i],
-				mode)) bitmask |= 1 << (x >> 3);
-			i++;
-		}
-		surfaceModSetRow(mask,y,bitmask);
-		i += di;
+	for (uint8_t y = yMin; y <= yMax; y++) {
+		surfaceModSetRow(mask,y,surfaceBlendSpanColour(surface,xMin,y,xMax-xMin+1,colour,alpha,mode));
 	}
 	
 	return bb;
@@ -1201,366 +1393,21 @@ BoundingBox surfaceDrawRectangle(Surface *surface, Point p0, Point p1, uint16_t
 // integer mathematics helper functions
 //------------------------------------------------------------------------------
 
-// return tan(x) for x in -45..+45, mapping [-1.0..+1.0] to -1024..+1024
+// integer trigonometry: wrappers around the table lookups of faMath.h
 int16_t surfaceTangent45(int16_t x) {
-	// limit to -44..+44
-	if (x <= -45) return -1024;
-// 	>>> for x in range(-44,45): print("case {}: return {};".format(x,round(math.tan(math.pi*x/180)*1024)))
-	switch (x) {
-		case -44: return -989;
-		case -43: return -955;
-		case -42: return -922;
-		case -41: return -890;
-		case -40: return -859;
-		case -39: return -829;
-		case -38: return -800;
-		case -37: return -772;
-		case -36: return -744;
-		case -35: return -717;
-		case -34: return -691;
-		case -33: return -665;
-		case -32: return -640;
-		case -31: return -615;
-		case -30: return -591;
-		case -29: return -568;
-		case -28: return -544;
-		case -27: return -522;
-		case -26: return -499;
-		case -25: return -477;
-		case -24: return -456;
-		case -23: return -435;
-		case -22: return -414;
-		case -21: return -393;
-		case -20: return -373;
-		case -19: return -353;
-		case -18: return -333;
-		case -17: return -313;
-		case -16: return -294;
-		case -15: return -274;
-		case -14: return -255;
-		case -13: return -236;
-		case -12: return -218;
-		case -11: return -199;
-		case -10: return -181;
-		case -9: return -162;
-		case -8: return -144;
-		case -7: return -126;
-		case -6: return -108;
-		case -5: return -90;
-		case -4: return -72;
-		case -3: return -54;
-		case -2: return -36;
-		case -1: return -18;
-		case 0: return 0;
-		case 1: return 18;
-		case 2: return 36;
-		case 3: return 54;
-		case 4: return 72;
-		case 5: return 90;
-		case 6: return 108;
-		case 7: return 126;
-		case 8: return 144;
-		case 9: return 162;
-		case 10: return 181;
-		case 11: return 199;
-		case 12: return 218;
-		case 13: return 236;
-		case 14: return 255;
-		case 15: return 274;
-		case 16: return 294;
-		case 17: return 313;
-		case 18: return 333;
-		case 19: return 353;
-		case 20: return 373;
-		case 21: return 393;
-		case 22: return 414;
-		case 23: return 435;
-		case 24: return 456;
-		case 25: return 477;
-		case 26: return 499;
-		case 27: return 522;
-		case 28: return 544;
-		case 29: return 568;
-		case 30: return 591;
-		case 31: return 615;
-		case 32: return 640;
-		case 33: return 665;
-		case 34: return 691;
-		case 35: return 717;
-		case 36: return 744;
-		case 37: return 772;
-		case 38: return 800;
-		case 39: return 829;
-		case 40: return 859;
-		case 41: return 890;
-		case 42: return 922;
-		case 43: return 955;
-		case 44: return 989;
-		default: return 1024;
-	}
-}
-
-// return sin(x) for x in 0..90, mapping [0..+1.0] to 0..+1024
-int16_t surfaceSine90(int16_t x) {
-	if (x <= 0) return 0;
-// 	>>> for x in range(0,91): print("case {}: return {};".format(x,round(math.sin(math.pi*x/180)*1024)))
-	switch (x) {
-		case 0: return 0;
-		case 1: return 18;
-		case 2: return 36;
-		case 3: return 54;
-		case 4: return 71;
-		case 5: return 89;
-		case 6: return 107;
-		case 7: return 125;
-		case 8: return 143;
-		case 9: return 160;
-		case 10: return 178;
-		case 11: return 195;
-		case 12: return 213;
-		case 13: return 230;
-		case 14: return 248;
-		case 15: return 265;
-		case 16: return 282;
-		case 17: return 299;
-		case 18: return 316;
-		case 19: return 333;
-		case 20: return 350;
-		case 21: return 367;
-		case 22: return 384;
-		case 23: return 400;
-		case 24: return 416;
-		case 25: return 433;
-		case 26: return 449;
-		case 27: return 465;
-		case 28: return 481;
-		case 29: return 496;
-		case 30: return 512;
-		case 31: return 527;
-		case 32: return 543;
-		case 33: return 558;
-		case 34: return 573;
-		case 35: return 587;
-		case 36: return 602;
-		case 37: return 616;
-		case 38: return 630;
-		case 39: return 644;
-		case 40: return 658;
-		case 41: return 672;
-		case 42: return 685;
-		case 43: return 698;
-		case 44: return 711;
-		case 45: return 724;
-		case 46: return 737;
-		case 47: return 749;
-		case 48: return 761;
-		case 49: return 773;
-		case 50: return 784;
-		case 51: return 796;
-		case 52: return 807;
-		case 53: return 818;
-		case 54: return 828;
-		case 55: return 839;
-		case 56: return 849;
-		case 57: return 859;
-		case 58: return 868;
-		case 59: return 878;
-		case 60: return 887;
-		case 61: return 896;
-		case 62: return 904;
-		case 63: return 912;
-		case 64: return 920;
-		case 65: return 928;
-		case 66: return 935;
-		case 67: return 943;
-		case 68: return 949;
-		case 69: return 956;
-		case 70: return 962;
-		case 71: return 968;
-		case 72: return 974;
-		case 73: return 979;
-		case 74: return 984;
-		case 75: return 989;
-		case 76: return 994;
-		case 77: return 998;
-		case 78: return 1002;
-		case 79: return 1005;
-		case 80: return 1008;
-		case 81: return 1011;
-		case 82: return 1014;
-		case 83: return 1016;
-		case 84: return 1018;
-		case 85: return 1020;
-		case 86: return 1022;
-		case 87: return 1023;
-		case 88: return 1023;
-		default: return 1024;
-	}
-}
-
-// return sin(x) for x in 0..360, mapping [-1.0..+1.0] to -1024..+1024
+	return mathTangent45(x);
+}
+
 int16_t surfaceSine(int16_t x) {
-	x = ((x % 360) + 360) % 360;
-	if (x < 90) {
-		// 1st sector: use surfaceSine90
-		return surfaceSine90(x);
-	} else if (x < 180) {
-		// 2nd sector: use surfaceSine90, mirrored about y axis
-		return surfaceSine90(180-x);
-	} else if (x < 270) {
-		// 3rd sector: use surfaceSine90, mirrored about x axis
-		return -surfaceSine90(x-180);
-	} else if (x < 360) {
-		// 4th sector: use surfaceSine90, mirrored about x and y axis
-		return -surfaceSine90(360-x);
-	} else {
-		return 0;
-	}
+	return mathSine(x);
 }
 
-// return cos(x) for x in 0..360, mapping [-1.0..+1.0] to -1024..+1024
 int16_t surfaceCosine(int16_t x) {
-	// cos = sin, phase-shifted by 90 degrees
-	return surfaceSine(x + 90);
+	return mathCosine(x);
 }
 
-// return acos(x) for x in [-1..1] (mapped to [-1024,1024], resulting in an angle in range [0..180]
 int16_t surfaceArcusCosine(int16_t x) {
-	if (x < -1024) return 180;
-	if (x >  1024) return 0;
-	// >>> for x in range(-1024,1025,16): print("case {}: return {};".format(x>>4,round(180*math.acos(x/1024)/math.pi)))
-	switch (x >> 4) {
-		case -64: return 180;
-		case -63: return 170;
-		case -62: return 166;
-		case -61: return 162;
-		case -60: return 160;
-		case -59: return 157;
-		case -58: return 155;
-		case -57: return 153;
-		case -56: return 151;
-		case -55: return 149;
-		case -54: return 148;
-		case -53: return 146;
-		case -52: return 144;
-		case -51: return 143;
-		case -50: return 141;
-		case -49: return 140;
-		case -48: return 139;
-		case -47: return 137;
-		case -46: return 136;
-		case -45: return 135;
-		case -44: return 133;
-		case -43: return 132;
-		case -42: return 131;
-		case -41: return 130;
-		case -40: return 129;
-		case -39: return 128;
-		case -38: return 126;
-		case -37: return 125;
-		case -36: return 124;
-		case -35: return 123;
-		case -34: return 122;
-		case -33: return 121;
-		case -32: return 120;
-		case -31: return 119;
-		case -30: return 118;
-		case -29: return 117;
-		case -28: return 116;
-		case -27: return 115;
-		case -26: return 114;
-		case -25: return 113;
-		case -24: return 112;
-		case -23: return 111;
-		case -22: return 110;
-		case -21: return 109;
-		case -20: return 108;
-		case -19: return 107;
-		case -18: return 106;
-		case -17: return 105;
-		case -16: return 104;
-		case -15: return 104;
-		case -14: return 103;
-		case -13: return 102;
-		case -12: return 101;
-		case -11: return 100;
-		case -10: return 99;
-		case -9: return 98;
-		case -8: return 97;
-		case -7: return 96;
-		case -6: return 95;
-		case -5: return 94;
-		case -4: return 94;
-		case -3: return 93;
-		case -2: return 92;
-		case -1: return 91;
-		case 0: return 90;
-		case 1: return 89;
-		case 2: return 88;
-		case 3: return 87;
-		case 4: return 86;
-		case 5: return 86;
-		case 6: return 85;
-		case 7: return 84;
-		case 8: return 83;
-		case 9: return 82;
-		case 10: return 81;
-		case 11: return 80;
-		case 12: return 79;
-		case 13: return 78;
-		case 14: return 77;
-		case 15: return 76;
-		case 16: return 76;
-		case 17: return 75;
-		case 18: return 74;
-		case 19: return 73;
-		case 20: return 72;
-		case 21: return 71;
-		case 22: return 70;
-		case 23: return 69;
-		case 24: return 68;
-		case 25: return 67;
-		case 26: return 66;
-		case 27: return 65;
-		case 28: return 64;
-		case 29: return 63;
-		case 30: return 62;
-		case 31: return 61;
-		case 32: return 60;
-		case 33: return 59;
-		case 34: return 58;
-		case 35: return 57;
-		case 36: return 56;
-		case 37: return 55;
-		case 38: return 54;
-		case 39: return 52;
-		case 40: return 51;
-		case 41: return 50;
-		case 42: return 49;
-		case 43: return 48;
-		case 44: return 47;
-		case 45: return 45;
-		case 46: return 44;
-		case 47: return 43;
-		case 48: return 41;
-		case 49: return 40;
-		case 50: return 39;
-		case 51: return 37;
-		case 52: return 36;
-		case 53: return 34;
-		case 54: return 32;
-		case 55: return 31;
-		case 56: return 29;
-		case 57: return 27;
-		case 58: return 25;
-		case 59: return 23;
-		case 60: return 20;
-		case 61: return 18;
-		case 62: return 14;
-		case 63: return 10;
-		case 64: return 0;
-	}
-	return 0;
+	return mathArcusCosine(x);
 }
 
 
@@ -1568,66 +1415,478 @@ int16_t surfaceArcusCosine(int16_t x) {
 // surface composition functions
 //------------------------------------------------------------------------------
 
-// Image composition function for alpha blending a colour component of a pixel
-// of surface A with a colour component of a pixel of surface B.
-// operation: result = a op b (mode defines op)
-bool surfacePixelBlend(uint16_t colourA, uint8_t alphaA, uint16_t colourB, uint8_t alphaB, uint16_t *colourResult, uint8_t *alphaResult, uint8_t mode) {
-	uint8_t F_A,F_B, alphaC;
-	uint16_t alpha,colourC;
-	uint32_t colour;
-	// depending on mode, select the right fractions (indicating the extent of contributions of A and B)
-	// see (Porter Duff, 1984) (https://doi.org/10.1145%2F800031.808606), p. 255
-	// adapted to alpha in [0,255]
+// reciprocal table for blending: round(65535/alpha), used to get from a
+// premultiplied blend result back to stored (straight) colour components
+// >>> for i in range(0,256,16): print(",".join("{:5}".format(0 if a == 0 else round(65535/a)) for a in range(i,i+16)))
+static const uint16_t surfaceReciprocal[256] = {
+	    0,65535,32768,21845,16384,13107,10922, 9362, 8192, 7282, 6554, 5958, 5461, 5041, 4681, 4369,
+	 4096, 3855, 3641, 3449, 3277, 3121, 2979, 2849, 2731, 2621, 2521, 2427, 2341, 2260, 2184, 2114,
+	 2048, 1986, 1928, 1872, 1820, 1771, 1725, 1680, 1638, 1598, 1560, 1524, 1489, 1456, 1425, 1394,
+	 1365, 1337, 1311, 1285, 1260, 1237, 1214, 1192, 1170, 1150, 1130, 1111, 1092, 1074, 1057, 1040,
+	 1024, 1008,  993,  978,  964,  950,  936,  923,  910,  898,  886,  874,  862,  851,  840,  830,
+	  819,  809,  799,  790,  780,  771,  762,  753,  745,  736,  728,  720,  712,  705,  697,  690,
+	  683,  676,  669,  662,  655,  649,  642,  636,  630,  624,  618,  612,  607,  601,  596,  590,
+	  585,  580,  575,  570,  565,  560,  555,  551,  546,  542,  537,  533,  529,  524,  520,  516,
+	  512,  508,  504,  500,  496,  493,  489,  485,  482,  478,  475,  471,  468,  465,  462,  458,
+	  455,  452,  449,  446,  443,  440,  437,  434,  431,  428,  426,  423,  420,  417,  415,  412,
+	  410,  407,  405,  402,  400,  397,  395,  392,  390,  388,  386,  383,  381,  379,  377,  374,
+	  372,  370,  368,  366,  364,  362,  360,  358,  356,  354,  352,  350,  349,  347,  345,  343,
+	  341,  340,  338,  336,  334,  333,  331,  329,  328,  326,  324,  323,  321,  320,  318,  317,
+	  315,  314,  312,  311,  309,  308,  306,  305,  303,  302,  301,  299,  298,  297,  295,  294,
+	  293,  291,  290,  289,  287,  286,  285,  284,  282,  281,  280,  279,  278,  277,  275,  274,
+	  273,  272,  271,  270,  269,  267,  266,  265,  264,  263,  262,  261,  260,  259,  258,  257,
+};
+
+// Image composition of a single pixel: "C = A op B", op depending on mode.
+// See (Porter Duff, 1984) (https://doi.org/10.1145%2F800031.808606), pp. 255-256,
+// adapted to alpha in [0,255]: the fractions F_A and F_B are folded into the
+// weights wA = alphaA*F_A/255 and wB = alphaB*F_B/255; the premultiplied result
+// is divided by the resulting alpha, since surfaces store straight colours.
+// This is inlined into the span kernels below; with a constant mode argument
+// the compiler removes the mode switch entirely.
+static inline __attribute__((always_inline)) bool surfaceBlendPixelInline(uint16_t colourA, uint8_t alphaA, uint16_t colourB, uint8_t alphaB, uint16_t *colourC, uint8_t *alphaC, const uint8_t mode) {
+	uint16_t weightA,weightB,alpha;
+	uint32_t reciprocal,colour,result;
 	switch (mode) {
 		case BLEND_OVER:
-			F_A = 255;
-			F_B = 255 - alphaA;
+			weightA = alphaA;
+			weightB = DIV255(alphaB * (255 - alphaA));
 			break;
 		case BLEND_IN:
-			F_A = alphaB;
-			F_B = 0;
+			weightA = DIV255(alphaA * alphaB);
+			weightB = 0;
 			break;
 		case BLEND_OUT:
-			F_A = 255 - alphaB;
-			F_B = 0;
+			weightA = DIV255(alphaA * (255 - alphaB));
+			weightB = 0;
 			break;
 		case BLEND_ATOP:
-			F_A = alphaB;
-			F_B = 255 - alphaA;
+			weightA = DIV255(alphaA * alphaB);
+			weightB = DIV255(alphaB * (255 - alphaA));
 			break;
 		case BLEND_XOR:
-			F_A = 255 - alphaB;
-			F_B = 255 - alphaA;
+			weightA = DIV255(alphaA * (255 - alphaB));
+			weightB = DIV255(alphaB * (255 - alphaA));
 			break;
 		case BLEND_PLUS:
-			F_A = 255;
-			F_B = 255;
+			weightA = alphaA;
+			weightB = alphaB;
 			break;
 		default:
 			return false;
 	}
-	// calculate compositing formula (cf. (Porter Duff, 1984), p. 256, adopted to alpha in [0,255])
-	alpha = (alphaA * F_A + alphaB * F_B) >> 8;
-	alphaC = (alpha > 255) ? 255 : (uint8_t)alpha;
-	
-	// compose red channel
-	colour = ( alphaA * F_A * ((colourA >> 11) & 0x1f) + alphaB * F_B * ((colourB >> 11) & 0x1f) ) >> 16;
-	if (colour > 31) colour = 31;
-	colourC = (uint16_t)(colour << 11); 
-	// compose green channel
-	colour = ( alphaA * F_A * ((colourA >> 5) & 0x3f) + alphaB * F_B * ((colourB >> 5) & 0x3f) ) >> 16;
-	if (colour > 63) colour = 63;
-	colourC |= (uint16_t)(colour << 5); 
-	// compose blue channel
-	colour = ( alphaA * F_A * (colourA & 0x1f) + alphaB * F_B * (colourB & 0x1f) ) >> 16;
-	if (colour > 31) colour = 31;
-	colourC |= (uint16_t)colour;
+	alpha = weightA + weightB;
+	if (alpha > 255) alpha = 255;
 	
-	*alphaResult = alphaC;
-	*colourResult = colourC;
+	if (alpha == 0) {
+		// fully transparent result: colour is meaningless, keep that of B
+		result = colourB;
+	} else {
+		reciprocal = surfaceReciprocal[alpha];
+		// compose red channel
+		colour = ((weightA * GETRED(colourA) + weightB * GETRED(colourB)) * reciprocal + 32768) >> 16;
+		if (colour > 31) colour = 31;
+		result = colour << 11;
+		// compose green channel
+		colour = ((weightA * GETGREEN(colourA) + weightB * GETGREEN(colourB)) * reciprocal + 32768) >> 16;
+		if (colour > 63) colour = 63;
+		result |= colour << 5;
+		// compose blue channel
+		colour = ((weightA * GETBLUE(colourA) + weightB * GETBLUE(colourB)) * reciprocal + 32768) >> 16;
+		if (colour > 31) colour = 31;
+		result |= colour;
+	}
 	
+	*colourC = (uint16_t)result;
+	*alphaC = (uint8_t)alpha;
 	// if A has modified B (B!=C), signal this by returning true
-	return (colourC != colourB || alphaC != alphaB);
+	return (result != colourB || alpha != alphaB);
+}
+
+// Image composition function for alpha blending a pixel of surface A with a
+// pixel of surface B; operation: result = a op b (mode defines op)
+bool surfacePixelBlend(uint16_t colourA, uint8_t alphaA, uint16_t colourB, uint8_t alphaB, uint16_t *colourResult, uint8_t *alphaResult, uint8_t mode) {
+	PROFILE_COUNT(PROFILE_PIXELS,1);
+	switch (mode) {
+		case BLEND_OVER: return surfaceBlendPixelInline(colourA,alphaA,colourB,alphaB,colourResult,alphaResult,BLEND_OVER);
+		case BLEND_IN:   return surfaceBlendPixelInline(colourA,alphaA,colourB,alphaB,colourResult,alphaResult,BLEND_IN);
+		case BLEND_OUT:  return surfaceBlendPixelInline(colourA,alphaA,colourB,alphaB,colourResult,alphaResult,BLEND_OUT);
+		case BLEND_ATOP: return surfaceBlendPixelInline(colourA,alphaA,colourB,alphaB,colourResult,alphaResult,BLEND_ATOP);
+		case BLEND_XOR:  return surfaceBlendPixelInline(colourA,alphaA,colourB,alphaB,colourResult,alphaResult,BLEND_XOR);
+		case BLEND_PLUS: return surfaceBlendPixelInline(colourA,alphaA,colourB,alphaB,colourResult,alphaResult,BLEND_PLUS);
+		default:         return false;
+	}
+}
+
+// Premultiplied counterpart of surfaceBlendPixelInline(): colours of A, B and
+// the result are premultiplied by their alpha values. The Porter-Duff fractions
+// F_A and F_B (normalised to 255) apply to colours and alpha alike, so no
+// division is needed, and mode over is one multiply-add per channel.
+static inline __attribute__((always_inline)) void surfaceBlendPixelPremultipliedInline(uint16_t colourA, uint8_t alphaA, uint16_t colourB, uint8_t alphaB, uint16_t *colourC, uint8_t *alphaC, const uint8_t mode) {
+	uint16_t fractionA,fractionB,alpha;
+	uint32_t red,green,blue;
+	switch (mode) {
+		case BLEND_OVER: fractionA = 255;          fractionB = 255 - alphaA; break;
+		case BLEND_IN:   fractionA = alphaB;       fractionB = 0;            break;
+		case BLEND_OUT:  fractionA = 255 - alphaB; fractionB = 0;            break;
+		case BLEND_ATOP: fractionA = alphaB;       fractionB = 255 - alphaA; break;
+		case BLEND_XOR:  fractionA = 255 - alphaB; fractionB = 255 - alphaA; break;
+		case BLEND_PLUS: fractionA = 255;          fractionB = 255;          break;
+		default:         return;
+	}
+	// same alpha as the straight kernel
+	alpha = DIV255(alphaA * fractionA) + DIV255(alphaB * fractionB);
+	if (alpha > 255) alpha = 255;
+	if (mode == BLEND_OVER || mode == BLEND_PLUS) {
+		red   = GETRED(colourA)   + DIV255(GETRED(colourB)   * fractionB);
+		green = GETGREEN(colourA) + DIV255(GETGREEN(colourB) * fractionB);
+		blue  = GETBLUE(colourA)  + DIV255(GETBLUE(colourB)  * fractionB);
+	} else {
+		red   = DIV255(GETRED(colourA)   * fractionA + GETRED(colourB)   * fractionB);
+		green = DIV255(GETGREEN(colourA) * fractionA + GETGREEN(colourB) * fractionB);
+		blue  = DIV255(GETBLUE(colourA)  * fractionA + GETBLUE(colourB)  * fractionB);
+	}
+	if (red > 31) red = 31;
+	if (green > 63) green = 63;
+	if (blue > 31) blue = 31;
+	*colourC = (uint16_t)((red << 11) | (green << 5) | blue);
+	*alphaC = (uint8_t)alpha;
+}
+
+// internal helper function: straight colour of a premultiplied colour with alpha > 0
+static inline uint16_t surfaceUnpremultiplyColour(uint16_t colour, uint8_t alpha) {
+	const uint32_t reciprocal = surfaceReciprocal[alpha] * 255;
+	uint32_t red   = (GETRED(colour)   * reciprocal + 32768) >> 16;
+	uint32_t green = (GETGREEN(colour) * reciprocal + 32768) >> 16;
+	uint32_t blue  = (GETBLUE(colour)  * reciprocal + 32768) >> 16;
+	if (red > 31) red = 31;
+	if (green > 63) green = 63;
+	if (blue > 31) blue = 31;
+	return (uint16_t)((red << 11) | (green << 5) | blue);
+}
+
+// Generic span kernel: blend len pixels of A onto row pointers of B, write to C.
+// A is either an array (colourA/alphaA) or, if solid is set, a single colour;
+// if opaqueA is set, A is a colour array with uniform alpha alphaSolid.
+// If opaqueB is set, B and C have no alpha plane: alpha(B) is 255 and the
+// resulting alpha is discarded. Specialised at compile time for each mode by
+// the dispatchers below. Fast paths:
+//  - alpha(A) == 0: modes over, atop, xor and plus leave B untouched
+//  - alpha(A) == 255: mode over copies A
+// Returns a tile bitmask of all modified pixels, x being the column of the first pixel.
+// If track is not set, pixels are not compared: all tiles of the span count as
+// modified (cf. SURFACE_FLAG_NOTRACK).
+static inline __attribute__((always_inline)) uint32_t surfaceBlendSpanKernel(
+		const uint16_t *colourA, const uint8_t *alphaA, uint16_t colourSolid, uint8_t alphaSolid, uint8_t alphaScale,
+		uint16_t *colourB, uint8_t *alphaB, uint16_t *colourC, uint8_t *alphaC,
+		uint8_t x, uint8_t len, const uint8_t mode, const bool solid, const bool scaled, const bool opaqueA, const bool opaqueB, const bool track) {
+	const bool inPlace = (colourB == colourC);
+	const bool transparentIsNop = (mode == BLEND_OVER || mode == BLEND_ATOP || mode == BLEND_XOR || mode == BLEND_PLUS);
+	const uint32_t bitmaskSpan = (len == 0) ? 0 : ((2u << ((x + len - 1) >> 3)) - 1) & ~((1u << (x >> 3)) - 1);
+	uint32_t bitmask = 0;
+	uint16_t cA,cB;
+	uint8_t aA,aB,aC,i;
+	
+	if (solid || opaqueA) {
+		// whole span shares one alpha value: resolve fast paths once
+		if (alphaSolid == 0 && transparentIsNop) {
+			if (inPlace) return 0;
+			for (i = 0; i < len; i++) {
+				colourC[i] = colourB[i];
+				if (!opaqueB) alphaC[i] = alphaB[i];
+			}
+			return 0;
+		}
+		if (alphaSolid == 255 && mode == BLEND_OVER) {
+			for (i = 0; i < len; i++, x++) {
+				cA = (solid) ? colourSolid : colourA[i];
+				if (track && (colourB[i] != cA || (!opaqueB && alphaB[i] != 255))) bitmask |= 1 << (x >> 3);
+				colourC[i] = cA;
+				if (!opaqueB) alphaC[i] = 255;
+			}
+			return (track) ? bitmask : bitmaskSpan;
+		}
+	}
+	
+	for (i = 0; i < len; i++, x++) {
+		if (solid) {
+			cA = colourSolid;
+			aA = alphaSolid;
+		} else if (opaqueA) {
+			cA = colourA[i];
+			aA = alphaSolid;
+		} else {
+			cA = colourA[i];
+			aA = (scaled) ? DIV255(alphaA[i] * alphaScale) : alphaA[i];
+			if (aA == 0 && transparentIsNop) {
+				if (!inPlace) {
+					colourC[i] = colourB[i];
+					if (!opaqueB) alphaC[i] = alphaB[i];
+				}
+				continue;
+			}
+			if (aA == 255 && mode == BLEND_OVER) {
+				if (track && (colourB[i] != cA || (!opaqueB && alphaB[i] != 255))) bitmask |= 1 << (x >> 3);
+				colourC[i] = cA;
+				if (!opaqueB) alphaC[i] = 255;
+				continue;
+			}
+		}
+		cB = colourB[i];
+		if (opaqueB) {
+			surfaceBlendPixelInline(cA,aA,cB,255,&colourC[i],&aC,mode);
+			if (track && colourC[i] != cB) bitmask |= 1 << (x >> 3);
+		} else {
+			aB = alphaB[i];
+			if (surfaceBlendPixelInline(cA,aA,cB,aB,&colourC[i],&alphaC[i],mode) && track) bitmask |= 1 << (x >> 3);
+		}
+	}
+	return (track) ? bitmask : bitmaskSpan;
+}
+
+// Premultiplied span kernel: like surfaceBlendSpanKernel(), but blending is done
+// on premultiplied colours. A is premultiplied if premultipliedA is set (a solid
+// colour is passed as colourA == NULL); B and C are premultiplied unless
+// straightB/straightC are set, in which case colours are converted on the fly;
+// alphaB == NULL means alpha(B) = 255, alphaC == NULL discards the resulting alpha.
+// The mode is specialised at compile time, and so are the format flags for a
+// premultiplied A blended onto opaque surfaces (cf. dispatcher below).
+static inline __attribute__((always_inline)) uint32_t surfaceBlendSpanKernelPremultiplied(
+		const uint16_t *colourA, const uint8_t *alphaA, uint16_t colourSolid, uint8_t alphaSolid, uint8_t alphaScale,
+		uint16_t *colourB, uint8_t *alphaB, uint16_t *colourC, uint8_t *alphaC,
+		uint8_t x, uint8_t len, const uint8_t mode, const bool premultipliedA, const bool straightB, const bool straightC) {
+	const bool transparentIsNop = (mode == BLEND_OVER || mode == BLEND_ATOP || mode == BLEND_XOR || mode == BLEND_PLUS);
+	uint32_t bitmask = 0;
+	uint16_t cA,cB,cBStored,cC;
+	uint8_t aA,aB,aC,i;
+	
+	for (i = 0; i < len; i++, x++) {
+		if (colourA == NULL) {
+			cA = colourSolid;
+			aA = alphaSolid;
+		} else {
+			cA = colourA[i];
+			aA = (alphaA != NULL) ? alphaA[i] : 255;
+			if (alphaScale != 255) {
+				aA = DIV255(aA * alphaScale);
+				if (premultipliedA) cA = surfacePremultiplyColour(cA,alphaScale);
+			}
+			if (!premultipliedA && aA != 255) cA = surfacePremultiplyColour(cA,aA);
+		}
+		cBStored = colourB[i];
+		aB = (alphaB != NULL) ? alphaB[i] : 255;
+		if (aA == 0 && transparentIsNop) {
+			// C = B, only if C is another surface of the same representation
+			if (colourC != colourB) {
+				colourC[i] = (straightB == straightC || aB == 255 || aB == 0) ? cBStored :
+					(straightC ? surfaceUnpremultiplyColour(cBStored,aB) : surfacePremultiplyColour(cBStored,aB));
+				if (alphaC != NULL) alphaC[i] = aB;
+			}
+			continue;
+		}
+		cB = (straightB && aB != 255) ? surfacePremultiplyColour(cBStored,aB) : cBStored;
+		if (aA == 255 && mode == BLEND_OVER) {
+			cC = cA;
+			aC = 255;
+		} else {
+			surfaceBlendPixelPremultipliedInline(cA,aA,cB,aB,&cC,&aC,mode);
+			// opaque B stays opaque in these modes
+			if (alphaB == NULL && (mode == BLEND_OVER || mode == BLEND_ATOP || mode == BLEND_PLUS)) aC = 255;
+			// fully transparent straight result: colour is meaningless, keep that of B (cf. straight kernel)
+			if (straightC && aC != 255) cC = (aC == 0) ? cBStored : surfaceUnpremultiplyColour(cC,aC);
+		}
+		if (cC != cBStored || (alphaC != NULL && aC != aB)) bitmask |= 1 << (x >> 3);
+		colourC[i] = cC;
+		if (alphaC != NULL) alphaC[i] = aC;
+	}
+	return bitmask;
+}
+
+// dispatcher helper: select the premultiplied kernel specialisation for the given mode
+#define SPAN_KERNEL_CASES_PREMULTIPLIED(colour,alpha,colourSolid,alphaSolid) \
+	case BLEND_OVER: return surfaceBlendSpanKernelPremultiplied(colour,alpha,colourSolid,alphaSolid,alphaScale,cB,aB,cC,aC,x,len,BLEND_OVER,premultipliedA,straightB,straightC); \
+	case BLEND_IN:   return surfaceBlendSpanKernelPremultiplied(colour,alpha,colourSolid,alphaSolid,alphaScale,cB,aB,cC,aC,x,len,BLEND_IN,  premultipliedA,straightB,straightC); \
+	case BLEND_OUT:  return surfaceBlendSpanKernelPremultiplied(colour,alpha,colourSolid,alphaSolid,alphaScale,cB,aB,cC,aC,x,len,BLEND_OUT, premultipliedA,straightB,straightC); \
+	case BLEND_ATOP: return surfaceBlendSpanKernelPremultiplied(colour,alpha,colourSolid,alphaSolid,alphaScale,cB,aB,cC,aC,x,len,BLEND_ATOP,premultipliedA,straightB,straightC); \
+	case BLEND_XOR:  return surfaceBlendSpanKernelPremultiplied(colour,alpha,colourSolid,alphaSolid,alphaScale,cB,aB,cC,aC,x,len,BLEND_XOR, premultipliedA,straightB,straightC); \
+	case BLEND_PLUS: return surfaceBlendSpanKernelPremultiplied(colour,alpha,colourSolid,alphaSolid,alphaScale,cB,aB,cC,aC,x,len,BLEND_PLUS,premultipliedA,straightB,straightC); \
+	default:         return 0;
+
+// dispatcher helper: premultiplied A onto opaque B and C
+#define SPAN_KERNEL_CASES_PREMULTIPLIED_OPAQUE(colour,alpha) \
+	case BLEND_OVER: return surfaceBlendSpanKernelPremultiplied(colour,alpha,0,0,alphaScale,cB,NULL,cC,NULL,x,len,BLEND_OVER,true,false,true); \
+	case BLEND_IN:   return surfaceBlendSpanKernelPremultiplied(colour,alpha,0,0,alphaScale,cB,NULL,cC,NULL,x,len,BLEND_IN,  true,false,true); \
+	case BLEND_OUT:  return surfaceBlendSpanKernelPremultiplied(colour,alpha,0,0,alphaScale,cB,NULL,cC,NULL,x,len,BLEND_OUT, true,false,true); \
+	case BLEND_ATOP: return surfaceBlendSpanKernelPremultiplied(colour,alpha,0,0,alphaScale,cB,NULL,cC,NULL,x,len,BLEND_ATOP,true,false,true); \
+	case BLEND_XOR:  return surfaceBlendSpanKernelPremultiplied(colour,alpha,0,0,alphaScale,cB,NULL,cC,NULL,x,len,BLEND_XOR, true,false,true); \
+	case BLEND_PLUS: return surfaceBlendSpanKernelPremultiplied(colour,alpha,0,0,alphaScale,cB,NULL,cC,NULL,x,len,BLEND_PLUS,true,false,true); \
+	default:         return 0;
+
+// dispatcher helper: select the kernel specialisation for the given mode
+#define SPAN_KERNEL_CASES(colour,alpha,colourSolid,alphaSolid,solid,scaled,opaqueA,opaqueB,track) \
+	case BLEND_OVER: return surfaceBlendSpanKernel(colour,alpha,colourSolid,alphaSolid,alphaScale,cB,aB,cC,aC,x,len,BLEND_OVER,solid,scaled,opaqueA,opaqueB,track); \
+	case BLEND_IN:   return surfaceBlendSpanKernel(colour,alpha,colourSolid,alphaSolid,alphaScale,cB,aB,cC,aC,x,len,BLEND_IN,  solid,scaled,opaqueA,opaqueB,track); \
+	case BLEND_OUT:  return surfaceBlendSpanKernel(colour,alpha,colourSolid,alphaSolid,alphaScale,cB,aB,cC,aC,x,len,BLEND_OUT, solid,scaled,opaqueA,opaqueB,track); \
+	case BLEND_ATOP: return surfaceBlendSpanKernel(colour,alpha,colourSolid,alphaSolid,alphaScale,cB,aB,cC,aC,x,len,BLEND_ATOP,solid,scaled,opaqueA,opaqueB,track); \
+	case BLEND_XOR:  return surfaceBlendSpanKernel(colour,alpha,colourSolid,alphaSolid,alphaScale,cB,aB,cC,aC,x,len,BLEND_XOR, solid,scaled,opaqueA,opaqueB,track); \
+	case BLEND_PLUS: return surfaceBlendSpanKernel(colour,alpha,colourSolid,alphaSolid,alphaScale,cB,aB,cC,aC,x,len,BLEND_PLUS,solid,scaled,opaqueA,opaqueB,track); \
+	default:         return 0;
+
+uint32_t surfaceBlendSpanColour(Surface *surface, uint8_t x, uint8_t y, uint8_t len, uint16_t colour, uint8_t alpha, uint8_t mode) {
+	PROFILE_COUNT(PROFILE_PIXELS,len);
+	const uint8_t alphaScale = 255;
+	if ((surface->shares != NULL || surface->runs != NULL) && !surfaceUnshare(surface)) return 0;
+	uint16_t i = y * surface->stride + x;
+	uint16_t *cB = surface->rgb565 + i;
+	uint16_t *cC = cB;
+	uint8_t  *aB = NULL;
+	uint8_t  *aC = NULL;
+	mode &= BLEND_MASK_MODE;
+	if (surface->alpha != NULL && (surface->flags & SURFACE_FLAG_PREMULTIPLIED)) {
+		// premultiplied surface: premultiply the colour once
+		const bool premultipliedA = true, straightB = false, straightC = false;
+		aB = aC = surface->alpha + i;
+		colour = surfacePremultiplyColour(colour,alpha);
+		switch (mode) { SPAN_KERNEL_CASES_PREMULTIPLIED(NULL,NULL,colour,alpha) }
+	}
+	if (surface->alpha == NULL) {
+		// untracked surface: the tiles of the span are reported without comparing pixels
+		if (surface->flags & SURFACE_FLAG_NOTRACK) {
+			switch (mode) { SPAN_KERNEL_CASES(NULL,NULL,colour,alpha,true,false,false,true,false) }
+		}
+		switch (mode) { SPAN_KERNEL_CASES(NULL,NULL,colour,alpha,true,false,false,true,true) }
+	} else {
+		aB = aC = surface->alpha + i;
+		switch (mode) { SPAN_KERNEL_CASES(NULL,NULL,colour,alpha,true,false,false,false,true) }
+	}
+}
+
+uint32_t surfaceBlendSpan(const uint16_t *colour, const uint8_t *alpha, uint8_t alphaScale, Surface *surface, Surface *destination, uint8_t x, uint8_t y, uint8_t len, uint8_t mode) {
+	PROFILE_COUNT(PROFILE_PIXELS,len);
+	if ((destination->shares != NULL || destination->runs != NULL) && !surfaceUnshare(destination)) return 0;
+	uint16_t i = y * surface->stride + x;
+	uint16_t iC = y * destination->stride + x;
+	uint16_t *cB = surface->rgb565 + i;
+	uint16_t *cC = destination->rgb565 + iC;
+	uint8_t  *aB = NULL;
+	uint8_t  *aC = NULL;
+	uint8_t  alphaDiscard[255];
+	const bool premultipliedA = (mode & BLEND_FLAG_PREMULTIPLIED) != 0;
+	const bool premultipliedB = surface->alpha != NULL && (surface->flags & SURFACE_FLAG_PREMULTIPLIED);
+	const bool premultipliedC = destination->alpha != NULL && (destination->flags & SURFACE_FLAG_PREMULTIPLIED);
+	mode &= BLEND_MASK_MODE;
+	if ((premultipliedA && alpha != NULL) || premultipliedB || premultipliedC) {
+		// any premultiplied party: premultiplied kernel; opaque B and C count as straight
+		const bool straightB = !premultipliedB;
+		const bool straightC = !premultipliedC;
+		if (surface->alpha == NULL && destination->alpha == NULL) {
+			// common case: premultiplied sprite onto an opaque surface, fully specialised
+			switch (mode) { SPAN_KERNEL_CASES_PREMULTIPLIED_OPAQUE(colour,alpha) }
+		}
+		if (surface->alpha != NULL) aB = surface->alpha + i;
+		if (destination->alpha != NULL) aC = destination->alpha + iC;
+		switch (mode) { SPAN_KERNEL_CASES_PREMULTIPLIED(colour,alpha,0,0) }
+	}
+	if (surface->alpha == NULL && destination->alpha == NULL) {
+		// B and C opaque: no alpha plane to read or write
+		if (alpha == NULL) {
+			switch (mode) { SPAN_KERNEL_CASES(colour,NULL,0,alphaScale,false,false,true,true,true) }
+		} else if (alphaScale == 255) {
+			switch (mode) { SPAN_KERNEL_CASES(colour,alpha,0,0,false,false,false,true,true) }
+		} else {
+			switch (mode) { SPAN_KERNEL_CASES(colour,alpha,0,0,false,true,false,true,true) }
+		}
+	}
+	
+	if (surface->alpha == NULL) {
+		// only B opaque: C's alpha row is set to 255 and doubles as alpha(B)
+		aC = destination->alpha + iC;
+		memset(aC,255,len);
+		aB = aC;
+	} else if (destination->alpha == NULL) {
+		// only C opaque: the resulting alpha goes to a scratch row
+		aB = surface->alpha + i;
+		aC = alphaDiscard;
+	} else {
+		aB = surface->alpha + i;
+		aC = destination->alpha + iC;
+	}
+	if (alpha == NULL) {
+		switch (mode) { SPAN_KERNEL_CASES(colour,NULL,0,alphaScale,false,false,true,false,true) }
+	} else if (alphaScale == 255) {
+		switch (mode) { SPAN_KERNEL_CASES(colour,alpha,0,0,false,false,false,false,true) }
+	} else {
+		switch (mode) { SPAN_KERNEL_CASES(colour,alpha,0,0,false,true,false,false,true) }
+	}
+}
+
+#undef SPAN_KERNEL_CASES
+#undef SPAN_KERNEL_CASES_PREMULTIPLIED
+#undef SPAN_KERNEL_CASES_PREMULTIPLIED_OPAQUE
+
+// bilinear sampling: weights are 8-bit fractions, i.e. all four sum up to 65536;
+// with alpha plane, colours are interpolated premultiplied and divided by alpha
+void surfaceSampleBilinear(Surface *surface, BoundingBox *bb, int32_t u, int32_t v, uint16_t *colour, uint8_t *alpha) {
+	int32_t x0 = u >> 10;
+	int32_t y0 = v >> 10;
+	uint32_t fx = (u & 1023) >> 2;
+	uint32_t fy = (v & 1023) >> 2;
+	int32_t x1 = x0 + 1;
+	int32_t y1 = y0 + 1;
+	if (x0 < bb->min.x) x0 = bb->min.x;
+	if (x1 > bb->max.x) x1 = bb->max.x;
+	if (y0 < bb->min.y) y0 = bb->min.y;
+	if (y1 > bb->max.y) y1 = bb->max.y;
+	
+	const uint16_t i[4] = {
+		y0 * surface->stride + x0, y0 * surface->stride + x1,
+		y1 * surface->stride + x0, y1 * surface->stride + x1
+	};
+	uint32_t w[4] = {
+		(256 - fx) * (256 - fy), fx * (256 - fy),
+		(256 - fx) * fy,         fx * fy
+	};
+	uint32_t sum = 0;
+	uint32_t red = 0, green = 0, blue = 0;
+	uint16_t c;
+	uint8_t k;
+	if (surface->alpha != NULL && (surface->flags & SURFACE_FLAG_PREMULTIPLIED)) {
+		// premultiplied: colours and alpha are interpolated alike, no division needed
+		for (k = 0; k < 4; k++) {
+			c = surface->rgb565[i[k]];
+			sum   += w[k] * surface->alpha[i[k]];
+			red   += w[k] * GETRED(c);
+			green += w[k] * GETGREEN(c);
+			blue  += w[k] * GETBLUE(c);
+		}
+		*alpha = (sum + 32768) >> 16;
+		*colour = (uint16_t)((((red + 32768) >> 16) << 11) | (((green + 32768) >> 16) << 5) | ((blue + 32768) >> 16));
+		return;
+	}
+	if (surface->alpha != NULL) {
+		// alpha-weighted: w*alpha fits into 24 bits, times a channel into 30 bits
+		for (k = 0; k < 4; k++) {
+			w[k] *= surface->alpha[i[k]];
+			sum += w[k];
+		}
+		*alpha = (sum + 32768) >> 16;
+		if (sum == 0) {
+			*colour = surface->rgb565[i[0]];
+			return;
+		}
+	}
+	for (k = 0; k < 4; k++) {
+		c = surface->rgb565[i[k]];
+		red   += w[k] * GETRED(c);
+		green += w[k] * GETGREEN(c);
+		blue  += w[k] * GETBLUE(c);
+	}
+	if (surface->alpha == NULL) {
+		// opaque: weights sum up to 65536, no division needed
+		*colour = (uint16_t)((((red + 32768) >> 16) << 11) | (((green + 32768) >> 16) << 5) | ((blue + 32768) >> 16));
+	} else {
+		*colour = (uint16_t)((((red + (sum >> 1)) / sum) << 11) | (((green + (sum >> 1)) / sum) << 5) | ((blue + (sum >> 1)) / sum));
+	}
 }
 
 
@@ -3,7 +3,7 @@
 /**
  * @file
  * @author Frank Abelbeck <frank.abelbeck@googlemail.com>
- * @version 2020-02-06
+ * @version 2026-10-14
  * 
  * @section License
  * 
@@ -40,8 +40,17 @@
 #define BLEND_XOR     5 ///< blend operation "xor"
 #define BLEND_PLUS    6 ///< blend operation "plus"
 
+#define BLEND_MASK_MODE     0x3f ///< mask of the blend operation bits of a mode value
+#define BLEND_FLAG_PREMULTIPLIED 0x40 ///< mode flag: colours of A are premultiplied by alpha (span functions; set automatically for premultiplied sources)
+#define BLEND_FLAG_BILINEAR 0x80 ///< mode flag: sample sprites bilinearly instead of nearest neighbour (composition functions only)
+
 #define MASK_MEMORY_STEPUP   32 ///< number of cells to add to the mask arrays if enlargement is necessary
 
+#define SURFACE_FLAG_VIEW   0x01 ///< surface flag: planes belong to a parent surface (cf. surfaceView())
+#define SURFACE_FLAG_VIEWED 0x02 ///< surface flag: views onto this surface exist; clones copy the planes
+#define SURFACE_FLAG_PREMULTIPLIED 0x04 ///< surface flag: colours are premultiplied by alpha (cf. surfacePremultiply())
+#define SURFACE_FLAG_NOTRACK 0x08 ///< surface flag: single-colour spans (primitives) on an opaque surface mark all covered tiles instead of comparing pixels
+
 //------------------------------------------------------------------------------
 // macro functions
 //------------------------------------------------------------------------------
@@ -50,6 +59,7 @@
 #define GETGREEN(x)     ( (uint8_t)( ( (x) >> 5 )  & 0x3f ) ) ///< get green component of an RGB565 colour value
 #define GETBLUE(x)      ( (uint8_t)(   (x)         & 0x1f ) ) ///< get blue component of an RGB565 colour value
 #define MKRGB565(r,g,b) ( (uint16_t)( (((r) >> 3) & 0x1f) << 11 | (((g) >> 2) & 0x3f) << 5 | (((b) >> 3) & 0x1f) ) ) ///< calculate an RGB565 colour value from components red/green/blue (each in range [0,255])
+#define DIV255(x)       ( ( ((x) + 128) + (((x) + 128) >> 8) ) >> 8 ) ///< divide an integer in range [0,65535] by 255, rounding to nearest
 
 //------------------------------------------------------------------------------
 // data structures
@@ -61,14 +71,93 @@ typedef struct {
 	uint8_t  alpha;  ///< Transparency information (0=transparent..255=opaque).
 } RGBA5658;
 
-/** Data structure of an image. */
+/** Data structure of a run: a sequence of non-transparent pixels in a row. */
+typedef struct {
+	uint8_t x;        ///< Column of the first pixel.
+	uint8_t len;      ///< Number of pixels.
+	uint8_t isOpaque; ///< True if all pixels have alpha 255, false if all are translucent (alpha 1..254).
+} SurfaceRun;
+
+/** Data structure of a run table (cf. surfaceBuildRuns()).
+ * 
+ * Pixels with alpha 0 are skipped; each row is a list of opaque and
+ * translucent runs, ordered from left to right.
+ */
+typedef struct {
+	uint16_t   nRuns; ///< Number of runs.
+	uint16_t   *row;  ///< Index of the first run of each row; row[height] equals nRuns.
+	SurfaceRun *run;  ///< Run array.
+	uint8_t    xMin;  ///< Ink box: smallest column covered by a run (greater than xMax if there are no runs).
+	uint8_t    yMin;  ///< Ink box: first row with a run.
+	uint8_t    xMax;  ///< Ink box: largest column covered by a run.
+	uint8_t    yMax;  ///< Ink box: last row with a run.
+} SurfaceRuns;
+
+/** Data structure of an image.
+ * 
+ * A surface without alpha plane (alpha == NULL) is opaque: every pixel has
+ * alpha 255. Blending and copying treat it that way without a per-pixel load,
+ * and the resulting alpha of a blend onto an opaque surface is discarded.
+ * 
+ * Pixel (x,y) is found at index y * stride + x of both planes. Planes may be
+ * shared: clones share them with their original until one of them is written
+ * (copy-on-write, reference counter shares), views point into the planes of a
+ * parent surface (flag SURFACE_FLAG_VIEW). Functions which write to a surface
+ * call surfaceUnshare() first; code writing pixels directly has to do the same.
+ * Unsharing also drops the run table, which no longer matches written pixels.
+ * 
+ * Colours are straight by default. With flag SURFACE_FLAG_PREMULTIPLIED, each
+ * colour channel is stored multiplied by the pixel's alpha value; blending
+ * then needs no division, and bilinear sampling no alpha weighting. All blend
+ * functions accept any combination of straight and premultiplied surfaces;
+ * opaque surfaces are the same in both representations.
+ */
 typedef struct {
 	uint8_t width;   ///< Width in pixels.
 	uint8_t height;  ///< Height in pixels.
+	uint8_t stride;  ///< Distance between two rows in pixels (at least width).
+	uint8_t flags;   ///< Combination of SURFACE_FLAG_* values.
 	uint16_t *rgb565; ///< Image data (address of a RGB565 pixel array).
-	uint8_t  *alpha;  ///< Alpha values (address of a byte array; might be NULL).
+	uint8_t  *alpha;  ///< Alpha values (address of a byte array; NULL for opaque surfaces).
+	uint16_t *shares; ///< Number of surfaces sharing the planes (NULL if not shared).
+	SurfaceRuns *runs; ///< Run table used to skip transparent pixels (NULL if none, cf. surfaceBuildRuns()).
 } Surface;
 
+/** Data structure of a colour palette, as used by indexed surfaces.
+ * 
+ * A palette may be shared by several indexed surfaces (reference counter
+ * users); it is freed together with the last of them. Changing an entry
+ * changes all surfaces using the palette without touching their pixels,
+ * e.g. for palette animations.
+ */
+typedef struct {
+	uint16_t size;    ///< Number of entries (1..256).
+	uint16_t users;   ///< Number of references to the palette (cf. paletteRetain(), paletteDestruct()).
+	uint16_t *rgb565; ///< Entry colours (straight RGB565).
+	uint8_t  *alpha;  ///< Entry alpha values (NULL if all entries are opaque).
+} Palette;
+
+/** Data structure of an indexed surface.
+ * 
+ * Each pixel is an index of 1, 2, 4 or 8 bits into a palette. Rows are packed
+ * like PNG scanlines: the leftmost pixel occupies the most significant bits of
+ * a byte, and each row starts at a byte boundary. Pixel (x,y) is found in byte
+ * y * stride + (x * depth) / 8 of the index plane. Indices beyond the palette
+ * size yield black pixels, transparent if the palette has alpha values.
+ * 
+ * Indexed surfaces are a storage format: they are blended onto or expanded
+ * into regular surfaces via palette lookup (cf. surfaceIndexedBlend(),
+ * surfaceIndexedExpand()).
+ */
+typedef struct {
+	uint8_t width;    ///< Width in pixels.
+	uint8_t height;   ///< Height in pixels.
+	uint8_t stride;   ///< Distance between two rows in bytes.
+	uint8_t depth;    ///< Number of bits per pixel (1, 2, 4 or 8).
+	uint8_t *index;   ///< Packed palette indices (address of a byte array).
+	Palette *palette; ///< Palette of the surface.
+} SurfaceIndexed;
+
 /** Data structure of a 2D point.
  * Components are assumed to be pixel-based.
  */
@@ -110,12 +199,22 @@ Surface* surfaceConstruct();
 
 /** Destructor: free any allocated memory in a Surface structure.
  * 
- * This calls free on all pointers and on the Surface structure itself.
+ * This releases the planes (cf. surfaceReleasePlanes()) and calls memoryFree()
+ * on the Surface structure itself.
  * 
  * @param self Pointer to a pointer to a Surface structure.
  */
 void surfaceDestruct(Surface **self);
 
+/** Release the planes of a surface and set its size to zero.
+ * 
+ * Planes are freed unless they are still shared with clones or belong to a
+ * parent surface. Afterwards new planes can be assigned to the surface.
+ * 
+ * @param surface Pointer to a Surface structure.
+ */
+void surfaceReleasePlanes(Surface *surface);
+
 /** Create a surface structure and allocate memory for given dimensions.
  * 
  * @param width Number of pixels in horizontal direction.
@@ -124,25 +223,111 @@ void surfaceDestruct(Surface **self);
  */
 Surface *surfaceSetup(uint8_t width, uint8_t height);
 
+/** Create an opaque surface structure and allocate colour memory for given dimensions.
+ * 
+ * No alpha plane is allocated, saving one byte per pixel.
+ * 
+ * @param width Number of pixels in horizontal direction.
+ * @param height Number of pixels in vertical direction.
+ * @returns A pointer to a Surface structure or NULL if something went wrong.
+ */
+Surface *surfaceSetupOpaque(uint8_t width, uint8_t height);
+
+/** Create a surface structure with premultiplied colours and allocate memory for given dimensions.
+ * 
+ * @param width Number of pixels in horizontal direction.
+ * @param height Number of pixels in vertical direction.
+ * @returns A pointer to a Surface structure or NULL if something went wrong.
+ */
+Surface *surfaceSetupPremultiplied(uint8_t width, uint8_t height);
+
+/** Convert the colours of a surface to premultiplied alpha and set flag
+ * SURFACE_FLAG_PREMULTIPLIED; does nothing if the surface is already premultiplied.
+ * 
+ * @param surface Pointer to a Surface structure.
+ */
+void surfacePremultiply(Surface *surface);
+
 /** Clear a surface by setting all pixels to a given colour and alpha value.
  * 
  * @param surface Pointer to a Surface structure to be modified.
- * @param colour A 16-bit colour value (RGB565).
- * @param alpha An 8-bit alpha value.
+ * @param colour A 16-bit colour value (RGB565, straight; premultiplied with alpha on premultiplied surfaces).
+ * @param alpha An 8-bit alpha value; ignored for opaque surfaces.
  */
 void surfaceClear(Surface *surface, uint16_t colour, uint8_t alpha);
 
-/** Clone an existing surface by creating a new surface of same size and copying
- * all pixels.
+/** Clone an existing surface. The clone of an opaque surface is opaque.
  * 
- * @param surface Pointer to a Surface structure to be modified.
- * @returns A pointer to a Surface structure.
+ * Clone and original share their planes until one of them is written; then
+ * the writing surface receives a copy (cf. surfaceUnshare()). Views and
+ * surfaces with views (SURFACE_FLAG_VIEWED) are copied immediately.
+ * 
+ * @param surface Pointer to a Surface structure.
+ * @returns A pointer to a Surface structure or NULL if something went wrong.
  */
 Surface *surfaceClone(Surface *surface);
 
+/** Create a view: a surface whose planes are a rectangle inside the planes of
+ * a parent surface, i.e. a sub-surface without copying (e.g. one sprite of a
+ * sprite sheet).
+ * 
+ * Writing to the view writes to the parent. The parent has to outlive its
+ * views; it is unshared first (which releases its run table) and can no
+ * longer be cloned without copying.
+ * 
+ * @param parent Pointer to a Surface structure.
+ * @param rect A BoundingBox structure (inclusive, parent coordinates); clipped to the parent.
+ * @returns A pointer to a Surface structure or NULL if something went wrong or rect is empty.
+ */
+Surface *surfaceView(Surface *parent, BoundingBox rect);
+
+/** Make sure that the planes of a surface may be written.
+ * 
+ * If the planes are shared with clones, they are copied first. A run table
+ * is released (cf. surfaceReleaseRuns()).
+ * 
+ * @param surface Pointer to a Surface structure.
+ * @returns True if the planes may be written, false if copying failed.
+ */
+bool surfaceUnshare(Surface *surface);
+
+/** Build the run table of a surface, e.g. of a mostly transparent sprite.
+ * 
+ * With a run table, surfaceBlendPosition() skips transparent pixels and
+ * copies opaque runs, and compose() skips transparent rows and margins, as
+ * long as the mode keeps the destination for transparent pixels (cf.
+ * surfaceBlendSkipsTransparent()). Writing to the surface releases the table;
+ * build it again after the surface has been modified.
+ * 
+ * Writing through a view releases only the view's own table, not the one of
+ * its parent. A table built on a surface with views (SURFACE_FLAG_VIEWED) is
+ * stale after any write through one of the views and must be built again.
+ * 
+ * @param surface Pointer to a Surface structure.
+ * @returns True if the run table was built, false if something went wrong.
+ */
+bool surfaceBuildRuns(Surface *surface);
+
+/** Release the run table of a surface.
+ * 
+ * @param surface Pointer to a Surface structure.
+ */
+void surfaceReleaseRuns(Surface *surface);
+
+/** Check if source pixels with alpha 0 leave the destination unchanged in a
+ * given mode (over, atop, xor and plus).
+ * 
+ * @param mode A mode as defined by BLEND_*; flags are ignored.
+ * @returns True if transparent source pixels may be skipped.
+ */
+bool surfaceBlendSkipsTransparent(uint8_t mode);
+
 /** Copy source surface onto destination surface according to the changes recorded in mask.
  * 
- * Dimensions must match!
+ * Dimensions must match! If source is opaque, the alpha values of destination
+ * are set to 255; if destination is opaque, only colours are copied. Nothing
+ * is copied if destination still shares its planes with source. Colours are
+ * copied as they are, so both surfaces should be either straight or premultiplied.
  * 
  * @param source Pointer to a Surface structure.
  * @param destination Pointer to a Surface structure.
@@ -151,6 +336,10 @@ Surface *surfaceClone(Surface *surface);
 void surfaceCopyMask(Surface *source, Surface *destination, SurfaceMod *mask);
 
 /** Copy one surface onto another at a given position.
+ * 
+ * If source has a run table (cf. surfaceBuildRuns()), only its runs are
+ * blended for modes over, atop, xor and plus; opaque runs in mode over are
+ * copied.
  * 
  * @param source Pointer to a Surface structure.
  * @param destination Pointer to a Surface structure.
@@ -160,6 +349,127 @@ void surfaceCopyMask(Surface *source, Surface *destination, SurfaceMod *mask);
  */
 void surfaceBlendPosition(Surface *source, Surface *destination, Point p, uint8_t mode, SurfaceMod *mask);
 
+/** Constructor: create a palette.
+ * 
+ * All entries are black and opaque; the palette has one user.
+ * 
+ * @param size Number of entries (1..256).
+ * @param hasAlpha If true, entries carry alpha values; otherwise the palette is opaque.
+ * @returns Pointer to a Palette structure or NULL if something went wrong.
+ */
+Palette *paletteConstruct(uint16_t size, bool hasAlpha);
+
+/** Destructor: drop a reference to a palette, free it if it was the last one.
+ * 
+ * @param self Pointer to a pointer to a Palette structure; set to NULL.
+ */
+void paletteDestruct(Palette **self);
+
+/** Add a reference to a palette, e.g. before handing it to another owner.
+ * 
+ * @param palette Pointer to a Palette structure.
+ * @returns The palette.
+ */
+Palette *paletteRetain(Palette *palette);
+
+/** Set a palette entry.
+ * 
+ * The alpha value is ignored for opaque palettes.
+ * 
+ * @param palette Pointer to a Palette structure.
+ * @param index Index of the entry; nothing happens if it is beyond the palette size.
+ * @param colour Straight RGB565 colour.
+ * @param alpha Alpha value.
+ */
+void paletteSetEntry(Palette *palette, uint8_t index, uint16_t colour, uint8_t alpha);
+
+/** Rotate a range of palette entries by one position (colour cycling).
+ * 
+ * Entry first takes the value of entry last and all other entries of the range
+ * move up by one; swap first and last to rotate in the other direction.
+ * 
+ * @param palette Pointer to a Palette structure.
+ * @param first Index of the first entry of the range.
+ * @param last Index of the last entry of the range.
+ */
+void paletteRotate(Palette *palette, uint8_t first, uint8_t last);
+
+/** Constructor: create an indexed surface with all indices set to 0.
+ * 
+ * @param width Width in pixels.
+ * @param height Height in pixels.
+ * @param depth Number of bits per pixel (1, 2, 4 or 8).
+ * @param palette Palette to use (a reference is added); if NULL, an opaque black palette of 2^depth entries is created.
+ * @returns Pointer to a SurfaceIndexed structure or NULL if something went wrong.
+ */
+SurfaceIndexed *surfaceIndexedConstruct(uint8_t width, uint8_t height, uint8_t depth, Palette *palette);
+
+/** Destructor: free the index plane and drop the palette reference.
+ * 
+ * @param self Pointer to a pointer to a SurfaceIndexed structure; set to NULL.
+ */
+void surfaceIndexedDestruct(SurfaceIndexed **self);
+
+/** Replace the palette of an indexed surface (palette swap).
+ * 
+ * @param surface Pointer to a SurfaceIndexed structure.
+ * @param palette Pointer to a Palette structure; a reference is added.
+ */
+void surfaceIndexedSetPalette(SurfaceIndexed *surface, Palette *palette);
+
+/** Get the palette index of a pixel.
+ * 
+ * @param surface Pointer to a SurfaceIndexed structure.
+ * @param x Column; must be less than the width.
+ * @param y Row; must be less than the height.
+ * @returns The palette index.
+ */
+uint8_t surfaceIndexedGetIndex(SurfaceIndexed *surface, uint8_t x, uint8_t y);
+
+/** Set the palette index of a pixel.
+ * 
+ * @param surface Pointer to a SurfaceIndexed structure.
+ * @param x Column; nothing happens if it is not less than the width.
+ * @param y Row; nothing happens if it is not less than the height.
+ * @param index Palette index; bits beyond the depth are ignored.
+ */
+void surfaceIndexedSetIndex(SurfaceIndexed *surface, uint8_t x, uint8_t y, uint8_t index);
+
+/** Look up the colours and alpha values of a span of pixels.
+ * 
+ * The span has to lie inside the surface.
+ * 
+ * @param surface Pointer to a SurfaceIndexed structure.
+ * @param x Column of the first pixel.
+ * @param y Row.
+ * @param len Number of pixels.
+ * @param rgb565 Address of an array of at least len colours.
+ * @param alpha Address of an array of at least len alpha values, or NULL if not needed.
+ */
+void surfaceIndexedLookup(SurfaceIndexed *surface, uint8_t x, uint8_t y, uint8_t len, uint16_t *rgb565, uint8_t *alpha);
+
+/** Blend an indexed surface onto a surface at a given position.
+ * 
+ * Works like surfaceBlendPosition(): rows are looked up into colour spans and
+ * blended with surfaceBlendSpan(); opaque palettes yield opaque spans.
+ * 
+ * @param source Pointer to a SurfaceIndexed structure.
+ * @param destination Pointer to a Surface structure.
+ * @param p A Point structure; upper left starting point on the destination surface.
+ * @param mode A mode as defined by BLEND_*
+ * @param mask Pointer to a SurfaceMod structure where changes to the destination surface are recorded.
+ */
+void surfaceIndexedBlend(SurfaceIndexed *source, Surface *destination, Point p, uint8_t mode, SurfaceMod *mask);
+
+/** Expand an indexed surface into a new surface, e.g. as compose() sprite.
+ * 
+ * The new surface is opaque if the palette is opaque.
+ * 
+ * @param surface Pointer to a SurfaceIndexed structure.
+ * @returns Pointer to a new Surface structure or NULL if something went wrong.
+ */
+Surface *surfaceIndexedExpand(SurfaceIndexed *surface);
+
 /** Create a new BoundingBox with given coordinates.
  * 
  * Minimum point = upper left point when worn on the left, lower right otherwise.
@@ -200,6 +510,29 @@ void surfaceModDestruct(SurfaceMod **mask);
  */
 void surfaceModClear(SurfaceMod *mask);
 
+/** Merge two SurfaceMod structures, i.e. mark all tiles of other in mask, too.
+ * 
+ * @param mask Pointer to a SurfaceMod structure to be modified.
+ * @param other Pointer to a SurfaceMod structure.
+ */
+void surfaceModMerge(SurfaceMod *mask, SurfaceMod *other);
+
+/** Merge the modified tiles of a SurfaceMod structure into a small set of rectangles.
+ * 
+ * Runs of modified tiles in a tile row become rectangles; rectangles with equal
+ * columns in consecutive tile rows are joined. If more than maxRects rectangles
+ * would be needed, remaining runs are merged into the rectangle that grows least,
+ * so the rectangles might cover unmodified tiles, too.
+ * 
+ * Rectangles are tile-aligned and not clipped to the surface width.
+ * 
+ * @param mask Pointer to a SurfaceMod structure.
+ * @param rects Pointer to an array of at least maxRects BoundingBox structures (pixel coordinates).
+ * @param maxRects Maximum number of rectangles.
+ * @returns Number of rectangles written to rects (0 if mask is empty).
+ */
+uint8_t surfaceModGetRects(SurfaceMod *mask, BoundingBox *rects, uint8_t maxRects);
+
 /** Set a sequence of updated pixel in the given SurfaceMod structure.
  * 
  * @param mask Pointer to a SurfaceMod structure.
@@ -281,7 +614,28 @@ BoundingBox surfaceDrawLine(Surface *surface, Point p0, Point p1, uint16_t colou
  */
 BoundingBox surfaceDrawCircle(Surface *surface, Point pm, uint16_t radius, uint16_t colour, uint8_t alpha, uint8_t mode, SurfaceMod *mask);
 
+/** Draw a disc (filled circle) onto the given surface, compositing pixel values with the given blend mode. 
+ * 
+ * Each row is blended as one span; the row extents follow the midpoint circle,
+ * i.e. a disc covers the pixels on and inside the circle of surfaceDrawCircle().
+ * 
+ * @param surface Pointer to a Surface structure to be modified.
+ * @param pm A Point structure describing the centre of the disc.
+ * @param radius Radius of the disc in pixels.
+ * @param colour Colour of the disc, RGB565 format.
+ * @param alpha Transparency value of the disc, in range 0..255.
+ * @param mode A mode as defined by BLEND_*
+ * @param mask Pointer to a SurfaceMod structure where changes to the surface are recorded.
+ * @returns A BoundingBox structure describing the smallest box enclosing this disc.
+ */
+BoundingBox surfaceDrawDisc(Surface *surface, Point pm, uint16_t radius, uint16_t colour, uint8_t alpha, uint8_t mode, SurfaceMod *mask);
+
 /** Draw an arc onto the given surface, compositing pixel values with the given blend mode. 
+ * 
+ * The arc runs from angleStart (inclusive) to angleStop (exclusive) in
+ * direction of increasing angles, i.e. clockwise on the display with 0° pointing
+ * right and 90° pointing down. If both angles are equal (modulo 360), the full
+ * circle is drawn.
  * 
  * @param surface Pointer to a Surface structure to be modified.
  * @param pm A Point structure describing the centre of the arc.
@@ -297,11 +651,17 @@ BoundingBox surfaceDrawCircle(Surface *surface, Point pm, uint16_t radius, uint1
 BoundingBox surfaceDrawArc(Surface *surface, Point pm, uint16_t radius, int16_t angleStart, int16_t angleStop, uint16_t colour, uint8_t alpha, uint8_t mode, SurfaceMod *mask);
 
 /** Draw a sector onto the given surface, compositing pixel values with the given blend mode. 
+ * 
+ * The sector covers all pixels of the disc with radius radiusOuter that are not
+ * part of the disc with radius radiusInner-1, from angleStart (inclusive) to
+ * angleStop (exclusive) as with surfaceDrawArc(). Thus sectors sharing an angle
+ * or a radius don't blend any pixel twice, which allows composing ring gauges.
+ * Each row is blended as at most four spans.
  * 
  * @param surface Pointer to a Surface structure to be modified.
  * @param pm A Point structure describing the centre of the arc.
  * @param radiusOuter Outer radius of the sector in pixels.
- * @param radiusInner Inner radius of the sector in pixels.
+ * @param radiusInner Inner radius of the sector in pixels (0 = pie slice); must not exceed radiusOuter.
  * @param angleStart Start angle of the arc in degrees.
  * @param angleStop Stop angle of the arc in degrees.
  * @param colour Colour of the sector, RGB565 format.
@@ -340,35 +700,35 @@ BoundingBox surfaceDrawTriangle(Surface *surface, Point p0, Point p1, Point p2,
 BoundingBox surfaceDrawRectangle(Surface *surface, Point p0, Point p1, uint16_t colour, uint8_t alpha, uint8_t mode, SurfaceMod *mask); 
 
 
-/** Calculate the tangent for x in range [-45,45].
+/** Calculate the tangent for x in range [-45,45]; cf. mathTangent45().
  * 
  * @param x Integer value in degrees in range [-45,45].
  * @returns Integer result of tan(x) normalised to range [-1024,+1024]; -1024 if x < -45; +1024 if x > 45.
  */
 int16_t surfaceTangent45(int16_t x) ;
 
-/** Calculate the sine for x in range [0,360[.
+/** Calculate the sine of x; cf. mathSine().
  * 
- * @param x Integer value as degrees in range [0,360[.
- * @returns Integer result of sin(x) normalised to range [-1024,+1024]; 0 if x outside range.
+ * @param x Integer value as degrees; any value is mapped to [0,360[.
+ * @returns Integer result of sin(x) normalised to range [-1024,+1024].
  */
 int16_t surfaceSine(int16_t x) ;
 
-/** Calculate the cosine for x in range [0,360[.
+/** Calculate the cosine of x; cf. mathCosine().
  * 
- * @param x Integer value as degrees in range [0,360[.
- * @returns Integer result of cos(x) normalised to range [-1024,+1024]; 0 if x outside range.
+ * @param x Integer value as degrees; any value is mapped to [0,360[.
+ * @returns Integer result of cos(x) normalised to range [-1024,+1024].
  */
 int16_t surfaceCosine(int16_t x) ;
 
-/** Calculate the arcus cosine for x in range [-1024,1024].
+/** Calculate the arcus cosine for x in range [-1024,1024]; cf. mathArcusCosine().
  * 
  * @param x Integer value in range [-1024,1024] (i.e. [-1,1], multiplied by 1024).
  * @returns Integer result of acos(x) in degress [0,180].
  */
 int16_t surfaceArcusCosine(int16_t x);
 
-	/** Image composition function for alpha blending a pixel with another pixel.
+/** Image composition function for alpha blending a pixel with another pixel.
  * 
  * This function calculates "A op B", with "op" depending of the given mode.
  * Details can be found in:
@@ -377,6 +737,9 @@ int16_t surfaceArcusCosine(int16_t x);
  *    ACM New York, NY, USA, 1984; pp. 253-259. 
  *    https://doi.org/10.1145%2F800031.808606
  * 
+ * Alpha values are normalised to 255 and colours are stored non-premultiplied,
+ * i.e. an opaque A "over" B yields A, and a transparent A "over" B yields B.
+ * 
  * @param colourA Colour component of pixel A.
  * @param alphaA Alpha value of pixel A.
  * @param colourB Colour component of pixel B.
@@ -388,6 +751,78 @@ int16_t surfaceArcusCosine(int16_t x);
  */
 bool surfacePixelBlend(uint16_t colourA, uint8_t alphaA, uint16_t colourB, uint8_t alphaB, uint16_t *colourResult, uint8_t *alphaResult, uint8_t mode);
 
+/** Blend a horizontal span of a single colour onto a surface ("B = A op B").
+ * 
+ * The blend mode is resolved once per span. Fully transparent colours are
+ * skipped for modes over/atop/xor/plus, opaque colours are filled for mode over.
+ * No clipping is done: the span has to lie inside the surface. The colour is
+ * straight; it is premultiplied once if the surface is premultiplied.
+ * 
+ * Opaque surfaces with flag SURFACE_FLAG_NOTRACK skip the per-pixel change
+ * detection: every tile covered by a span which is not skipped is reported as
+ * modified. This suits surfaces whose modifications are derived from the
+ * geometry of the drawn shapes anyway, like the band of a DrawList.
+ * 
+ * @param surface Pointer to a Surface structure to be modified.
+ * @param x Column of the first pixel of the span.
+ * @param y Row of the span.
+ * @param len Number of pixels in the span.
+ * @param colour Colour of A, RGB565 format.
+ * @param alpha Transparency value of A, in range 0..255.
+ * @param mode A mode as defined by BLEND_*
+ * @returns A tile bitmask (cf. SurfaceMod) of the modified pixels, to be passed to surfaceModSetRow().
+ */
+uint32_t surfaceBlendSpanColour(Surface *surface, uint8_t x, uint8_t y, uint8_t len, uint16_t colour, uint8_t alpha, uint8_t mode);
+
+/** Blend a horizontal span of pixels ("C = A op B").
+ * 
+ * A is given as consecutive colour and alpha values, e.g. a row of another
+ * surface. B and C are given as surfaces of equal dimensions; both may be the
+ * same surface. The blend mode is resolved once per span. No clipping is done:
+ * the span has to lie inside the surfaces. If B is opaque, its alpha is taken
+ * as 255; if C is opaque, the resulting alpha is discarded.
+ * 
+ * Colours of A are straight unless mode includes BLEND_FLAG_PREMULTIPLIED;
+ * B and C may be straight or premultiplied surfaces. If any of them is
+ * premultiplied, a premultiplied kernel is used, converting straight colours
+ * on the fly; mode over then needs one multiply-add per channel.
+ * 
+ * Premultiplied colours are quantised to RGB565 as well, so the premultiplied
+ * kernel is exact only for opaque results. Compared with straight blending,
+ * a channel differs by at most 2 LSB for results with alpha 192 and above,
+ * 3 LSB from alpha 128, 5 LSB from alpha 64 and 10 LSB from alpha 32; below
+ * that, colours are approximate only.
+ * 
+ * @param colour Pointer to the first colour value of A (RGB565).
+ * @param alpha Pointer to the first alpha value of A; NULL if A is opaque.
+ * @param alphaScale Transparency multiplied with the alpha values of A (255 = A unchanged).
+ * @param surface Pointer to a Surface structure (B).
+ * @param destination Pointer to a Surface structure (C).
+ * @param x Column of the first pixel of the span on B and C.
+ * @param y Row of the span on B and C.
+ * @param len Number of pixels in the span.
+ * @param mode A mode as defined by BLEND_*
+ * @returns A tile bitmask (cf. SurfaceMod) of the modified pixels of C, to be passed to surfaceModSetRow().
+ */
+uint32_t surfaceBlendSpan(const uint16_t *colour, const uint8_t *alpha, uint8_t alphaScale, Surface *surface, Surface *destination, uint8_t x, uint8_t y, uint8_t len, uint8_t mode);
+
+/** Sample a surface bilinearly at a sub-pixel position.
+ * 
+ * Pixel centres are located at integer coordinates. The four neighbouring
+ * pixels are weighted by their distance to the sampling position; neighbours
+ * outside the given bounding box are replaced by the nearest pixel inside it.
+ * Colours are weighted by their alpha values, so that colours of transparent
+ * pixels do not bleed into the result. No further clipping is done: the
+ * position has to lie less than one pixel outside the bounding box.
+ * 
+ * @param surface Pointer to a Surface structure.
+ * @param bb Pointer to a BoundingBox structure inside the surface.
+ * @param u Horizontal position, normalised to 1024 (i.e. 0.5 would be 512).
+ * @param v Vertical position, normalised to 1024.
+ * @param colour Pointer to the resulting colour (RGB565).
+ * @param alpha Pointer to the resulting alpha value; not modified if the surface is opaque.
+ */
+void surfaceSampleBilinear(Surface *surface, BoundingBox *bb, int32_t u, int32_t v, uint16_t *colour, uint8_t *alpha);
 
 void printInt(int32_t value);
 
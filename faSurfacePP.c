@@ -1,7 +1,7 @@
 /**
  * @file
  * @author Frank Abelbeck <frank.abelbeck@googlemail.com>
- * @version 2020-02-12
+ * @version 2026-10-14
  * 
  * @section License
  * 
@@ -25,11 +25,14 @@
  * (CPU-hungry) homogeneous coordinate transformation routines.
  */
 
-#include <stdlib.h> // uses: malloc(), free()
+#include <stddef.h> // uses: NULL
 #include <stdint.h> // uses: int8_t, uint8_t, int16_t, uint16_t, uint32_t
 
 #include "faSurfacePP.h"
 #include "faSurfaceBase.h"
+#include "faMath.h" // uses: mathSineCosine()
+#include "faSurface.h" // uses: compose() for affine matrices
+#include "faProfile.h" // uses: PROFILE_SCOPE()
 
 //------------------------------------------------------------------------------
 // matrix manipulation functions (full version, 3x3 matrix, 3x1 point)
@@ -54,7 +57,7 @@ PointPP mulMatrixPointPP(MatrixPP m, PointPP p) {
 	PointPP result;
 	result.x = (m.xx * p.x + m.xy * p.y + m.xz * p.z) >> 10;
 	result.y = (m.yx * p.x + m.yy * p.y + m.yz * p.z) >> 10;
-	result.z = (m.zx * p.y + m.zy * p.y + m.zz * p.z) >> 10;
+	result.z = (m.zx * p.x + m.zy * p.y + m.zz * p.z) >> 10;
 	return result;
 }
 
@@ -128,9 +131,8 @@ MatrixPP invertMatrixPP(MatrixPP m) {
 // construct a matrix: rotation about origin
 MatrixPP getMatrixRotatePP(int16_t angle) {
 	MatrixPP result;
-	angle = (360 + (angle % 360)) % 360;
-	int16_t ca = surfaceCosine(angle); 
-	int16_t sa = surfaceSine(angle); 
+	int16_t ca,sa;
+	mathSineCosine(angle,&sa,&ca);
 	result.xx = ca;
 	result.xy = -sa;
 	result.xz = 0;
@@ -222,8 +224,26 @@ MatrixPP getMatrixPerspective(int16_t factorX, int16_t factorY, int16_t factorZ)
 // surface composition functions
 //------------------------------------------------------------------------------
 
+// map destination pixel x of a row to sprite coordinates u,v (normalised to 1024);
+// cx,cy,cz: homogeneous sprite coordinates of the row at x = 0;
+// returns the homogeneous z coordinate, 0 if the pixel is mapped to infinity
+static inline int32_t composePPMap(MatrixPP *inverse, int32_t x, int32_t cx, int32_t cy, int32_t cz, int32_t *u, int32_t *v) {
+	int32_t z = inverse->zx * x + cz;
+	if (z != 0) {
+		*u = ((inverse->xx * x + cx) << 10) / z;
+		*v = ((inverse->yx * x + cy) << 10) / z;
+	}
+	return z;
+}
+
+// scale a matrix component by 1024/zz (affine matrix with zz != 1024)
+static inline int32_t composePPNormalise(int32_t value, int32_t zz) {
+	return (zz == 1024) ? value : (int32_t)(((int64_t)value << 10) / zz);
+}
+
 // paint sprite transformed by given matrix on surface, using given transparency value and blend mode
 BoundingBox composePP(Surface *surface, Surface *sprite, Surface *destination, MatrixPP matrix, uint8_t alpha, uint8_t mode, BoundingBox boundingBoxSprite, SurfaceMod *mask) {
+	PROFILE_SCOPE(PROFILE_COMPOSE_PP);
 	// 2020-01-09: move from "3 shears" to "general affine transformation", i.e. p' = A*p
 	//             problem: interpolation
 	//             anti-aliasing/interpolation via blendFractional() does not work
@@ -237,12 +257,27 @@ BoundingBox composePP(Surface *surface, Surface *sprite, Surface *destination, M
 	// 2020-02-05: removed boundingBox return value, using mask parameter instead
 	// 2020-02-06: re-introduced boundingBox return value
 	// 2020-02-11: new meaning of return value: bounding box of _unclipped_ sprite; removing explicit coordinate rounding
+	// 2026-10-14: sampled pixels are gathered into runs and blended via surfaceBlendSpan()
+	// 2026-10-14: exact perspective divide only every COMPOSEPP_STEP pixels, linear
+	//             interpolation inbetween; affine matrices are passed on to compose()
 	
 	if (surface == NULL || sprite == NULL || destination == NULL || mask == NULL || \
 		surface->width != destination->width || surface->height != destination->height || 
 		mask->height != surface->height)
 		return boundingBoxCreate(0,0,0,0);
 	
+	if (matrix.zx == 0 && matrix.zy == 0 && matrix.zz != 0) {
+		// no perspective: use the incremental affine kernel
+		Matrix affine;
+		affine.xx = composePPNormalise(matrix.xx,matrix.zz);
+		affine.xy = composePPNormalise(matrix.xy,matrix.zz);
+		affine.xz = composePPNormalise(matrix.xz,matrix.zz);
+		affine.yx = composePPNormalise(matrix.yx,matrix.zz);
+		affine.yy = composePPNormalise(matrix.yy,matrix.zz);
+		affine.yz = composePPNormalise(matrix.yz,matrix.zz);
+		return compose(surface,sprite,destination,affine,alpha,mode,boundingBoxSprite,mask);
+	}
+	
 	PointPP pMin,pMax,pMod;
 	BoundingBox bb;
 	
@@ -310,53 +345,78 @@ BoundingBox composePP(Surface *surface, Surface *sprite, Surface *destination, M
 	// clip bounding box to surface area
 	uint8_t xMin = (bb.min.x < 0) ? 0 : bb.min.x;
 	uint8_t yMin = (bb.min.y < 0) ? 0 : bb.min.y;
-	uint8_t xMax = (bb.max.x > surface->width) ? surface->width - 1 : bb.max.x;
-	uint8_t yMax = (bb.max.y > surface->height) ? surface->height - 1 : bb.max.y;
+	uint8_t xMax = (bb.max.x >= surface->width) ? surface->width - 1 : bb.max.x;
+	uint8_t yMax = (bb.max.y >= surface->height) ? surface->height - 1 : bb.max.y;
 	
 	// calculate inverse of transformation matrix
 	MatrixPP inverse = invertMatrixPP(matrix);
 	
-	// iterate over boundingBox area of surface
-	uint8_t  x,y;
-	uint16_t iSurface = yMin * surface->width + xMin;
-	uint16_t diSurface = surface->width - (xMax - xMin + 1);
-	uint16_t iSprite;
+	// iterate over boundingBox area of surface; sampled sprite pixels are
+	// gathered into runs and blended as spans (destination = sprite op surface);
+	// sprite coordinates are calculated exactly every COMPOSEPP_STEP pixels and
+	// interpolated linearly inbetween, as long as both ends are well-defined
+	const bool bilinear = (mode & BLEND_FLAG_BILINEAR) != 0;
+	mode &= BLEND_MASK_MODE;
+	if (sprite->flags & SURFACE_FLAG_PREMULTIPLIED) mode |= BLEND_FLAG_PREMULTIPLIED; // sampled colours stay premultiplied
+	int32_t  u,v,uNext,vNext,du,dv,z,zNext,cx,cy,cz,xSprite,ySprite;
+	bool     interpolate = false;
+	uint8_t  x,y,xRun,lenRun;
+	uint16_t runColour[256];
+	uint8_t  runAlpha[256];
+	uint8_t  *alphaRun = (sprite->alpha != NULL) ? runAlpha : NULL; // opaque sprite: no alpha run
 	uint32_t bitmask;
 	for (y = yMin; y <= yMax; y++) {
+		// homogeneous sprite coordinates of the row at x = 0
+		cx = inverse.xy * y + inverse.xz;
+		cy = inverse.yy * y + inverse.yz;
+		cz = inverse.zy * y + inverse.zz;
 		bitmask = 0;
+		lenRun = 0;
+		xRun = xMin;
 		for (x = xMin; x <= xMax; x++) {
-			// calculate sprite coordinates:
-			// 1) apply inverse matrix
-			pMod.x = x << 10;
-			pMod.y = y << 10;
-			pMod.z = 1024;
-			// 2) apply perspective divide if z non-zero (otherwise skip)
-			pMod = mulMatrixPointPP(inverse,pMod);
-			if (pMod.z != 0) {
-				pMod.x = (pMod.x << 10) / pMod.z;
-				pMod.y = (pMod.y << 10) / pMod.z;
-				// 3) de-normalise and round
-				pMod.x = (pMod.x >> 10) + (((pMod.x & 1023) >= 512) ? 1 : 0);
-				pMod.y = (pMod.y >> 10) + (((pMod.y & 1023) >= 512) ? 1 : 0);
-				// 4) check that the sprite coordinates are inside the sprite's bounding box
-				if (pMod.x >= boundingBoxSprite.min.x && pMod.y >= boundingBoxSprite.min.y && \
-					pMod.x <= boundingBoxSprite.max.x && pMod.y <= boundingBoxSprite.max.y) {
-					// 5) calculate pixel index
-					iSprite = pMod.y * sprite->width + pMod.x;
-					// 6) blend pixel (destination = sprite op surface) and add pixel to mask if destination was changed
-					if (surfacePixelBlend(
-						sprite->rgb565[iSprite],(alpha * sprite->alpha[iSprite]) >> 8,
-						surface->rgb565[iSurface],surface->alpha[iSurface],
-						&destination->rgb565[iSurface],&destination->alpha[iSurface],
-						mode)) bitmask |= 1 << (x >> 3); // pixel changed: mark in bitmask
+			// 1) calculate sprite coordinates
+			if (((x - xMin) & (COMPOSEPP_STEP - 1)) == 0) {
+				// start of a segment: exact coordinates at both segment ends; interpolation
+				// requires both ends on the same side of the horizon and not too far away
+				z = composePPMap(&inverse,x,cx,cy,cz,&u,&v);
+				zNext = composePPMap(&inverse,x + COMPOSEPP_STEP,cx,cy,cz,&uNext,&vNext);
+				interpolate = (z != 0 && zNext != 0 && (z > 0) == (zNext > 0) && \
+					u > -COMPOSEPP_LIMIT && u < COMPOSEPP_LIMIT && v > -COMPOSEPP_LIMIT && v < COMPOSEPP_LIMIT && \
+					uNext > -COMPOSEPP_LIMIT && uNext < COMPOSEPP_LIMIT && vNext > -COMPOSEPP_LIMIT && vNext < COMPOSEPP_LIMIT);
+				if (interpolate) {
+					du = (uNext - u) >> COMPOSEPP_STEP_SHIFT;
+					dv = (vNext - v) >> COMPOSEPP_STEP_SHIFT;
+				}
+			} else if (interpolate) {
+				u += du;
+				v += dv;
+			} else {
+				z = composePPMap(&inverse,x,cx,cy,cz,&u,&v);
+			}
+			
+			// 2) de-normalise and round, check that the sprite coordinates are inside the sprite's bounding box
+			xSprite = (u + 512) >> 10;
+			ySprite = (v + 512) >> 10;
+			if ((interpolate || z != 0) && \
+				xSprite >= boundingBoxSprite.min.x && ySprite >= boundingBoxSprite.min.y && \
+				xSprite <= boundingBoxSprite.max.x && ySprite <= boundingBoxSprite.max.y) {
+				// 3) append pixel to the current run
+				if (lenRun == 0) xRun = x;
+				if (bilinear) {
+					surfaceSampleBilinear(sprite,&boundingBoxSprite,u - 512,v - 512,&runColour[lenRun],&runAlpha[lenRun]);
+				} else {
+					runColour[lenRun] = sprite->rgb565[ySprite * sprite->stride + xSprite];
+					if (alphaRun != NULL) alphaRun[lenRun] = sprite->alpha[ySprite * sprite->stride + xSprite];
 				}
+				lenRun++;
+			} else if (lenRun > 0) {
+				// 4) run interrupted: blend it and mark changed pixels in bitmask
+				bitmask |= surfaceBlendSpan(runColour,alphaRun,alpha,surface,destination,xRun,y,lenRun,mode);
+				lenRun = 0;
 			}
-			// next pixel
-			iSurface++;
 		}
-		// skip remainder of line and beginning of next line (xMax --> width, xMin)
+		if (lenRun > 0) bitmask |= surfaceBlendSpan(runColour,alphaRun,alpha,surface,destination,xRun,y,lenRun,mode);
 		surfaceModSetRow(mask,y,bitmask);
-		iSurface += diSurface;
 	}
 	
 	return bb;
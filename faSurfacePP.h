@@ -30,6 +30,14 @@
 #include <stdint.h> // uses: int8_t, uint8_t, int16_t, uint16_t, uint32_t
 #include "faSurfaceBase.h" // uses BoundingBox
 
+//------------------------------------------------------------------------------
+// constants
+//------------------------------------------------------------------------------
+
+#define COMPOSEPP_STEP_SHIFT 4 ///< composePP(): exact perspective divide every 2^n pixels
+#define COMPOSEPP_STEP       (1 << COMPOSEPP_STEP_SHIFT) ///< composePP(): number of pixels per interpolated segment
+#define COMPOSEPP_LIMIT      (1 << 24) ///< composePP(): maximum absolute sprite coordinate (normalised to 1024) for interpolation
+
 //------------------------------------------------------------------------------
 // data structures
 //------------------------------------------------------------------------------
@@ -172,12 +180,18 @@ MatrixPP getMatrixPerspective(int16_t factorX, int16_t factorY, int16_t factorZ)
  *    ACM New York, NY, USA, 1984; pp. 253-259.
  *    https://doi.org/10.1145%2F800031.808606
  * 
+ * Sprite coordinates are calculated with a perspective divide every
+ * COMPOSEPP_STEP pixels and interpolated linearly inbetween. Segments crossing
+ * the horizon (z = 0) are calculated exactly for every pixel. Affine matrices
+ * (zx = zy = 0) are handed over to compose(), so faSurface.c has to be linked, too.
+ * Add BLEND_FLAG_BILINEAR to mode for bilinear sampling.
+ * 
  * @param surface Pointer to a Surface.
  * @param sprite Pointer to a Surface.
  * @param destination Pointer to a Surface.
  * @param matrix 3-by-3 Transformation MatrixPP structure.
  * @param alpha Transparency of the sprite during composition (multiplied with the sprite's own transparency).
- * @param mode A mode as defined by BLEND_*
+ * @param mode A mode as defined by BLEND_*, optionally combined with BLEND_FLAG_BILINEAR.
  * @param boundingBoxSprite BoundingBox of the sprite are that should be displayed; use getBoundingBoxSurface(sprite) to display the entire sprite.
  * @param mask Pointer to a SurfaceMod structure where changes to the surface are recorded.
  * @returns A BoundingBox structure describing the smalles box enclosing the sprite on the surface.
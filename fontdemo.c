@@ -107,6 +107,7 @@ int main(int argc, char **argv) {
 	// variables
 	union disp_framebuffer *framebuffer = NULL;
 	SurfaceMod *mask = NULL;
+	SurfaceMod *maskDisplay = NULL;
 	Surface *background = NULL;
 	Surface *frontbuffer = NULL;
 // 	Surface *sprite = NULL;
@@ -161,6 +162,7 @@ int main(int argc, char **argv) {
 	
 	fontTiny = fontFileLoad("png/faTinyFont.bin");
 	if (fontTiny == NULL) doExit("could not load faTinyFont",-1);
+	if (fontFileTileCacheSetup(fontTiny,64) != RET_FAFF_OK) doExit("could not set up tile cache",-1);
 	fontTiny->distChar = 1;
 	fontTiny->distLine = 1;
 	fontTiny->colour = MKRGB565(0,255,0);
@@ -173,6 +175,8 @@ int main(int argc, char **argv) {
 	puts("creating update mask");
 	mask = surfaceModConstruct(DISP_HEIGHT);
 	if (mask == NULL) doExit("could not set up update mask",-1);
+	maskDisplay = surfaceModConstruct(DISP_HEIGHT);
+	if (maskDisplay == NULL) doExit("could not set up display update mask",-1);
 	
 	// prepare framebuffer and sprite
 	puts("creating framebuffer");
@@ -180,7 +184,7 @@ int main(int argc, char **argv) {
 	if (framebuffer == NULL) doExit("could not set up framebuffer",-1);
 	
 	// set up background image
-	background = pngDataLoad("png/earthrise.png");
+	background = pngDataLoadCached("png/earthrise.png");
 	if (background == NULL) doExit("could not set up background surface",-1);
 	
 	// set up front buffer surface
@@ -188,6 +192,10 @@ int main(int argc, char **argv) {
 	frontbuffer = surfaceClone(background);
 	if (frontbuffer == NULL) doExit("could not set up frontbuffer surface",-1);
 	
+	// initial transfer of the complete background; afterwards only modified tiles are sent
+	framebufferCopySurface(framebuffer,frontbuffer);
+	framebufferRedraw(framebuffer);
+	
 	puts("initialising BME680 climate sensor");
 	switch (epic_bme680_init()) {
 		case -EFAULT:
@@ -329,10 +337,13 @@ int main(int argc, char **argv) {
 		fontFilePrint(frontbuffer,mask,fontTiny,p5,"ori: %i,%i,%i",dataOrientSensor[0].x,dataOrientSensor[0].y,dataOrientSensor[0].z);
 		fontFilePrint(frontbuffer,mask,fontTiny,p6,"dt=%i ms",dt);
 		
-		// update framebuffer
-		framebufferCopySurface(framebuffer,frontbuffer);
-		framebufferRedraw(framebuffer);
+		// update framebuffer: send tiles changed in this frame or restored after the previous one
+		surfaceModMerge(maskDisplay,mask);
+		framebufferUpdateFromSurface(framebuffer,frontbuffer,maskDisplay);
+		framebufferRedrawMask(framebuffer,maskDisplay);
 		surfaceCopyMask(background,frontbuffer,mask);
+		surfaceModClear(maskDisplay);
+		surfaceModMerge(maskDisplay,mask);
 		surfaceModClear(mask);
 		
 		
@@ -0,0 +1,571 @@
+/**
+ * @file
+ * @author Frank Abelbeck <frank.abelbeck@googlemail.com>
+ * @version 2026-10-14
+ * 
+ * @section License
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * @section Description
+ * 
+ * Host-side benchmark and regression suite; run from the repository root.
+ * 
+ *    bench                    time all cases, print calls/s, pixels/s and hashes
+ *    bench --time MS          time each case for MS milliseconds (default 250)
+ *    bench --write FILE       record the golden hashes of all cases in FILE
+ *    bench --check FILE       compare all cases with FILE; exit code 1 on mismatch
+ *    bench NAME...            restrict to cases whose names start with NAME
+ * 
+ * Each case is set up, run BENCH_GOLDEN_RUNS times and hashed (FNV-1a of its
+ * output surface or of the captured display); timing continues from there.
+ * Pixel rates count the display area of the bounding boxes returned by the
+ * functions under test, or whole displays for frames.
+ * If a display case fails the check, its capture is written to NAME.ppm.
+ */
+
+#include <stdio.h> // uses: printf(), fprintf(), fopen(), fclose(), fgets(), sscanf()
+#include <stdlib.h> // uses: strtol()
+#include <string.h> // uses: strcmp(), strncmp(), strlen()
+#include <time.h> // uses: clock_gettime()
+
+#include "epicardium.h"
+#include "faSurfaceBase.h"
+#include "faSurface.h"
+#include "faSurfacePP.h"
+#include "faReadPng.h"
+#include "faFontFile.h"
+#include "faFramebuffer.h"
+#include "faScene.h"
+#include "faDrawList.h"
+#include "faMesh.h"
+#include "faProfile.h"
+
+//------------------------------------------------------------------------------
+// constants
+//------------------------------------------------------------------------------
+#define BENCH_GOLDEN_RUNS 8   ///< runs of a case before its output is hashed
+#define BENCH_TIME_MS     250 ///< default timing duration of a case
+#define BENCH_MAX_GOLDEN  64  ///< maximum number of entries in a golden file
+#define BENCH_NAME_LENGTH 32  ///< maximum length of a case name, terminator included
+
+#define BENCH_UNIT_CALL  0 ///< one run is one call of the function under test
+#define BENCH_UNIT_FRAME 1 ///< one run is one complete frame sent to the display
+
+//------------------------------------------------------------------------------
+// data structures
+//------------------------------------------------------------------------------
+
+/** Data structure of a benchmark case. */
+typedef struct {
+	const char *name; ///< Unique name, used in golden files.
+	uint8_t unit;     ///< One of BENCH_UNIT_*.
+	int16_t param;    ///< Case parameter, passed to setup and run.
+	uint8_t mode;     ///< Blend mode and flags, passed to run.
+	bool (*setup)(int16_t param);
+	uint32_t (*run)(int16_t param, uint8_t mode, uint32_t i); ///< Runs the i-th iteration, returns the number of pixels produced.
+} BenchCase;
+
+/** Data structure of a golden entry. */
+typedef struct {
+	char name[BENCH_NAME_LENGTH];
+	uint32_t hash;
+} BenchGolden;
+
+//------------------------------------------------------------------------------
+// shared state
+//------------------------------------------------------------------------------
+
+static const char *benchPngFiles[] = { "earthrise.png","stars.png","sprite.png","sprite-logo.png","text.png","title.png",
+	"host/stored16.png" }; // stored16: stored DEFLATE blocks, 1 kB window, Adam7, RGBA 16 bit
+
+static Surface *background = NULL; // earthrise.png
+static Surface *sprite = NULL;     // sprite.png
+static Surface *logo = NULL;       // sprite-logo.png
+static Surface *text = NULL;       // text.png
+static Surface *title = NULL;      // title.png
+static FontFileData *font = NULL;  // faTinyFont.bin
+
+static Surface *canvas = NULL;     // destination of surface cases
+static SurfaceMod *mask = NULL;
+static union disp_framebuffer *framebuffer = NULL;
+static Surface *decoded = NULL;    // result of the last PNG case run
+static Surface *output = NULL;     // surface hashed after the golden runs; NULL hashes the display
+static Scene *scene = NULL;
+static SceneLayer *layerTitle = NULL;
+static DrawList *list = NULL;
+static FontLayout *layout = NULL;
+static Mesh *mesh = NULL;
+
+// internal helper function: 32 bit FNV-1a hash of a surface
+static uint32_t benchHashSurface(Surface *surface) {
+	uint32_t hash = 2166136261u;
+	for (uint16_t i = 0; i < surface->width * surface->height; i++) {
+		hash = (hash ^ (surface->rgb565[i] & 0xff)) * 16777619u;
+		hash = (hash ^ (surface->rgb565[i] >> 8)) * 16777619u;
+		hash = (hash ^ ((surface->alpha != NULL) ? surface->alpha[i] : 0xff)) * 16777619u;
+	}
+	return hash;
+}
+
+// internal helper function: 32 bit FNV-1a hash of the captured display
+static uint32_t benchHashDisplay(void) {
+	const uint16_t *pixels = hostDisplayPixels();
+	uint32_t hash = 2166136261u;
+	for (uint16_t i = 0; i < DISP_WIDTH * DISP_HEIGHT; i++) {
+		hash = (hash ^ (pixels[i] & 0xff)) * 16777619u;
+		hash = (hash ^ (pixels[i] >> 8)) * 16777619u;
+	}
+	return hash;
+}
+
+// internal helper function: number of display pixels of a bounding box, 0 if empty
+static uint32_t benchArea(BoundingBox box) {
+	if (box.min.x < 0) box.min.x = 0;
+	if (box.min.y < 0) box.min.y = 0;
+	if (box.max.x >= DISP_WIDTH) box.max.x = DISP_WIDTH - 1;
+	if (box.max.y >= DISP_HEIGHT) box.max.y = DISP_HEIGHT - 1;
+	if (box.max.x < box.min.x || box.max.y < box.min.y) return 0;
+	return (uint32_t)(box.max.x - box.min.x + 1) * (uint32_t)(box.max.y - box.min.y + 1);
+}
+
+// internal helper function: monotonic clock in nanoseconds
+static uint64_t benchNanoseconds(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+// internal helper function: matrix placing a surface's centre at (x,y), rotated and scaled
+static Matrix benchMatrixCentre(Surface *surface, int16_t x, int16_t y, int16_t angle, int16_t scale) {
+	Matrix matrix = getMatrixTranslate(-surface->width/2,-surface->height/2);
+	matrix = mulMatrixMatrix(getMatrixScale(scale,scale),matrix);
+	matrix = mulMatrixMatrix(getMatrixRotate(angle),matrix);
+	return mulMatrixMatrix(getMatrixTranslate(x,y),matrix);
+}
+
+// internal helper function: release all per-case state
+static void benchTeardown(void) {
+	if (canvas != NULL) surfaceDestruct(&canvas);
+	if (decoded != NULL) surfaceDestruct(&decoded);
+	if (mask != NULL) surfaceModDestruct(&mask);
+	if (framebuffer != NULL) framebufferDestruct(&framebuffer);
+	if (scene != NULL) sceneDestruct(&scene);
+	if (list != NULL) drawListDestruct(&list);
+	if (layout != NULL) fontLayoutDestruct(&layout);
+	if (mesh != NULL) meshDestruct(&mesh);
+	layerTitle = NULL;
+	output = NULL;
+}
+
+// internal helper function: set up a fresh canvas showing the background
+static bool benchSetupCanvas(int16_t param) {
+	canvas = surfaceClone(background);
+	mask = surfaceModConstruct(DISP_HEIGHT);
+	output = canvas;
+	return canvas != NULL && mask != NULL;
+}
+
+// internal helper function: restore the canvas where the last run changed it
+static void benchRestoreCanvas(void) {
+	surfaceCopyMask(background,canvas,mask);
+	surfaceModClear(mask);
+}
+
+//------------------------------------------------------------------------------
+// PNG decoding
+//------------------------------------------------------------------------------
+
+static bool benchSetupPng(int16_t param) {
+	output = NULL;
+	return true;
+}
+
+static uint32_t benchRunPng(int16_t param, uint8_t mode, uint32_t i) {
+	if (decoded != NULL) surfaceDestruct(&decoded);
+	decoded = pngDataLoad((char*)benchPngFiles[param]);
+	output = decoded;
+	return (decoded != NULL) ? decoded->width * decoded->height : 0;
+}
+
+//------------------------------------------------------------------------------
+// composition
+//------------------------------------------------------------------------------
+
+static uint32_t benchRunCompose(int16_t param, uint8_t mode, uint32_t i) {
+	benchRestoreCanvas();
+	Matrix matrix = benchMatrixCentre(sprite,80,40,param,2048);
+	return benchArea(compose(canvas,sprite,canvas,matrix,255,mode,boundingBoxGet(sprite),mask));
+}
+
+static uint32_t benchRunComposeLogo(int16_t param, uint8_t mode, uint32_t i) {
+	benchRestoreCanvas();
+	Matrix matrix = benchMatrixCentre(logo,80,40,param,768);
+	return benchArea(compose(canvas,logo,canvas,matrix,200,mode,boundingBoxGet(logo),mask));
+}
+
+static uint32_t benchRunComposePP(int16_t param, uint8_t mode, uint32_t i) {
+	// star wars crawl: text plane tilted away from the viewer, half scrolled in
+	benchRestoreCanvas();
+	MatrixPP matrix = getMatrixTranslatePP(-text->width/2,-64-text->height/2);
+	matrix = mulMatrixMatrixPP(getMatrixPerspective(0,param,256),matrix);
+	matrix = mulMatrixMatrixPP(getMatrixTranslatePP(DISP_WIDTH/2,200),matrix);
+	return benchArea(composePP(canvas,text,canvas,matrix,255,mode,boundingBoxGet(text),mask));
+}
+
+//------------------------------------------------------------------------------
+// primitives and text
+//------------------------------------------------------------------------------
+
+static uint32_t benchRunPrimitive(int16_t param, uint8_t mode, uint32_t i) {
+	benchRestoreCanvas();
+	Point pm = createPoint(80,40);
+	Point p0 = createPoint(10 + (i & 7),5);
+	Point p1 = createPoint(150,75 - (i & 7));
+	Point p2 = createPoint(30,70);
+	uint8_t alpha = (i & 1) ? 255 : 128;
+	switch (param) {
+		case 0: return benchArea(surfaceDrawLine(canvas,p0,p1,0xf800,alpha,mode,mask));
+		case 1: return benchArea(surfaceDrawTriangle(canvas,p0,p1,p2,0x07e0,alpha,mode,mask));
+		case 2: return benchArea(surfaceDrawRectangle(canvas,p0,p1,0x001f,alpha,mode,mask));
+		case 3: return benchArea(surfaceDrawCircle(canvas,pm,36,0xffff,alpha,mode,mask));
+		case 4: return benchArea(surfaceDrawDisc(canvas,pm,36,0xffe0,alpha,mode,mask));
+		case 5: return benchArea(surfaceDrawArc(canvas,pm,36,i,i + 120,0xf81f,alpha,mode,mask));
+		case 6: return benchArea(surfaceDrawSector(canvas,pm,36,24,i,i + 120,0x07ff,alpha,mode,mask));
+		default: return 0;
+	}
+}
+
+static uint32_t benchRunFont(int16_t param, uint8_t mode, uint32_t i) {
+	benchRestoreCanvas();
+	font->colourBg = 0x0000;
+	font->alphaBg = (uint8_t)param;
+	return benchArea(fontFilePrint(canvas,mask,font,createPoint(2,2),"Frame %i: äöü ÄÖÜ ß\nThe quick brown fox\njumps over the lazy dog.\t%i%%",(int)(i & 7),42));
+}
+
+//------------------------------------------------------------------------------
+// demo frames
+//------------------------------------------------------------------------------
+
+static bool benchSetupDemo(int16_t param) {
+	if (!benchSetupCanvas(param)) return false;
+	framebuffer = framebufferConstruct(0);
+	output = NULL;
+	return framebuffer != NULL;
+}
+
+static uint32_t benchRunDemoSprites(int16_t param, uint8_t mode, uint32_t i) {
+	// surfacedemo: bouncing rotating sprite, pulsing logo, rotating arcs
+	int16_t angle = (int16_t)(i * 7);
+	Point pm = createPoint(80,40);
+	Matrix matrix = benchMatrixCentre(sprite,20 + (i * 5) % 120,20 + (i * 3) % 40,angle,1024);
+	compose(background,sprite,canvas,matrix,255 - (i & 63),BLEND_OVER,boundingBoxGet(sprite),mask);
+	matrix = getMatrixTranslate(-logo->width/2,-logo->height/2);
+	matrix = mulMatrixMatrix(getMatrixScale(256 + (i & 255),512),matrix);
+	matrix = mulMatrixMatrix(getMatrixTranslate(80,40),matrix);
+	compose(canvas,logo,canvas,matrix,255,BLEND_OVER,boundingBoxGet(logo),mask);
+	surfaceDrawLine(canvas,pm,createPoint(80 + surfaceCosine(angle)/32,40 + surfaceSine(angle)/32),0x0fff,0xff,BLEND_OVER,mask);
+	surfaceDrawArc(canvas,pm,32,angle,angle + 120,0xffff,0xff,BLEND_OVER,mask);
+	surfaceDrawArc(canvas,pm,28,angle - 60,angle + 60,0xffff,0xff,BLEND_OVER,mask);
+	surfaceDrawArc(canvas,pm,24,angle - 120,angle - 60,0xffff,0xff,BLEND_OVER,mask);
+	framebufferCopySurface(framebuffer,canvas);
+	framebufferRedraw(framebuffer);
+	benchRestoreCanvas();
+	return DISP_WIDTH * DISP_HEIGHT;
+}
+
+static bool benchSetupDemoScene(int16_t param) {
+	if (!benchSetupDemo(param)) return false;
+	scene = sceneConstruct(2,0);
+	if (scene == NULL) return false;
+	sceneAddSurface(scene,background,createPoint(0,0),BLEND_OVER);
+	layerTitle = sceneAddSprite(scene,title,getMatrixTranslate(0,0),255,BLEND_OVER);
+	return layerTitle != NULL;
+}
+
+static uint32_t benchRunDemoScene(int16_t param, uint8_t mode, uint32_t i) {
+	// surfacedemo: shrinking title, only changed tiles are rendered and sent
+	int16_t scale = 1024 - (int16_t)((i * 8) & 1023);
+	sceneLayerSetMatrix(layerTitle,benchMatrixCentre(title,80,40,0,scale));
+	sceneLayerSetAlpha(layerTitle,(scale > 255) ? 255 : scale);
+	sceneRender(scene,framebuffer,mask);
+	framebufferRedrawMask(framebuffer,mask);
+	surfaceModClear(mask);
+	return DISP_WIDTH * DISP_HEIGHT;
+}
+
+static bool benchSetupDemoCube(int16_t param) {
+	if (!benchSetupDemo(param)) return false;
+	mesh = meshConstruct(8,12);
+	if (mesh == NULL) return false;
+	static const uint16_t indices[36] = {
+		0,2,4, 2,6,4, 1,5,3, 5,7,3, 0,4,1, 4,5,1,
+		2,3,6, 3,7,6, 0,1,2, 1,3,2, 4,6,5, 6,7,5
+	};
+	static const uint16_t colours[6] = { 0xf800,0xffe0,0x07e0,0x07ff,0x001f,0xf81f };
+	for (uint8_t k = 0; k < 8; k++) {
+		mesh->vertices[k].x = (k & 1) ? -1024 : 1024;
+		mesh->vertices[k].y = (k & 2) ? -1024 : 1024;
+		mesh->vertices[k].z = (k & 4) ? -1024 : 1024;
+	}
+	for (uint8_t k = 0; k < 36; k++) mesh->indices[k] = indices[k];
+	for (uint8_t k = 0; k < 12; k++) {
+		mesh->colour[k] = colours[k >> 1];
+		mesh->alpha[k] = 255;
+	}
+	return true;
+}
+
+static uint32_t benchRunDemoCube(int16_t param, uint8_t mode, uint32_t i) {
+	// triangledemo: rotating cube, full frame copy
+	MeshCamera camera = {80,40,1024,1024,1};
+	Matrix3D rotation = getMatrix3DRotate(i,i * 2,i * 3);
+	rotation.zw = 65536;
+	meshDraw(canvas,mesh,rotation,camera,MESH_CULL_BACK,BLEND_OVER,mask);
+	framebufferCopySurface(framebuffer,canvas);
+	framebufferRedraw(framebuffer);
+	benchRestoreCanvas();
+	return DISP_WIDTH * DISP_HEIGHT;
+}
+
+static bool benchSetupDemoDrawList(int16_t param) {
+	if (!benchSetupDemo(param)) return false;
+	list = drawListConstruct(32,0);
+	layout = fontLayoutConstruct(64);
+	return list != NULL && layout != NULL;
+}
+
+static uint32_t benchRunDemoDrawList(int16_t param, uint8_t mode, uint32_t i) {
+	// dashboard: background, gauges and text, replayed band by band
+	int16_t angle = (int16_t)(i * 5);
+	drawListClear(list);
+	drawListSurface(list,background,createPoint(0,0),BLEND_OVER);
+	drawListRectangle(list,createPoint(0,0),createPoint(159,11),0x0000,160,BLEND_OVER);
+	drawListSector(list,createPoint(40,48),28,20,0,angle % 360,0x07e0,255,BLEND_OVER);
+	drawListSector(list,createPoint(120,48),28,20,0,(angle * 2) % 360,0xf800,255,BLEND_OVER);
+	drawListCircle(list,createPoint(40,48),30,0xffff,255,BLEND_OVER);
+	drawListCircle(list,createPoint(120,48),30,0xffff,255,BLEND_OVER);
+	drawListSprite(list,sprite,benchMatrixCentre(sprite,80,48,angle,1024),255,BLEND_OVER,boundingBoxGet(sprite));
+	fontFileMeasure(layout,font,"frame %i",(int)i);
+	drawListText(list,font,layout,createPoint(2,2));
+	drawListCull(list);
+	drawListRender(list,framebuffer,NULL);
+	framebufferRedraw(framebuffer);
+	return DISP_WIDTH * DISP_HEIGHT;
+}
+
+//------------------------------------------------------------------------------
+// case table
+//------------------------------------------------------------------------------
+
+static const BenchCase benchCases[] = {
+	{ "png-earthrise",       BENCH_UNIT_CALL,  0,  0,                               benchSetupPng,          benchRunPng },
+	{ "png-stars",           BENCH_UNIT_CALL,  1,  0,                               benchSetupPng,          benchRunPng },
+	{ "png-sprite",          BENCH_UNIT_CALL,  2,  0,                               benchSetupPng,          benchRunPng },
+	{ "png-sprite-logo",     BENCH_UNIT_CALL,  3,  0,                               benchSetupPng,          benchRunPng },
+	{ "png-text",            BENCH_UNIT_CALL,  4,  0,                               benchSetupPng,          benchRunPng },
+	{ "png-title",           BENCH_UNIT_CALL,  5,  0,                               benchSetupPng,          benchRunPng },
+	{ "png-stored16",        BENCH_UNIT_CALL,  6,  0,                               benchSetupPng,          benchRunPng },
+	{ "compose-0",           BENCH_UNIT_CALL,  0,  BLEND_OVER,                      benchSetupCanvas,       benchRunCompose },
+	{ "compose-30",          BENCH_UNIT_CALL,  30, BLEND_OVER,                      benchSetupCanvas,       benchRunCompose },
+	{ "compose-45",          BENCH_UNIT_CALL,  45, BLEND_OVER,                      benchSetupCanvas,       benchRunCompose },
+	{ "compose-90",          BENCH_UNIT_CALL,  90, BLEND_OVER,                      benchSetupCanvas,       benchRunCompose },
+	{ "compose-135",         BENCH_UNIT_CALL,  135,BLEND_OVER,                      benchSetupCanvas,       benchRunCompose },
+	{ "compose-30-bilinear", BENCH_UNIT_CALL,  30, BLEND_OVER | BLEND_FLAG_BILINEAR,benchSetupCanvas,       benchRunCompose },
+	{ "compose-logo-0",      BENCH_UNIT_CALL,  0,  BLEND_OVER,                      benchSetupCanvas,       benchRunComposeLogo },
+	{ "compose-logo-45",     BENCH_UNIT_CALL,  45, BLEND_OVER,                      benchSetupCanvas,       benchRunComposeLogo },
+	{ "composePP-2",         BENCH_UNIT_CALL,  -2, BLEND_OVER,                      benchSetupCanvas,       benchRunComposePP },
+	{ "composePP-3",         BENCH_UNIT_CALL,  -3, BLEND_OVER,                      benchSetupCanvas,       benchRunComposePP },
+	{ "composePP-4",         BENCH_UNIT_CALL,  -4, BLEND_OVER,                      benchSetupCanvas,       benchRunComposePP },
+	{ "composePP-4-bilinear",BENCH_UNIT_CALL,  -4, BLEND_OVER | BLEND_FLAG_BILINEAR,benchSetupCanvas,       benchRunComposePP },
+	{ "line",                BENCH_UNIT_CALL,  0,  BLEND_OVER,                      benchSetupCanvas,       benchRunPrimitive },
+	{ "triangle",            BENCH_UNIT_CALL,  1,  BLEND_OVER,                      benchSetupCanvas,       benchRunPrimitive },
+	{ "rectangle",           BENCH_UNIT_CALL,  2,  BLEND_OVER,                      benchSetupCanvas,       benchRunPrimitive },
+	{ "circle",              BENCH_UNIT_CALL,  3,  BLEND_OVER,                      benchSetupCanvas,       benchRunPrimitive },
+	{ "disc",                BENCH_UNIT_CALL,  4,  BLEND_OVER,                      benchSetupCanvas,       benchRunPrimitive },
+	{ "arc",                 BENCH_UNIT_CALL,  5,  BLEND_OVER,                      benchSetupCanvas,       benchRunPrimitive },
+	{ "sector",              BENCH_UNIT_CALL,  6,  BLEND_OVER,                      benchSetupCanvas,       benchRunPrimitive },
+	{ "triangle-xor",        BENCH_UNIT_CALL,  1,  BLEND_XOR,                       benchSetupCanvas,       benchRunPrimitive },
+	{ "font",                BENCH_UNIT_CALL,  0,  0,                               benchSetupCanvas,       benchRunFont },
+	{ "font-background",     BENCH_UNIT_CALL,  128,0,                               benchSetupCanvas,       benchRunFont },
+	{ "demo-sprites",        BENCH_UNIT_FRAME, 0,  0,                               benchSetupDemo,         benchRunDemoSprites },
+	{ "demo-scene",          BENCH_UNIT_FRAME, 0,  0,                               benchSetupDemoScene,    benchRunDemoScene },
+	{ "demo-cube",           BENCH_UNIT_FRAME, 0,  0,                               benchSetupDemoCube,     benchRunDemoCube },
+	{ "demo-drawlist",       BENCH_UNIT_FRAME, 0,  0,                               benchSetupDemoDrawList, benchRunDemoDrawList },
+};
+
+#define BENCH_CASES (sizeof(benchCases) / sizeof(benchCases[0]))
+
+//------------------------------------------------------------------------------
+// golden files
+//------------------------------------------------------------------------------
+
+// internal helper function: read a golden file; returns the number of entries or -1
+static int16_t benchGoldenRead(const char *filename, BenchGolden *golden) {
+	FILE *file = fopen(filename,"r");
+	if (file == NULL) return -1;
+	char line[128];
+	int16_t n = 0;
+	while (n < BENCH_MAX_GOLDEN && fgets(line,sizeof(line),file) != NULL) {
+		// skip comments and empty lines
+		if (line[0] == '#' || line[0] == '\n') continue;
+		if (sscanf(line,"%31s %x",golden[n].name,&golden[n].hash) == 2) n++;
+	}
+	fclose(file);
+	return n;
+}
+
+// internal helper function: look up a golden hash; false if not recorded
+static bool benchGoldenFind(BenchGolden *golden, int16_t n, const char *name, uint32_t *hash) {
+	for (int16_t i = 0; i < n; i++) {
+		if (strcmp(golden[i].name,name) == 0) {
+			*hash = golden[i].hash;
+			return true;
+		}
+	}
+	return false;
+}
+
+//------------------------------------------------------------------------------
+// main
+//------------------------------------------------------------------------------
+
+// internal helper function: true if a case is selected by the name filters
+static bool benchSelected(const char *name, char **filters, int nFilters) {
+	if (nFilters == 0) return true;
+	for (int i = 0; i < nFilters; i++) {
+		if (strncmp(name,filters[i],strlen(filters[i])) == 0) return true;
+	}
+	return false;
+}
+
+int main(int argc, char **argv) {
+	const char *filenameCheck = NULL;
+	const char *filenameWrite = NULL;
+	uint32_t timeMs = BENCH_TIME_MS;
+	char *filters[BENCH_CASES];
+	int nFilters = 0;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i],"--check") == 0 && i + 1 < argc) filenameCheck = argv[++i];
+		else if (strcmp(argv[i],"--write") == 0 && i + 1 < argc) filenameWrite = argv[++i];
+		else if (strcmp(argv[i],"--time") == 0 && i + 1 < argc) timeMs = (uint32_t)strtol(argv[++i],NULL,10);
+		else if (argv[i][0] != '-' && nFilters < (int)BENCH_CASES) filters[nFilters++] = argv[i];
+		else {
+			fprintf(stderr,"usage: %s [--time MS] [--check FILE | --write FILE] [NAME...]\n",argv[0]);
+			return 2;
+		}
+	}
+
+	BenchGolden golden[BENCH_MAX_GOLDEN];
+	int16_t nGolden = 0;
+	if (filenameCheck != NULL) {
+		nGolden = benchGoldenRead(filenameCheck,golden);
+		if (nGolden < 0) {
+			fprintf(stderr,"could not read %s\n",filenameCheck);
+			return 2;
+		}
+	}
+	FILE *fileWrite = NULL;
+	if (filenameWrite != NULL) {
+		fileWrite = fopen(filenameWrite,"w");
+		if (fileWrite == NULL) {
+			fprintf(stderr,"could not write %s\n",filenameWrite);
+			return 2;
+		}
+		fprintf(fileWrite,"# golden hashes of host/bench (FNV-1a), %u runs per case\n",BENCH_GOLDEN_RUNS);
+	}
+
+	background = pngDataLoad("earthrise.png");
+	sprite = pngDataLoad("sprite.png");
+	logo = pngDataLoad("sprite-logo.png");
+	text = pngDataLoad("text.png");
+	title = pngDataLoad("title.png");
+	font = fontFileLoad("faTinyFont/faTinyFont.bin");
+	if (background == NULL || sprite == NULL || logo == NULL || text == NULL || title == NULL || font == NULL) {
+		fprintf(stderr,"could not load assets; run from the repository root\n");
+		return 2;
+	}
+	PROFILE_INIT();
+
+	bool timed = (filenameCheck == NULL && filenameWrite == NULL);
+	uint16_t nFailed = 0;
+	uint32_t hash,hashGolden;
+	if (timed) printf("%-21s %8s %12s %14s %10s\n","case","us/run","runs/s","pixels/s","hash");
+
+	for (uint16_t c = 0; c < BENCH_CASES; c++) {
+		const BenchCase *bench = &benchCases[c];
+		if (!benchSelected(bench->name,filters,nFilters)) continue;
+		if (!bench->setup(bench->param)) {
+			fprintf(stderr,"%s: setup failed\n",bench->name);
+			benchTeardown();
+			nFailed++;
+			continue;
+		}
+
+		// golden runs, then hash of the output
+		uint32_t i;
+		for (i = 0; i < BENCH_GOLDEN_RUNS; i++) bench->run(bench->param,bench->mode,i);
+		hash = (output != NULL) ? benchHashSurface(output) : benchHashDisplay();
+
+		if (fileWrite != NULL) fprintf(fileWrite,"%s %08x\n",bench->name,hash);
+
+		if (filenameCheck != NULL) {
+			if (!benchGoldenFind(golden,nGolden,bench->name,&hashGolden)) {
+				printf("FAIL %-21s %08x (no golden entry)\n",bench->name,hash);
+				nFailed++;
+			} else if (hash != hashGolden) {
+				printf("FAIL %-21s %08x (expected %08x)\n",bench->name,hash,hashGolden);
+				if (output == NULL) {
+					char filename[BENCH_NAME_LENGTH + 4];
+					snprintf(filename,sizeof(filename),"%s.ppm",bench->name);
+					hostDisplayWritePpm(filename);
+				}
+				nFailed++;
+			} else {
+				printf("OK   %-21s %08x\n",bench->name,hash);
+			}
+		}
+
+		if (timed) {
+			// repeat runs until the time is up, checking the clock every few runs
+			uint64_t pixels = 0;
+			uint32_t runs = 0;
+			uint64_t start = benchNanoseconds();
+			uint64_t elapsed;
+			do {
+				for (uint8_t k = 0; k < 8; k++, i++, runs++) pixels += bench->run(bench->param,bench->mode,i);
+				PROFILE_FRAME();
+				elapsed = benchNanoseconds() - start;
+			} while (elapsed < (uint64_t)timeMs * 1000000u);
+			double seconds = elapsed / 1e9;
+			printf("%-21s %8.2f %12.0f %14.0f %08x %s\n",bench->name,
+				seconds * 1e6 / runs,runs / seconds,pixels / seconds,hash,
+				(bench->unit == BENCH_UNIT_FRAME) ? "frames" : "calls");
+		}
+		benchTeardown();
+	}
+
+	if (fileWrite != NULL) fclose(fileWrite);
+	if (filenameCheck != NULL) printf("%u case(s) failed\n",nFailed);
+	if (timed) PROFILE_PRINT();
+
+	surfaceDestruct(&background);
+	surfaceDestruct(&sprite);
+	surfaceDestruct(&logo);
+	surfaceDestruct(&text);
+	surfaceDestruct(&title);
+	fontFileDestruct(&font);
+	return (nFailed > 0) ? 1 : 0;
+}
@@ -0,0 +1,197 @@
+/**
+ * @file
+ * @author Frank Abelbeck <frank.abelbeck@googlemail.com>
+ * @version 2026-10-14
+ * 
+ * @section License
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * @section Description
+ * 
+ * Host shim of the Epicardium API.
+ */
+
+#include <stdio.h> // uses: FILE, fopen(), fclose(), fread(), fwrite(), fseek(), ftell()
+#include <stdlib.h> // uses: exit()
+#include <time.h> // uses: clock_gettime(), nanosleep()
+#include <sys/stat.h> // uses: stat()
+
+#include "epicardium.h"
+
+//------------------------------------------------------------------------------
+// shim state
+//------------------------------------------------------------------------------
+
+static FILE *hostFiles[HOST_MAX_FILES];
+static uint16_t hostDisplay[DISP_WIDTH * DISP_HEIGHT]; // screen coordinates, native RGB565
+static uint32_t hostFrames = 0;
+static uint64_t hostBytes = 0;
+static bool hostIsOpen = false;
+
+// internal helper function: file of a descriptor; NULL if invalid
+static FILE *hostFile(int fd) {
+	return (fd >= 0 && fd < HOST_MAX_FILES) ? hostFiles[fd] : NULL;
+}
+
+//------------------------------------------------------------------------------
+// file functions
+//------------------------------------------------------------------------------
+
+int epic_file_open(const char *filename, const char *modeString) {
+	for (int fd = 0; fd < HOST_MAX_FILES; fd++) {
+		if (hostFiles[fd] != NULL) continue;
+		hostFiles[fd] = fopen(filename,modeString);
+		return (hostFiles[fd] != NULL) ? fd : -ENOENT;
+	}
+	return -EMFILE;
+}
+
+int epic_file_close(int fd) {
+	FILE *file = hostFile(fd);
+	if (file == NULL) return -EBADF;
+	fclose(file);
+	hostFiles[fd] = NULL;
+	return 0;
+}
+
+int epic_file_read(int fd, void *buf, size_t nbytes) {
+	FILE *file = hostFile(fd);
+	if (file == NULL) return -EBADF;
+	return (int)fread(buf,1,nbytes,file);
+}
+
+int epic_file_write(int fd, const void *buf, size_t nbytes) {
+	FILE *file = hostFile(fd);
+	if (file == NULL) return -EBADF;
+	return (int)fwrite(buf,1,nbytes,file);
+}
+
+int epic_file_seek(int fd, long offset, int whence) {
+	FILE *file = hostFile(fd);
+	if (file == NULL) return -EBADF;
+	return (fseek(file,offset,whence) == 0) ? 0 : -EINVAL;
+}
+
+int epic_file_tell(int fd) {
+	FILE *file = hostFile(fd);
+	if (file == NULL) return -EBADF;
+	return (int)ftell(file);
+}
+
+int epic_file_stat(const char *path, struct epic_stat *stat) {
+	struct stat st;
+	if (path == NULL || stat == NULL) return -EINVAL;
+	if (lstat(path,&st) != 0) return -ENOENT;
+	stat->type = S_ISDIR(st.st_mode) ? EPICSTAT_DIR : EPICSTAT_FILE;
+	stat->size = (uint32_t)st.st_size;
+	stat->name[0] = '\0';
+	return 0;
+}
+
+//------------------------------------------------------------------------------
+// display functions
+//------------------------------------------------------------------------------
+
+int epic_disp_open(void) {
+	if (hostIsOpen) return -EBUSY;
+	hostIsOpen = true;
+	return 0;
+}
+
+int epic_disp_close(void) {
+	hostIsOpen = false;
+	return 0;
+}
+
+int epic_disp_update(void) {
+	hostFrames++;
+	return 0;
+}
+
+int epic_disp_framebuffer(union disp_framebuffer *fb) {
+	if (fb == NULL) return -EINVAL;
+	// framebuffer pixels are stored in reversed order, big endian
+	for (uint16_t i = 0; i < DISP_WIDTH * DISP_HEIGHT; i++) {
+		uint16_t iRaw = (DISP_WIDTH * DISP_HEIGHT - 1 - i) << 1;
+		hostDisplay[i] = ((uint16_t)fb->raw[iRaw] << 8) | fb->raw[iRaw + 1];
+	}
+	hostBytes += sizeof(fb->raw);
+	hostFrames++;
+	return 0;
+}
+
+int epic_disp_blit(int16_t x, int16_t y, int16_t width, int16_t height, void *img, enum epic_rgb_format format) {
+	if (img == NULL || format != EPIC_RGB565) return -EINVAL;
+	const uint16_t *pixels = (const uint16_t*)img;
+	for (int16_t row = 0; row < height; row++) {
+		for (int16_t col = 0; col < width; col++) {
+			if (x + col >= 0 && x + col < DISP_WIDTH && y + row >= 0 && y + row < DISP_HEIGHT)
+				hostDisplay[(y + row) * DISP_WIDTH + x + col] = pixels[row * width + col];
+		}
+	}
+	hostBytes += (uint64_t)width * height * 2;
+	return 0;
+}
+
+//------------------------------------------------------------------------------
+// system functions
+//------------------------------------------------------------------------------
+
+uint64_t epic_rtc_get_milliseconds(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+int epic_sleep(uint32_t ms) {
+	struct timespec ts = { ms / 1000, (long)(ms % 1000) * 1000000 };
+	nanosleep(&ts,NULL);
+	return 0;
+}
+
+void epic_exit(int ret) {
+	exit(ret);
+}
+
+//------------------------------------------------------------------------------
+// host extensions
+//------------------------------------------------------------------------------
+
+const uint16_t *hostDisplayPixels(void) {
+	return hostDisplay;
+}
+
+uint32_t hostDisplayFrames(void) {
+	return hostFrames;
+}
+
+uint64_t hostDisplayBytes(void) {
+	return hostBytes;
+}
+
+bool hostDisplayWritePpm(const char *filename) {
+	FILE *file = fopen(filename,"wb");
+	if (file == NULL) return false;
+	fprintf(file,"P6\n%i %i\n255\n",DISP_WIDTH,DISP_HEIGHT);
+	for (uint16_t i = 0; i < DISP_WIDTH * DISP_HEIGHT; i++) {
+		// expand 5/6/5 bits to 8 bits by repeating the upper bits
+		uint8_t r = (hostDisplay[i] >> 11) & 0x1f;
+		uint8_t g = (hostDisplay[i] >> 5) & 0x3f;
+		uint8_t b = hostDisplay[i] & 0x1f;
+		uint8_t rgb[3] = { (uint8_t)((r << 3) | (r >> 2)), (uint8_t)((g << 2) | (g >> 4)), (uint8_t)((b << 3) | (b >> 2)) };
+		fwrite(rgb,1,3,file);
+	}
+	return fclose(file) == 0;
+}
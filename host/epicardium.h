@@ -0,0 +1,133 @@
+#ifndef _EPICARDIUM_H
+#define _EPICARDIUM_H
+/**
+ * @file
+ * @author Frank Abelbeck <frank.abelbeck@googlemail.com>
+ * @version 2026-10-14
+ * 
+ * @section License
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * @section Description
+ * 
+ * Host shim of the Epicardium API: the subset used by the library, so that
+ * it builds and runs on a desktop system (cf. host/Makefile).
+ * 
+ * File functions map to the host's file system, relative to the working
+ * directory. Display functions do not drive any hardware; instead, they
+ * capture what would be shown: every epic_disp_framebuffer() or
+ * epic_disp_update() completes a frame, and hostDisplayPixels() returns the
+ * display contents in screen coordinates. Time is taken from the host's
+ * monotonic clock.
+ */
+
+#include <stdint.h> // uses: int16_t, uint8_t, uint16_t, uint32_t, uint64_t
+#include <stddef.h> // uses: size_t
+#include <stdbool.h> // uses: bool
+#include <errno.h> // uses: ENOENT, EBADF, EMFILE, EINVAL
+
+//------------------------------------------------------------------------------
+// constants
+//------------------------------------------------------------------------------
+#define DISP_WIDTH  160 ///< display width in pixels
+#define DISP_HEIGHT 80  ///< display height in pixels
+
+#define HOST_MAX_FILES 16 ///< maximum number of simultaneously open files
+
+//------------------------------------------------------------------------------
+// data structures
+//------------------------------------------------------------------------------
+
+/** Framebuffer as expected by the display: pixels in reversed order, RGB565 big endian. */
+union disp_framebuffer {
+	uint16_t fb[DISP_HEIGHT][DISP_WIDTH]; ///< Coordinate based access.
+	uint8_t  raw[DISP_HEIGHT*DISP_WIDTH*2]; ///< Raw buffer access.
+};
+
+/** Pixel formats of epic_disp_blit(). */
+enum epic_rgb_format {
+	EPIC_RGB8,
+	EPIC_RGBA8,
+	EPIC_RGB565,
+	EPIC_RGBA5551,
+};
+
+/** Types of file system entries. */
+enum epic_stat_type {
+	EPICSTAT_NONE,
+	EPICSTAT_FILE,
+	EPICSTAT_DIR,
+};
+
+/** Result of epic_file_stat(). */
+struct epic_stat {
+	enum epic_stat_type type; ///< Type of the entry.
+	uint32_t size; ///< Size in bytes.
+	char name[256]; ///< Name of the entry (unused by the shim).
+	uint8_t _reserved[12];
+};
+
+//------------------------------------------------------------------------------
+// Epicardium API subset
+//------------------------------------------------------------------------------
+
+int epic_file_open(const char *filename, const char *modeString);
+int epic_file_close(int fd);
+int epic_file_read(int fd, void *buf, size_t nbytes);
+int epic_file_write(int fd, const void *buf, size_t nbytes);
+int epic_file_seek(int fd, long offset, int whence);
+int epic_file_tell(int fd);
+int epic_file_stat(const char *path, struct epic_stat *stat);
+
+int epic_disp_open(void);
+int epic_disp_close(void);
+int epic_disp_update(void);
+int epic_disp_framebuffer(union disp_framebuffer *fb);
+int epic_disp_blit(int16_t x, int16_t y, int16_t width, int16_t height, void *img, enum epic_rgb_format format);
+
+uint64_t epic_rtc_get_milliseconds(void);
+int epic_sleep(uint32_t ms);
+void epic_exit(int ret);
+
+//------------------------------------------------------------------------------
+// host extensions
+//------------------------------------------------------------------------------
+
+/** Return the captured display contents.
+ * 
+ * @returns A pointer to DISP_WIDTH * DISP_HEIGHT RGB565 pixels, row by row in screen coordinates.
+ */
+const uint16_t *hostDisplayPixels(void);
+
+/** Return the number of frames completed so far.
+ * 
+ * @returns Number of calls of epic_disp_framebuffer() and epic_disp_update().
+ */
+uint32_t hostDisplayFrames(void);
+
+/** Return the number of bytes transferred to the display so far.
+ * 
+ * @returns Sum of all framebuffer and blit transfers in bytes.
+ */
+uint64_t hostDisplayBytes(void);
+
+/** Write the captured display contents as binary portable pixmap (PPM).
+ * 
+ * @param filename Name of the file to be written.
+ * @returns True on success.
+ */
+bool hostDisplayWritePpm(const char *filename);
+
+#endif // _EPICARDIUM_H
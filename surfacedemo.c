@@ -28,6 +28,7 @@
 #include "faSurfacePP.h" // custom bitmap surface lib (perspective projection)
 #include "faFramebuffer.h" // custom framebuffer access lib
 #include "faReadPng.h" // custom PNG reader lib
+#include "faScene.h" // custom scene compositor lib
 
 #include "epicardium.h" // card10 API access
 #include "FreeRTOS.h" // needed for access to vTaskDelay() and pdMS_TO_TICKS() in FreeRTOS SDK
@@ -51,6 +52,8 @@ int main(int argc, char **argv) {
 	MatrixPP matrixPP;
 	Point p;
 	Surface *background, *frontbuffer, *sprite, *logo; 
+	Scene *scene;
+	SceneLayer *layerTitle;
 	BoundingBox bbSprite;
 	int16_t scale,x,y,alpha,angle;
 	int8_t dx,dy,dalpha,dangle,dscale;
@@ -76,7 +79,7 @@ int main(int argc, char **argv) {
 	
 	// set up stars background
 	printf("creating background surface\n");
-	background = pngDataLoad("png/stars.png");
+	background = pngDataLoadCached("png/stars.png");
 	if (background == NULL) {
 		printf("could not set-up background surface\n");
 		surfaceModDestruct(&mask);
@@ -97,7 +100,7 @@ int main(int argc, char **argv) {
 	
 	// set up the opening title
 	printf("loading title image\n");
-	sprite = pngDataLoad("png/title.png");
+	sprite = pngDataLoadCached("png/title.png");
 	if (sprite == NULL) {
 		printf("could not set-up title sprite surface\n");
 		surfaceModDestruct(&mask);
@@ -106,26 +109,42 @@ int main(int argc, char **argv) {
 		surfaceDestruct(&frontbuffer);
 		epic_exit(1);
 	}
+	
+	// mostly transparent sprites: run tables let blending skip transparent pixels
+	surfaceBuildRuns(sprite);
+	
+	// the title is composited by a scene: only the area of the shrinking title is redrawn
+	printf("creating title scene\n");
+	scene = sceneConstruct(2,0x0000);
+	if (scene == NULL) {
+		printf("could not set-up title scene\n");
+		surfaceModDestruct(&mask);
+		framebufferDestruct(&framebuffer);
+		surfaceDestruct(&background);
+		surfaceDestruct(&frontbuffer);
+		surfaceDestruct(&sprite);
+		epic_exit(1);
+	}
+	sceneAddSurface(scene,background,createPoint(0,0),BLEND_OVER);
+	layerTitle = sceneAddSprite(scene,sprite,getMatrixTranslate(0,0),255,BLEND_OVER);
+	
 	printf("loop: star wars titles...\n");
 	for (scale = 1024; scale >= 0; scale -= 8) {
 		matrix = getMatrixTranslate(-sprite->width/2,-sprite->height/2);
 		matrix = mulMatrixMatrix(getMatrixScale(scale,scale),matrix);
 		matrix = mulMatrixMatrix(getMatrixTranslate(80,40),matrix);
 		
-		if (scale > 255)
-			compose(background,sprite,frontbuffer,matrix,255,BLEND_OVER,boundingBoxGet(sprite),mask);
-		else
-			compose(background,sprite,frontbuffer,matrix,scale,BLEND_OVER,boundingBoxGet(sprite),mask);
-		
-		framebufferCopySurface(framebuffer,frontbuffer);
-		framebufferRedraw(framebuffer);
-		surfaceCopyMask(background,frontbuffer,mask);
+		sceneLayerSetMatrix(layerTitle,matrix);
+		sceneLayerSetAlpha(layerTitle,(scale > 255) ? 255 : scale);
+		sceneRender(scene,framebuffer,mask);
+		framebufferRedrawMask(framebuffer,mask);
 		surfaceModClear(mask);
 	}
 	
+	sceneDestruct(&scene);
 	surfaceDestruct(&sprite);
 	printf("loading text image\n");
-	sprite = pngDataLoad("png/text.png");
+	sprite = pngDataLoadCached("png/text.png");
 	if (sprite == NULL) {
 		printf("could not set-up text sprite surface\n");
 		surfaceModDestruct(&mask);
@@ -153,7 +172,7 @@ int main(int argc, char **argv) {
 	
 	surfaceDestruct(&sprite);
 	printf("loading sprite image\n");
-	sprite = pngDataLoad("png/sprite.png");
+	sprite = pngDataLoadCached("png/sprite.png");
 	if (sprite == NULL) {
 		printf("could not set-up sprite surface\n");
 		surfaceModDestruct(&mask);
@@ -163,7 +182,7 @@ int main(int argc, char **argv) {
 		epic_exit(1);
 	}
 	printf("loading logo image\n");
-	logo = pngDataLoad("png/sprite-logo.png");
+	logo = pngDataLoadCached("png/sprite-logo.png");
 	if (logo == NULL) {
 		printf("could not set-up logo sprite surface\n");
 		surfaceModDestruct(&mask);
@@ -174,6 +193,9 @@ int main(int argc, char **argv) {
 		epic_exit(1);
 	}
 	
+	surfaceBuildRuns(sprite);
+	surfaceBuildRuns(logo);
+	
 	x = 21;
 	y = 42;
 	angle = 0;
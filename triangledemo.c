@@ -1,7 +1,7 @@
 /**
  * @file
  * @author Frank Abelbeck <frank.abelbeck@googlemail.com>
- * @version 2020-02-17
+ * @version 2026-10-14
  * 
  * @section License
  * 
@@ -29,6 +29,8 @@
 #include "faSurface.h" // custom bitmap surface lib
 #include "faFramebuffer.h" // custom framebuffer access lib
 #include "faReadPng.h" // custom PNG reader lib
+#include "faMesh.h" // custom triangle mesh lib
+#include "faProfile.h" // optional profiling (compile with -DFAPROFILE)
 
 
 #define CAM_DX DISP_WIDTH/2
@@ -38,10 +40,8 @@
 #define CAM_SX 1024
 #define CAM_SY 1024
 
+#define TRIANGLEDEMO_FPS 30 // target frame rate; the presenter sleeps between frames
 
-typedef struct {
-	int32_t x,y,z;
-} Point3D;
 
 typedef struct {
 	uint8_t  p0,p1,p2,p3;
@@ -50,27 +50,6 @@ typedef struct {
 } Triangle;
 
 
-// apply rotation according to the yaw-pitch-roll convention:
-//  1st rotate around z by yaw
-//  2nd rotate around y' by pitch
-//  3rd rotate around x'' by roll
-Point3D rotate3D(Point3D p, int16_t roll, int16_t pitch, int16_t yaw) {
-	int16_t cosRoll   = surfaceCosine(roll);
-	int16_t cosPitch = surfaceCosine(pitch);
-	int16_t cosYaw   = surfaceCosine(yaw);
-	int16_t sinRoll   = surfaceSine(roll);
-	int16_t sinPitch = surfaceSine(pitch);
-	int16_t sinYaw   = surfaceSine(yaw);
-	Point3D result;
-	result.x = p.x * (cosPitch*cosYaw) + p.y * (-cosRoll*sinYaw + ((sinRoll*sinPitch*cosYaw)>>10)) + p.z * (sinRoll*sinYaw + ((cosRoll*sinPitch*cosYaw)>>10));
-	result.y = p.x * (cosPitch*sinYaw) + p.y * (cosRoll*cosYaw + ((sinRoll*sinPitch*sinYaw)>>10))  + p.z * (-sinRoll*cosYaw + ((cosRoll*sinPitch*sinYaw)>>10));
-	result.z = p.x * (-sinPitch << 10) + p.y * (sinRoll*cosPitch)                                 + p.z * (cosRoll*cosPitch);
-	result.x >>= 20;
-	result.y >>= 20;
-	result.z >>= 20;
-	return result;
-}
-
 Point3D normaliseVector(Point3D p) {
 	int64_t norm2 = p.x*p.x + p.y*p.y + p.z*p.z;
 	int32_t norm = 0;
@@ -116,45 +95,51 @@ Point3D crossProduct(Point3D a, Point3D b) {
 }
 
 
-void doCleanExit(char *reason, int numError, union disp_framebuffer **framebuffer, Surface **background, Surface **frontbuffer, SurfaceMod **mask) {
+void doCleanExit(char *reason, int numError, Presenter **presenter, Surface **background, Surface **frontbuffer, SurfaceMod **mask, Mesh **mesh) {
 	printf("%s\n",reason);
-	framebufferDestruct(framebuffer);
+	presenterDestruct(presenter);
 	surfaceDestruct(background);
 	surfaceDestruct(frontbuffer);
 	surfaceModDestruct(mask);
+	if (*mesh != NULL) meshDestruct(mesh);
 	epic_exit(numError);
 }
 
 
 int main(int argc, char **argv) {
-	union disp_framebuffer *framebuffer = NULL;
+	Presenter *presenter = NULL;
 	SurfaceMod *mask = NULL;
 	Surface *background = NULL;
 	Surface *frontbuffer = NULL; 
+	Mesh *mesh = NULL;
 	
 	printf("starting triangledemo...\n");
+	PROFILE_INIT();
 	
 	// prepare surface update mask
 	printf("creating update mask\n");
 	mask = surfaceModConstruct(DISP_HEIGHT);
-	if (mask == NULL) doCleanExit("could not set up update mask",-1,&framebuffer,&background,&frontbuffer,&mask);
+	if (mask == NULL) doCleanExit("could not set up update mask",-1,&presenter,&background,&frontbuffer,&mask,&mesh);
 	
-	// prepare framebuffer and sprite
-	printf("creating framebuffer\n");
-	framebuffer = framebufferConstruct(0);
-	if (framebuffer == NULL) doCleanExit("could not set up framebuffer",-1,&framebuffer,&background,&frontbuffer,&mask);
+	// prepare framebuffer: single-buffered (transfers block on current firmware), paced to TRIANGLEDEMO_FPS
+	printf("creating presenter\n");
+	presenter = presenterConstruct(0,TRIANGLEDEMO_FPS,false);
+	if (presenter == NULL) doCleanExit("could not set up presenter",-1,&presenter,&background,&frontbuffer,&mask,&mesh);
 	
 	// set up stars background
 	printf("creating background surface\n");
-	background = pngDataLoad("png/stars.png");
-	if (background == NULL) doCleanExit("could not set up background surface",-1,&framebuffer,&background,&frontbuffer,&mask);
+	background = pngDataLoadCached("png/stars.png");
+	if (background == NULL) doCleanExit("could not set up background surface",-1,&presenter,&background,&frontbuffer,&mask,&mesh);
 	
 	// set up front buffer surface
 	printf("creating frontbuffer surface\n");
 	frontbuffer = surfaceClone(background);
-	if (frontbuffer == NULL) doCleanExit("could not set up frontbuffer surface",-1,&framebuffer,&background,&frontbuffer,&mask);
+	if (frontbuffer == NULL) doCleanExit("could not set up frontbuffer surface",-1,&presenter,&background,&frontbuffer,&mask,&mesh);
 	
 	// prepare vertices of the cube
+	printf("creating cube mesh\n");
+	mesh = meshConstruct(8,12);
+	if (mesh == NULL) doCleanExit("could not set up cube mesh",-1,&presenter,&background,&frontbuffer,&mask,&mesh);
 	Point3D vertices[8] = {
 		{ 1024, 1024, 1024}, // 0
 		{-1024, 1024, 1024}, // 1
@@ -168,7 +153,9 @@ int main(int argc, char **argv) {
 	
 	// prepare cube faces: assign vertices to faces
 	// note: order of vertices determines face normal direction since crossproduct of p0p1 and p0p2 is used
-	// applying the right-hand rule, those normals should point outward
+	// applying the right-hand rule, those normals should point outward; seen from
+	// outside, p0p1p2 and p1p3p2 then appear counter-clockwise on the display,
+	// i.e. they are front faces of the mesh
 	Triangle triangles[6] = {
 		{0,2,4,6,MKRGB565(255,  0,  0),255},
 		{1,5,3,7,MKRGB565(255,255,  0),255},
@@ -178,6 +165,21 @@ int main(int argc, char **argv) {
 		{4,6,5,7,MKRGB565(255,  0,255),255}
 	};
 	
+	// each face is split into the mesh triangles p0p1p2 and p1p3p2
+	uint8_t k;
+	for (k=0; k<8; k++) mesh->vertices[k] = vertices[k];
+	for (k=0; k<6; k++) {
+		mesh->indices[6*k]   = triangles[k].p0;
+		mesh->indices[6*k+1] = triangles[k].p1;
+		mesh->indices[6*k+2] = triangles[k].p2;
+		mesh->indices[6*k+3] = triangles[k].p1;
+		mesh->indices[6*k+4] = triangles[k].p3;
+		mesh->indices[6*k+5] = triangles[k].p2;
+	}
+	
+	// naive projection: divide x and y by z, scale and shift output (see CAM_* defs)
+	MeshCamera camera = {CAM_DX,CAM_DY,CAM_SX,CAM_SY,1};
+	
 	// light source: assume one vector, valid for all surfaces, i.e. like the sun
 	// note: shading is done with the dot product; the angle between surface normals
 	// and the light vector determines the amount of shading
@@ -188,7 +190,6 @@ int main(int argc, char **argv) {
 	Point3D lightSource = {0,0,-1024};
 	
 	// pre-calculate face normals (for shading)
-	uint8_t k;
 	Point3D normals[6];
 	for (k=0; k<6; k++) {
 		normals[k] = normaliseVector(
@@ -200,7 +201,7 @@ int main(int argc, char **argv) {
 	}
 	
 	Point3D p,pLight;
-	Point p0,p1,p2,p3;
+	Matrix3D rotation;
 	uint16_t colour;
 	uint8_t alpha;
 	int16_t shading;
@@ -223,24 +224,14 @@ int main(int argc, char **argv) {
 	bool doShading = true;
 	
 	while (1) {
+		rotation = getMatrix3DRotate(roll,pitch,yaw);
+		if (doShading) pLight = mulMatrix3DPoint3D(getMatrix3DRotate(0,pitchLight,0),lightSource);
 		for (k=0; k<6; k++) {
-			// first, check visibility of the cube face:
-			// rotate face normal and calculate dot product to estimate
-			// the cosine of the angle between face normal and camera normal
-			// since we have a fixed camera looking into z direction, the normals
-			// should look out of the z-plane, i.e. be parallel with (0,0,-1024),
-			// this is dot product is reduced to -p.z * 1024 / 1024 = -p.z = cos angle;
-			// visibile = cos angle = -p.z > 0 (i.e. -90 < angle < 90)
-			// => p.z < 0 (*(-1) on both sides)
-			// => continue with next iteration if p.x >= 0
-			p = rotate3D(normals[k],yaw,pitch,roll);
-			if (p.z >= 0) continue; // break since angle outside (-90,90)
-			
-			// calculate shading value: dot product of normal and light vector,
+			// calculate shading value: dot product of rotated normal and light vector,
 			// scaled to 0..255, because it is used as an alpha value to map
 			// the colour black onto the cube face's colour
 			if (doShading) {
-				pLight = rotate3D(lightSource,0,pitchLight,0);
+				p = mulMatrix3DPoint3D(rotation,normals[k]);
 				shading = surfaceArcusCosine((p.x * pLight.x + p.y * pLight.y + p.z * pLight.z) >> 10);
 				if (shading >= 90) shading = 255; else shading = 255*shading/90;
 				surfacePixelBlend(0,shading,triangles[k].colour,triangles[k].alpha,&colour,&alpha,BLEND_OVER);
@@ -248,43 +239,21 @@ int main(int argc, char **argv) {
 				colour = triangles[k].colour;
 				alpha = triangles[k].alpha;
 			}
-			
-			// get transformed coordinates of this cube face
-			// naive projection: divide x and y by z, scale and shift output (see CAM_* defs)
-			p = rotate3D(vertices[triangles[k].p0],roll,pitch,yaw);
-			p.z += CAM_DZ;
-			if (p.z == 0) continue;
-			p0.x = CAM_DX + CAM_SX * p.x / p.z;
-			p0.y = CAM_DY + CAM_SY * p.y / p.z;
-			
-			p = rotate3D(vertices[triangles[k].p1],roll,pitch,yaw);
-			p.z += CAM_DZ;
-			if (p.z == 0) continue;
-			p1.x = CAM_DX + CAM_SX * p.x / p.z;
-			p1.y = CAM_DY + CAM_SY * p.y / p.z;
-			
-			p = rotate3D(vertices[triangles[k].p2],roll,pitch,yaw);
-			p.z += CAM_DZ;
-			if (p.z == 0) continue;
-			p2.x = CAM_DX + CAM_SX * p.x / p.z;
-			p2.y = CAM_DY + CAM_SY * p.y / p.z;
-			
-			p = rotate3D(vertices[triangles[k].p3],roll,pitch,yaw);
-			p.z += CAM_DZ;
-			if (p.z == 0) continue;
-			p3.x = CAM_DX + CAM_SX * p.x / p.z;
-			p3.y = CAM_DY + CAM_SY * p.y / p.z;
-			
-			// draw triangles (2 per face)
-			surfaceDrawTriangle(frontbuffer,p0,p1,p2,colour,alpha,BLEND_OVER,mask);
-			surfaceDrawTriangle(frontbuffer,p1,p2,p3,colour,alpha,BLEND_OVER,mask);
+			mesh->colour[2*k] = mesh->colour[2*k+1] = colour;
+			mesh->alpha[2*k]  = mesh->alpha[2*k+1]  = alpha;
 		}
 		
-		// update framebuffer
-		framebufferCopySurface(framebuffer,frontbuffer);
-		framebufferRedraw(framebuffer);
+		// draw cube: move it away from the camera and let the mesh renderer
+		// skip faces pointing away from the camera (replaces the normal test)
+		rotation.zw = CAM_DZ;
+		meshDraw(frontbuffer,mesh,rotation,camera,MESH_CULL_BACK,BLEND_OVER,mask);
+		
+		// update framebuffer: every pixel is rewritten, then the frame is sent when due
+		framebufferCopySurface(presenterBegin(presenter,true),frontbuffer);
+		presenterPresent(presenter,NULL);
 		surfaceCopyMask(background,frontbuffer,mask);
 		surfaceModClear(mask);
+		PROFILE_FRAME();
 		
 		buttons = epic_buttons_read(BUTTON_LEFT_BOTTOM | BUTTON_RIGHT_BOTTOM | BUTTON_LEFT_TOP | BUTTON_RIGHT_TOP);
 		buttonsPressed = (buttonsOld ^ buttons) & buttons;
@@ -318,6 +287,7 @@ int main(int argc, char **argv) {
 	}
 	
 	// clean up and exit
-	doCleanExit("exiting triangledemo",0,&framebuffer,&background,&frontbuffer,&mask);
+	PROFILE_PRINT();
+	doCleanExit("exiting triangledemo",0,&presenter,&background,&frontbuffer,&mask,&mesh);
 	return 0;
 }